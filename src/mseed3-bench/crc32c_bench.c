@@ -0,0 +1,104 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libmseed.h>
+
+#include <mseed3-common/crc32c.h>
+
+/* Buffer sizes covering small records, typical records and bulk data */
+static const size_t bench_sizes[] = {64, 512, 4096, 65536, 1048576};
+
+/* Total bytes checksummed per size and kernel */
+#define BENCH_BYTES (256u * 1024u * 1024u)
+
+static double
+now_seconds (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Time one kernel over a buffer of the given size, returns GB/s */
+static double
+bench_kernel (const char *kernel, const uint8_t *buffer, size_t size, uint32_t *result)
+{
+  size_t rounds = BENCH_BYTES / size;
+  uint32_t crc  = 0;
+  double start;
+
+  start = now_seconds ();
+
+  for (size_t i = 0; i < rounds; i++)
+  {
+    if (kernel == NULL)
+      crc = ms_crc32c ((const uint8_t *)buffer, (int)size, crc);
+    else
+      crc = mseed3_crc32c (buffer, size, crc);
+  }
+
+  *result = crc;
+
+  return ((double)rounds * (double)size) / (now_seconds () - start) / 1e9;
+}
+
+int
+main (void)
+{
+  static const char *kernels[] = {"table", "sse4.2", "pclmul"};
+  size_t max_size = bench_sizes[sizeof (bench_sizes) / sizeof (bench_sizes[0]) - 1];
+  uint8_t *buffer;
+
+  if ((buffer = (uint8_t *)malloc (max_size)) == NULL)
+  {
+    fprintf (stderr, "Cannot allocate benchmark buffer\n");
+    return EXIT_FAILURE;
+  }
+
+  srand (42);
+  for (size_t i = 0; i < max_size; i++)
+  {
+    buffer[i] = (uint8_t)rand ();
+  }
+
+  printf ("Default kernel: %s\n", mseed3_crc32c_kernel ());
+  printf ("%-10s %10s %10s %12s\n", "kernel", "size", "GB/s", "crc");
+
+  for (size_t s = 0; s < sizeof (bench_sizes) / sizeof (bench_sizes[0]); s++)
+  {
+    uint32_t reference;
+    double rate = bench_kernel (NULL, buffer, bench_sizes[s], &reference);
+
+    printf ("%-10s %10zu %10.2f   0x%08X\n", "libmseed", bench_sizes[s], rate, reference);
+
+    for (size_t k = 0; k < sizeof (kernels) / sizeof (kernels[0]); k++)
+    {
+      uint32_t crc;
+
+      if (mseed3_crc32c_select (kernels[k]) < 0)
+      {
+        printf ("%-10s %10zu %10s\n", kernels[k], bench_sizes[s], "n/a");
+        continue;
+      }
+
+      rate = bench_kernel (kernels[k], buffer, bench_sizes[s], &crc);
+
+      printf ("%-10s %10zu %10.2f   0x%08X%s\n", kernels[k], bench_sizes[s], rate, crc,
+              (crc == reference) ? "" : "  MISMATCH");
+
+      if (crc != reference)
+      {
+        free (buffer);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  free (buffer);
+
+  return EXIT_SUCCESS;
+}
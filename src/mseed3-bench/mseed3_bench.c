@@ -0,0 +1,773 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <mseed3-common/array.h>
+#include <mseed3-common/constants.h>
+#include <mseed3-common/crc32c.h>
+#include <mseed3-common/steim.h>
+
+#include <mseed3-validator/report.h>
+#include <mseed3-validator/schema_registry.h>
+#include <mseed3-validator/validator.h>
+#include <mseed3-validator/warnings.h>
+
+/* Each stage is repeated over the whole scaled dataset for at least this long */
+#define BENCH_MIN_SECONDS 0.5
+
+/* Default number of copies of the reference datasets */
+#define BENCH_DEFAULT_SCALE 1000
+
+/* Default throughput drop tolerated against the baseline, in percent */
+#define BENCH_DEFAULT_TOLERANCE 10.0
+
+/* Name of the scaled dataset written for the tool stages */
+#define BENCH_SCALED_FILE "mseed3-bench-scaled.ms3"
+
+#define BENCH_HEADER_LEN 40
+
+/* One record of the scaled dataset */
+struct bench_record_s
+{
+  const char *record;
+  uint32_t length;
+  uint32_t number_samples;
+  uint32_t payload_offset;
+  uint32_t payload_len;
+  uint16_t extra_offset;
+  uint16_t extra_len;
+  uint8_t encoding;
+};
+
+/* Scaled dataset, the reference records repeated scale times */
+struct bench_data_s
+{
+  char *buffer;
+  uint64_t length;
+  struct bench_record_s *records;
+  uint32_t record_cnt;
+  uint32_t max_samples;
+  int32_t *samples;
+
+  /* Extra headers are checked as by mseed3-validator, events are dropped */
+  const char *schema_file;
+  struct schema_registry_s *schema;
+  struct extra_options_s options;
+  struct report_s sink;
+  struct validator_context_s *context;
+
+  char *scaled_path;
+  const char *tool_dir;
+};
+
+/* Work done by one pass of a stage */
+struct bench_count_s
+{
+  uint64_t records;
+  uint64_t bytes;
+};
+
+/* Timing of one stage, also read back from a baseline */
+struct bench_result_s
+{
+  char name[32];
+  uint64_t records;
+  uint64_t bytes;
+  double seconds;
+  double records_per_second;
+  double mb_per_second;
+};
+
+typedef bool (*bench_pass_f) (struct bench_data_s *data, const void *arg, struct bench_count_s *count);
+
+/* Tool run on the scaled dataset, output discarded, schema is true to pass -j with the schema */
+struct bench_tool_s
+{
+  const char *stage;
+  const char *tool;
+  const char *option;
+  bool schema;
+};
+
+static const struct bench_tool_s bench_tools[] = {{"validator", "mseed3-validator", NULL, true},
+                                                  {"json", "mseed3-json", NULL, false},
+                                                  {"json-data", "mseed3-json", "-d", false},
+                                                  {"text", "mseed3-text", NULL, false},
+                                                  {"text-data", "mseed3-text", "-d", false}};
+
+static double
+now_seconds (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t
+read_uint32 (const uint8_t *field)
+{
+  return field[0] | (field[1] << 8) | (field[2] << 16) | ((uint32_t)field[3] << 24);
+}
+
+static int
+compare_names (const void *a, const void *b)
+{
+  return strcmp (*(char *const *)a, *(char *const *)b);
+}
+
+/* Append the contents of a regular file to a growing buffer */
+static int
+append_file (const char *path, char **buffer, uint64_t *length)
+{
+  struct stat info;
+  FILE *file;
+  char *grown;
+
+  if (stat (path, &info) || !S_ISREG (info.st_mode))
+  {
+    return 0;
+  }
+
+  if ((file = fopen (path, "rb")) == NULL ||
+      (grown = (char *)realloc (*buffer, *length + (uint64_t)info.st_size)) == NULL)
+  {
+    fprintf (stderr, "Cannot read %s\n", path);
+    if (file)
+      fclose (file);
+    return -1;
+  }
+
+  *buffer = grown;
+  if (fread (*buffer + *length, 1, info.st_size, file) != (size_t)info.st_size)
+  {
+    fprintf (stderr, "Cannot read %s\n", path);
+    fclose (file);
+    return -1;
+  }
+
+  *length += info.st_size;
+  fclose (file);
+
+  return 0;
+}
+
+/*! @brief Read every file of a directory, in name order, into one buffer
+ *
+ *  @param[in] dir_name directory holding the reference datasets
+ *  @param[out] buffer concatenated file contents, to be freed by the caller
+ *  @param[out] length bytes in buffer
+ *
+ *  @return 0 on success, -1 on error
+ */
+static int
+load_reference (const char *dir_name, char **buffer, uint64_t *length)
+{
+  DIR *dir;
+  struct dirent *entry;
+  char **names    = NULL;
+  size_t name_cnt = 0;
+  char path[4096];
+  int rv = 0;
+
+  if ((dir = opendir (dir_name)) == NULL)
+  {
+    fprintf (stderr, "Cannot open reference dataset directory %s\n", dir_name);
+    return -1;
+  }
+
+  while ((entry = readdir (dir)) != NULL)
+  {
+    if (entry->d_name[0] == '.')
+      continue;
+
+    names             = (char **)realloc (names, (name_cnt + 1) * sizeof (char *));
+    names[name_cnt++] = strdup (entry->d_name);
+  }
+  closedir (dir);
+
+  if (name_cnt > 0)
+    qsort (names, name_cnt, sizeof (char *), compare_names);
+
+  *buffer = NULL;
+  *length = 0;
+
+  for (size_t i = 0; i < name_cnt; i++)
+  {
+    snprintf (path, sizeof (path), "%s/%s", dir_name, names[i]);
+    if (rv == 0)
+      rv = append_file (path, buffer, length);
+    free (names[i]);
+  }
+  free (names);
+
+  if (rv == 0 && *length == 0)
+  {
+    fprintf (stderr, "No reference datasets found in %s\n", dir_name);
+    rv = -1;
+  }
+
+  return rv;
+}
+
+/*! @brief Repeat the reference records and index the result
+ *
+ *  @param[out] data scaled dataset
+ *  @param[in] reference concatenated reference records
+ *  @param[in] reference_len bytes in reference
+ *  @param[in] scale number of copies
+ *
+ *  @return 0 on success, -1 if the reference records are malformed
+ */
+static int
+build_dataset (struct bench_data_s *data, const char *reference, uint64_t reference_len, uint32_t scale)
+{
+  uint64_t offset  = 0;
+  int record_alloc = 0;
+
+  if ((data->buffer = (char *)malloc (reference_len * scale)) == NULL)
+  {
+    fprintf (stderr, "Cannot allocate %" PRIu64 " bytes for the scaled dataset\n", reference_len * scale);
+    return -1;
+  }
+
+  for (uint32_t i = 0; i < scale; i++)
+  {
+    memcpy (data->buffer + i * reference_len, reference, reference_len);
+  }
+  data->length = reference_len * scale;
+
+  while (offset < data->length)
+  {
+    const uint8_t *header = (const uint8_t *)data->buffer + offset;
+    struct bench_record_s *record;
+
+    if (data->length - offset < BENCH_HEADER_LEN || header[0] != 'M' || header[1] != 'S' || header[2] != 3)
+    {
+      fprintf (stderr, "Reference datasets hold something other than miniSEED 3 records at offset %" PRIu64 "\n",
+               offset % reference_len);
+      return -1;
+    }
+
+    if (record_alloc <= (int)data->record_cnt &&
+        (record_alloc = expand_array ((void **)&data->records, record_alloc, sizeof (struct bench_record_s))) < 0)
+    {
+      fprintf (stderr, "Cannot allocate the record table of the scaled dataset\n");
+      return -1;
+    }
+
+    record                 = &data->records[data->record_cnt++];
+    record->record         = (const char *)header;
+    record->encoding       = header[15];
+    record->number_samples = read_uint32 (header + 24);
+    record->extra_offset   = BENCH_HEADER_LEN + header[33];
+    record->extra_len      = header[34] | (header[35] << 8);
+    record->payload_offset = record->extra_offset + record->extra_len;
+    record->payload_len    = read_uint32 (header + 36);
+    record->length         = record->payload_offset + record->payload_len;
+
+    if (record->length > data->length - offset)
+    {
+      fprintf (stderr, "Truncated record in the reference datasets at offset %" PRIu64 "\n", offset % reference_len);
+      return -1;
+    }
+
+    if (record->number_samples > data->max_samples)
+      data->max_samples = record->number_samples;
+
+    offset += record->length;
+  }
+
+  data->samples = (int32_t *)malloc ((data->max_samples + 1) * sizeof (int32_t));
+
+  return 0;
+}
+
+/* Walk the records by their fixed header lengths only */
+static bool
+pass_header_scan (struct bench_data_s *data, const void *arg, struct bench_count_s *count)
+{
+  uint64_t offset = 0;
+
+  while (offset + BENCH_HEADER_LEN <= data->length)
+  {
+    const uint8_t *header = (const uint8_t *)data->buffer + offset;
+
+    if (header[0] != 'M' || header[1] != 'S' || header[2] != 3)
+      return false;
+
+    offset += BENCH_HEADER_LEN + header[33] + (header[34] | (header[35] << 8)) + read_uint32 (header + 36);
+    count->records++;
+  }
+
+  count->bytes += offset;
+
+  return offset == data->length;
+}
+
+static bool
+pass_crc (struct bench_data_s *data, const void *arg, struct bench_count_s *count)
+{
+  for (uint32_t i = 0; i < data->record_cnt; i++)
+  {
+    const struct bench_record_s *record = &data->records[i];
+
+    if (mseed3_record_crc (record->record, record->length) != mseed3_record_stored_crc (record->record))
+      return false;
+
+    count->records++;
+    count->bytes += record->length;
+  }
+
+  return true;
+}
+
+/* Decode the records of one Steim encoding, arg points at the encoding */
+static bool
+pass_steim (struct bench_data_s *data, const void *arg, struct bench_count_s *count)
+{
+  uint8_t encoding = *(const uint8_t *)arg;
+  int version      = (encoding == MSEED3_STEIM1) ? 1 : 2;
+
+  for (uint32_t i = 0; i < data->record_cnt; i++)
+  {
+    const struct bench_record_s *record = &data->records[i];
+
+    if (record->encoding != encoding)
+      continue;
+
+    if (mseed3_steim_decode (record->record + record->payload_offset, record->payload_len, version,
+                             record->number_samples, data->samples) < 0)
+      return false;
+
+    count->records++;
+    count->bytes += record->length;
+  }
+
+  return true;
+}
+
+/* Events of the validation context, only the verdicts are of interest */
+static void
+drop_event (void *client, enum report_check_e check, enum report_severity_e severity, const char *message)
+{
+  return;
+}
+
+/* Parse the extra headers and, given a schema, validate them as mseed3-validator does.
+ * Every header is validated, the valid verdicts mseed3-validator remembers would
+ * otherwise turn the repeated reference records into lookups */
+static bool
+pass_extra_headers (struct bench_data_s *data, const void *arg, struct bench_count_s *count)
+{
+  for (uint32_t i = 0; i < data->record_cnt; i++)
+  {
+    const struct bench_record_s *record = &data->records[i];
+
+    if (record->extra_len == 0)
+      continue;
+
+    /* Invalid extra headers are verdicts on the data, not failures of the stage */
+    check_extra_headers_schema (data->context, record->record + record->extra_offset, record->extra_len);
+
+    count->records++;
+    count->bytes += record->length;
+  }
+
+  return true;
+}
+
+/* Run one of bench_tools on the scaled dataset, arg points at the tool */
+static bool
+pass_tool (struct bench_data_s *data, const void *arg, struct bench_count_s *count)
+{
+  const struct bench_tool_s *tool = (const struct bench_tool_s *)arg;
+  char path[4096];
+  const char *argv[6];
+  int argc = 0;
+  int status;
+  pid_t pid;
+
+  snprintf (path, sizeof (path), "%s/%s", data->tool_dir, tool->tool);
+  argv[argc++] = path;
+  if (tool->option)
+    argv[argc++] = tool->option;
+  if (tool->schema && data->schema_file)
+  {
+    argv[argc++] = "-j";
+    argv[argc++] = data->schema_file;
+  }
+  argv[argc++] = data->scaled_path;
+  argv[argc]   = NULL;
+
+  if ((pid = fork ()) < 0)
+    return false;
+
+  if (pid == 0)
+  {
+    int null_fd = open ("/dev/null", O_WRONLY);
+
+    dup2 (null_fd, STDOUT_FILENO);
+    dup2 (null_fd, STDERR_FILENO);
+    execv (path, (char *const *)argv);
+    _exit (127);
+  }
+
+  if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    return false;
+
+  count->records += data->record_cnt;
+  count->bytes += data->length;
+
+  return true;
+}
+
+/*! @brief Time a stage over the scaled dataset
+ *
+ *  Passes are repeated until BENCH_MIN_SECONDS have elapsed.
+ *
+ *  @param[in] data scaled dataset
+ *  @param[in] name stage name
+ *  @param[in] pass one pass over the dataset
+ *  @param[in] arg passed through to pass
+ *  @param[out] result timing of the stage
+ *
+ *  @return true if every pass succeeded and did some work
+ */
+static bool
+bench_stage (struct bench_data_s *data, const char *name, bench_pass_f pass, const void *arg,
+             struct bench_result_s *result)
+{
+  struct bench_count_s count = {0, 0};
+  double start, elapsed;
+
+  memset (result, 0, sizeof (*result));
+  snprintf (result->name, sizeof (result->name), "%s", name);
+
+  start = now_seconds ();
+  do
+  {
+    if (!pass (data, arg, &count))
+    {
+      fprintf (stderr, "Stage %s failed\n", name);
+      return false;
+    }
+    elapsed = now_seconds () - start;
+  } while (elapsed < BENCH_MIN_SECONDS && count.records > 0);
+
+  if (count.records == 0)
+    return false;
+
+  result->records            = count.records;
+  result->bytes              = count.bytes;
+  result->seconds            = elapsed;
+  result->records_per_second = (double)count.records / elapsed;
+  result->mb_per_second      = (double)count.bytes / elapsed / 1e6;
+
+  return true;
+}
+
+/*! @brief Write stage results as JSON
+ *
+ *  Each stage is kept on a line of its own so read_results() can read the
+ *  file back as a baseline.
+ *
+ *  @return 0 on success, -1 on error
+ */
+static int
+write_results (const char *path, uint32_t scale, const struct bench_data_s *data,
+               const struct bench_result_s *results, int result_cnt)
+{
+  FILE *file;
+
+  if ((file = fopen (path, "w")) == NULL)
+  {
+    fprintf (stderr, "Cannot write %s\n", path);
+    return -1;
+  }
+
+  fprintf (file, "{\n  \"scale\": %" PRIu32 ",\n  \"records\": %" PRIu32 ",\n  \"bytes\": %" PRIu64 ",\n",
+           scale, data->record_cnt, data->length);
+  fprintf (file, "  \"crc32c_kernel\": \"%s\",\n  \"steim_kernel\": \"%s\",\n  \"stages\": [\n",
+           mseed3_crc32c_kernel (), mseed3_steim_decode_kernel ());
+
+  for (int i = 0; i < result_cnt; i++)
+  {
+    fprintf (file,
+             "    {\"stage\": \"%s\", \"records\": %" PRIu64 ", \"bytes\": %" PRIu64
+             ", \"seconds\": %.6f, \"records_per_second\": %.1f, \"mb_per_second\": %.3f}%s\n",
+             results[i].name, results[i].records, results[i].bytes, results[i].seconds,
+             results[i].records_per_second, results[i].mb_per_second, (i + 1 < result_cnt) ? "," : "");
+  }
+
+  fprintf (file, "  ]\n}\n");
+
+  return fclose (file) ? -1 : 0;
+}
+
+/*! @brief Read the stage lines of a results file written by write_results()
+ *
+ *  @param[in] path results file
+ *  @param[out] results stages found, to be freed by the caller
+ *
+ *  @return number of stages, -1 if the file cannot be read
+ */
+static int
+read_results (const char *path, struct bench_result_s **results)
+{
+  FILE *file;
+  char line[1024];
+  const char *field;
+  int result_cnt = 0;
+
+  *results = NULL;
+  if ((file = fopen (path, "r")) == NULL)
+  {
+    return -1;
+  }
+
+  while (fgets (line, sizeof (line), file))
+  {
+    struct bench_result_s result;
+
+    memset (&result, 0, sizeof (result));
+    if ((field = strstr (line, "\"stage\": \"")) == NULL ||
+        sscanf (field, "\"stage\": \"%31[^\"]\"", result.name) != 1 ||
+        (field = strstr (line, "\"mb_per_second\": ")) == NULL ||
+        sscanf (field, "\"mb_per_second\": %lf", &result.mb_per_second) != 1)
+    {
+      continue;
+    }
+
+    if ((field = strstr (line, "\"records_per_second\": ")) != NULL)
+      sscanf (field, "\"records_per_second\": %lf", &result.records_per_second);
+
+    *results                 = (struct bench_result_s *)realloc (*results, (result_cnt + 1) * sizeof (result));
+    (*results)[result_cnt++] = result;
+  }
+  fclose (file);
+
+  return result_cnt;
+}
+
+static void
+usage (const char *program)
+{
+  fprintf (stderr,
+           "Usage: %s -d reference-dir [-s scale] [-j schema] [-T tool-dir] [-w work-dir]\n"
+           "          [-o results.json] [-b baseline.json] [-t tolerance-percent] [-u]\n"
+           "  -d  directory of miniSEED 3 reference datasets\n"
+           "  -s  copies of the reference datasets to time, default %d\n"
+           "  -j  extra header JSON schema, also given to mseed3-validator, headers are only parsed without it\n"
+           "  -T  directory holding mseed3-validator, mseed3-json and mseed3-text\n"
+           "  -w  directory for the scaled dataset used by the tools, default .\n"
+           "  -o  write results as JSON\n"
+           "  -b  compare with a baseline results file, written if it does not exist\n"
+           "  -t  throughput drop tolerated against the baseline, default %.0f%%\n"
+           "  -u  replace the baseline with these results\n",
+           program, BENCH_DEFAULT_SCALE, BENCH_DEFAULT_TOLERANCE);
+}
+
+int
+main (int argc, char **argv)
+{
+  static const uint8_t steim1 = MSEED3_STEIM1;
+  static const uint8_t steim2 = MSEED3_STEIM2;
+  struct bench_data_s data;
+  struct bench_result_s results[16];
+  struct bench_result_s *baseline = NULL;
+  int result_cnt                  = 0;
+  int baseline_cnt                = -1;
+  int regressions                 = 0;
+  const char *reference_dir       = NULL;
+  const char *work_dir            = ".";
+  const char *results_file        = NULL;
+  const char *baseline_file       = NULL;
+  double tolerance                = BENCH_DEFAULT_TOLERANCE;
+  bool update_baseline            = false;
+  int scale                       = BENCH_DEFAULT_SCALE;
+  int rv                          = EXIT_SUCCESS;
+  char *reference;
+  uint64_t reference_len;
+  FILE *file;
+  int opt;
+
+  memset (&data, 0, sizeof (data));
+
+  while ((opt = getopt (argc, argv, "d:s:j:T:w:o:b:t:u")) != -1)
+  {
+    switch (opt)
+    {
+    case 'd':
+      reference_dir = optarg;
+      break;
+    case 's':
+      scale = atoi (optarg);
+      break;
+    case 'j':
+      data.schema_file = optarg;
+      break;
+    case 'T':
+      data.tool_dir = optarg;
+      break;
+    case 'w':
+      work_dir = optarg;
+      break;
+    case 'o':
+      results_file = optarg;
+      break;
+    case 'b':
+      baseline_file = optarg;
+      break;
+    case 't':
+      tolerance = atof (optarg);
+      break;
+    case 'u':
+      update_baseline = true;
+      break;
+    default:
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (reference_dir == NULL || scale < 1 || tolerance < 0)
+  {
+    usage (argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (load_reference (reference_dir, &reference, &reference_len) < 0 ||
+      build_dataset (&data, reference, reference_len, scale) < 0)
+  {
+    return EXIT_FAILURE;
+  }
+  free (reference);
+
+  /* The schema and every schema it references, loaded once as by mseed3-validator */
+  report_collect (&data.sink, 0, drop_event, NULL);
+  data.options.jobs = 1;
+
+  if (data.schema_file && (data.schema = schema_registry_open (data.schema_file, &data.sink, 0)) == NULL)
+  {
+    fprintf (stderr, "Cannot load schema %s\n", data.schema_file);
+    return EXIT_FAILURE;
+  }
+
+  if ((data.context = validator_context_open (&data.options, data.schema, &data.sink, 0)) == NULL)
+  {
+    fprintf (stderr, "Cannot allocate a validation context\n");
+    return EXIT_FAILURE;
+  }
+
+  printf ("%" PRIu32 " records, %.1f MB (%d copies of %s)\n", data.record_cnt, (double)data.length / 1e6, scale,
+          reference_dir);
+
+  /* In process stages, the building blocks shared by the tools */
+  if (!bench_stage (&data, "header-scan", pass_header_scan, NULL, &results[result_cnt]))
+    rv = EXIT_FAILURE;
+  else
+    result_cnt++;
+
+  if (!bench_stage (&data, "crc", pass_crc, NULL, &results[result_cnt]))
+    rv = EXIT_FAILURE;
+  else
+    result_cnt++;
+
+  if (bench_stage (&data, "steim1-decode", pass_steim, &steim1, &results[result_cnt]))
+    result_cnt++;
+
+  if (bench_stage (&data, "steim2-decode", pass_steim, &steim2, &results[result_cnt]))
+    result_cnt++;
+
+  if (bench_stage (&data, data.schema ? "extra-header-schema" : "extra-header-parse", pass_extra_headers, NULL,
+                   &results[result_cnt]))
+    result_cnt++;
+
+  /* Whole tools on the scaled dataset written to a file */
+  if (data.tool_dir)
+  {
+    size_t path_len  = strlen (work_dir) + sizeof (BENCH_SCALED_FILE) + 1;
+    data.scaled_path = (char *)malloc (path_len);
+    snprintf (data.scaled_path, path_len, "%s/%s", work_dir, BENCH_SCALED_FILE);
+
+    if ((file = fopen (data.scaled_path, "wb")) == NULL || fwrite (data.buffer, 1, data.length, file) != data.length ||
+        fclose (file))
+    {
+      fprintf (stderr, "Cannot write %s\n", data.scaled_path);
+      return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < sizeof (bench_tools) / sizeof (bench_tools[0]); i++)
+    {
+      if (!bench_stage (&data, bench_tools[i].stage, pass_tool, &bench_tools[i], &results[result_cnt]))
+        rv = EXIT_FAILURE;
+      else
+        result_cnt++;
+    }
+
+    unlink (data.scaled_path);
+    free (data.scaled_path);
+  }
+
+  if (baseline_file && !update_baseline)
+    baseline_cnt = read_results (baseline_file, &baseline);
+
+  printf ("%-20s %12s %10s %14s %10s  %s\n", "stage", "records", "MB", "records/s", "MB/s", "vs baseline");
+  for (int i = 0; i < result_cnt; i++)
+  {
+    char change[32] = "";
+
+    for (int j = 0; j < baseline_cnt; j++)
+    {
+      double ratio;
+
+      if (strcmp (baseline[j].name, results[i].name) || baseline[j].mb_per_second <= 0)
+        continue;
+
+      ratio = results[i].mb_per_second / baseline[j].mb_per_second;
+      snprintf (change, sizeof (change), "%+.1f%%%s", (ratio - 1) * 100,
+                (ratio < 1 - tolerance / 100) ? "  REGRESSION" : "");
+      if (ratio < 1 - tolerance / 100)
+        regressions++;
+    }
+
+    printf ("%-20s %12" PRIu64 " %10.1f %14.0f %10.1f  %s\n", results[i].name, results[i].records,
+            (double)results[i].bytes / 1e6, results[i].records_per_second, results[i].mb_per_second, change);
+  }
+
+  if (results_file && write_results (results_file, scale, &data, results, result_cnt) < 0)
+    rv = EXIT_FAILURE;
+
+  /* A missing baseline is established by this run */
+  if (baseline_file && baseline_cnt < 0)
+  {
+    if (write_results (baseline_file, scale, &data, results, result_cnt) < 0)
+      rv = EXIT_FAILURE;
+    else
+      printf ("Baseline written to %s\n", baseline_file);
+  }
+  else if (regressions > 0)
+  {
+    printf ("%d stage(s) below the %s baseline by more than %.0f%%\n", regressions, baseline_file, tolerance);
+    rv = EXIT_FAILURE;
+  }
+
+  validator_context_close (data.context);
+  schema_registry_close (data.schema);
+  free (baseline);
+  free (data.records);
+  free (data.samples);
+  free (data.buffer);
+
+  return rv;
+}
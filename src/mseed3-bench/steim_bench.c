@@ -0,0 +1,105 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mseed3-common/constants.h>
+#include <mseed3-common/steim.h>
+
+/* Total samples decoded per kernel */
+#define BENCH_SAMPLES (200u * 1000u * 1000u)
+
+static double
+now_seconds (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const char *kernels[] = {"scalar", "sse4.1", "avx2"};
+  uint8_t header[40];
+  uint32_t number_samples, payload_len, skip_len;
+  int32_t *reference, *samples;
+  char *payload;
+  FILE *input;
+  int version;
+
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: %s steim-record-file\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if ((input = fopen (argv[1], "rb")) == NULL ||
+      fread (header, 1, sizeof (header), input) != sizeof (header))
+  {
+    fprintf (stderr, "Cannot read %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  if (header[15] != MSEED3_STEIM1 && header[15] != MSEED3_STEIM2)
+  {
+    fprintf (stderr, "First record of %s is not Steim encoded\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  version        = (header[15] == MSEED3_STEIM1) ? 1 : 2;
+  number_samples = header[24] | (header[25] << 8) | (header[26] << 16) | ((uint32_t)header[27] << 24);
+  skip_len       = header[33] + (header[34] | (header[35] << 8));
+  payload_len    = header[36] | (header[37] << 8) | (header[38] << 16) | ((uint32_t)header[39] << 24);
+
+  payload   = (char *)malloc (payload_len);
+  reference = (int32_t *)malloc (number_samples * sizeof (int32_t));
+  samples   = (int32_t *)malloc (number_samples * sizeof (int32_t));
+
+  if (payload == NULL || reference == NULL || samples == NULL || fseek (input, skip_len, SEEK_CUR) ||
+      fread (payload, 1, payload_len, input) != payload_len)
+  {
+    fprintf (stderr, "Cannot read payload of %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  fclose (input);
+
+  mseed3_steim_decode_select ("scalar");
+  if (mseed3_steim_decode (payload, payload_len, version, number_samples, reference) < 0)
+  {
+    fprintf (stderr, "Cannot decode Steim-%d payload of %s\n", version, argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  printf ("Steim-%d, %u samples per record\n", version, number_samples);
+  printf ("%-8s %14s\n", "kernel", "Msamples/s");
+
+  for (size_t k = 0; k < sizeof (kernels) / sizeof (kernels[0]); k++)
+  {
+    uint32_t rounds = BENCH_SAMPLES / number_samples;
+    double start;
+
+    if (mseed3_steim_decode_select (kernels[k]) < 0)
+    {
+      printf ("%-8s %14s\n", kernels[k], "n/a");
+      continue;
+    }
+
+    start = now_seconds ();
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+      mseed3_steim_decode (payload, payload_len, version, number_samples, samples);
+    }
+
+    printf ("%-8s %14.1f%s\n", kernels[k], (double)rounds * number_samples / (now_seconds () - start) / 1e6,
+            memcmp (samples, reference, number_samples * sizeof (int32_t)) ? "  MISMATCH" : "");
+  }
+
+  free (payload);
+  free (reference);
+  free (samples);
+
+  return EXIT_SUCCESS;
+}
@@ -5,7 +5,12 @@ enum error_codes_e
 {
     MSEED3_SEEK_ERROR = -1,
     MSEED3_BAD_INPUT = -2,
-    MSEED3_MALLOC_ERROR = -3
+    MSEED3_MALLOC_ERROR = -3,
+    MSEED3_READ_ERROR = -4,
+    MSEED3_WRITE_ERROR = -5,
+    MSEED3_NOT_FOUND = -6,
+    MSEED3_NOT_REGULAR = -7,
+    MSEED3_OPEN_ERROR = -8
 };
 
 enum data_encodings_e
@@ -0,0 +1,357 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <mseed3-common/config.h>
+
+#include "crc32c.h"
+
+/* The kernel is picked once, also when the first CRCs are computed on several threads */
+#if defined(HAVE_PTHREAD) && !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <pthread.h>
+#define MSEED3_CRC32C_ONCE 1
+#endif
+
+/* Hardware kernels need GCC/Clang target attributes and 64-bit crc32 instructions */
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#define MSEED3_CRC32C_X86 1
+#endif
+
+/* Castagnoli polynomial, bit reflected */
+#define CRC32C_POLY 0x82F63B78u
+
+/* Block sizes of the three interleaved streams in the PCLMULQDQ kernel */
+#define CRC32C_LONG_BLOCK 2048
+#define CRC32C_SHORT_BLOCK 256
+
+typedef uint32_t (*crc32c_kernel_f) (uint32_t crc, const uint8_t *data, size_t len);
+
+static uint32_t crc32c_table_kernel (uint32_t crc, const uint8_t *data, size_t len);
+
+static uint32_t crc32c_table[8][256];
+static bool crc32c_table_ready = false;
+
+static crc32c_kernel_f crc32c_kernel = NULL;
+static const char *crc32c_kernel_name = NULL;
+
+#ifdef MSEED3_CRC32C_ONCE
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+#endif
+
+/* Multiply a bit reflected polynomial by x^n modulo the CRC polynomial */
+static uint32_t
+crc32c_xpow (uint32_t value, uint64_t n)
+{
+  while (n--)
+  {
+    value = (value >> 1) ^ ((value & 1) ? CRC32C_POLY : 0);
+  }
+  return value;
+}
+
+/* Fill the slicing-by-8 tables, safe to repeat as it always writes the same values */
+static void
+crc32c_init_table (void)
+{
+  if (crc32c_table_ready)
+  {
+    return;
+  }
+
+  for (uint32_t n = 0; n < 256; n++)
+  {
+    uint32_t crc = n;
+
+    for (int k = 0; k < 8; k++)
+    {
+      crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+    }
+    crc32c_table[0][n] = crc;
+  }
+
+  for (uint32_t n = 0; n < 256; n++)
+  {
+    for (int k = 1; k < 8; k++)
+    {
+      crc32c_table[k][n] = (crc32c_table[k - 1][n] >> 8) ^ crc32c_table[0][crc32c_table[k - 1][n] & 0xFF];
+    }
+  }
+
+  crc32c_table_ready = true;
+}
+
+/* Portable slicing-by-8 kernel, 8 table lookups per 8 bytes on little-endian hosts */
+static uint32_t
+crc32c_table_kernel (uint32_t crc, const uint8_t *data, size_t len)
+{
+  const uint16_t endian_test = 1;
+
+  if (*(const uint8_t *)&endian_test == 1)
+  {
+    while (len >= 8)
+    {
+      uint64_t word;
+
+      memcpy (&word, data, sizeof (word));
+      word ^= crc;
+
+      crc = crc32c_table[7][word & 0xFF] ^
+            crc32c_table[6][(word >> 8) & 0xFF] ^
+            crc32c_table[5][(word >> 16) & 0xFF] ^
+            crc32c_table[4][(word >> 24) & 0xFF] ^
+            crc32c_table[3][(word >> 32) & 0xFF] ^
+            crc32c_table[2][(word >> 40) & 0xFF] ^
+            crc32c_table[1][(word >> 48) & 0xFF] ^
+            crc32c_table[0][word >> 56];
+
+      data += 8;
+      len -= 8;
+    }
+  }
+
+  while (len--)
+  {
+    crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *data++) & 0xFF];
+  }
+
+  return crc;
+}
+
+#ifdef MSEED3_CRC32C_X86
+/* Single stream SSE4.2 crc32 instruction kernel */
+__attribute__ ((target ("sse4.2"))) static uint32_t
+crc32c_sse42_kernel (uint32_t crc, const uint8_t *data, size_t len)
+{
+  uint64_t crc64 = crc;
+
+  while (len >= 8)
+  {
+    uint64_t word;
+
+    memcpy (&word, data, sizeof (word));
+    crc64 = _mm_crc32_u64 (crc64, word);
+    data += 8;
+    len -= 8;
+  }
+
+  crc = (uint32_t)crc64;
+
+  while (len--)
+  {
+    crc = _mm_crc32_u8 (crc, *data++);
+  }
+
+  return crc;
+}
+
+/* Constants shifting a CRC across one and two blocks, x^(8 * bytes - 33) mod P */
+static uint32_t crc32c_shift_long[2];
+static uint32_t crc32c_shift_short[2];
+
+/* Advance a CRC over len zero bytes using a precomputed shift constant */
+__attribute__ ((target ("sse4.2,pclmul"))) static inline uint64_t
+crc32c_shift (uint64_t crc, uint32_t constant)
+{
+  __m128i product = _mm_clmulepi64_si128 (_mm_cvtsi32_si128 ((int)crc), _mm_cvtsi32_si128 ((int)constant), 0);
+
+  return _mm_crc32_u64 (0, (uint64_t)_mm_cvtsi128_si64 (product));
+}
+
+/* Three interleaved crc32 streams over consecutive blocks, hiding the latency of
+ * the instruction, merged by carry-less multiplication with PCLMULQDQ */
+__attribute__ ((target ("sse4.2,pclmul"))) static uint32_t
+crc32c_pclmul_kernel (uint32_t crc, const uint8_t *data, size_t len)
+{
+  static const size_t blocks[2]    = {CRC32C_LONG_BLOCK, CRC32C_SHORT_BLOCK};
+  const uint32_t *shifts[2]        = {crc32c_shift_long, crc32c_shift_short};
+  uint64_t crc0                    = crc;
+
+  for (int tier = 0; tier < 2; tier++)
+  {
+    size_t block = blocks[tier];
+
+    while (len >= 3 * block)
+    {
+      uint64_t crc1 = 0;
+      uint64_t crc2 = 0;
+
+      for (size_t pos = 0; pos < block; pos += 8)
+      {
+        uint64_t word0, word1, word2;
+
+        memcpy (&word0, data + pos, sizeof (word0));
+        memcpy (&word1, data + block + pos, sizeof (word1));
+        memcpy (&word2, data + 2 * block + pos, sizeof (word2));
+
+        crc0 = _mm_crc32_u64 (crc0, word0);
+        crc1 = _mm_crc32_u64 (crc1, word1);
+        crc2 = _mm_crc32_u64 (crc2, word2);
+      }
+
+      crc0 = crc32c_shift (crc0, shifts[tier][1]) ^ crc32c_shift (crc1, shifts[tier][0]) ^ crc2;
+
+      data += 3 * block;
+      len -= 3 * block;
+    }
+  }
+
+  return crc32c_sse42_kernel ((uint32_t)crc0, data, len);
+}
+#endif
+
+/* Pick the fastest kernel supported by the running processor */
+static void
+crc32c_dispatch (void)
+{
+  crc32c_init_table ();
+
+#ifdef MSEED3_CRC32C_X86
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("sse4.2") && __builtin_cpu_supports ("pclmul"))
+  {
+    mseed3_crc32c_select ("pclmul");
+    return;
+  }
+
+  if (__builtin_cpu_supports ("sse4.2"))
+  {
+    mseed3_crc32c_select ("sse4.2");
+    return;
+  }
+#endif
+
+  mseed3_crc32c_select ("table");
+}
+
+/*! @brief Pick the CRC-32C kernel and fill its tables
+ *
+ *  Done by the first CRC computed otherwise.  Call it before starting
+ *  threads that compute CRCs, so that they only read the kernel and tables.
+ *  Safe to call any number of times, from any thread.
+ */
+void
+mseed3_crc32c_init (void)
+{
+#ifdef MSEED3_CRC32C_ONCE
+  pthread_once (&crc32c_once, crc32c_dispatch);
+#else
+  if (crc32c_kernel == NULL)
+  {
+    crc32c_dispatch ();
+  }
+#endif
+}
+
+/*! @brief Force a specific CRC-32C kernel, mainly for benchmarking
+ *
+ *  @param[in] kernel one of "table", "sse4.2" or "pclmul"
+ *
+ *  @return 0 on success, -1 if the kernel is unknown or not supported here
+ */
+int
+mseed3_crc32c_select (const char *kernel)
+{
+  crc32c_init_table ();
+
+  if (0 == strcmp (kernel, "table"))
+  {
+    crc32c_kernel_name = "table";
+    crc32c_kernel      = crc32c_table_kernel;
+    return 0;
+  }
+
+#ifdef MSEED3_CRC32C_X86
+  __builtin_cpu_init ();
+
+  if (0 == strcmp (kernel, "sse4.2") && __builtin_cpu_supports ("sse4.2"))
+  {
+    crc32c_kernel_name = "sse4.2";
+    crc32c_kernel      = crc32c_sse42_kernel;
+    return 0;
+  }
+
+  if (0 == strcmp (kernel, "pclmul") && __builtin_cpu_supports ("sse4.2") && __builtin_cpu_supports ("pclmul"))
+  {
+    crc32c_shift_long[0]  = crc32c_xpow (0x80000000u, 8 * CRC32C_LONG_BLOCK - 33);
+    crc32c_shift_long[1]  = crc32c_xpow (0x80000000u, 2 * 8 * CRC32C_LONG_BLOCK - 33);
+    crc32c_shift_short[0] = crc32c_xpow (0x80000000u, 8 * CRC32C_SHORT_BLOCK - 33);
+    crc32c_shift_short[1] = crc32c_xpow (0x80000000u, 2 * 8 * CRC32C_SHORT_BLOCK - 33);
+
+    crc32c_kernel_name = "pclmul";
+    crc32c_kernel      = crc32c_pclmul_kernel;
+    return 0;
+  }
+#endif
+
+  return -1;
+}
+
+/*! @brief Name of the CRC-32C kernel in use
+ *
+ */
+const char *
+mseed3_crc32c_kernel (void)
+{
+  if (crc32c_kernel == NULL)
+  {
+    mseed3_crc32c_init ();
+  }
+
+  return crc32c_kernel_name;
+}
+
+/*! @brief Compute or continue a CRC-32C (Castagnoli) checksum
+ *
+ *  @param[in] data bytes to checksum
+ *  @param[in] len number of bytes
+ *  @param[in] crc CRC of the preceding data, 0 to start a new checksum
+ *
+ *  @return CRC-32C of all data so far
+ */
+uint32_t
+mseed3_crc32c (const void *data, size_t len, uint32_t crc)
+{
+  if (crc32c_kernel == NULL)
+  {
+    mseed3_crc32c_init ();
+  }
+
+  return ~crc32c_kernel (~crc, (const uint8_t *)data, len);
+}
+
+/*! @brief Compute the CRC of a miniSEED 3 record
+ *
+ *  The CRC is calculated over the whole record with the CRC field itself
+ *  taken as zero, without modifying the record.
+ *
+ *  @param[in] record pointer to the start of the record
+ *  @param[in] record_len length of the record, at least the fixed header
+ *
+ */
+uint32_t
+mseed3_record_crc (const char *record, uint64_t record_len)
+{
+  static const uint8_t zero_crc[4] = {0, 0, 0, 0};
+  uint32_t crc;
+
+  crc = mseed3_crc32c (record, MSEED3_CRC_OFFSET, 0);
+  crc = mseed3_crc32c (zero_crc, sizeof (zero_crc), crc);
+  crc = mseed3_crc32c (record + MSEED3_CRC_OFFSET + 4, (size_t)(record_len - MSEED3_CRC_OFFSET - 4), crc);
+
+  return crc;
+}
+
+/*! @brief CRC stored in the fixed header of a miniSEED 3 record
+ *
+ */
+uint32_t
+mseed3_record_stored_crc (const char *record)
+{
+  const uint8_t *field = (const uint8_t *)record + MSEED3_CRC_OFFSET;
+
+  return (uint32_t)field[0] | ((uint32_t)field[1] << 8) | ((uint32_t)field[2] << 16) | ((uint32_t)field[3] << 24);
+}
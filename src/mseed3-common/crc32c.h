@@ -0,0 +1,22 @@
+#ifndef __MSEED3_COMMON_CRC32C_H__
+#define __MSEED3_COMMON_CRC32C_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Byte offset of the CRC field in the miniSEED 3 fixed header */
+#define MSEED3_CRC_OFFSET 28
+
+uint32_t mseed3_crc32c(const void *data, size_t len, uint32_t crc);
+
+uint32_t mseed3_record_crc(const char *record, uint64_t record_len);
+
+uint32_t mseed3_record_stored_crc(const char *record);
+
+void mseed3_crc32c_init(void);
+
+const char *mseed3_crc32c_kernel(void);
+
+int mseed3_crc32c_select(const char *kernel);
+
+#endif /* __MSEED3_COMMON_CRC32C_H__ */
@@ -0,0 +1,10 @@
+#ifndef __MSEED3_COMMON_DECODE_H__
+#define __MSEED3_COMMON_DECODE_H__
+
+#include <stdint.h>
+
+#include <libmseed.h>
+
+int64_t mseed3_decode_samples(MS3Record *msr, int8_t verbose);
+
+#endif /* __MSEED3_COMMON_DECODE_H__ */
@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include <libmseed.h>
+
+#include "constants.h"
+#include "decode.h"
+#include "steim.h"
+
+/*! @brief Decode the data samples of a parsed record
+ *
+ *  Steim1 and Steim2 payloads are decoded with the vector kernels in
+ *  steim_decode.c, every other encoding is left to msr3_unpack_data().  The
+ *  samples are stored in msr->datasamples exactly as libmseed would, reusing
+ *  the buffer of the previous record when it is large enough.
+ *
+ *  @param[in,out] msr record parsed without MSF_UNPACKDATA
+ *  @param[in] verbose verbosity level
+ *
+ *  @return number of samples decoded, negative libmseed error code on failure
+ */
+int64_t
+mseed3_decode_samples (MS3Record *msr, int8_t verbose)
+{
+  const char *payload;
+  uint64_t needed;
+  int64_t decoded;
+
+  if (msr->encoding != MSEED3_STEIM1 && msr->encoding != MSEED3_STEIM2)
+  {
+    return msr3_unpack_data (msr, verbose);
+  }
+
+  if (msr->samplecnt <= 0 || msr->samplecnt > UINT32_MAX || msr->record == NULL)
+  {
+    return MS_GENERROR;
+  }
+
+  payload = msr->record + msr->reclen - msr->datalength;
+  needed  = (uint64_t)msr->samplecnt * sizeof (int32_t);
+
+  if (msr->datasize < needed)
+  {
+    void *samples = libmseed_memory.realloc (msr->datasamples, needed);
+
+    if (samples == NULL)
+    {
+      fprintf (stderr, "%s: Cannot allocate memory for data samples\n", msr->sid);
+      return MS_GENERROR;
+    }
+
+    msr->datasamples = samples;
+    msr->datasize    = needed;
+  }
+
+  decoded = mseed3_steim_decode (payload, msr->datalength, (msr->encoding == MSEED3_STEIM1) ? 1 : 2,
+                                 (uint32_t)msr->samplecnt, (int32_t *)msr->datasamples);
+
+  if (decoded < 0)
+  {
+    fprintf (stderr, "%s: Cannot decode Steim-%d payload, %s\n", msr->sid,
+             (msr->encoding == MSEED3_STEIM1) ? 1 : 2, mseed3_steim_strerror ((int)-decoded));
+    msr->numsamples = 0;
+    return MS_STBADCOMPFLAG;
+  }
+
+  /* Same integrity check as libmseed, reported but not fatal */
+  if (((int32_t *)msr->datasamples)[decoded - 1] != mseed3_steim_decode_xn (payload))
+  {
+    fprintf (stderr, "%s: Warning: Data integrity check for Steim-%d failed, Last sample=%d, Xn=%d\n",
+             msr->sid, (msr->encoding == MSEED3_STEIM1) ? 1 : 2, ((int32_t *)msr->datasamples)[decoded - 1],
+             mseed3_steim_decode_xn (payload));
+  }
+
+  msr->numsamples = decoded;
+  msr->sampletype = 'i';
+
+  return decoded;
+}
@@ -2,15 +2,92 @@
 #define __MSEED3_COMMON_FILES_H__
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <fcntl.h>
+#elif !defined(AT_FDCWD)
+/* Only relative to the working directory without openat() */
+#define AT_FDCWD -100
+#endif
 
 bool mseed3_file_exists(char *pathname);
 
 bool mseed3_regular_file(char *pathname);
 
+int mseed3_open_file(int dirfd, const char *pathname, FILE **file);
+
 long mseed3_file_length(FILE *file);
 
 char * mseed3_get_dirname(char* path);
 
 char * mseed3_cat_strings(char *str1,char* str2);
 
+/* Read-only view of a whole file, see mseed3_map_file() */
+struct mseed3_file_map_s
+{
+    const char *data;
+    uint64_t length;
+    bool mapped;
+};
+
+int mseed3_map_file(FILE *file, struct mseed3_file_map_s *map);
+
+void mseed3_unmap_file(struct mseed3_file_map_s *map);
+
+void mseed3_release_file_range(const struct mseed3_file_map_s *map, const char *data, uint64_t length);
+
+/* Forward-only reader for input that cannot be mapped or seeked, see mseed3_stream_open() */
+struct mseed3_stream_s
+{
+    FILE *file;
+    char *data;
+    size_t alloc;
+    size_t fill;
+    uint64_t read;
+    uint64_t offset;
+    bool eof;
+    bool failed;
+};
+
+int mseed3_stream_open(FILE *file, struct mseed3_stream_s *stream);
+
+void mseed3_stream_close(struct mseed3_stream_s *stream);
+
+size_t mseed3_stream_fill(struct mseed3_stream_s *stream, size_t length);
+
+size_t mseed3_stream_read(struct mseed3_stream_s *stream, char *data, size_t length);
+
+int mseed3_stream_next(struct mseed3_stream_s *stream, uint64_t length);
+
+/* Compression detected from the leading bytes of an input */
+enum mseed3_compression_e
+{
+    MSEED3_COMPRESSION_NONE = 0,
+    MSEED3_COMPRESSION_GZIP,
+    MSEED3_COMPRESSION_XZ,
+    MSEED3_COMPRESSION_ZSTD
+};
+
+/* Input opened with mseed3_input_open(), decompressed on a worker thread when needed */
+struct mseed3_input_s
+{
+    FILE *file;
+    enum mseed3_compression_e compression;
+    char path[32];
+    struct mseed3_inflate_s *worker;
+};
+
+enum mseed3_compression_e mseed3_detect_compression(const unsigned char *magic, size_t length);
+
+const char *mseed3_compression_name(enum mseed3_compression_e compression);
+
+int mseed3_input_open(FILE *file, struct mseed3_input_s *input);
+
+const char *mseed3_input_path(struct mseed3_input_s *input, const char *file_name);
+
+int mseed3_input_close(struct mseed3_input_s *input);
+
 #endif /* __MSEED3_COMMON_FILES_H__ */
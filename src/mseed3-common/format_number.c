@@ -0,0 +1,750 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "format_number.h"
+
+/* Bits of the 5^i and 2^k / 5^i multipliers of the shortest round trip search, as in Ryu */
+#define POW5_BITCOUNT 125
+#define POW5_INV_BITCOUNT 125
+#define FLOAT_POW5_BITCOUNT (POW5_BITCOUNT - 64)
+#define FLOAT_POW5_INV_BITCOUNT (POW5_INV_BITCOUNT - 64)
+
+/* Powers of five needed for the whole double range */
+#define POW5_TABLE_SIZE 326
+#define POW5_INV_TABLE_SIZE 342
+
+/* 32-bit limbs holding 5^341 and twice it while the tables are built */
+#define POW5_LIMBS 26
+
+#define DOUBLE_MANTISSA_BITS 52
+#define DOUBLE_BIAS 1023
+#define FLOAT_MANTISSA_BITS 23
+#define FLOAT_BIAS 127
+
+/* Eight ASCII zeros, added to eight digit values at once */
+#define ASCII_ZEROS 0x3030303030303030ULL
+
+/* 5^i and 2^k / 5^i rounded up, as low and high 64-bit halves of 125 bits */
+static uint64_t pow5_split[POW5_TABLE_SIZE][2];
+static uint64_t pow5_inv_split[POW5_INV_TABLE_SIZE][2];
+static bool pow5_tables_ready = false;
+
+/* Number of bits of 5^e, 1 for e = 0 */
+static inline int32_t
+pow5bits (int32_t e)
+{
+  return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+/* floor (log10 (2^e)) */
+static inline uint32_t
+log10_pow2 (int32_t e)
+{
+  return ((uint32_t)e * 78913) >> 18;
+}
+
+/* floor (log10 (5^e)) */
+static inline uint32_t
+log10_pow5 (int32_t e)
+{
+  return ((uint32_t)e * 732923) >> 20;
+}
+
+/* Bit of a little-endian multi-limb number */
+static inline uint32_t
+big_bit (const uint32_t *big, int32_t bit)
+{
+  if (bit < 0 || bit >= POW5_LIMBS * 32)
+    return 0;
+  return (big[bit / 32] >> (bit % 32)) & 1;
+}
+
+/* 128 bits of a multi-limb number starting at bit shift, shifted left if shift is negative */
+static void
+big_window (const uint32_t *big, int32_t shift, uint64_t *window)
+{
+  window[0] = 0;
+  window[1] = 0;
+
+  for (int32_t bit = 0; bit < 128; bit++)
+  {
+    window[bit / 64] |= (uint64_t)big_bit (big, bit + shift) << (bit % 64);
+  }
+}
+
+/* Compare two multi-limb numbers */
+static int
+big_compare (const uint32_t *a, const uint32_t *b)
+{
+  for (int limb = POW5_LIMBS - 1; limb >= 0; limb--)
+  {
+    if (a[limb] != b[limb])
+      return (a[limb] < b[limb]) ? -1 : 1;
+  }
+  return 0;
+}
+
+/* Fill the multiplier tables once, safe to repeat as it always writes the same values */
+static void
+init_pow5_tables (void)
+{
+  uint32_t power[POW5_LIMBS] = {1};
+
+  if (pow5_tables_ready)
+  {
+    return;
+  }
+
+  for (int32_t i = 0; i < POW5_INV_TABLE_SIZE; i++)
+  {
+    int32_t bits = pow5bits (i);
+    uint32_t remainder[POW5_LIMBS] = {0};
+    uint64_t quotient[2]           = {0, 0};
+    uint64_t carry                 = 0;
+
+    if (i < POW5_TABLE_SIZE)
+    {
+      big_window (power, bits - POW5_BITCOUNT, pow5_split[i]);
+    }
+
+    /* 2^(bits - 1 + POW5_INV_BITCOUNT) / 5^i by long division, from the remainder 2^(bits - 1) */
+    remainder[(bits - 1) / 32] = 1u << ((bits - 1) % 32);
+
+    if (big_compare (remainder, power) >= 0)
+    {
+      memset (remainder, 0, sizeof (remainder));
+      quotient[0] = 1;
+    }
+
+    for (int32_t step = 0; step < POW5_INV_BITCOUNT; step++)
+    {
+      uint32_t borrow = 0;
+
+      for (int limb = POW5_LIMBS - 1; limb > 0; limb--)
+        remainder[limb] = (remainder[limb] << 1) | (remainder[limb - 1] >> 31);
+      remainder[0] <<= 1;
+
+      quotient[1] = (quotient[1] << 1) | (quotient[0] >> 63);
+      quotient[0] <<= 1;
+
+      if (big_compare (remainder, power) < 0)
+        continue;
+
+      for (int limb = 0; limb < POW5_LIMBS; limb++)
+      {
+        uint64_t difference = (uint64_t)remainder[limb] - power[limb] - borrow;
+
+        remainder[limb] = (uint32_t)difference;
+        borrow          = (uint32_t)(difference >> 63);
+      }
+      quotient[0] |= 1;
+    }
+
+    /* Rounded up */
+    pow5_inv_split[i][0] = quotient[0] + 1;
+    pow5_inv_split[i][1] = quotient[1] + (pow5_inv_split[i][0] == 0);
+
+    for (int limb = 0; limb < POW5_LIMBS; limb++)
+    {
+      carry += (uint64_t)power[limb] * 5;
+      power[limb] = (uint32_t)carry;
+      carry >>= 32;
+    }
+  }
+
+  pow5_tables_ready = true;
+}
+
+/* (m * mul) >> j for a 125-bit multiplier, 64 < j < 128 */
+static inline uint64_t
+mul_shift64 (uint64_t m, const uint64_t *mul, int32_t j)
+{
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 low  = (unsigned __int128)m * mul[0];
+  unsigned __int128 high = (unsigned __int128)m * mul[1];
+
+  return (uint64_t)(((low >> 64) + high) >> (j - 64));
+#else
+  uint64_t parts[2][2];
+  uint64_t sum_low, sum_high;
+
+  /* Both 64x64 bit products from 32-bit halves */
+  for (int half = 0; half < 2; half++)
+  {
+    uint64_t a_low   = (uint32_t)m, a_high = m >> 32;
+    uint64_t b_low   = (uint32_t)mul[half], b_high = mul[half] >> 32;
+    uint64_t low_low = a_low * b_low;
+    uint64_t middle1 = a_high * b_low + (low_low >> 32);
+    uint64_t middle2 = a_low * b_high + (uint32_t)middle1;
+
+    parts[half][0] = (middle2 << 32) | (uint32_t)low_low;
+    parts[half][1] = a_high * b_high + (middle1 >> 32) + (middle2 >> 32);
+  }
+
+  sum_low  = parts[0][1] + parts[1][0];
+  sum_high = parts[1][1] + (sum_low < parts[0][1]);
+
+  return (sum_high << (128 - j)) | (sum_low >> (j - 64));
+#endif
+}
+
+/* (m * factor) >> shift for the high half of a table multiplier, 32 < shift < 96 */
+static inline uint32_t
+mul_shift32 (uint32_t m, uint64_t factor, int32_t shift)
+{
+  uint64_t low  = (uint64_t)m * (uint32_t)factor;
+  uint64_t high = (uint64_t)m * (uint32_t)(factor >> 32);
+
+  return (uint32_t)(((low >> 32) + high) >> (shift - 32));
+}
+
+/* Number of times value divides by 5 */
+static inline uint32_t
+pow5_factor (uint64_t value)
+{
+  uint32_t count = 0;
+
+  while (value % 5 == 0)
+  {
+    value /= 5;
+    count++;
+  }
+  return count;
+}
+
+/* Shortest decimal digits and exponent within the rounding interval of a double, Ryu's d2d */
+static uint64_t
+shortest_double (uint64_t ieee_mantissa, uint32_t ieee_exponent, int32_t *exponent)
+{
+  int32_t e2;
+  uint64_t m2;
+  uint64_t mv, vr, vp, vm, output;
+  uint32_t mm_shift;
+  int32_t e10;
+  int32_t removed        = 0;
+  uint8_t last_removed   = 0;
+  bool vm_trailing_zeros = false;
+  bool vr_trailing_zeros = false;
+  bool accept_bounds;
+
+  if (ieee_exponent == 0)
+  {
+    e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+    m2 = ieee_mantissa;
+  }
+  else
+  {
+    e2 = (int32_t)ieee_exponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+    m2 = (1ULL << DOUBLE_MANTISSA_BITS) | ieee_mantissa;
+  }
+
+  /* Ties of the exact value go to the even mantissa, so bounds of even mantissas read back */
+  accept_bounds = (m2 & 1) == 0;
+  mv            = 4 * m2;
+  mm_shift      = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+  /* The value and the bounds of its interval scaled by a power of ten */
+  if (e2 >= 0)
+  {
+    uint32_t q = log10_pow2 (e2) - (e2 > 3);
+    int32_t k  = POW5_INV_BITCOUNT + pow5bits ((int32_t)q) - 1;
+    int32_t i  = -e2 + (int32_t)q + k;
+
+    e10 = (int32_t)q;
+    vr = mul_shift64 (mv, pow5_inv_split[q], i);
+    vp = mul_shift64 (mv + 2, pow5_inv_split[q], i);
+    vm = mul_shift64 (mv - 1 - mm_shift, pow5_inv_split[q], i);
+
+    if (q <= 21)
+    {
+      if (mv % 5 == 0)
+        vr_trailing_zeros = pow5_factor (mv) >= q;
+      else if (accept_bounds)
+        vm_trailing_zeros = pow5_factor (mv - 1 - mm_shift) >= q;
+      else
+        vp -= pow5_factor (mv + 2) >= q;
+    }
+  }
+  else
+  {
+    uint32_t q = log10_pow5 (-e2) - (-e2 > 1);
+    int32_t i  = -e2 - (int32_t)q;
+    int32_t k  = pow5bits (i) - POW5_BITCOUNT;
+    int32_t j  = (int32_t)q - k;
+
+    e10 = (int32_t)q + e2;
+    vr = mul_shift64 (mv, pow5_split[i], j);
+    vp = mul_shift64 (mv + 2, pow5_split[i], j);
+    vm = mul_shift64 (mv - 1 - mm_shift, pow5_split[i], j);
+
+    if (q <= 1)
+    {
+      vr_trailing_zeros = true;
+      if (accept_bounds)
+        vm_trailing_zeros = mm_shift == 1;
+      else
+        vp--;
+    }
+    else if (q < 63)
+    {
+      vr_trailing_zeros = (mv & ((1ULL << q) - 1)) == 0;
+    }
+  }
+
+  /* Drop digits while the bounds still differ, rounding the value on the last one dropped */
+  if (vm_trailing_zeros || vr_trailing_zeros)
+  {
+    while (vp / 10 > vm / 10)
+    {
+      vm_trailing_zeros &= vm % 10 == 0;
+      vr_trailing_zeros &= last_removed == 0;
+      last_removed = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+
+    if (vm_trailing_zeros)
+    {
+      while (vm % 10 == 0)
+      {
+        vr_trailing_zeros &= last_removed == 0;
+        last_removed = (uint8_t)(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        removed++;
+      }
+    }
+
+    if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+      last_removed = 4;
+
+    output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+  }
+  else
+  {
+    bool round_up = false;
+
+    while (vp / 10 > vm / 10)
+    {
+      round_up = vr % 10 >= 5;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+
+    output = vr + (vr == vm || round_up);
+  }
+
+  *exponent = e10 + removed;
+
+  return output;
+}
+
+/* Shortest decimal digits and exponent within the rounding interval of a float, Ryu's f2d */
+static uint32_t
+shortest_float (uint32_t ieee_mantissa, uint32_t ieee_exponent, int32_t *exponent)
+{
+  int32_t e2;
+  uint32_t m2;
+  uint32_t mv, mp, mm, vr, vp, vm, output;
+  uint32_t mm_shift;
+  int32_t e10;
+  int32_t removed        = 0;
+  uint8_t last_removed   = 0;
+  bool vm_trailing_zeros = false;
+  bool vr_trailing_zeros = false;
+  bool accept_bounds;
+
+  if (ieee_exponent == 0)
+  {
+    e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+    m2 = ieee_mantissa;
+  }
+  else
+  {
+    e2 = (int32_t)ieee_exponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+    m2 = (1u << FLOAT_MANTISSA_BITS) | ieee_mantissa;
+  }
+
+  accept_bounds = (m2 & 1) == 0;
+  mm_shift      = ieee_mantissa != 0 || ieee_exponent <= 1;
+  mv            = 4 * m2;
+  mp            = 4 * m2 + 2;
+  mm            = 4 * m2 - 1 - mm_shift;
+
+  if (e2 >= 0)
+  {
+    uint32_t q = log10_pow2 (e2);
+    int32_t k  = FLOAT_POW5_INV_BITCOUNT + pow5bits ((int32_t)q) - 1;
+    int32_t i  = -e2 + (int32_t)q + k;
+
+    e10 = (int32_t)q;
+    vr = mul_shift32 (mv, pow5_inv_split[q][1] + 1, i);
+    vp = mul_shift32 (mp, pow5_inv_split[q][1] + 1, i);
+    vm = mul_shift32 (mm, pow5_inv_split[q][1] + 1, i);
+
+    /* The digit below the last one kept is needed even if no digit is dropped below */
+    if (q != 0 && (vp - 1) / 10 <= vm / 10)
+    {
+      int32_t l = FLOAT_POW5_INV_BITCOUNT + pow5bits ((int32_t)q - 1) - 1;
+
+      last_removed = (uint8_t)(mul_shift32 (mv, pow5_inv_split[q - 1][1] + 1, -e2 + (int32_t)q - 1 + l) % 10);
+    }
+
+    if (q <= 9)
+    {
+      if (mv % 5 == 0)
+        vr_trailing_zeros = pow5_factor (mv) >= q;
+      else if (accept_bounds)
+        vm_trailing_zeros = pow5_factor (mm) >= q;
+      else
+        vp -= pow5_factor (mp) >= q;
+    }
+  }
+  else
+  {
+    uint32_t q = log10_pow5 (-e2);
+    int32_t i  = -e2 - (int32_t)q;
+    int32_t k  = pow5bits (i) - FLOAT_POW5_BITCOUNT;
+    int32_t j  = (int32_t)q - k;
+
+    e10 = (int32_t)q + e2;
+    vr = mul_shift32 (mv, pow5_split[i][1], j);
+    vp = mul_shift32 (mp, pow5_split[i][1], j);
+    vm = mul_shift32 (mm, pow5_split[i][1], j);
+
+    if (q != 0 && (vp - 1) / 10 <= vm / 10)
+    {
+      j            = (int32_t)q - 1 - (pow5bits (i + 1) - FLOAT_POW5_BITCOUNT);
+      last_removed = (uint8_t)(mul_shift32 (mv, pow5_split[i + 1][1], j) % 10);
+    }
+
+    if (q <= 1)
+    {
+      vr_trailing_zeros = true;
+      if (accept_bounds)
+        vm_trailing_zeros = mm_shift == 1;
+      else
+        vp--;
+    }
+    else if (q < 31)
+    {
+      vr_trailing_zeros = (mv & ((1u << (q - 1)) - 1)) == 0;
+    }
+  }
+
+  if (vm_trailing_zeros || vr_trailing_zeros)
+  {
+    while (vp / 10 > vm / 10)
+    {
+      vm_trailing_zeros &= vm % 10 == 0;
+      vr_trailing_zeros &= last_removed == 0;
+      last_removed = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+
+    if (vm_trailing_zeros)
+    {
+      while (vm % 10 == 0)
+      {
+        vr_trailing_zeros &= last_removed == 0;
+        last_removed = (uint8_t)(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        removed++;
+      }
+    }
+
+    if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+      last_removed = 4;
+
+    output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+  }
+  else
+  {
+    while (vp / 10 > vm / 10)
+    {
+      last_removed = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+
+    output = vr + (vr == vm || last_removed >= 5);
+  }
+
+  *exponent = e10 + removed;
+
+  return output;
+}
+
+/* Eight decimal digits of a value below 10^8 as byte values 0 to 9, the most significant in the
+ * lowest byte.  Both four digit halves are split into digit pairs and the pairs into digits
+ * in all lanes of one 64-bit word at once, dividing by 100 and by 10 with multiplications that
+ * are exact over the range of each lane */
+static inline uint64_t
+split_digits (uint32_t value)
+{
+  uint64_t merged   = (uint64_t)(value / 10000) | ((uint64_t)(value % 10000) << 32);
+  uint64_t hundreds = ((merged * 10486) >> 20) & 0x0000007F0000007FULL;
+  uint64_t pairs    = ((merged - 100 * hundreds) << 16) + hundreds;
+  uint64_t tens     = ((pairs * 103) >> 10) & 0x000F000F000F000FULL;
+
+  return tens + ((pairs - 10 * tens) << 8);
+}
+
+/* Store a word lowest byte first, compilers merge the stores into one on little-endian hosts */
+static inline void
+store_digits (char *text, uint64_t digits)
+{
+  for (int byte = 0; byte < 8; byte++)
+  {
+    text[byte] = (char)(digits >> (byte * 8));
+  }
+}
+
+/* Digits of a value below 10^8 without leading zeros, 8 bytes are stored */
+static inline size_t
+format_leading (char *text, uint32_t value)
+{
+  uint64_t digits = split_digits (value);
+  int zeros;
+
+  if (value == 0)
+  {
+    zeros = 7;
+  }
+  else
+  {
+#if defined(__GNUC__)
+    zeros = __builtin_ctzll (digits) / 8;
+#else
+    for (zeros = 0; ((digits >> (zeros * 8)) & 0xFF) == 0; zeros++)
+      ;
+#endif
+  }
+
+  store_digits (text, (digits >> (zeros * 8)) + ASCII_ZEROS);
+
+  return (size_t)(8 - zeros);
+}
+
+/* Digits of an unsigned value, up to 8 bytes past them are overwritten */
+static size_t
+format_unsigned (char *text, uint64_t value)
+{
+  uint64_t head;
+  size_t len;
+
+  if (value < 100000000)
+  {
+    return format_leading (text, (uint32_t)value);
+  }
+
+  head = value / 100000000;
+
+  if (head < 100000000)
+  {
+    len = format_leading (text, (uint32_t)head);
+  }
+  else
+  {
+    len = format_leading (text, (uint32_t)(head / 100000000));
+    store_digits (text + len, split_digits ((uint32_t)(head % 100000000)) + ASCII_ZEROS);
+    len += 8;
+  }
+
+  store_digits (text + len, split_digits ((uint32_t)(value % 100000000)) + ASCII_ZEROS);
+
+  return len + 8;
+}
+
+/* Write digits * 10^exponent as JavaScript writes numbers, in plain notation from 1e-6 up to 1e21
+ * and in scientific notation outside that range */
+static size_t
+format_decimal (char *text, bool negative, uint64_t mantissa, int32_t exponent)
+{
+  char digits[MSEED3_NUMBER_LEN];
+  size_t len     = format_unsigned (digits, mantissa);
+  int32_t point  = (int32_t)len + exponent;
+  char *position = text;
+
+  if (negative)
+    *position++ = '-';
+
+  if (point > 21 || point < -5)
+  {
+    *position++ = digits[0];
+
+    if (len > 1)
+    {
+      *position++ = '.';
+      memcpy (position, digits + 1, len - 1);
+      position += len - 1;
+    }
+
+    *position++ = 'e';
+    position += mseed3_format_int32 (position, point - 1);
+  }
+  else if (exponent >= 0)
+  {
+    memcpy (position, digits, len);
+    memset (position + len, '0', (size_t)exponent);
+    position += len + (size_t)exponent;
+  }
+  else if (point > 0)
+  {
+    memcpy (position, digits, (size_t)point);
+    position += point;
+    *position++ = '.';
+    memcpy (position, digits + point, len - (size_t)point);
+    position += len - (size_t)point;
+  }
+  else
+  {
+    memcpy (position, "0.", 2);
+    memset (position + 2, '0', (size_t)-point);
+    position += 2 + (size_t)-point;
+    memcpy (position, digits, len);
+    position += len;
+  }
+
+  return (size_t)(position - text);
+}
+
+/* Text of zero, infinity and NaN, as printf ("%g") writes them */
+static size_t
+format_special (char *text, bool negative, bool zero, bool infinite)
+{
+  size_t len = 0;
+
+  if (negative && (zero || infinite))
+    text[len++] = '-';
+
+  memcpy (text + len, zero ? "0" : infinite ? "inf" : "nan", zero ? 1 : 3);
+
+  return len + (zero ? 1 : 3);
+}
+
+/*! @brief Write the decimal digits of an integer
+ *
+ *  @param[out] text room for MSEED3_NUMBER_LEN bytes, not NUL terminated
+ *  @param[in] value integer
+ *
+ *  @return number of characters written
+ */
+size_t
+mseed3_format_int32 (char *text, int32_t value)
+{
+  if (value < 0)
+  {
+    *text = '-';
+    return 1 + format_unsigned (text + 1, (uint64_t)(-(int64_t)value));
+  }
+
+  return format_unsigned (text, (uint64_t)value);
+}
+
+/*! @brief Write the decimal digits of a 64-bit integer
+ *
+ *  @param[out] text room for MSEED3_NUMBER_LEN bytes, not NUL terminated
+ *  @param[in] value integer
+ *
+ *  @return number of characters written
+ */
+size_t
+mseed3_format_int64 (char *text, int64_t value)
+{
+  if (value < 0)
+  {
+    *text = '-';
+    return 1 + format_unsigned (text + 1, 0 - (uint64_t)value);
+  }
+
+  return format_unsigned (text, (uint64_t)value);
+}
+
+/*! @brief Write a double with the fewest digits that read back to the same value
+ *
+ *  Digits are found with the Ryu algorithm and laid out as JavaScript
+ *  writes numbers, 0.000001 to 1e21 in plain notation, without a
+ *  fraction for integral values.  NaN and infinity are written as nan
+ *  and inf.
+ *
+ *  @param[out] text room for MSEED3_NUMBER_LEN bytes, not NUL terminated
+ *  @param[in] value number
+ *
+ *  @return number of characters written
+ */
+size_t
+mseed3_format_double (char *text, double value)
+{
+  uint64_t bits;
+  uint64_t ieee_mantissa;
+  uint32_t ieee_exponent;
+  uint64_t digits;
+  int32_t exponent;
+  bool negative;
+
+  memcpy (&bits, &value, sizeof (bits));
+  negative      = (bits >> 63) != 0;
+  ieee_mantissa = bits & ((1ULL << DOUBLE_MANTISSA_BITS) - 1);
+  ieee_exponent = (uint32_t)(bits >> DOUBLE_MANTISSA_BITS) & 0x7FF;
+
+  if (ieee_exponent == 0x7FF || (ieee_exponent == 0 && ieee_mantissa == 0))
+  {
+    return format_special (text, negative, ieee_exponent == 0, ieee_mantissa == 0);
+  }
+
+  init_pow5_tables ();
+  digits = shortest_double (ieee_mantissa, ieee_exponent, &exponent);
+
+  return format_decimal (text, negative, digits, exponent);
+}
+
+/*! @brief Write a float with the fewest digits that read back to the same float
+ *
+ *  Laid out as mseed3_format_double() writes numbers, 0.1f is written
+ *  as 0.1 rather than with the digits of the nearest double.
+ *
+ *  @param[out] text room for MSEED3_NUMBER_LEN bytes, not NUL terminated
+ *  @param[in] value number
+ *
+ *  @return number of characters written
+ */
+size_t
+mseed3_format_float (char *text, float value)
+{
+  uint32_t bits;
+  uint32_t ieee_mantissa;
+  uint32_t ieee_exponent;
+  uint32_t digits;
+  int32_t exponent;
+  bool negative;
+
+  memcpy (&bits, &value, sizeof (bits));
+  negative      = (bits >> 31) != 0;
+  ieee_mantissa = bits & ((1u << FLOAT_MANTISSA_BITS) - 1);
+  ieee_exponent = (bits >> FLOAT_MANTISSA_BITS) & 0xFF;
+
+  if (ieee_exponent == 0xFF || (ieee_exponent == 0 && ieee_mantissa == 0))
+  {
+    return format_special (text, negative, ieee_exponent == 0, ieee_mantissa == 0);
+  }
+
+  init_pow5_tables ();
+  digits = shortest_float (ieee_mantissa, ieee_exponent, &exponent);
+
+  return format_decimal (text, negative, digits, exponent);
+}
@@ -0,0 +1,19 @@
+#ifndef __MSEED3_COMMON_FORMAT_NUMBER_H__
+#define __MSEED3_COMMON_FORMAT_NUMBER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Room the mseed3_format_* functions need at text, more than the longest number they write
+ * as they store whole 8 byte words */
+#define MSEED3_NUMBER_LEN 32
+
+size_t mseed3_format_int32(char *text, int32_t value);
+
+size_t mseed3_format_int64(char *text, int64_t value);
+
+size_t mseed3_format_double(char *text, double value);
+
+size_t mseed3_format_float(char *text, float value);
+
+#endif /* __MSEED3_COMMON_FORMAT_NUMBER_H__ */
@@ -7,7 +7,14 @@ mseed3_get_dirname (char *path)
   char *last;
   char *parent;
   //TODO need case for WIN
-  last   = strrchr (path, '/');
+  last = strrchr (path, '/');
+
+  /* A bare file name lives in the current directory */
+  if (last == NULL)
+  {
+    return strdup (".");
+  }
+
   parent = strndup (path, strlen (path) - (strlen (last)));
 
   return parent;
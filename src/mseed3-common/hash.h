@@ -0,0 +1,28 @@
+#ifndef __MSEED3_COMMON_HASH_H__
+#define __MSEED3_COMMON_HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Incremental 64-bit hash state, see mseed3_hash64_reset() */
+struct mseed3_hash64_s
+{
+    uint64_t total;
+    uint64_t lanes[4];
+    unsigned char buffer[32];
+    uint32_t buffered;
+    uint64_t seed;
+};
+
+uint64_t mseed3_hash64(const void *data, size_t length, uint64_t seed);
+
+void mseed3_hash64_reset(struct mseed3_hash64_s *state, uint64_t seed);
+
+void mseed3_hash64_update(struct mseed3_hash64_s *state, const void *data, size_t length);
+
+uint64_t mseed3_hash64_digest(const struct mseed3_hash64_s *state);
+
+int mseed3_hash64_file(FILE *file, uint64_t length, struct mseed3_hash64_s *state);
+
+#endif /* __MSEED3_COMMON_HASH_H__ */
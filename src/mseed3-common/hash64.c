@@ -0,0 +1,284 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "hash.h"
+
+/* XXH64 by Yann Collet, a non-cryptographic hash running at memory speed.
+ * Values are identical to the reference implementation on every platform. */
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+/* Bytes read at a time by mseed3_hash64_file() */
+#define HASH_FILE_CHUNK_LEN (1024 * 1024)
+
+static inline uint64_t
+rotl64 (uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+/* Little-endian loads through memcpy, so alignment and host byte order do not matter */
+static inline uint64_t
+read64 (const unsigned char *p)
+{
+  uint64_t value;
+
+  memcpy (&value, p, sizeof (value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  value = __builtin_bswap64 (value);
+#endif
+  return value;
+}
+
+static inline uint32_t
+read32 (const unsigned char *p)
+{
+  uint32_t value;
+
+  memcpy (&value, p, sizeof (value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  value = __builtin_bswap32 (value);
+#endif
+  return value;
+}
+
+static inline uint64_t
+round64 (uint64_t lane, uint64_t input)
+{
+  lane += input * PRIME64_2;
+  lane = rotl64 (lane, 31);
+  return lane * PRIME64_1;
+}
+
+static inline uint64_t
+merge_round (uint64_t hash, uint64_t lane)
+{
+  hash ^= round64 (0, lane);
+  return hash * PRIME64_1 + PRIME64_4;
+}
+
+/* Mix the final, less than 32 byte long, tail into the hash */
+static uint64_t
+finish (uint64_t hash, const unsigned char *p, size_t length)
+{
+  for (; length >= 8; p += 8, length -= 8)
+  {
+    hash ^= round64 (0, read64 (p));
+    hash = rotl64 (hash, 27) * PRIME64_1 + PRIME64_4;
+  }
+
+  if (length >= 4)
+  {
+    hash ^= (uint64_t)read32 (p) * PRIME64_1;
+    hash = rotl64 (hash, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+    length -= 4;
+  }
+
+  for (; length > 0; p++, length--)
+  {
+    hash ^= (*p) * PRIME64_5;
+    hash = rotl64 (hash, 11) * PRIME64_1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= PRIME64_2;
+  hash ^= hash >> 29;
+  hash *= PRIME64_3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+/* Consume whole 32 byte stripes, returns the number of bytes used */
+static size_t
+consume (uint64_t lanes[4], const unsigned char *p, size_t length)
+{
+  const unsigned char *start = p;
+
+  for (; length >= 32; p += 32, length -= 32)
+  {
+    lanes[0] = round64 (lanes[0], read64 (p));
+    lanes[1] = round64 (lanes[1], read64 (p + 8));
+    lanes[2] = round64 (lanes[2], read64 (p + 16));
+    lanes[3] = round64 (lanes[3], read64 (p + 24));
+  }
+
+  return (size_t)(p - start);
+}
+
+static uint64_t
+merge_lanes (const uint64_t lanes[4])
+{
+  uint64_t hash = rotl64 (lanes[0], 1) + rotl64 (lanes[1], 7) + rotl64 (lanes[2], 12) + rotl64 (lanes[3], 18);
+
+  hash = merge_round (hash, lanes[0]);
+  hash = merge_round (hash, lanes[1]);
+  hash = merge_round (hash, lanes[2]);
+  hash = merge_round (hash, lanes[3]);
+
+  return hash;
+}
+
+/*! @brief Start an incremental hash
+ *
+ *  @param[out] state hash state
+ *  @param[in] seed seed, different seeds give unrelated hashes of the same data
+ *
+ */
+void
+mseed3_hash64_reset (struct mseed3_hash64_s *state, uint64_t seed)
+{
+  memset (state, 0, sizeof (struct mseed3_hash64_s));
+  state->seed     = seed;
+  state->lanes[0] = seed + PRIME64_1 + PRIME64_2;
+  state->lanes[1] = seed + PRIME64_2;
+  state->lanes[2] = seed;
+  state->lanes[3] = seed - PRIME64_1;
+}
+
+/*! @brief Add data to an incremental hash
+ *
+ *  @param[in,out] state hash state
+ *  @param[in] data bytes to add
+ *  @param[in] length number of bytes
+ *
+ */
+void
+mseed3_hash64_update (struct mseed3_hash64_s *state, const void *data, size_t length)
+{
+  const unsigned char *p = (const unsigned char *)data;
+
+  state->total += length;
+
+  if (state->buffered > 0)
+  {
+    size_t take = 32 - state->buffered;
+
+    if (take > length)
+    {
+      take = length;
+    }
+
+    memcpy (state->buffer + state->buffered, p, take);
+    state->buffered += (uint32_t)take;
+    p += take;
+    length -= take;
+
+    if (state->buffered < 32)
+    {
+      return;
+    }
+
+    consume (state->lanes, state->buffer, 32);
+    state->buffered = 0;
+  }
+
+  size_t used = consume (state->lanes, p, length);
+
+  memcpy (state->buffer, p + used, length - used);
+  state->buffered = (uint32_t)(length - used);
+}
+
+/*! @brief Hash of everything added so far, the state may be updated further
+ *
+ */
+uint64_t
+mseed3_hash64_digest (const struct mseed3_hash64_s *state)
+{
+  uint64_t hash;
+
+  if (state->total >= 32)
+  {
+    hash = merge_lanes (state->lanes);
+  }
+  else
+  {
+    hash = state->seed + PRIME64_5;
+  }
+
+  hash += state->total;
+
+  return finish (hash, state->buffer, state->buffered);
+}
+
+/*! @brief Hash a block of memory in one call
+ *
+ *  @param[in] data bytes to hash
+ *  @param[in] length number of bytes
+ *  @param[in] seed seed, 0 unless several independent hashes are needed
+ *
+ *  @return 64-bit hash of the data
+ */
+uint64_t
+mseed3_hash64 (const void *data, size_t length, uint64_t seed)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  uint64_t hash;
+
+  if (length >= 32)
+  {
+    uint64_t lanes[4] = {seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1};
+    size_t used       = consume (lanes, p, length);
+
+    hash = merge_lanes (lanes);
+    p += used;
+  }
+  else
+  {
+    hash = seed + PRIME64_5;
+  }
+
+  hash += length;
+
+  return finish (hash, p, length & 31);
+}
+
+/*! @brief Add the next bytes of a file to an incremental hash
+ *
+ *  Reads from the current file position, so successive calls hash
+ *  consecutive parts of the file.
+ *
+ *  @param[in] file open file pointer
+ *  @param[in] length number of bytes to add
+ *  @param[in,out] state hash state
+ *
+ *  @return 0 on success, MSEED3_READ_ERROR if the file is shorter or cannot be read
+ */
+int
+mseed3_hash64_file (FILE *file, uint64_t length, struct mseed3_hash64_s *state)
+{
+  char *buffer;
+  int rv = 0;
+
+  if ((buffer = (char *)malloc (HASH_FILE_CHUNK_LEN)) == NULL)
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  while (length > 0)
+  {
+    size_t want = length < HASH_FILE_CHUNK_LEN ? (size_t)length : HASH_FILE_CHUNK_LEN;
+    size_t got  = fread (buffer, 1, want, file);
+
+    if (got == 0)
+    {
+      rv = MSEED3_READ_ERROR;
+      break;
+    }
+
+    mseed3_hash64_update (state, buffer, got);
+    length -= got;
+  }
+
+  free (buffer);
+
+  return rv;
+}
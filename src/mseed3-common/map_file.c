@@ -0,0 +1,176 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "constants.h"
+#include "files.h"
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define MSEED3_HAVE_MMAP 1
+#endif
+
+/*! @brief Read a whole file into a heap buffer, used when mmap is unavailable
+ *
+ *  @param[in] file open file pointer
+ *  @param[out] map mapping description to fill
+ *
+ */
+static int
+read_file (FILE *file, struct mseed3_file_map_s *map)
+{
+  long file_len = mseed3_file_length (file);
+  char *buffer;
+
+  if (file_len < 0)
+  {
+    return MSEED3_SEEK_ERROR;
+  }
+
+  if (file_len == 0)
+  {
+    return 0;
+  }
+
+  if ((buffer = (char *)malloc ((size_t)file_len)) == NULL)
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  rewind (file);
+  if ((size_t)file_len != fread (buffer, sizeof (char), (size_t)file_len, file))
+  {
+    free (buffer);
+    return MSEED3_READ_ERROR;
+  }
+
+  map->data   = buffer;
+  map->length = (uint64_t)file_len;
+  map->mapped = false;
+
+  return 0;
+}
+
+/*! @brief Map the contents of an open file read-only into memory
+ *
+ *  The whole file is mapped in one region so that callers can walk records
+ *  by pointer without any further reads or copies.  Falls back to reading
+ *  the file into a heap buffer where memory mapping is not available.
+ *
+ *  @param[in] file open file pointer
+ *  @param[out] map mapping description, release with mseed3_unmap_file()
+ *
+ *  @return 0 on success, negative error code on failure
+ */
+int
+mseed3_map_file (FILE *file, struct mseed3_file_map_s *map)
+{
+  map->data   = NULL;
+  map->length = 0;
+  map->mapped = false;
+
+  if (NULL == file)
+  {
+    return MSEED3_BAD_INPUT;
+  }
+
+#ifdef MSEED3_HAVE_MMAP
+  struct stat info;
+  void *data;
+
+  if (fstat (fileno (file), &info) == 0 && S_ISREG (info.st_mode))
+  {
+    /* mmap() refuses zero length regions, an empty file is simply no data */
+    if (info.st_size == 0)
+    {
+      return 0;
+    }
+
+    data = mmap (NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fileno (file), 0);
+
+    if (data != MAP_FAILED)
+    {
+#ifdef MADV_SEQUENTIAL
+      madvise (data, (size_t)info.st_size, MADV_SEQUENTIAL);
+#endif
+      map->data   = (const char *)data;
+      map->length = (uint64_t)info.st_size;
+      map->mapped = true;
+      return 0;
+    }
+  }
+#endif
+
+  return read_file (file, map);
+}
+
+/*! @brief Release a region created by mseed3_map_file()
+ *
+ *  @param[in,out] map mapping description to release
+ *
+ */
+void
+mseed3_unmap_file (struct mseed3_file_map_s *map)
+{
+  if (NULL == map || NULL == map->data)
+  {
+    return;
+  }
+
+#ifdef MSEED3_HAVE_MMAP
+  if (map->mapped)
+  {
+    munmap ((void *)map->data, (size_t)map->length);
+  }
+  else
+#endif
+  {
+    free ((void *)map->data);
+  }
+
+  map->data   = NULL;
+  map->length = 0;
+  map->mapped = false;
+}
+
+/*! @brief Drop pages of a mapped region that will not be read again
+ *
+ *  Keeps the resident size bounded while walking very large records.  Only
+ *  whole pages inside the range are released, and nothing is done for a
+ *  region read into a heap buffer.
+ *
+ *  @param[in] map mapping description
+ *  @param[in] data start of the range, inside the mapped region
+ *  @param[in] length length of the range
+ *
+ */
+void
+mseed3_release_file_range (const struct mseed3_file_map_s *map, const char *data, uint64_t length)
+{
+#if defined(MSEED3_HAVE_MMAP) && defined(MADV_DONTNEED)
+  static uintptr_t page_len = 0;
+  uintptr_t start, end;
+
+  if (NULL == map || !map->mapped || length == 0)
+  {
+    return;
+  }
+
+  if (page_len == 0)
+  {
+    page_len = (uintptr_t)sysconf (_SC_PAGESIZE);
+  }
+
+  start = ((uintptr_t)data + page_len - 1) & ~(page_len - 1);
+  end   = ((uintptr_t)data + length) & ~(page_len - 1);
+
+  if (end > start)
+  {
+    madvise ((void *)start, end - start, MADV_DONTNEED);
+  }
+#endif
+}
@@ -0,0 +1,83 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "constants.h"
+#include "files.h"
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <fcntl.h>
+#include <unistd.h>
+#define MSEED3_HAVE_OPENAT 1
+#endif
+
+#ifndef S_ISDIR
+#define S_ISDIR(mode) (((mode)&S_IFMT) == S_IFDIR)
+#endif
+
+/*! @brief Open a file for reading, refusing directories
+ *
+ *  The file is opened once and checked through the open descriptor, so it
+ *  cannot be replaced between the checks and the read.
+ *
+ *  @param[in] dirfd directory pathname is relative to, AT_FDCWD for the working directory
+ *  @param[in] pathname name of the file
+ *  @param[out] file open file pointer on success, NULL otherwise
+ *
+ *  @return 0 on success, MSEED3_NOT_FOUND, MSEED3_NOT_REGULAR or MSEED3_OPEN_ERROR on failure
+ */
+int
+mseed3_open_file (int dirfd, const char *pathname, FILE **file)
+{
+  struct stat info;
+
+  *file = NULL;
+
+#ifdef MSEED3_HAVE_OPENAT
+  int fd = openat (dirfd, pathname, O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0)
+  {
+    return (errno == ENOENT || errno == ENOTDIR) ? MSEED3_NOT_FOUND : MSEED3_OPEN_ERROR;
+  }
+
+  if (fstat (fd, &info) != 0)
+  {
+    close (fd);
+    return MSEED3_OPEN_ERROR;
+  }
+
+  if (S_ISDIR (info.st_mode))
+  {
+    close (fd);
+    return MSEED3_NOT_REGULAR;
+  }
+
+  if ((*file = fdopen (fd, "rb")) == NULL)
+  {
+    close (fd);
+    return MSEED3_OPEN_ERROR;
+  }
+#else
+  (void)dirfd;
+
+  if (stat (pathname, &info) != 0)
+  {
+    return errno == ENOENT ? MSEED3_NOT_FOUND : MSEED3_OPEN_ERROR;
+  }
+
+  if (S_ISDIR (info.st_mode))
+  {
+    return MSEED3_NOT_REGULAR;
+  }
+
+  if ((*file = fopen (pathname, "rb")) == NULL)
+  {
+    return MSEED3_OPEN_ERROR;
+  }
+#endif
+
+  return 0;
+}
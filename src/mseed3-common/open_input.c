@@ -0,0 +1,560 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mseed3-common/config.h>
+
+#include "constants.h"
+#include "files.h"
+
+#if defined(HAVE_PTHREAD) && !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#define MSEED3_HAVE_INFLATE_THREAD 1
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LIBLZMA
+#include <lzma.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* Longest magic number checked, the xz stream header */
+#define INPUT_MAGIC_LEN 6
+
+/* Compressed and decompressed bytes handled per step of the worker thread */
+#define INFLATE_CHUNK_LEN (256 * 1024)
+
+/* Capacity asked for the pipe between the worker thread and the reader */
+#define INFLATE_PIPE_LEN (1024 * 1024)
+
+/*! @brief Identify a compressed stream by its magic number
+ *
+ *  @param[in] magic leading bytes of the input
+ *  @param[in] length number of leading bytes available
+ *
+ *  @return compression of the input, MSEED3_COMPRESSION_NONE if not recognised
+ */
+enum mseed3_compression_e
+mseed3_detect_compression (const unsigned char *magic, size_t length)
+{
+  static const unsigned char gzip[] = {0x1F, 0x8B};
+  static const unsigned char xz[]   = {0xFD, '7', 'z', 'X', 'Z', 0x00};
+  static const unsigned char zstd[] = {0x28, 0xB5, 0x2F, 0xFD};
+
+  if (length >= sizeof (gzip) && 0 == memcmp (magic, gzip, sizeof (gzip)))
+  {
+    return MSEED3_COMPRESSION_GZIP;
+  }
+  if (length >= sizeof (xz) && 0 == memcmp (magic, xz, sizeof (xz)))
+  {
+    return MSEED3_COMPRESSION_XZ;
+  }
+  if (length >= sizeof (zstd) && 0 == memcmp (magic, zstd, sizeof (zstd)))
+  {
+    return MSEED3_COMPRESSION_ZSTD;
+  }
+
+  return MSEED3_COMPRESSION_NONE;
+}
+
+/*! @brief Name of a compression for messages
+ *
+ */
+const char *
+mseed3_compression_name (enum mseed3_compression_e compression)
+{
+  switch (compression)
+  {
+  case MSEED3_COMPRESSION_GZIP:
+    return "gzip";
+  case MSEED3_COMPRESSION_XZ:
+    return "xz";
+  case MSEED3_COMPRESSION_ZSTD:
+    return "zstd";
+  default:
+    return "none";
+  }
+}
+
+#ifdef MSEED3_HAVE_INFLATE_THREAD
+/* Worker thread state, the thread writes decompressed bytes into a pipe read by the caller */
+struct mseed3_inflate_s
+{
+  FILE *source;
+  enum mseed3_compression_e compression;
+  unsigned char magic[INPUT_MAGIC_LEN];
+  size_t magic_len;
+  int write_fd;
+  bool stopped;
+  int status;
+  pthread_t thread;
+};
+
+/* Read compressed bytes, starting with the magic bytes consumed while detecting the compression */
+static size_t
+inflate_read (struct mseed3_inflate_s *worker, unsigned char *data, size_t length)
+{
+  if (worker->magic_len > 0)
+  {
+    size_t magic_len = worker->magic_len;
+
+    memcpy (data, worker->magic, magic_len);
+    worker->magic_len = 0;
+
+    return magic_len + fread (data + magic_len, sizeof (char), length - magic_len, worker->source);
+  }
+
+  return fread (data, sizeof (char), length, worker->source);
+}
+
+/* Hand decompressed bytes to the reader, false once the reader has gone away */
+static bool
+inflate_write (struct mseed3_inflate_s *worker, const unsigned char *data, size_t length)
+{
+  while (length > 0)
+  {
+    ssize_t written = write (worker->write_fd, data, length);
+
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      worker->stopped = true;
+      return false;
+    }
+
+    data += written;
+    length -= (size_t)written;
+  }
+
+  return true;
+}
+
+/* Uncompressed input that cannot be rewound, copied through with its magic bytes */
+static int
+inflate_copy (struct mseed3_inflate_s *worker, unsigned char *in, unsigned char *out)
+{
+  size_t length;
+
+  while ((length = inflate_read (worker, in, INFLATE_CHUNK_LEN)) > 0)
+  {
+    if (!inflate_write (worker, in, length))
+    {
+      return 0;
+    }
+  }
+
+  return ferror (worker->source) ? MSEED3_READ_ERROR : 0;
+}
+
+#ifdef HAVE_ZLIB
+/* gzip, including files made of several concatenated members */
+static int
+inflate_gzip (struct mseed3_inflate_s *worker, unsigned char *in, unsigned char *out)
+{
+  bool member_open = false;
+  int status       = 0;
+  z_stream stream;
+
+  memset (&stream, 0, sizeof (z_stream));
+
+  /* 32 added to the window bits accepts the gzip header */
+  if (inflateInit2 (&stream, 15 + 32) != Z_OK)
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  for (;;)
+  {
+    int rv;
+
+    if (stream.avail_in == 0)
+    {
+      stream.next_in  = in;
+      stream.avail_in = (uInt)inflate_read (worker, in, INFLATE_CHUNK_LEN);
+
+      if (stream.avail_in == 0)
+      {
+        break;
+      }
+    }
+
+    stream.next_out  = out;
+    stream.avail_out = INFLATE_CHUNK_LEN;
+
+    rv = inflate (&stream, Z_NO_FLUSH);
+
+    if (rv == Z_STREAM_END)
+    {
+      member_open = false;
+      inflateReset (&stream);
+    }
+    else if (rv == Z_OK || (rv == Z_BUF_ERROR && stream.avail_in == 0))
+    {
+      member_open = true;
+    }
+    else
+    {
+      status = MSEED3_READ_ERROR;
+      break;
+    }
+
+    if (!inflate_write (worker, out, INFLATE_CHUNK_LEN - stream.avail_out))
+    {
+      break;
+    }
+  }
+
+  inflateEnd (&stream);
+
+  if (status == 0 && (member_open || ferror (worker->source)))
+  {
+    status = MSEED3_READ_ERROR;
+  }
+
+  return status;
+}
+#endif
+
+#ifdef HAVE_LIBLZMA
+/* xz, including concatenated streams */
+static int
+inflate_xz (struct mseed3_inflate_s *worker, unsigned char *in, unsigned char *out)
+{
+  lzma_stream stream = LZMA_STREAM_INIT;
+  lzma_action action = LZMA_RUN;
+  int status         = 0;
+
+  if (lzma_stream_decoder (&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  for (;;)
+  {
+    lzma_ret rv;
+
+    if (stream.avail_in == 0 && action == LZMA_RUN)
+    {
+      stream.next_in  = in;
+      stream.avail_in = inflate_read (worker, in, INFLATE_CHUNK_LEN);
+
+      if (stream.avail_in == 0)
+      {
+        action = LZMA_FINISH;
+      }
+    }
+
+    stream.next_out  = out;
+    stream.avail_out = INFLATE_CHUNK_LEN;
+
+    rv = lzma_code (&stream, action);
+
+    if (!inflate_write (worker, out, INFLATE_CHUNK_LEN - stream.avail_out))
+    {
+      break;
+    }
+
+    if (rv == LZMA_STREAM_END)
+    {
+      break;
+    }
+
+    if (rv != LZMA_OK)
+    {
+      status = MSEED3_READ_ERROR;
+      break;
+    }
+  }
+
+  lzma_end (&stream);
+
+  return status;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/* zstd, including concatenated frames */
+static int
+inflate_zstd (struct mseed3_inflate_s *worker, unsigned char *in, unsigned char *out)
+{
+  ZSTD_DCtx *context = ZSTD_createDCtx ();
+  size_t pending     = 0;
+  int status         = 0;
+  size_t length;
+
+  if (context == NULL)
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  while (status == 0 && (length = inflate_read (worker, in, INFLATE_CHUNK_LEN)) > 0)
+  {
+    ZSTD_inBuffer input = {in, length, 0};
+
+    while (input.pos < input.size)
+    {
+      ZSTD_outBuffer output = {out, INFLATE_CHUNK_LEN, 0};
+
+      pending = ZSTD_decompressStream (context, &output, &input);
+
+      if (ZSTD_isError (pending))
+      {
+        status = MSEED3_READ_ERROR;
+        break;
+      }
+
+      if (!inflate_write (worker, out, output.pos))
+      {
+        ZSTD_freeDCtx (context);
+        return 0;
+      }
+    }
+  }
+
+  ZSTD_freeDCtx (context);
+
+  /* A frame still expecting input was cut short */
+  if (status == 0 && (pending != 0 || ferror (worker->source)))
+  {
+    status = MSEED3_READ_ERROR;
+  }
+
+  return status;
+}
+#endif
+
+/* Worker thread entry point */
+static void *
+inflate_thread (void *context)
+{
+  struct mseed3_inflate_s *worker = (struct mseed3_inflate_s *)context;
+  unsigned char *in               = (unsigned char *)malloc (INFLATE_CHUNK_LEN);
+  unsigned char *out              = (unsigned char *)malloc (INFLATE_CHUNK_LEN);
+  sigset_t pipe_signal;
+
+  /* A reader that stops early makes write() fail with EPIPE instead of killing the process */
+  sigemptyset (&pipe_signal);
+  sigaddset (&pipe_signal, SIGPIPE);
+  pthread_sigmask (SIG_BLOCK, &pipe_signal, NULL);
+
+  if (in == NULL || out == NULL)
+  {
+    worker->status = MSEED3_MALLOC_ERROR;
+  }
+  else
+  {
+    switch (worker->compression)
+    {
+#ifdef HAVE_ZLIB
+    case MSEED3_COMPRESSION_GZIP:
+      worker->status = inflate_gzip (worker, in, out);
+      break;
+#endif
+#ifdef HAVE_LIBLZMA
+    case MSEED3_COMPRESSION_XZ:
+      worker->status = inflate_xz (worker, in, out);
+      break;
+#endif
+#ifdef HAVE_ZSTD
+    case MSEED3_COMPRESSION_ZSTD:
+      worker->status = inflate_zstd (worker, in, out);
+      break;
+#endif
+    default:
+      worker->status = inflate_copy (worker, in, out);
+      break;
+    }
+  }
+
+  /* Nothing is wrong with input the reader did not want */
+  if (worker->stopped)
+  {
+    worker->status = 0;
+  }
+
+  free (in);
+  free (out);
+
+  /* End of file for the reader */
+  close (worker->write_fd);
+
+  return NULL;
+}
+
+/* Start the worker thread and point the input at the read end of its pipe */
+static int
+start_inflate (FILE *file, struct mseed3_input_s *input, const unsigned char *magic, size_t magic_len)
+{
+  struct mseed3_inflate_s *worker;
+  int fds[2];
+
+  if ((worker = (struct mseed3_inflate_s *)calloc (1, sizeof (struct mseed3_inflate_s))) == NULL)
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  if (pipe (fds) != 0)
+  {
+    free (worker);
+    return MSEED3_READ_ERROR;
+  }
+
+#ifdef F_SETPIPE_SZ
+  /* A deeper pipe lets the worker run further ahead of the reader, failure just keeps the default */
+  fcntl (fds[1], F_SETPIPE_SZ, INFLATE_PIPE_LEN);
+#endif
+
+  worker->source      = file;
+  worker->compression = input->compression;
+  worker->magic_len   = magic_len;
+  worker->write_fd    = fds[1];
+  memcpy (worker->magic, magic, magic_len);
+
+  if ((input->file = fdopen (fds[0], "rb")) == NULL)
+  {
+    close (fds[0]);
+    close (fds[1]);
+    free (worker);
+    return MSEED3_READ_ERROR;
+  }
+
+  if (pthread_create (&worker->thread, NULL, inflate_thread, worker) != 0)
+  {
+    fclose (input->file);
+    close (fds[1]);
+    free (worker);
+    input->file = file;
+    return MSEED3_READ_ERROR;
+  }
+
+  input->worker = worker;
+  snprintf (input->path, sizeof (input->path), "/dev/fd/%d", fds[0]);
+
+  return 0;
+}
+#endif
+
+/*! @brief Prepare an open file for reading records, decompressing it if needed
+ *
+ *  gzip, xz and zstd input is recognised by its magic number and
+ *  decompressed on a worker thread while the caller reads records, so
+ *  decompression and validation overlap.  The decompressed bytes arrive
+ *  through a pipe, read from input->file or opened by name with
+ *  mseed3_input_path().  Uncompressed files are rewound and read as they
+ *  are, except for unseekable input such as stdin, which is passed through
+ *  the worker as well since its leading bytes cannot be put back.
+ *
+ *  @param[in] file open file pointer, not closed by mseed3_input_close()
+ *  @param[out] input input description, release with mseed3_input_close()
+ *
+ *  @return 0 on success, MSEED3_BAD_INPUT if the compression is not supported
+ *          by this build, other negative error code on failure
+ */
+int
+mseed3_input_open (FILE *file, struct mseed3_input_s *input)
+{
+  unsigned char magic[INPUT_MAGIC_LEN];
+  size_t magic_len;
+  bool seekable;
+
+  memset (input, 0, sizeof (struct mseed3_input_s));
+  input->file = file;
+
+  if (NULL == file)
+  {
+    return MSEED3_BAD_INPUT;
+  }
+
+  seekable           = (fseek (file, 0L, SEEK_CUR) == 0);
+  magic_len          = fread (magic, sizeof (char), INPUT_MAGIC_LEN, file);
+  input->compression = mseed3_detect_compression (magic, magic_len);
+
+  if (seekable && input->compression == MSEED3_COMPRESSION_NONE)
+  {
+    return (fseek (file, -(long)magic_len, SEEK_CUR) == 0) ? 0 : MSEED3_SEEK_ERROR;
+  }
+
+  switch (input->compression)
+  {
+  case MSEED3_COMPRESSION_NONE:
+    break;
+#ifdef HAVE_ZLIB
+  case MSEED3_COMPRESSION_GZIP:
+    break;
+#endif
+#ifdef HAVE_LIBLZMA
+  case MSEED3_COMPRESSION_XZ:
+    break;
+#endif
+#ifdef HAVE_ZSTD
+  case MSEED3_COMPRESSION_ZSTD:
+    break;
+#endif
+  default:
+    return MSEED3_BAD_INPUT;
+  }
+
+#ifdef MSEED3_HAVE_INFLATE_THREAD
+  return start_inflate (file, input, magic, magic_len);
+#else
+  /* No worker thread, only seekable uncompressed input can be read */
+  return MSEED3_BAD_INPUT;
+#endif
+}
+
+/*! @brief File name to hand to readers that open the input themselves, such as libmseed
+ *
+ *  @param[in] input open input
+ *  @param[in] file_name name the file was opened with
+ *
+ *  @return file_name, or the name of the pipe carrying the decompressed bytes
+ */
+const char *
+mseed3_input_path (struct mseed3_input_s *input, const char *file_name)
+{
+  return (input->worker != NULL) ? input->path : file_name;
+}
+
+/*! @brief Stop reading an input and wait for its worker thread
+ *
+ *  @param[in,out] input input description to release
+ *
+ *  @return 0 on success, MSEED3_READ_ERROR if the compressed data was corrupt or truncated
+ */
+int
+mseed3_input_close (struct mseed3_input_s *input)
+{
+  int status = 0;
+
+#ifdef MSEED3_HAVE_INFLATE_THREAD
+  if (input->worker != NULL)
+  {
+    /* Closing the read end stops a worker that is still writing */
+    fclose (input->file);
+    pthread_join (input->worker->thread, NULL);
+
+    status = input->worker->status;
+    free (input->worker);
+    input->worker = NULL;
+  }
+#endif
+
+  input->file = NULL;
+
+  return status;
+}
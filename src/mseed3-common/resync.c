@@ -0,0 +1,166 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "constants.h"
+#include "crc32c.h"
+#include "resync.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MSEED3_RESYNC_SSE2 1
+#endif
+
+/* Length of the fixed header, the least a record can be */
+#define RESYNC_HEADER_LEN 40
+
+/* Record signature, "MS" followed by format version 3 */
+static const char record_signature[3] = {'M', 'S', 3};
+
+/*! @brief Check that a record start is plausible enough to resume validation at
+ *
+ *  The fixed header fields must be in range, the record must fit in the
+ *  available bytes and its CRC must match, so a match inside payload bytes
+ *  is practically ruled out.
+ *
+ *  @param[in] record candidate record start
+ *  @param[in] available bytes from the candidate to the end of the data
+ *
+ *  @return true if a whole, intact record starts here
+ */
+bool
+mseed3_record_plausible (const char *record, uint64_t available)
+{
+  const uint8_t *header = (const uint8_t *)record;
+  uint64_t record_len;
+
+  if (available < RESYNC_HEADER_LEN || 0 != memcmp (record, record_signature, sizeof (record_signature)))
+  {
+    return false;
+  }
+
+  uint32_t nanoseconds = header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t)header[7] << 24);
+  uint16_t doy         = header[10] | (header[11] << 8);
+
+  if (nanoseconds > 999999999 || doy < 1 || doy > 366 || header[12] > 23 || header[13] > 59 || header[14] > 60)
+  {
+    return false;
+  }
+
+  switch (header[15])
+  {
+  case MSEED3_TEXT:
+  case MSEED3_UINT16:
+  case MSEED3_UINT32:
+  case MSEED3_FLOAT:
+  case MSEED3_DOUBLE:
+  case MSEED3_STEIM1:
+  case MSEED3_STEIM2:
+  case MSEED3_STEIM3:
+  case MSEED3_OPAQUE:
+    break;
+  default:
+    return false;
+  }
+
+  /* An identifier is required */
+  if (header[33] == 0)
+  {
+    return false;
+  }
+
+  record_len = RESYNC_HEADER_LEN + header[33] + (header[34] | (header[35] << 8)) +
+               (header[36] | (header[37] << 8) | (header[38] << 16) | ((uint64_t)header[39] << 24));
+
+  if (record_len > available)
+  {
+    return false;
+  }
+
+  return mseed3_record_stored_crc (record) == mseed3_record_crc (record, record_len);
+}
+
+/* Offset of the next "MS\x03" at or after from, length if there is none */
+static uint64_t
+find_signature (const char *data, uint64_t length, uint64_t from)
+{
+  uint64_t pos = from;
+
+#ifdef MSEED3_RESYNC_SSE2
+  /* Compare 16 candidate positions at once, each against all three signature bytes */
+  const __m128i m = _mm_set1_epi8 (record_signature[0]);
+  const __m128i s = _mm_set1_epi8 (record_signature[1]);
+  const __m128i v = _mm_set1_epi8 (record_signature[2]);
+
+  for (; pos + 16 + 2 <= length; pos += 16)
+  {
+    __m128i at0  = _mm_loadu_si128 ((const __m128i *)(data + pos));
+    __m128i at1  = _mm_loadu_si128 ((const __m128i *)(data + pos + 1));
+    __m128i at2  = _mm_loadu_si128 ((const __m128i *)(data + pos + 2));
+    __m128i hits = _mm_and_si128 (_mm_cmpeq_epi8 (at0, m),
+                                  _mm_and_si128 (_mm_cmpeq_epi8 (at1, s), _mm_cmpeq_epi8 (at2, v)));
+    int mask     = _mm_movemask_epi8 (hits);
+
+    if (mask != 0)
+    {
+      return pos + (uint64_t)__builtin_ctz ((unsigned int)mask);
+    }
+  }
+#endif
+
+  /* memchr() for the leading byte, vectorized by the C library, then the rest */
+  while (pos + sizeof (record_signature) <= length)
+  {
+    const char *hit = (const char *)memchr (data + pos, record_signature[0], (size_t)(length - pos - 2));
+
+    if (hit == NULL)
+    {
+      break;
+    }
+
+    pos = (uint64_t)(hit - data);
+
+    if (hit[1] == record_signature[1] && hit[2] == record_signature[2])
+    {
+      return pos;
+    }
+    pos++;
+  }
+
+  return length;
+}
+
+/*! @brief Find the next plausible record start after a damaged record
+ *
+ *  Candidates are found by searching for the record signature, then
+ *  confirmed with mseed3_record_plausible().
+ *
+ *  @param[in] data file contents
+ *  @param[in] length length of the data
+ *  @param[in] from offset to start searching at
+ *
+ *  @return offset of the next record, MSEED3_NO_RECORD if there is none
+ */
+uint64_t
+mseed3_find_record (const char *data, uint64_t length, uint64_t from)
+{
+  uint64_t pos = from;
+
+  while (pos < length)
+  {
+    pos = find_signature (data, length, pos);
+
+    if (pos >= length)
+    {
+      break;
+    }
+
+    if (mseed3_record_plausible (data + pos, length - pos))
+    {
+      return pos;
+    }
+    pos++;
+  }
+
+  return MSEED3_NO_RECORD;
+}
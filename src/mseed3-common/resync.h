@@ -0,0 +1,15 @@
+#ifndef __MSEED3_COMMON_RESYNC_H__
+#define __MSEED3_COMMON_RESYNC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returned by mseed3_find_record() when no further record exists */
+#define MSEED3_NO_RECORD UINT64_MAX
+
+bool mseed3_record_plausible(const char *record, uint64_t available);
+
+uint64_t mseed3_find_record(const char *data, uint64_t length, uint64_t from);
+
+#endif /* __MSEED3_COMMON_RESYNC_H__ */
@@ -0,0 +1,220 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+/* Stage names in the summary, in enum mseed3_stage_e order */
+static const char *stage_names[MSEED3_STAGE_CNT] = {"other", "read", "header",  "identifier", "extra-header",
+                                                    "crc",   "payload", "output", "wait"};
+
+bool mseed3_stats_enabled = false;
+struct mseed3_stats_s mseed3_stats_gbl;
+
+/* Stage currently charged, since the clock reading in stage_since */
+static int stage_current    = MSEED3_STAGE_OTHER;
+static uint64_t stage_since = 0;
+static uint64_t stats_start = 0;
+
+/* Monotonic clock in nanoseconds */
+static uint64_t
+now_nanoseconds (void)
+{
+  struct timespec ts;
+
+#if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
+  timespec_get (&ts, TIME_UTC);
+#else
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+#endif
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*! @brief Start timing stages, until then every stats call returns at once
+ *
+ */
+void
+mseed3_stats_enable (void)
+{
+  memset (&mseed3_stats_gbl, 0, sizeof (struct mseed3_stats_s));
+  mseed3_stats_enabled = true;
+  stage_current        = MSEED3_STAGE_OTHER;
+  stats_start          = now_nanoseconds ();
+  stage_since          = stats_start;
+}
+
+/*! @brief Charge the time since the last switch to the current stage and move to another
+ *
+ *  Use mseed3_stats_enter() and mseed3_stats_leave(), which skip the clock
+ *  reading when stats are off.
+ *
+ *  @param[in] stage stage charged from now on
+ *
+ *  @return the stage charged until now
+ */
+int
+mseed3_stats_switch (int stage)
+{
+  uint64_t now = now_nanoseconds ();
+  int previous = stage_current;
+
+  mseed3_stats_gbl.nanoseconds[stage_current] += now - stage_since;
+  if (stage != previous)
+  {
+    mseed3_stats_gbl.entries[stage]++;
+  }
+
+  stage_current = stage;
+  stage_since   = now;
+
+  return previous;
+}
+
+/*! @brief Move the counters accumulated so far out of this process and start again from zero
+ *
+ *  Workers take their counters once done and hand them to the parent, which
+ *  merges them with mseed3_stats_add().
+ *
+ *  @param[out] stats counters so far, or NULL to discard them
+ */
+void
+mseed3_stats_take (struct mseed3_stats_s *stats)
+{
+  if (!mseed3_stats_enabled)
+  {
+    return;
+  }
+
+  mseed3_stats_switch (stage_current);
+
+  if (stats != NULL)
+  {
+    *stats = mseed3_stats_gbl;
+  }
+  memset (&mseed3_stats_gbl, 0, sizeof (struct mseed3_stats_s));
+}
+
+/*! @brief Merge counters taken by mseed3_stats_take() in another process
+ *
+ *  @param[in] stats counters to add
+ */
+void
+mseed3_stats_add (const struct mseed3_stats_s *stats)
+{
+  if (!mseed3_stats_enabled)
+  {
+    return;
+  }
+
+  for (int stage = 0; stage < MSEED3_STAGE_CNT; stage++)
+  {
+    mseed3_stats_gbl.nanoseconds[stage] += stats->nanoseconds[stage];
+    mseed3_stats_gbl.entries[stage] += stats->entries[stage];
+  }
+  mseed3_stats_gbl.files += stats->files;
+  mseed3_stats_gbl.records += stats->records;
+  mseed3_stats_gbl.bytes += stats->bytes;
+}
+
+/*! @brief Parse the argument of --stats
+ *
+ *  @param[in] name text, json, or NULL for the default text table
+ *  @param[out] json true for JSON
+ *
+ *  @return false if the format is unknown
+ */
+bool
+mseed3_stats_parse_format (const char *name, bool *json)
+{
+  if (name == NULL || 0 == strcmp (name, "text"))
+  {
+    *json = false;
+    return true;
+  }
+
+  if (0 == strcmp (name, "json"))
+  {
+    *json = true;
+    return true;
+  }
+
+  return false;
+}
+
+/*! @brief Print the time spent per stage and the work done
+ *
+ *  Stage times of concurrent workers are summed, so they may add up to
+ *  more than the elapsed time.
+ *
+ *  @param[in] output stream written to, stderr keeps the summary out of program output
+ *  @param[in] program program name
+ *  @param[in] json print one JSON object instead of a table
+ */
+void
+mseed3_stats_print (FILE *output, const char *program, bool json)
+{
+  uint64_t total = 0;
+  double elapsed;
+
+  if (!mseed3_stats_enabled)
+  {
+    return;
+  }
+
+  mseed3_stats_switch (stage_current);
+  elapsed = (double)(stage_since - stats_start) * 1e-9;
+
+  for (int stage = 0; stage < MSEED3_STAGE_CNT; stage++)
+  {
+    total += mseed3_stats_gbl.nanoseconds[stage];
+  }
+
+  if (json)
+  {
+    fprintf (output,
+             "{\"program\":\"%s\",\"elapsed_seconds\":%.6f,\"files\":%" PRIu64 ",\"records\":%" PRIu64
+             ",\"bytes\":%" PRIu64 ",\"records_per_second\":%.1f,\"mb_per_second\":%.3f,\"stages\":{",
+             program, elapsed, mseed3_stats_gbl.files, mseed3_stats_gbl.records, mseed3_stats_gbl.bytes,
+             (elapsed > 0) ? (double)mseed3_stats_gbl.records / elapsed : 0.0,
+             (elapsed > 0) ? (double)mseed3_stats_gbl.bytes / elapsed / 1e6 : 0.0);
+
+    for (int stage = 0; stage < MSEED3_STAGE_CNT; stage++)
+    {
+      fprintf (output, "%s\"%s\":{\"entries\":%" PRIu64 ",\"seconds\":%.6f}", (stage > 0) ? "," : "",
+               stage_names[stage], mseed3_stats_gbl.entries[stage],
+               (double)mseed3_stats_gbl.nanoseconds[stage] * 1e-9);
+    }
+
+    fprintf (output, "}}\n");
+    fflush (output);
+    return;
+  }
+
+  fprintf (output, "%s STATS - %" PRIu64 " record(s), %.3f MB in %" PRIu64 " file(s), %.6f s elapsed\n", program,
+           mseed3_stats_gbl.records, (double)mseed3_stats_gbl.bytes / 1e6, mseed3_stats_gbl.files, elapsed);
+
+  if (elapsed > 0)
+  {
+    fprintf (output, "%s STATS - %.0f records/s, %.3f MB/s\n", program, (double)mseed3_stats_gbl.records / elapsed,
+             (double)mseed3_stats_gbl.bytes / elapsed / 1e6);
+  }
+
+  fprintf (output, "%-14s %12s %12s %7s\n", "stage", "entries", "seconds", "share");
+
+  for (int stage = 0; stage < MSEED3_STAGE_CNT; stage++)
+  {
+    if (mseed3_stats_gbl.nanoseconds[stage] == 0 && mseed3_stats_gbl.entries[stage] == 0)
+    {
+      continue;
+    }
+
+    fprintf (output, "%-14s %12" PRIu64 " %12.6f %6.1f%%\n", stage_names[stage], mseed3_stats_gbl.entries[stage],
+             (double)mseed3_stats_gbl.nanoseconds[stage] * 1e-9,
+             (total > 0) ? 100.0 * (double)mseed3_stats_gbl.nanoseconds[stage] / (double)total : 0.0);
+  }
+
+  fflush (output);
+}
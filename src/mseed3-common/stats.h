@@ -0,0 +1,81 @@
+#ifndef __MSEED3_COMMON_STATS_H__
+#define __MSEED3_COMMON_STATS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Stages time is charged to, time is always charged to exactly one stage */
+enum mseed3_stage_e
+{
+    MSEED3_STAGE_OTHER = 0,    /* anything not in a stage below */
+    MSEED3_STAGE_READ,         /* reading and mapping input, decompression waits */
+    MSEED3_STAGE_HEADER,       /* fixed header checks and parsing */
+    MSEED3_STAGE_IDENTIFIER,   /* source identifier checks */
+    MSEED3_STAGE_EXTRA_HEADER, /* extra header parsing and schema validation */
+    MSEED3_STAGE_CRC,          /* record CRC */
+    MSEED3_STAGE_PAYLOAD,      /* payload decoding and checks */
+    MSEED3_STAGE_OUTPUT,       /* formatting and writing output */
+    MSEED3_STAGE_WAIT,         /* waiting for worker processes, whose stages are counted separately */
+    MSEED3_STAGE_CNT
+};
+
+/* Time and work accumulated per stage, see mseed3_stats_enable() */
+struct mseed3_stats_s
+{
+    uint64_t nanoseconds[MSEED3_STAGE_CNT];
+    uint64_t entries[MSEED3_STAGE_CNT];
+    uint64_t files;
+    uint64_t records;
+    uint64_t bytes;
+};
+
+/* Set by mseed3_stats_enable(), checked before every clock read */
+extern bool mseed3_stats_enabled;
+
+/* Counters of this process */
+extern struct mseed3_stats_s mseed3_stats_gbl;
+
+void mseed3_stats_enable(void);
+
+int mseed3_stats_switch(int stage);
+
+void mseed3_stats_take(struct mseed3_stats_s *stats);
+
+void mseed3_stats_add(const struct mseed3_stats_s *stats);
+
+bool mseed3_stats_parse_format(const char *name, bool *json);
+
+void mseed3_stats_print(FILE *output, const char *program, bool json);
+
+/* Charge time from now on to stage, returns the stage to hand back to mseed3_stats_leave()
+ * or is ignored when moving from one stage of a loop to the next */
+static inline int
+mseed3_stats_enter (int stage)
+{
+  return mseed3_stats_enabled ? mseed3_stats_switch (stage) : MSEED3_STAGE_OTHER;
+}
+
+/* Charge time from now on to the stage that was left by mseed3_stats_enter() */
+static inline void
+mseed3_stats_leave (int previous)
+{
+  if (mseed3_stats_enabled)
+  {
+    mseed3_stats_switch (previous);
+  }
+}
+
+/* Count work done, records and bytes are counted where records are read */
+static inline void
+mseed3_stats_count (uint64_t files, uint64_t records, uint64_t bytes)
+{
+  if (mseed3_stats_enabled)
+  {
+    mseed3_stats_gbl.files += files;
+    mseed3_stats_gbl.records += records;
+    mseed3_stats_gbl.bytes += bytes;
+  }
+}
+
+#endif /* __MSEED3_COMMON_STATS_H__ */
@@ -0,0 +1,55 @@
+#ifndef __MSEED3_COMMON_STEIM_H__
+#define __MSEED3_COMMON_STEIM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Steim payloads are made of 64-byte frames of sixteen 32-bit words */
+#define MSEED3_STEIM_FRAME_LEN 64
+
+enum mseed3_steim_status_e
+{
+  MSEED3_STEIM_OK = 0,       /* payload decodes to the header sample count and Xn */
+  MSEED3_STEIM_BAD_LENGTH,   /* payload does not hold a single whole frame */
+  MSEED3_STEIM_BAD_NIBBLE,   /* reserved nibble/dnib combination in a data word */
+  MSEED3_STEIM_FEW_SAMPLES,  /* fewer differences than the header number of samples */
+  MSEED3_STEIM_BAD_XN,       /* last sample does not match the reverse integration constant */
+  MSEED3_STEIM_NO_SAMPLES    /* header declares no samples for a Steim payload */
+};
+
+/* Incremental verification state, frames may be supplied in any number of pieces of whole frames */
+struct mseed3_steim_state_s
+{
+  int version;             /* 1 or 2 */
+  uint32_t number_samples; /* sample count from the fixed header */
+  uint32_t samples;        /* samples reconstructed so far */
+  uint32_t frame;          /* index of the next frame */
+  int32_t x0;              /* forward integration constant */
+  int32_t xn;              /* reverse integration constant */
+  uint32_t last;           /* last reconstructed sample, unsigned to wrap like the encoder */
+  int status;
+  uint32_t error_frame;
+  uint32_t error_word;
+};
+
+void mseed3_steim_init(struct mseed3_steim_state_s *state, int version, uint32_t number_samples);
+
+int mseed3_steim_feed(struct mseed3_steim_state_s *state, const char *frames, uint64_t length);
+
+int mseed3_steim_finish(struct mseed3_steim_state_s *state);
+
+int mseed3_steim_verify(const char *payload, uint64_t payload_len, int version, uint32_t number_samples,
+                        struct mseed3_steim_state_s *state);
+
+const char *mseed3_steim_strerror(int status);
+
+int64_t mseed3_steim_decode(const char *payload, uint64_t payload_len, int version, uint32_t number_samples,
+                            int32_t *samples);
+
+int32_t mseed3_steim_decode_xn(const char *payload);
+
+const char *mseed3_steim_decode_kernel(void);
+
+int mseed3_steim_decode_select(const char *kernel);
+
+#endif /* __MSEED3_COMMON_STEIM_H__ */
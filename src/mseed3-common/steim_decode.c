@@ -0,0 +1,403 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "steim.h"
+
+/* Vector kernels need GCC/Clang target attributes */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MSEED3_STEIM_X86 1
+#endif
+
+/* Words per frame, word 0 holds the 2-bit nibbles of all sixteen words */
+#define STEIM_FRAME_WORDS 16
+
+/* Most differences packed into one word, seven 4-bit Steim2 differences */
+#define STEIM_MAX_DIFFS 7
+
+/* Unpacking recipe for one nibble/dnib combination.  Difference k of a word
+ * is (int32_t)(word << lshift[k]) >> rshift, the same shift pair for every
+ * lane, so a word is unpacked with one broadcast and two vector shifts. */
+struct steim_code_s
+{
+  int32_t count;
+  int32_t rshift;
+  int32_t lshift[8];
+  int32_t lmul[8]; /* 1 << lshift, for processors without variable shifts */
+};
+
+typedef uint32_t (*steim_word_f) (const struct steim_code_s *code, uint32_t word, int32_t *output,
+                                  uint32_t room);
+typedef void (*steim_integrate_f) (int32_t *samples, uint32_t count);
+
+/* Recipes indexed by [version - 1][nibble << 2 | dnib], count 0 marks reserved codes */
+static struct steim_code_s steim_codes[2][16];
+static bool steim_codes_ready = false;
+
+static steim_word_f steim_word_kernel           = NULL;
+static steim_integrate_f steim_integrate_kernel = NULL;
+static const char *steim_kernel_name            = NULL;
+
+static void
+steim_set_code (int version, uint32_t nibble, uint32_t dnib, int count, int width)
+{
+  struct steim_code_s *code = &steim_codes[version - 1][(nibble << 2) | dnib];
+
+  code->count  = count;
+  code->rshift = 32 - width;
+
+  for (int k = 0; k < 8; k++)
+  {
+    code->lshift[k] = (k < count) ? 32 - width * (count - k) : 0;
+    code->lmul[k]   = (int32_t)(1u << code->lshift[k]);
+  }
+}
+
+/* Fill the recipe tables, safe to repeat as it always writes the same values */
+static void
+steim_init_codes (void)
+{
+  if (steim_codes_ready)
+  {
+    return;
+  }
+
+  memset (steim_codes, 0, sizeof (steim_codes));
+
+  for (uint32_t dnib = 0; dnib < 4; dnib++)
+  {
+    steim_set_code (1, 1, dnib, 4, 8);
+    steim_set_code (1, 2, dnib, 2, 16);
+    steim_set_code (1, 3, dnib, 1, 32);
+    steim_set_code (2, 1, dnib, 4, 8);
+  }
+
+  steim_set_code (2, 2, 1, 1, 30);
+  steim_set_code (2, 2, 2, 2, 15);
+  steim_set_code (2, 2, 3, 3, 10);
+  steim_set_code (2, 3, 0, 5, 6);
+  steim_set_code (2, 3, 1, 6, 5);
+  steim_set_code (2, 3, 2, 7, 4);
+
+  steim_codes_ready = true;
+}
+
+/* Read a big-endian 32-bit word */
+static inline uint32_t
+steim_be32 (const char *frame, int index)
+{
+  const uint8_t *word = (const uint8_t *)frame + 4 * index;
+
+  return ((uint32_t)word[0] << 24) | ((uint32_t)word[1] << 16) | ((uint32_t)word[2] << 8) | (uint32_t)word[3];
+}
+
+/* Portable word unpacker, writes exactly min(count, room) differences */
+static uint32_t
+steim_word_scalar (const struct steim_code_s *code, uint32_t word, int32_t *output, uint32_t room)
+{
+  uint32_t count = ((uint32_t)code->count < room) ? (uint32_t)code->count : room;
+
+  for (uint32_t k = 0; k < count; k++)
+  {
+    output[k] = (int32_t)(word << code->lshift[k]) >> code->rshift;
+  }
+
+  return count;
+}
+
+/* Portable integration of differences into samples, samples[0] already holds X0 */
+static void
+steim_integrate_scalar (int32_t *samples, uint32_t count)
+{
+  uint32_t last = (count > 0) ? (uint32_t)samples[0] : 0;
+
+  for (uint32_t i = 1; i < count; i++)
+  {
+    last += (uint32_t)samples[i];
+    samples[i] = (int32_t)last;
+  }
+}
+
+#ifdef MSEED3_STEIM_X86
+/* AVX2: broadcast the word, per-lane variable left shift, uniform arithmetic right shift */
+__attribute__ ((target ("avx2"))) static uint32_t
+steim_word_avx2 (const struct steim_code_s *code, uint32_t word, int32_t *output, uint32_t room)
+{
+  __m256i lanes;
+
+  /* Lanes past the count are scratch, only store 8 when the buffer has room for them */
+  if (room < 8)
+  {
+    return steim_word_scalar (code, word, output, room);
+  }
+
+  lanes = _mm256_set1_epi32 ((int32_t)word);
+  lanes = _mm256_sllv_epi32 (lanes, _mm256_loadu_si256 ((const __m256i *)code->lshift));
+  lanes = _mm256_sra_epi32 (lanes, _mm_cvtsi32_si128 (code->rshift));
+  _mm256_storeu_si256 ((__m256i *)output, lanes);
+
+  return (uint32_t)code->count;
+}
+
+/* AVX2 inclusive prefix sum, eight samples per step */
+__attribute__ ((target ("avx2"))) static void
+steim_integrate_avx2 (int32_t *samples, uint32_t count)
+{
+  __m256i carry = _mm256_setzero_si256 ();
+  uint32_t i    = 0;
+
+  for (; i + 8 <= count; i += 8)
+  {
+    __m256i sums = _mm256_loadu_si256 ((const __m256i *)(samples + i));
+    __m256i low_top;
+
+    /* Scan within each 128-bit half, then carry the low half total into the high half */
+    sums    = _mm256_add_epi32 (sums, _mm256_slli_si256 (sums, 4));
+    sums    = _mm256_add_epi32 (sums, _mm256_slli_si256 (sums, 8));
+    low_top = _mm256_shuffle_epi32 (sums, 0xFF);
+    sums    = _mm256_add_epi32 (sums, _mm256_permute2x128_si256 (low_top, low_top, 0x08));
+    sums    = _mm256_add_epi32 (sums, carry);
+
+    _mm256_storeu_si256 ((__m256i *)(samples + i), sums);
+    carry = _mm256_permutevar8x32_epi32 (sums, _mm256_set1_epi32 (7));
+  }
+
+  if (i > 0 && i < count)
+  {
+    samples[i] = (int32_t)((uint32_t)samples[i] + (uint32_t)samples[i - 1]);
+  }
+  if (i < count)
+  {
+    steim_integrate_scalar (samples + i, count - i);
+  }
+}
+
+/* SSE4.1: no per-lane shifts, so the left shift is a multiply by a power of two */
+__attribute__ ((target ("sse4.1"))) static uint32_t
+steim_word_sse41 (const struct steim_code_s *code, uint32_t word, int32_t *output, uint32_t room)
+{
+  __m128i lanes, shift;
+
+  if (room < 8)
+  {
+    return steim_word_scalar (code, word, output, room);
+  }
+
+  lanes = _mm_set1_epi32 ((int32_t)word);
+  shift = _mm_cvtsi32_si128 (code->rshift);
+
+  _mm_storeu_si128 ((__m128i *)output,
+                    _mm_sra_epi32 (_mm_mullo_epi32 (lanes, _mm_loadu_si128 ((const __m128i *)code->lmul)), shift));
+
+  if (code->count > 4)
+  {
+    _mm_storeu_si128 ((__m128i *)(output + 4),
+                      _mm_sra_epi32 (_mm_mullo_epi32 (lanes, _mm_loadu_si128 ((const __m128i *)(code->lmul + 4))),
+                                     shift));
+  }
+
+  return (uint32_t)code->count;
+}
+
+/* SSE2 inclusive prefix sum, four samples per step */
+__attribute__ ((target ("sse2"))) static void
+steim_integrate_sse2 (int32_t *samples, uint32_t count)
+{
+  __m128i carry = _mm_setzero_si128 ();
+  uint32_t i    = 0;
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128i sums = _mm_loadu_si128 ((const __m128i *)(samples + i));
+
+    sums = _mm_add_epi32 (sums, _mm_slli_si128 (sums, 4));
+    sums = _mm_add_epi32 (sums, _mm_slli_si128 (sums, 8));
+    sums = _mm_add_epi32 (sums, carry);
+
+    _mm_storeu_si128 ((__m128i *)(samples + i), sums);
+    carry = _mm_shuffle_epi32 (sums, 0xFF);
+  }
+
+  if (i > 0 && i < count)
+  {
+    samples[i] = (int32_t)((uint32_t)samples[i] + (uint32_t)samples[i - 1]);
+  }
+  if (i < count)
+  {
+    steim_integrate_scalar (samples + i, count - i);
+  }
+}
+#endif
+
+/*! @brief Force a specific Steim decoding kernel, mainly for benchmarking
+ *
+ *  @param[in] kernel one of "scalar", "sse4.1" or "avx2"
+ *
+ *  @return 0 on success, -1 if the kernel is unknown or not supported here
+ */
+int
+mseed3_steim_decode_select (const char *kernel)
+{
+  steim_init_codes ();
+
+  if (0 == strcmp (kernel, "scalar"))
+  {
+    steim_kernel_name      = "scalar";
+    steim_word_kernel      = steim_word_scalar;
+    steim_integrate_kernel = steim_integrate_scalar;
+    return 0;
+  }
+
+#ifdef MSEED3_STEIM_X86
+  __builtin_cpu_init ();
+
+  if (0 == strcmp (kernel, "sse4.1") && __builtin_cpu_supports ("sse4.1"))
+  {
+    steim_kernel_name      = "sse4.1";
+    steim_word_kernel      = steim_word_sse41;
+    steim_integrate_kernel = steim_integrate_sse2;
+    return 0;
+  }
+
+  if (0 == strcmp (kernel, "avx2") && __builtin_cpu_supports ("avx2"))
+  {
+    steim_kernel_name      = "avx2";
+    steim_word_kernel      = steim_word_avx2;
+    steim_integrate_kernel = steim_integrate_avx2;
+    return 0;
+  }
+#endif
+
+  return -1;
+}
+
+/* Pick the fastest kernel supported by the running processor */
+static void
+steim_dispatch (void)
+{
+  if (mseed3_steim_decode_select ("avx2") == 0 || mseed3_steim_decode_select ("sse4.1") == 0)
+  {
+    return;
+  }
+
+  mseed3_steim_decode_select ("scalar");
+}
+
+/*! @brief Name of the Steim decoding kernel in use
+ *
+ */
+const char *
+mseed3_steim_decode_kernel (void)
+{
+  if (steim_word_kernel == NULL)
+  {
+    steim_dispatch ();
+  }
+
+  return steim_kernel_name;
+}
+
+/*! @brief Decode a Steim1 or Steim2 payload into 32-bit integer samples
+ *
+ *  All differences are unpacked word by word into the output buffer first,
+ *  then integrated in a single prefix sum pass starting from X0.  A
+ *  mismatch between the last sample and Xn is not an error here, as in
+ *  libmseed, callers can compare against mseed3_steim_decode_xn().
+ *
+ *  @param[in] payload pointer to the payload, big-endian 64-byte frames
+ *  @param[in] payload_len length of the payload
+ *  @param[in] version Steim version, 1 or 2
+ *  @param[in] number_samples number of samples from the fixed header
+ *  @param[out] samples buffer for number_samples samples
+ *
+ *  @return number of samples decoded, or a negated mseed3_steim_status_e
+ */
+int64_t
+mseed3_steim_decode (const char *payload, uint64_t payload_len, int version, uint32_t number_samples,
+                     int32_t *samples)
+{
+  const struct steim_code_s *codes;
+  uint32_t decoded = 0;
+  uint32_t frame   = 0;
+  int32_t x0       = 0;
+
+  if (steim_word_kernel == NULL)
+  {
+    steim_dispatch ();
+  }
+
+  if (number_samples == 0)
+  {
+    return -MSEED3_STEIM_NO_SAMPLES;
+  }
+  if (payload_len < MSEED3_STEIM_FRAME_LEN)
+  {
+    return -MSEED3_STEIM_BAD_LENGTH;
+  }
+
+  codes = steim_codes[(version == 1) ? 0 : 1];
+
+  for (; payload_len >= MSEED3_STEIM_FRAME_LEN && decoded < number_samples;
+       payload += MSEED3_STEIM_FRAME_LEN, payload_len -= MSEED3_STEIM_FRAME_LEN, frame++)
+  {
+    uint32_t nibbles = steim_be32 (payload, 0);
+    int first_word   = 1;
+
+    /* Integration constants lead the first frame */
+    if (frame == 0)
+    {
+      x0         = (int32_t)steim_be32 (payload, 1);
+      first_word = 3;
+    }
+
+    for (int index = first_word; index < STEIM_FRAME_WORDS && decoded < number_samples; index++)
+    {
+      uint32_t nibble = (nibbles >> (30 - 2 * index)) & 0x3;
+      uint32_t word;
+      const struct steim_code_s *code;
+
+      if (nibble == 0)
+      {
+        continue;
+      }
+
+      word = steim_be32 (payload, index);
+      code = &codes[(nibble << 2) | (word >> 30)];
+
+      if (code->count == 0)
+      {
+        return -MSEED3_STEIM_BAD_NIBBLE;
+      }
+
+      decoded += steim_word_kernel (code, word, samples + decoded, number_samples - decoded);
+    }
+  }
+
+  if (decoded > number_samples)
+  {
+    decoded = number_samples;
+  }
+
+  if (decoded < number_samples)
+  {
+    return -MSEED3_STEIM_FEW_SAMPLES;
+  }
+
+  /* The first difference refers to the previous record, X0 is the first sample */
+  samples[0] = x0;
+  steim_integrate_kernel (samples, decoded);
+
+  return decoded;
+}
+
+/*! @brief Reverse integration constant of a Steim payload
+ *
+ *  @param[in] payload pointer to the payload, at least one frame long
+ *
+ */
+int32_t
+mseed3_steim_decode_xn (const char *payload)
+{
+  return (int32_t)steim_be32 (payload, 2);
+}
@@ -0,0 +1,252 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "steim.h"
+
+/* Words per frame, word 0 holds the 2-bit nibbles of all sixteen words */
+#define STEIM_FRAME_WORDS 16
+
+/* Read a big-endian 32-bit word */
+static inline uint32_t
+steim_word (const char *frame, int index)
+{
+  const uint8_t *word = (const uint8_t *)frame + 4 * index;
+
+  return ((uint32_t)word[0] << 24) | ((uint32_t)word[1] << 16) | ((uint32_t)word[2] << 8) | (uint32_t)word[3];
+}
+
+/* Split a data word into its difference count and bit width, 0 count on a reserved code */
+static inline int
+steim_layout (int version, uint32_t nibble, uint32_t word, int *width)
+{
+  uint32_t dnib = word >> 30;
+
+  switch (nibble)
+  {
+  case 1:
+    *width = 8;
+    return 4;
+  case 2:
+    if (version == 1)
+    {
+      *width = 16;
+      return 2;
+    }
+    switch (dnib)
+    {
+    case 1:
+      *width = 30;
+      return 1;
+    case 2:
+      *width = 15;
+      return 2;
+    case 3:
+      *width = 10;
+      return 3;
+    }
+    return 0;
+  case 3:
+    if (version == 1)
+    {
+      *width = 32;
+      return 1;
+    }
+    switch (dnib)
+    {
+    case 0:
+      *width = 6;
+      return 5;
+    case 1:
+      *width = 5;
+      return 6;
+    case 2:
+      *width = 4;
+      return 7;
+    }
+    return 0;
+  }
+
+  return 0;
+}
+
+/*! @brief Start verifying a Steim payload
+ *
+ *  @param[out] state verification state
+ *  @param[in] version Steim version, 1 or 2
+ *  @param[in] number_samples number of samples from the fixed header
+ *
+ */
+void
+mseed3_steim_init (struct mseed3_steim_state_s *state, int version, uint32_t number_samples)
+{
+  state->version        = version;
+  state->number_samples = number_samples;
+  state->samples        = 0;
+  state->frame          = 0;
+  state->x0             = 0;
+  state->xn             = 0;
+  state->last           = 0;
+  state->status         = MSEED3_STEIM_OK;
+  state->error_frame    = 0;
+  state->error_word     = 0;
+}
+
+/*! @brief Verify the next frames of a Steim payload in place
+ *
+ *  The differences are integrated without storing any sample, so only the
+ *  running last value is kept.  Words after the header number of samples is
+ *  reached are padding and are not inspected.  As in libmseed, a trailing
+ *  partial frame is ignored, so pieces other than the last must be whole frames.
+ *
+ *  @param[in,out] state verification state
+ *  @param[in] frames pointer to 64-byte frames
+ *  @param[in] length number of bytes
+ *
+ *  @return MSEED3_STEIM_OK or the first error found
+ */
+int
+mseed3_steim_feed (struct mseed3_steim_state_s *state, const char *frames, uint64_t length)
+{
+  if (state->status != MSEED3_STEIM_OK)
+  {
+    return state->status;
+  }
+
+  for (; length >= MSEED3_STEIM_FRAME_LEN && state->samples < state->number_samples;
+       frames += MSEED3_STEIM_FRAME_LEN, length -= MSEED3_STEIM_FRAME_LEN, state->frame++)
+  {
+    uint32_t nibbles = steim_word (frames, 0);
+    int first_word   = 1;
+
+    /* Integration constants lead the first frame */
+    if (state->frame == 0)
+    {
+      state->x0   = (int32_t)steim_word (frames, 1);
+      state->xn   = (int32_t)steim_word (frames, 2);
+      state->last = (uint32_t)state->x0;
+      first_word  = 3;
+    }
+
+    for (int index = first_word; index < STEIM_FRAME_WORDS && state->samples < state->number_samples; index++)
+    {
+      uint32_t nibble = (nibbles >> (30 - 2 * index)) & 0x3;
+      uint32_t word;
+      int width = 0;
+      int count;
+
+      if (nibble == 0)
+      {
+        continue;
+      }
+
+      word  = steim_word (frames, index);
+      count = steim_layout (state->version, nibble, word, &width);
+
+      if (count == 0)
+      {
+        state->error_frame = state->frame;
+        state->error_word  = (uint32_t)index;
+        state->status      = MSEED3_STEIM_BAD_NIBBLE;
+        return state->status;
+      }
+
+      for (int diff_idx = 0; diff_idx < count && state->samples < state->number_samples; diff_idx++)
+      {
+        int shift     = width * (count - 1 - diff_idx);
+        uint32_t bits = (width == 32) ? word : (word >> shift) & ((1u << width) - 1);
+        int32_t diff  = (width == 32) ? (int32_t)bits : (int32_t)(bits << (32 - width)) >> (32 - width);
+
+        /* The first difference refers to the previous record, X0 is the first sample */
+        if (state->samples > 0)
+        {
+          state->last += (uint32_t)diff;
+        }
+        state->samples++;
+      }
+    }
+  }
+
+  return state->status;
+}
+
+/*! @brief Complete verification once all frames have been supplied
+ *
+ *  @param[in,out] state verification state
+ *
+ *  @return MSEED3_STEIM_OK or the error found
+ */
+int
+mseed3_steim_finish (struct mseed3_steim_state_s *state)
+{
+  if (state->status != MSEED3_STEIM_OK)
+  {
+    return state->status;
+  }
+
+  if (state->number_samples == 0)
+  {
+    state->status = MSEED3_STEIM_NO_SAMPLES;
+  }
+  else if (state->frame == 0)
+  {
+    state->status = MSEED3_STEIM_BAD_LENGTH;
+  }
+  else if (state->samples < state->number_samples)
+  {
+    state->error_frame = state->frame - 1;
+    state->status      = MSEED3_STEIM_FEW_SAMPLES;
+  }
+  else if ((int32_t)state->last != state->xn)
+  {
+    state->error_frame = 0;
+    state->error_word  = 2;
+    state->status      = MSEED3_STEIM_BAD_XN;
+  }
+
+  return state->status;
+}
+
+/*! @brief Verify a complete Steim1 or Steim2 payload without decoding samples
+ *
+ *  @param[in] payload pointer to the payload
+ *  @param[in] payload_len length of the payload
+ *  @param[in] version Steim version, 1 or 2
+ *  @param[in] number_samples number of samples from the fixed header
+ *  @param[out] state verification state, holds error location and constants
+ *
+ *  @return MSEED3_STEIM_OK or the first error found
+ */
+int
+mseed3_steim_verify (const char *payload, uint64_t payload_len, int version, uint32_t number_samples,
+                     struct mseed3_steim_state_s *state)
+{
+  mseed3_steim_init (state, version, number_samples);
+  mseed3_steim_feed (state, payload, payload_len);
+
+  return mseed3_steim_finish (state);
+}
+
+/*! @brief Describe a Steim verification result
+ *
+ */
+const char *
+mseed3_steim_strerror (int status)
+{
+  switch (status)
+  {
+  case MSEED3_STEIM_OK:
+    return "valid";
+  case MSEED3_STEIM_BAD_LENGTH:
+    return "payload does not contain a whole 64-byte frame";
+  case MSEED3_STEIM_BAD_NIBBLE:
+    return "invalid difference code";
+  case MSEED3_STEIM_FEW_SAMPLES:
+    return "fewer samples than the header number of samples";
+  case MSEED3_STEIM_BAD_XN:
+    return "last sample does not match the reverse integration constant";
+  case MSEED3_STEIM_NO_SAMPLES:
+    return "header number of samples is zero";
+  }
+
+  return "unknown error";
+}
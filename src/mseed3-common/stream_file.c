@@ -0,0 +1,163 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "files.h"
+
+/* Bytes read and dropped at a time when skipping the unread rest of a record */
+#define STREAM_SKIP_LEN 65536
+
+/*! @brief Start reading an unseekable file, such as a pipe, front to back
+ *
+ *  Only the record being checked is held in memory.  The caller fills the
+ *  buffer with the leading bytes of the record, may read any further bytes
+ *  of it into its own buffer, and then moves on to the next record.
+ *
+ *  @param[in] file open file pointer, not closed by the stream
+ *  @param[out] stream stream description, release with mseed3_stream_close()
+ *
+ *  @return 0 on success, negative error code on failure
+ */
+int
+mseed3_stream_open (FILE *file, struct mseed3_stream_s *stream)
+{
+  memset (stream, 0, sizeof (struct mseed3_stream_s));
+
+  if (NULL == file)
+  {
+    return MSEED3_BAD_INPUT;
+  }
+
+  stream->file = file;
+
+  return 0;
+}
+
+/*! @brief Release the buffer of a stream
+ *
+ *  @param[in,out] stream stream description to release
+ *
+ */
+void
+mseed3_stream_close (struct mseed3_stream_s *stream)
+{
+  free (stream->data);
+  stream->data  = NULL;
+  stream->alloc = 0;
+  stream->fill  = 0;
+}
+
+/*! @brief Buffer the first bytes of the current record
+ *
+ *  The buffer starts at the current record and grows to exactly the length
+ *  asked for, so memory use is bounded by the largest length requested.
+ *
+ *  @param[in,out] stream open stream
+ *  @param[in] length number of bytes wanted from the start of the record
+ *
+ *  @return number of bytes buffered, less than length at the end of the input
+ */
+size_t
+mseed3_stream_fill (struct mseed3_stream_s *stream, size_t length)
+{
+  if (stream->fill >= length || stream->read > 0)
+  {
+    return stream->fill;
+  }
+
+  if (stream->alloc < length)
+  {
+    char *data = (char *)realloc (stream->data, length);
+
+    if (data == NULL)
+    {
+      stream->failed = true;
+      return stream->fill;
+    }
+
+    stream->data  = data;
+    stream->alloc = length;
+  }
+
+  while (stream->fill < length && !stream->eof)
+  {
+    size_t got = fread (stream->data + stream->fill, sizeof (char), length - stream->fill, stream->file);
+
+    stream->fill += got;
+
+    if (got == 0)
+    {
+      stream->eof    = true;
+      stream->failed = (ferror (stream->file) != 0);
+    }
+  }
+
+  return stream->fill;
+}
+
+/*! @brief Read bytes of the current record that follow the buffered ones
+ *
+ *  Used for records too large to buffer, the bytes go straight to the
+ *  caller and the buffered start of the record stays in place.
+ *
+ *  @param[in,out] stream open stream
+ *  @param[out] data destination of at least length bytes
+ *  @param[in] length number of bytes to read
+ *
+ *  @return number of bytes read, less than length at the end of the input
+ */
+size_t
+mseed3_stream_read (struct mseed3_stream_s *stream, char *data, size_t length)
+{
+  size_t total = 0;
+
+  while (total < length && !stream->eof)
+  {
+    size_t got = fread (data + total, sizeof (char), length - total, stream->file);
+
+    total += got;
+
+    if (got == 0)
+    {
+      stream->eof    = true;
+      stream->failed = (ferror (stream->file) != 0);
+    }
+  }
+
+  stream->read += total;
+
+  return total;
+}
+
+/*! @brief Move on to the record following the current one
+ *
+ *  Any bytes of the current record that were neither buffered nor read
+ *  are read and dropped, the input is never seeked.
+ *
+ *  @param[in,out] stream open stream
+ *  @param[in] length length of the current record
+ *
+ *  @return 0 on success, MSEED3_READ_ERROR if the input failed or ended early
+ */
+int
+mseed3_stream_next (struct mseed3_stream_s *stream, uint64_t length)
+{
+  uint64_t done = stream->fill + stream->read;
+  char skip[STREAM_SKIP_LEN];
+
+  while (done < length && !stream->eof)
+  {
+    size_t want = (length - done < STREAM_SKIP_LEN) ? (size_t)(length - done) : STREAM_SKIP_LEN;
+
+    done += mseed3_stream_read (stream, skip, want);
+  }
+
+  stream->offset += done;
+  stream->fill = 0;
+  stream->read = 0;
+
+  return (done < length || stream->failed) ? MSEED3_READ_ERROR : 0;
+}
@@ -0,0 +1,292 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "writer.h"
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <sys/uio.h>
+#include <unistd.h>
+#define MSEED3_HAVE_WRITEV 1
+#else
+#include <io.h>
+/* Same layout as the POSIX structure, written one entry at a time */
+struct iovec
+{
+  void *iov_base;
+  size_t iov_len;
+};
+#endif
+
+/* Writes at least this long are passed to writev() by reference instead of copied */
+#define WRITER_DIRECT_LEN (MSEED3_WRITER_BLOCK_LEN / 2)
+
+/* Write a set of buffers completely, resuming after partial writes */
+static int
+write_all (int fd, struct iovec *iov, int iov_cnt)
+{
+  while (iov_cnt > 0)
+  {
+#ifdef MSEED3_HAVE_WRITEV
+    ssize_t written = writev (fd, iov, iov_cnt);
+#else
+    int written = _write (fd, iov->iov_base, (unsigned int)iov->iov_len);
+#endif
+
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return MSEED3_WRITE_ERROR;
+    }
+
+    /* Skip what was written, possibly ending inside one buffer */
+    while (iov_cnt > 0 && (size_t)written >= iov->iov_len)
+    {
+      written -= iov->iov_len;
+      iov++;
+      iov_cnt--;
+    }
+
+    if (iov_cnt > 0)
+    {
+      iov->iov_base = (char *)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+
+  return 0;
+}
+
+/* Write the filled blocks, followed by an optional caller buffer, in one call */
+static int
+flush_blocks (struct mseed3_writer_s *writer, const char *data, size_t len)
+{
+  struct iovec iov[MSEED3_WRITER_BLOCKS + 1];
+  int iov_cnt = 0;
+  int rv;
+
+  for (int block = 0; block <= writer->current; block++)
+  {
+    if (writer->used[block] > 0)
+    {
+      iov[iov_cnt].iov_base = writer->buffer + (size_t)block * MSEED3_WRITER_BLOCK_LEN;
+      iov[iov_cnt].iov_len  = writer->used[block];
+      iov_cnt++;
+    }
+    writer->used[block] = 0;
+  }
+
+  if (len > 0)
+  {
+    iov[iov_cnt].iov_base = (void *)data;
+    iov[iov_cnt].iov_len  = len;
+    iov_cnt++;
+  }
+
+  writer->current = 0;
+
+  if (iov_cnt == 0 || writer->failed)
+  {
+    return writer->failed ? MSEED3_WRITE_ERROR : 0;
+  }
+
+  rv = write_all (writer->fd, iov, iov_cnt);
+  if (rv < 0)
+  {
+    writer->failed = true;
+  }
+
+  return rv;
+}
+
+/* Make sure the current block has room for len bytes, moving on or flushing */
+static char *
+reserve (struct mseed3_writer_s *writer, size_t len)
+{
+  if (MSEED3_WRITER_BLOCK_LEN - writer->used[writer->current] < len)
+  {
+    if (writer->current + 1 < MSEED3_WRITER_BLOCKS)
+    {
+      writer->current++;
+    }
+    else
+    {
+      flush_blocks (writer, NULL, 0);
+    }
+  }
+
+  return writer->buffer + (size_t)writer->current * MSEED3_WRITER_BLOCK_LEN + writer->used[writer->current];
+}
+
+/*! @brief Start buffering output for a file descriptor
+ *
+ *  @param[out] writer writer to initialise
+ *  @param[in] fd open file descriptor, not closed by the writer
+ *
+ *  @return 0 on success, MSEED3_MALLOC_ERROR if the buffer cannot be allocated
+ */
+int
+mseed3_writer_open (struct mseed3_writer_s *writer, int fd)
+{
+  memset (writer, 0, sizeof (struct mseed3_writer_s));
+  writer->fd = fd;
+
+  if ((writer->buffer = (char *)malloc ((size_t)MSEED3_WRITER_BLOCKS * MSEED3_WRITER_BLOCK_LEN)) == NULL)
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  return 0;
+}
+
+/*! @brief Flush and release a writer
+ *
+ */
+void
+mseed3_writer_close (struct mseed3_writer_s *writer)
+{
+  if (writer->buffer == NULL)
+  {
+    return;
+  }
+
+  flush_blocks (writer, NULL, 0);
+  free (writer->buffer);
+  writer->buffer = NULL;
+}
+
+/*! @brief Write out everything buffered so far
+ *
+ *  @return 0 on success, MSEED3_WRITE_ERROR once any write has failed
+ */
+int
+mseed3_writer_flush (struct mseed3_writer_s *writer)
+{
+  if (writer->buffer == NULL)
+  {
+    return 0;
+  }
+
+  return flush_blocks (writer, NULL, 0);
+}
+
+/*! @brief Append bytes to the output
+ *
+ *  Large writes are not copied, they are handed to the same writev() call
+ *  as the blocks buffered before them.
+ *
+ *  @param[in,out] writer open writer
+ *  @param[in] data bytes to write
+ *  @param[in] len number of bytes
+ *
+ */
+void
+mseed3_writer_write (struct mseed3_writer_s *writer, const char *data, size_t len)
+{
+  if (len >= WRITER_DIRECT_LEN)
+  {
+    flush_blocks (writer, data, len);
+    return;
+  }
+
+  memcpy (reserve (writer, len), data, len);
+  writer->used[writer->current] += len;
+}
+
+/*! @brief Get room for formatting output in place
+ *
+ *  The bytes are only output once passed to mseed3_writer_commit(), before
+ *  any other call on the writer.
+ *
+ *  @param[in,out] writer open writer
+ *  @param[in] len room needed, at most MSEED3_WRITER_BLOCK_LEN
+ *
+ *  @return position to format len bytes at
+ */
+char *
+mseed3_writer_reserve (struct mseed3_writer_s *writer, size_t len)
+{
+  return reserve (writer, len);
+}
+
+/*! @brief Output bytes formatted at the position returned by mseed3_writer_reserve()
+ *
+ *  @param[in,out] writer open writer
+ *  @param[in] len number of bytes formatted, at most the room reserved
+ *
+ */
+void
+mseed3_writer_commit (struct mseed3_writer_s *writer, size_t len)
+{
+  writer->used[writer->current] += len;
+}
+
+/*! @brief Append formatted text to the output
+ *
+ *  Text is formatted straight into the current block, only text longer
+ *  than a block goes through a temporary heap buffer.
+ *
+ */
+void
+mseed3_writer_vprintf (struct mseed3_writer_s *writer, const char *format, va_list ap)
+{
+  size_t space = MSEED3_WRITER_BLOCK_LEN - writer->used[writer->current];
+  char *position;
+  va_list retry;
+  int len;
+
+  va_copy (retry, ap);
+
+  position = writer->buffer + (size_t)writer->current * MSEED3_WRITER_BLOCK_LEN + writer->used[writer->current];
+  len      = vsnprintf (position, space, format, ap);
+
+  if (len < 0)
+  {
+    va_end (retry);
+    return;
+  }
+
+  if ((size_t)len < space)
+  {
+    writer->used[writer->current] += (size_t)len;
+  }
+  else if ((size_t)len < MSEED3_WRITER_BLOCK_LEN)
+  {
+    position = reserve (writer, (size_t)len + 1);
+    vsnprintf (position, (size_t)len + 1, format, retry);
+    writer->used[writer->current] += (size_t)len;
+  }
+  else
+  {
+    char *text = (char *)malloc ((size_t)len + 1);
+
+    if (text != NULL)
+    {
+      vsnprintf (text, (size_t)len + 1, format, retry);
+      mseed3_writer_write (writer, text, (size_t)len);
+      free (text);
+    }
+  }
+
+  va_end (retry);
+}
+
+/*! @brief Append formatted text to the output, printf style
+ *
+ */
+void
+mseed3_writer_printf (struct mseed3_writer_s *writer, const char *format, ...)
+{
+  va_list ap;
+
+  va_start (ap, format);
+  mseed3_writer_vprintf (writer, format, ap);
+  va_end (ap);
+}
@@ -0,0 +1,38 @@
+#ifndef __MSEED3_COMMON_WRITER_H__
+#define __MSEED3_COMMON_WRITER_H__
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Output is gathered in blocks and written with one writev() once all are full */
+#define MSEED3_WRITER_BLOCK_LEN 65536
+#define MSEED3_WRITER_BLOCKS 16
+
+/* Buffered writer on a file descriptor, see mseed3_writer_open() */
+struct mseed3_writer_s
+{
+    int fd;
+    char *buffer;
+    size_t used[MSEED3_WRITER_BLOCKS];
+    int current;
+    bool failed;
+};
+
+int mseed3_writer_open(struct mseed3_writer_s *writer, int fd);
+
+void mseed3_writer_close(struct mseed3_writer_s *writer);
+
+int mseed3_writer_flush(struct mseed3_writer_s *writer);
+
+void mseed3_writer_write(struct mseed3_writer_s *writer, const char *data, size_t len);
+
+char *mseed3_writer_reserve(struct mseed3_writer_s *writer, size_t len);
+
+void mseed3_writer_commit(struct mseed3_writer_s *writer, size_t len);
+
+void mseed3_writer_vprintf(struct mseed3_writer_s *writer, const char *format, va_list ap);
+
+void mseed3_writer_printf(struct mseed3_writer_s *writer, const char *format, ...);
+
+#endif /* __MSEED3_COMMON_WRITER_H__ */
@@ -0,0 +1,360 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <yyjson.h>
+
+#include <mseed3-common/format_number.h>
+#include <mseed3-common/writer.h>
+
+#include "json_writer.h"
+
+/* Spaces of one indentation level of YYJSON_WRITE_PRETTY */
+#define JSON_INDENT 4
+
+static const char spaces[] = "                                                                ";
+
+/*! @brief Start writing JSON to a file descriptor
+ *
+ *  @param[out] writer writer to initialise
+ *  @param[in] fd open file descriptor, not closed by the writer
+ *
+ *  @return 0 on success, MSEED3_MALLOC_ERROR if the output buffer cannot be allocated
+ */
+int
+json_writer_open (struct json_writer_s *writer, int fd)
+{
+  memset (writer, 0, sizeof (struct json_writer_s));
+
+  return mseed3_writer_open (&writer->output, fd);
+}
+
+/*! @brief Flush and release a writer
+ *
+ */
+void
+json_writer_close (struct json_writer_s *writer)
+{
+  mseed3_writer_close (&writer->output);
+  free (writer->pool);
+  writer->pool      = NULL;
+  writer->pool_size = 0;
+}
+
+/*! @brief Write text that is already JSON, such as separators between documents
+ *
+ */
+void
+json_writer_raw (struct json_writer_s *writer, const char *text, size_t len)
+{
+  mseed3_writer_write (&writer->output, text, len);
+}
+
+/*! @brief Open an object or array, members follow with json_writer_key() or json_writer_next()
+ *
+ *  @param[in,out] writer open writer
+ *  @param[in] open '{' or '['
+ *
+ */
+void
+json_writer_begin (struct json_writer_s *writer, char open)
+{
+  mseed3_writer_write (&writer->output, &open, 1);
+  writer->depth++;
+  writer->first = true;
+}
+
+/* Start a new line at the current depth */
+static void
+write_indent (struct json_writer_s *writer)
+{
+  size_t len = (size_t)writer->depth * JSON_INDENT;
+
+  mseed3_writer_write (&writer->output, "\n", 1);
+
+  while (len > 0)
+  {
+    size_t step = (len < sizeof (spaces) - 1) ? len : sizeof (spaces) - 1;
+
+    mseed3_writer_write (&writer->output, spaces, step);
+    len -= step;
+  }
+}
+
+/*! @brief Close the object or array opened last
+ *
+ *  @param[in,out] writer open writer
+ *  @param[in] close '}' or ']'
+ *
+ */
+void
+json_writer_end (struct json_writer_s *writer, char close)
+{
+  writer->depth--;
+
+  if (!writer->first)
+  {
+    write_indent (writer);
+  }
+
+  mseed3_writer_write (&writer->output, &close, 1);
+  writer->first = false;
+}
+
+/*! @brief Start the next element of an array
+ *
+ */
+void
+json_writer_next (struct json_writer_s *writer)
+{
+  if (!writer->first)
+  {
+    mseed3_writer_write (&writer->output, ",", 1);
+  }
+
+  write_indent (writer);
+  writer->first = false;
+}
+
+/*! @brief Start the next member of an object, its value follows
+ *
+ *  @param[in,out] writer open writer
+ *  @param[in] key member name
+ *
+ */
+void
+json_writer_key (struct json_writer_s *writer, const char *key)
+{
+  json_writer_next (writer);
+  json_writer_string (writer, key, strlen (key));
+  mseed3_writer_write (&writer->output, ": ", 2);
+}
+
+/*! @brief Write a string value, escaping quotes, backslashes and control characters
+ *
+ *  @param[in,out] writer open writer
+ *  @param[in] text string, not necessarily NUL terminated
+ *  @param[in] len length of text in bytes
+ *
+ */
+void
+json_writer_string (struct json_writer_s *writer, const char *text, size_t len)
+{
+  static const char hex[] = "0123456789abcdef";
+  const char *end         = text + len;
+  const char *run         = text;
+
+  mseed3_writer_write (&writer->output, "\"", 1);
+
+  for (; text < end; text++)
+  {
+    unsigned char c = (unsigned char)*text;
+    char escape[6];
+
+    if (c >= 0x20 && c != '"' && c != '\\')
+    {
+      continue;
+    }
+
+    mseed3_writer_write (&writer->output, run, (size_t)(text - run));
+    run = text + 1;
+
+    switch (c)
+    {
+    case '"':
+      mseed3_writer_write (&writer->output, "\\\"", 2);
+      break;
+    case '\\':
+      mseed3_writer_write (&writer->output, "\\\\", 2);
+      break;
+    case '\b':
+      mseed3_writer_write (&writer->output, "\\b", 2);
+      break;
+    case '\f':
+      mseed3_writer_write (&writer->output, "\\f", 2);
+      break;
+    case '\n':
+      mseed3_writer_write (&writer->output, "\\n", 2);
+      break;
+    case '\r':
+      mseed3_writer_write (&writer->output, "\\r", 2);
+      break;
+    case '\t':
+      mseed3_writer_write (&writer->output, "\\t", 2);
+      break;
+    default:
+      memcpy (escape, "\\u00", 4);
+      escape[4] = hex[c >> 4];
+      escape[5] = hex[c & 0xF];
+      mseed3_writer_write (&writer->output, escape, 6);
+      break;
+    }
+  }
+
+  mseed3_writer_write (&writer->output, run, (size_t)(text - run));
+  mseed3_writer_write (&writer->output, "\"", 1);
+}
+
+/*! @brief Write an integer value
+ *
+ */
+void
+json_writer_int (struct json_writer_s *writer, int64_t value)
+{
+  char *position = mseed3_writer_reserve (&writer->output, MSEED3_NUMBER_LEN);
+
+  mseed3_writer_commit (&writer->output, mseed3_format_int64 (position, value));
+}
+
+/*! @brief Write a boolean value
+ *
+ */
+void
+json_writer_bool (struct json_writer_s *writer, bool value)
+{
+  if (value)
+    mseed3_writer_write (&writer->output, "true", 4);
+  else
+    mseed3_writer_write (&writer->output, "false", 5);
+}
+
+/* Keep a ".0" on integral reals as yyjson writes them, so they still read as reals */
+static void
+commit_real (struct json_writer_s *writer, char *position, size_t len)
+{
+  size_t digits = (position[0] == '-') ? 1 : 0;
+
+  digits += strspn (position + digits, "0123456789");
+
+  if (digits == len)
+  {
+    memcpy (position + len, ".0", 2);
+    len += 2;
+  }
+
+  mseed3_writer_commit (&writer->output, len);
+}
+
+/*! @brief Write a real value with the fewest digits that read back to the same double
+ *
+ *  NaN and infinity have no JSON form and are written as null.
+ *
+ */
+void
+json_writer_real (struct json_writer_s *writer, double value)
+{
+  char *position;
+
+  if (!isfinite (value))
+  {
+    mseed3_writer_write (&writer->output, "null", 4);
+    return;
+  }
+
+  position = mseed3_writer_reserve (&writer->output, MSEED3_NUMBER_LEN);
+  commit_real (writer, position, mseed3_format_double (position, value));
+}
+
+/*! @brief Write a float sample with the fewest digits that read back to the same float
+ *
+ */
+void
+json_writer_float (struct json_writer_s *writer, float value)
+{
+  char *position;
+
+  if (!isfinite (value))
+  {
+    mseed3_writer_write (&writer->output, "null", 4);
+    return;
+  }
+
+  position = mseed3_writer_reserve (&writer->output, MSEED3_NUMBER_LEN);
+  commit_real (writer, position, mseed3_format_float (position, value));
+}
+
+/* Write a checked JSON document without the whitespace between its tokens */
+static void
+write_minified (struct json_writer_s *writer, const char *json, size_t len)
+{
+  const char *end = json + len;
+  const char *run = json;
+  bool in_string  = false;
+
+  for (const char *position = json; position < end; position++)
+  {
+    if (in_string)
+    {
+      if (*position == '\\')
+        position++;
+      else if (*position == '"')
+        in_string = false;
+    }
+    else if (*position == '"')
+    {
+      in_string = true;
+    }
+    else if (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r')
+    {
+      mseed3_writer_write (&writer->output, run, (size_t)(position - run));
+      run = position + 1;
+    }
+  }
+
+  mseed3_writer_write (&writer->output, run, (size_t)(end - run));
+}
+
+/*! @brief Write a JSON document held as text, such as extra headers, as a value
+ *
+ *  The document is parsed to check it is valid JSON, into memory kept for
+ *  the next document, and written as given or without whitespace.
+ *
+ *  @param[in,out] writer open writer
+ *  @param[in] json document text
+ *  @param[in] len length of json in bytes
+ *  @param[in] minify drop whitespace between tokens
+ *  @param[out] error parse error if the document is not valid
+ *
+ *  @return false if the document is not valid JSON, nothing is written then
+ */
+bool
+json_writer_document (struct json_writer_s *writer, const char *json, size_t len, bool minify, yyjson_read_err *error)
+{
+  size_t pool_size = yyjson_read_max_memory_usage (len, YYJSON_READ_NOFLAG);
+  yyjson_alc allocator;
+  yyjson_alc *pool = NULL;
+  yyjson_doc *document;
+
+  if (pool_size > writer->pool_size)
+  {
+    void *grown = realloc (writer->pool, pool_size);
+
+    if (grown != NULL)
+    {
+      writer->pool      = grown;
+      writer->pool_size = pool_size;
+    }
+  }
+
+  if (pool_size <= writer->pool_size && yyjson_alc_pool_init (&allocator, writer->pool, writer->pool_size))
+  {
+    pool = &allocator;
+  }
+
+  /* Without YYJSON_READ_INSITU the text is only read */
+  if ((document = yyjson_read_opts ((char *)json, len, YYJSON_READ_NOFLAG, pool, error)) == NULL)
+  {
+    return false;
+  }
+
+  yyjson_doc_free (document);
+
+  if (minify)
+    write_minified (writer, json, len);
+  else
+    mseed3_writer_write (&writer->output, json, len);
+
+  return true;
+}
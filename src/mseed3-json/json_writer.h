@@ -0,0 +1,53 @@
+#ifndef __MSEED3JSON_JSON_WRITER_H__
+#define __MSEED3JSON_JSON_WRITER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <yyjson.h>
+
+#include <mseed3-common/writer.h>
+
+/* Pretty printed JSON written in document order straight to a buffered
+ * writer, with the layout of YYJSON_WRITE_PRETTY.  Memory use does not
+ * depend on the size of the document, see json_writer_open() */
+struct json_writer_s
+{
+    struct mseed3_writer_s output;
+    int depth;
+    bool first;
+
+    /* Memory extra headers are parsed into to check them, reused by every record */
+    void *pool;
+    size_t pool_size;
+};
+
+int json_writer_open(struct json_writer_s *writer, int fd);
+
+void json_writer_close(struct json_writer_s *writer);
+
+void json_writer_raw(struct json_writer_s *writer, const char *text, size_t len);
+
+void json_writer_begin(struct json_writer_s *writer, char open);
+
+void json_writer_end(struct json_writer_s *writer, char close);
+
+void json_writer_key(struct json_writer_s *writer, const char *key);
+
+void json_writer_next(struct json_writer_s *writer);
+
+void json_writer_string(struct json_writer_s *writer, const char *text, size_t len);
+
+void json_writer_int(struct json_writer_s *writer, int64_t value);
+
+void json_writer_bool(struct json_writer_s *writer, bool value);
+
+void json_writer_real(struct json_writer_s *writer, double value);
+
+void json_writer_float(struct json_writer_s *writer, float value);
+
+bool json_writer_document(struct json_writer_s *writer, const char *json, size_t len, bool minify,
+                          yyjson_read_err *error);
+
+#endif /* __MSEED3JSON_JSON_WRITER_H__ */
@@ -1,16 +1,22 @@
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <libmseed.h>
 #include <yyjson.h>
 
+#include "json_writer.h"
 #include "mseed3-json_config.h"
 #include <mseed3-common/cmd_opt.h>
+#include <mseed3-common/crc32c.h>
+#include <mseed3-common/decode.h>
 #include <mseed3-common/files.h>
 #include <mseed3-common/mseed3_string.h>
+#include <mseed3-common/stats.h>
 
 #if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
 #include <mseed3-common/vcs_getopt.h>
+#define STDOUT_FILENO 1
 #else
 
 #include <getopt.h>
@@ -24,10 +30,14 @@ static const struct mseed3_option_s args[] = {
     {'v', "verbose", "Verbosity level", NULL, OPTIONAL_OPTARG},
     {'d', "data", "   Include data payload, default is without", NULL, OPTIONAL_OPTARG},
     {'B', "bare", "   Omit top-level array wrapper", NULL, OPTIONAL_OPTARG},
+    {'m', "minify", " Print extra headers without whitespace, default is as stored in the record", NULL,
+     OPTIONAL_OPTARG},
+    {'S', "stats", "  Print time spent per stage to stderr at exit, text (default) or json", NULL, OPTIONAL_OPTARG},
     {'V', "version", "Print program version", NULL, OPTIONAL_OPTARG},
     {0, 0, 0, 0, 0}};
 
-int print_mseed3_2_json (char *file_name, bool print_data, bool print_array, uint8_t verbose);
+int print_mseed3_2_json (struct json_writer_s *writer, char *file_name, const char *path, bool print_data,
+                         bool print_array, bool minify, uint8_t verbose);
 
 /*! @brief Program to Print a miniSEED file in JSON format
  *
@@ -47,6 +57,13 @@ main (int argc, char **argv)
   char *file_name                = NULL;
   bool print_data                = false;
   bool print_array               = true;
+  bool minify                    = false;
+  bool stats                     = false;
+  bool stats_json                = false;
+  MS3Record *msr                 = NULL;
+  FILE *file                     = NULL;
+  struct mseed3_input_s input;
+  struct json_writer_s writer;
 
   /* parse command line args */
   mseed3_get_short_getopt_string (&short_opt_string, args);
@@ -62,6 +79,17 @@ main (int argc, char **argv)
     case 'B':
       print_array = false;
       break;
+    case 'm':
+      minify = true;
+      break;
+    case 'S':
+      if (!mseed3_stats_parse_format (optarg, &stats_json))
+      {
+        fprintf (stderr, "Error: Unknown stats format: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      stats = true;
+      break;
     case 'v':
       if (0 == optarg)
       {
@@ -107,6 +135,17 @@ main (int argc, char **argv)
   free (long_opt_array);
   free (short_opt_string);
 
+  if (stats)
+  {
+    mseed3_stats_enable ();
+  }
+
+  if (json_writer_open (&writer, STDOUT_FILENO) < 0)
+  {
+    fprintf (stderr, "Error: Cannot allocate output buffer\n");
+    return EXIT_FAILURE;
+  }
+
   while (argc > optind)
   {
     file_name = argv[optind++];
@@ -117,25 +156,78 @@ main (int argc, char **argv)
       continue;
     }
 
-    print_mseed3_2_json (file_name, print_data, print_array, verbose);
+    if ((file = fopen (file_name, "rb")) == NULL)
+    {
+      fprintf (stderr, "Error reading file: %s, fopen failure\n", file_name);
+      continue;
+    }
+
+    /* Compressed files are decompressed on a worker thread while records are printed */
+    if (mseed3_input_open (file, &input) < 0)
+    {
+      fprintf (stderr, "Error reading file: %s, cannot read %s compressed input!\n", file_name,
+               mseed3_compression_name (input.compression));
+      mseed3_input_close (&input);
+      fclose (file);
+      continue;
+    }
+
+    mseed3_stats_count (1, 0, 0);
+    print_mseed3_2_json (&writer, file_name, mseed3_input_path (&input, file_name), print_data, print_array, minify,
+                         verbose);
+
+    /* libmseed must let go of the input before the worker thread is stopped, whatever path the
+     * conversion returned from */
+    ms3_readmsr (&msr, NULL, 0, 0);
+
+    if (mseed3_input_close (&input) < 0)
+    {
+      fprintf (stderr, "Error reading file: %s, corrupt %s compressed data!\n", file_name,
+               mseed3_compression_name (input.compression));
+    }
+    fclose (file);
   }
 
+  /* Output still buffered is part of the output stage */
+  mseed3_stats_enter (MSEED3_STAGE_OUTPUT);
+  json_writer_close (&writer);
+  mseed3_stats_print (stderr, "mseed3-json", stats_json);
+
   return 0;
 }
 
+/*! @brief Print the records of a miniSEED file as JSON
+ *
+ *  Each record is written field by field in a fixed order straight to the
+ *  output buffer, extra headers are checked and copied as stored in the
+ *  record, so memory use does not grow with the number of records or samples.
+ *
+ *  @param[in,out] writer JSON output
+ *  @param[in] file_name file name given on the cmd line
+ *  @param[in] path path libmseed reads the records from
+ *  @param[in] print_data include the data samples
+ *  @param[in] print_array wrap the records in an array
+ *  @param[in] minify write extra headers without whitespace
+ *  @param[in] verbose verbosity level
+ *
+ *  @return EXIT_SUCCESS, or EXIT_FAILURE if a record could not be printed
+ */
 int
-print_mseed3_2_json (char *file_name, bool print_data, bool print_array, uint8_t verbose)
+print_mseed3_2_json (struct json_writer_s *writer, char *file_name, const char *path, bool print_data,
+                     bool print_array, bool minify, uint8_t verbose)
 {
   MS3Record *msr = NULL;
 
   char string[1024];
-  uint32_t flags   = 0;
-  uint64_t records = 0;
+  uint32_t flags     = 0;
+  uint64_t records   = 0;
+  bool records_valid = true;
+  int stage;
 
-  yyjson_mut_doc *mut_doc;
-  yyjson_doc *ehdoc;
-  yyjson_read_err rerr;
-  bool rv = true;
+  /* Names of the bits of the record flags, in bit order */
+  static const char *flag_names[8] = {"CalibrationSignalsPresent", "TimeTagQuestionable", "ClockLocked",
+                                      "ReservedBit3", "ReservedBit4", "ReservedBit5", "ReservedBit6",
+                                      "ReservedBit7"};
 
   if (!mseed3_file_exists (file_name))
   {
@@ -143,221 +235,162 @@ print_mseed3_2_json (char *file_name, bool print_data, bool print_array, uint8_t
     return EXIT_FAILURE;
   }
 
-  /* Set flags to check CRC and unpack data */
-  flags |= MSF_VALIDATECRC;
-  if (print_data)
-    flags |= MSF_UNPACKDATA;
+  /* The CRC is checked and the data samples decoded separately for each record */
 
   if (print_array)
-    printf ("[");
+    json_writer_raw (writer, "[", 1);
 
   /* Loop over all records in input file,
    * Add 1 to verbose level as verbose = 1 prints nothing extra */
-  while ((ms3_readmsr (&msr, file_name, flags, verbose + 1) == MS_NOERROR))
+  stage = mseed3_stats_enter (MSEED3_STAGE_READ);
+  while ((ms3_readmsr (&msr, path, flags, verbose + 1) == MS_NOERROR))
   {
-    mut_doc = yyjson_mut_doc_new (NULL);
-
-    if (!mut_doc)
-    {
-      fprintf (stderr, "Cannot initialize JSON document, out of memory?\n");
-      return EXIT_FAILURE;
-    }
+    mseed3_stats_enter (MSEED3_STAGE_CRC);
+    mseed3_stats_count (0, 1, msr->reclen);
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/SID", yyjson_mut_str (mut_doc, msr->sid)))
+    if (msr->crc != mseed3_record_crc (msr->record, msr->reclen))
     {
-      fprintf (stderr, "Something went wrong generating JSON : SID\n");
-      return EXIT_FAILURE;
-    }
-
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/RecordLength", yyjson_mut_sint (mut_doc, msr->reclen)))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : RecordLength\n");
-      return EXIT_FAILURE;
+      fprintf (stderr, "Error: CRC mismatch in record %" PRIu64 " of %s\n", records, file_name);
+      records_valid = false;
+      break;
     }
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/FormatVersion", yyjson_mut_sint (mut_doc, msr->formatversion)))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : FormatVersion\n");
-      return EXIT_FAILURE;
-    }
+    mseed3_stats_enter (MSEED3_STAGE_PAYLOAD);
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/Flags/RawUInt8", yyjson_mut_uint (mut_doc, msr->flags)))
+    if (print_data && mseed3_decode_samples (msr, verbose + 1) < 0)
     {
-      fprintf (stderr, "Something went wrong generating JSON : Flags RawUint8\n");
-      return EXIT_FAILURE;
+      fprintf (stderr, "Error: Cannot decode data samples in record %" PRIu64 " of %s\n", records, file_name);
+      records_valid = false;
+      break;
     }
 
-    /* Add boolean entries for each bit flag set */
-    if (msr->flags)
+    if (msr->numsamples > 0 && ms_samplesize (msr->sampletype) == 0)
     {
-      if (bit (msr->flags, 0x01))
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Flags/CalibrationSignalsPresent", yyjson_mut_bool (mut_doc, true));
-      if (rv && bit (msr->flags, 0x02))
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Flags/TimeTagQuestionable", yyjson_mut_bool (mut_doc, true));
-      if (rv && bit (msr->flags, 0x04))
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Flags/ClockLocked", yyjson_mut_bool (mut_doc, true));
-      if (rv && bit (msr->flags, 0x08))
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Flags/ReservedBit3", yyjson_mut_bool (mut_doc, true));
-      if (rv && bit (msr->flags, 0x10))
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Flags/ReservedBit4", yyjson_mut_bool (mut_doc, true));
-      if (rv && bit (msr->flags, 0x20))
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Flags/ReservedBit5", yyjson_mut_bool (mut_doc, true));
-      if (rv && bit (msr->flags, 0x40))
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Flags/ReservedBit6", yyjson_mut_bool (mut_doc, true));
-      if (rv && bit (msr->flags, 0x80))
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Flags/ReservedBit7", yyjson_mut_bool (mut_doc, true));
-
-      if (rv == false)
-      {
-        fprintf (stderr, "Something went wrong generating JSON : Flags values\n");
-        return EXIT_FAILURE;
-      }
+      fprintf (stderr, "Unrecognized sample type: '%c'\n", msr->sampletype);
+      records_valid = false;
+      break;
     }
 
-    ms_nstime2timestr (msr->starttime, string, ISOMONTHDAY_Z, NANO);
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/StartTime", yyjson_mut_strcpy (mut_doc, string)))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : StartTime\n");
-      return EXIT_FAILURE;
-    }
+    mseed3_stats_enter (MSEED3_STAGE_OUTPUT);
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/EncodingFormat", yyjson_mut_sint (mut_doc, msr->encoding)))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : EncodingFormat\n");
-      return EXIT_FAILURE;
-    }
+    if (records > 0)
+      json_writer_raw (writer, ",", 1);
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/SampleRate", yyjson_mut_real (mut_doc, msr3_sampratehz (msr))))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : SampleRate\n");
-      return EXIT_FAILURE;
-    }
+    json_writer_begin (writer, '{');
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/SampleCount", yyjson_mut_sint (mut_doc, msr->samplecnt)))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : SampleCount\n");
-      return EXIT_FAILURE;
-    }
+    json_writer_key (writer, "SID");
+    json_writer_string (writer, msr->sid, strlen (msr->sid));
+    json_writer_key (writer, "RecordLength");
+    json_writer_int (writer, msr->reclen);
+    json_writer_key (writer, "FormatVersion");
+    json_writer_int (writer, msr->formatversion);
 
-    sprintf (string, "0x%0X", msr->crc);
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/CRC", yyjson_mut_strcpy (mut_doc, string)))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : CRC\n");
-      return EXIT_FAILURE;
-    }
+    /* Raw flags, followed by a boolean entry for each bit set */
+    json_writer_key (writer, "Flags");
+    json_writer_begin (writer, '{');
+    json_writer_key (writer, "RawUInt8");
+    json_writer_int (writer, msr->flags);
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/PublicationVersion", yyjson_mut_sint (mut_doc, msr->pubversion)))
+    for (int flag = 0; flag < 8; flag++)
     {
-      fprintf (stderr, "Something went wrong generating JSON : PublicationVersion\n");
-      return EXIT_FAILURE;
+      if (bit (msr->flags, 1 << flag))
+      {
+        json_writer_key (writer, flag_names[flag]);
+        json_writer_bool (writer, true);
+      }
     }
+    json_writer_end (writer, '}');
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/ExtraLength", yyjson_mut_sint (mut_doc, msr->extralength)))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : ExtraLength\n");
-      return EXIT_FAILURE;
-    }
+    ms_nstime2timestr (msr->starttime, string, ISOMONTHDAY_Z, NANO);
+    json_writer_key (writer, "StartTime");
+    json_writer_string (writer, string, strlen (string));
+    json_writer_key (writer, "EncodingFormat");
+    json_writer_int (writer, msr->encoding);
+    json_writer_key (writer, "SampleRate");
+    json_writer_real (writer, msr3_sampratehz (msr));
+    json_writer_key (writer, "SampleCount");
+    json_writer_int (writer, msr->samplecnt);
 
-    if (!yyjson_mut_doc_ptr_set (mut_doc, "/DataLength", yyjson_mut_sint (mut_doc, msr->datalength)))
-    {
-      fprintf (stderr, "Something went wrong generating JSON : DataLength\n");
-      return EXIT_FAILURE;
-    }
+    sprintf (string, "0x%0X", msr->crc);
+    json_writer_key (writer, "CRC");
+    json_writer_string (writer, string, strlen (string));
+    json_writer_key (writer, "PublicationVersion");
+    json_writer_int (writer, msr->pubversion);
+    json_writer_key (writer, "ExtraLength");
+    json_writer_int (writer, msr->extralength);
+    json_writer_key (writer, "DataLength");
+    json_writer_int (writer, msr->datalength);
 
     if (msr->extralength > 0 && msr->extra)
     {
-      ehdoc = yyjson_read_opts (msr->extra, msr->extralength, 0, NULL, &rerr);
+      int previous = mseed3_stats_enter (MSEED3_STAGE_EXTRA_HEADER);
+      yyjson_read_err error;
 
-      if (!yyjson_mut_doc_ptr_set (mut_doc, "/ExtraHeaders",
-                                   yyjson_mut_doc_get_root (yyjson_doc_mut_copy(ehdoc, NULL))))
+      json_writer_key (writer, "ExtraHeaders");
+
+      if (!json_writer_document (writer, msr->extra, msr->extralength, minify, &error))
       {
-        fprintf (stderr, "Something went wrong generating JSON : ExtraHeaders\n");
-        return EXIT_FAILURE;
+        fprintf (stderr, "Error: Cannot parse extra headers in record %" PRIu64 " of %s, byte %zu: %s\n", records,
+                 file_name, error.pos, error.msg);
+        json_writer_raw (writer, "null", 4);
+        records_valid = false;
       }
+      mseed3_stats_leave (previous);
     }
 
-    /* Build array of data samples if present */
+    /* Data samples, with the loop for the sample type chosen once per record */
     if (msr->numsamples > 0)
     {
-      yyjson_mut_val *array;
-      int samplesize;
-      void *sptr;
-
-      if ((samplesize = ms_samplesize (msr->sampletype)) == 0)
-      {
-        fprintf (stderr, "Unrecognized sample type: '%c'\n", msr->sampletype);
-        return EXIT_FAILURE;
-      }
-
-      if (msr->sampletype == 't')
-      {
-        rv = yyjson_mut_doc_ptr_set (mut_doc, "/Data",
-                                     yyjson_mut_strn (mut_doc,
-                                                      (const char *)msr->datasamples,
-                                                      msr->numsamples));
+      json_writer_key (writer, "Data");
 
-        if (rv == false)
-        {
-          fprintf (stderr, "Something went wrong generating JSON : Data (Text)\n");
-          return EXIT_FAILURE;
-        }
-      }
-      else
+      switch (msr->sampletype)
       {
-        if ((array = yyjson_mut_arr (mut_doc)) == NULL ||
-            !yyjson_mut_doc_ptr_set (mut_doc, "/Data", array))
+      case 't':
+        json_writer_string (writer, (const char *)msr->datasamples, (size_t)msr->numsamples);
+        break;
+      case 'i':
+        json_writer_begin (writer, '[');
+        for (int64_t i = 0; i < msr->numsamples; i++)
         {
-          fprintf (stderr, "Something went wrong generating JSON : Data array\n");
-          return EXIT_FAILURE;
+          json_writer_next (writer);
+          json_writer_int (writer, ((const int32_t *)msr->datasamples)[i]);
         }
-
-        for (int i = 0; i < msr->numsamples && rv != false; i++)
+        json_writer_end (writer, ']');
+        break;
+      case 'f':
+        json_writer_begin (writer, '[');
+        for (int64_t i = 0; i < msr->numsamples; i++)
         {
-          sptr = (char *)msr->datasamples + (i * samplesize);
-
-          if (msr->sampletype == 'i')
-          {
-            rv = yyjson_mut_arr_append (array, yyjson_mut_sint (mut_doc, *(int32_t *)sptr));
-          }
-          else if (msr->sampletype == 'f')
-          {
-            rv = yyjson_mut_arr_append (array, yyjson_mut_real (mut_doc, *(float *)sptr));
-          }
-          else if (msr->sampletype == 'd')
-          {
-            rv = yyjson_mut_arr_append (array, yyjson_mut_real (mut_doc, *(double *)sptr));
-          }
+          json_writer_next (writer);
+          json_writer_float (writer, ((const float *)msr->datasamples)[i]);
         }
-
-        if (rv == false)
+        json_writer_end (writer, ']');
+        break;
+      case 'd':
+        json_writer_begin (writer, '[');
+        for (int64_t i = 0; i < msr->numsamples; i++)
         {
-          fprintf (stderr, "Something went wrong generating JSON : Data (numeric)\n");
-          return EXIT_FAILURE;
+          json_writer_next (writer);
+          json_writer_real (writer, ((const double *)msr->datasamples)[i]);
         }
+        json_writer_end (writer, ']');
+        break;
       }
     }
 
-    yyjson_write_err werr;
-    char *serialized = yyjson_mut_write_opts (mut_doc, YYJSON_WRITE_PRETTY, NULL, NULL, &werr);
-
-    if (serialized == NULL)
-    {
-      fprintf (stderr, "Something went wrong generating JSON : %s\n", werr.msg);
-      return EXIT_FAILURE;
-    }
-
-    printf ("%s%s", (records == 0) ? "" : ",", serialized);
-
-    yyjson_mut_doc_free (mut_doc);
+    json_writer_end (writer, '}');
 
     records += 1;
+    mseed3_stats_enter (MSEED3_STAGE_READ);
   } /* End of loop over records */
 
+  mseed3_stats_leave (stage);
+
   if (print_array)
-    printf ("]");
+    json_writer_raw (writer, "]", 1);
 
   if (msr)
     ms3_readmsr (&msr, NULL, flags, verbose + 1);
 
-  return EXIT_SUCCESS;
+  return (records_valid) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
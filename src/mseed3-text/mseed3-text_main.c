@@ -1,12 +1,17 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <libmseed.h>
 #include "mseed3-text_config.h"
 #include <mseed3-common/cmd_opt.h>
+#include <mseed3-common/crc32c.h>
+#include <mseed3-common/decode.h>
 #include <mseed3-common/files.h>
+#include <mseed3-common/format_number.h>
 #include <mseed3-common/mseed3_string.h>
+#include <mseed3-common/stats.h>
 
 #if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
 #include <mseed3-common/vcs_getopt.h>
@@ -22,9 +27,59 @@ static const struct mseed3_option_s args[] = {
     {'h', "help", "   Display usage information", NULL, NO_OPTARG},
     {'v', "verbose", "Verbosity level", NULL, OPTIONAL_OPTARG},
     {'d', "data", "   Print data payload", NULL, OPTIONAL_OPTARG},
+    {'S', "stats", "  Print time spent per stage to stderr at exit, text (default) or json", NULL, OPTIONAL_OPTARG},
     {'V', "version", "Print program version", NULL, OPTIONAL_OPTARG},
     {0, 0, 0, 0, 0}};
 
+/* Numbers printed on each line of data samples */
+#define SAMPLE_COLUMNS 6
+
+/* Width numbers are right aligned to, as printf ("%10d  ") wrote them */
+#define SAMPLE_WIDTH 10
+
+/* Line of data samples gathered before it is printed */
+struct sample_line_s
+{
+  char text[SAMPLE_COLUMNS * (MSEED3_NUMBER_LEN + SAMPLE_WIDTH) + 1];
+  size_t used;
+  int columns;
+};
+
+/* Room for the next number, formatted after the padding it may need */
+static char *
+sample_column (struct sample_line_s *line)
+{
+  return line->text + line->used + SAMPLE_WIDTH;
+}
+
+/* Print the samples gathered and start a new line */
+static void
+end_sample_line (struct sample_line_s *line)
+{
+  line->text[line->used++] = '\n';
+  fwrite (line->text, 1, line->used, stdout);
+  line->used    = 0;
+  line->columns = 0;
+}
+
+/* Right align the number just formatted and print the line once it is full */
+static void
+end_sample_column (struct sample_line_s *line, size_t len)
+{
+  char *column = line->text + line->used;
+  size_t pad   = (len < SAMPLE_WIDTH) ? SAMPLE_WIDTH - len : 0;
+
+  memmove (column + pad, column + SAMPLE_WIDTH, len);
+  memset (column, ' ', pad);
+  memcpy (column + pad + len, "  ", 2);
+  line->used += pad + len + 2;
+
+  if (++line->columns == SAMPLE_COLUMNS)
+  {
+    end_sample_line (line);
+  }
+}
+
 /*! @brief Prints miniSEED file contents in human readable format
  *
  */
@@ -42,7 +97,12 @@ main (int argc, char **argv)
   unsigned char display_revision = 0;
   uint8_t verbose                = 0;
   bool print_data                = false;
+  bool stats                     = false;
+  bool stats_json                = false;
   char *file_name                = NULL;
+  FILE *file                     = NULL;
+  struct mseed3_input_s input;
+  int stage;
 
   /* parse command line args */
   mseed3_get_short_getopt_string (&short_opt_string, args);
@@ -55,6 +115,14 @@ main (int argc, char **argv)
     case 'd':
       print_data = true;
       break;
+    case 'S':
+      if (!mseed3_stats_parse_format (optarg, &stats_json))
+      {
+        fprintf (stderr, "Error: Unknown stats format: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      stats = true;
+      break;
     case 'v':
       if (0 == optarg)
       {
@@ -100,10 +168,12 @@ main (int argc, char **argv)
   free (long_opt_array);
   free (short_opt_string);
 
-  /* Set flags to check CRC and unpack data */
-  flags |= MSF_VALIDATECRC;
-  if (print_data)
-    flags |= MSF_UNPACKDATA;
+  if (stats)
+  {
+    mseed3_stats_enable ();
+  }
+
+  /* The CRC is checked and the data samples decoded separately for each record */
 
   while (argc > optind)
   {
@@ -115,22 +185,57 @@ main (int argc, char **argv)
       continue;
     }
 
+    if ((file = fopen (file_name, "rb")) == NULL)
+    {
+      fprintf (stderr, "Error reading file: %s, fopen failure \n", file_name);
+      continue;
+    }
+
+    /* Compressed files are decompressed on a worker thread while records are printed */
+    if (mseed3_input_open (file, &input) < 0)
+    {
+      fprintf (stderr, "Error reading file: %s, cannot read %s compressed input! \n", file_name,
+               mseed3_compression_name (input.compression));
+      mseed3_input_close (&input);
+      fclose (file);
+      continue;
+    }
+
+    mseed3_stats_count (1, 0, 0);
+
     /* loop over all records in intput file,
      * Add 1 to verbose level as verbose = 1 prints nothing extra */
-    while ((ms3_readmsr (&msr, file_name, flags, verbose + 1) == MS_NOERROR))
+    stage = mseed3_stats_enter (MSEED3_STAGE_READ);
+    while ((ms3_readmsr (&msr, mseed3_input_path (&input, file_name), flags, verbose + 1) == MS_NOERROR))
     {
+      mseed3_stats_enter (MSEED3_STAGE_CRC);
+      mseed3_stats_count (0, 1, msr->reclen);
+
+      if (msr->crc != mseed3_record_crc (msr->record, msr->reclen))
+      {
+        fprintf (stderr, "Error reading file: %s, CRC mismatch! \n", file_name);
+        break;
+      }
+
+      mseed3_stats_enter (MSEED3_STAGE_PAYLOAD);
+
+      if (print_data && mseed3_decode_samples (msr, verbose + 1) < 0)
+      {
+        fprintf (stderr, "Error reading file: %s, Cannot decode data samples! \n", file_name);
+        break;
+      }
+
+      mseed3_stats_enter (MSEED3_STAGE_OUTPUT);
       msr3_print (msr, 2);
 
       /* Output data samples if present */
       if (msr->numsamples > 0)
       {
-        int line, col, cnt, samplesize;
-        uint64_t lines = (msr->numsamples / 6) + 1;
-        void *sptr;
+        struct sample_line_s line = {{0}, 0, 0};
 
         printf ("Data:\n");
 
-        if ((samplesize = ms_samplesize (msr->sampletype)) == 0)
+        if (ms_samplesize (msr->sampletype) == 0)
         {
           fprintf (stderr, "Unrecognized sample type: '%c'\n", msr->sampletype);
           return EXIT_FAILURE;
@@ -158,37 +263,60 @@ main (int argc, char **argv)
             printf ("\n");
           }
         }
-        else /* If samples are non-text i.e. numbers */
+        else /* Numbers, with the loop for the sample type chosen once per record */
         {
-          for (cnt = 0, line = 0; line < lines; line++)
+          switch (msr->sampletype)
           {
-            for (col = 0; col < 6; col++)
+          case 'i':
+            for (int64_t i = 0; i < msr->numsamples; i++)
             {
-              if (cnt < msr->numsamples)
-              {
-                sptr = (char *)msr->datasamples + (cnt * samplesize);
+              char *number = sample_column (&line);
 
-                if (msr->sampletype == 'i')
-                  printf ("%10d  ", *(int32_t *)sptr);
-
-                else if (msr->sampletype == 'f')
-                  printf ("%10.8g  ", *(float *)sptr);
+              end_sample_column (&line, mseed3_format_int32 (number, ((const int32_t *)msr->datasamples)[i]));
+            }
+            break;
+          case 'f':
+            for (int64_t i = 0; i < msr->numsamples; i++)
+            {
+              char *number = sample_column (&line);
 
-                else if (msr->sampletype == 'd')
-                  printf ("%10.10g  ", *(double *)sptr);
+              end_sample_column (&line, mseed3_format_float (number, ((const float *)msr->datasamples)[i]));
+            }
+            break;
+          case 'd':
+            for (int64_t i = 0; i < msr->numsamples; i++)
+            {
+              char *number = sample_column (&line);
 
-                cnt++;
-              }
+              end_sample_column (&line, mseed3_format_double (number, ((const double *)msr->datasamples)[i]));
             }
-            printf ("\n");
+            break;
           }
+
+          end_sample_line (&line);
         }
       }
+
+      mseed3_stats_enter (MSEED3_STAGE_READ);
     } /* End of loop over records */
 
-    if (msr)
-      ms3_readmsr (&msr, NULL, flags, verbose + 1);
+    mseed3_stats_leave (stage);
+
+    /* libmseed must let go of the input before the worker thread is stopped */
+    ms3_readmsr (&msr, NULL, flags, verbose + 1);
+
+    if (mseed3_input_close (&input) < 0)
+    {
+      fprintf (stderr, "Error reading file: %s, corrupt %s compressed data! \n", file_name,
+               mseed3_compression_name (input.compression));
+    }
+    fclose (file);
   }
 
+  /* Output still buffered by stdio is part of the output stage */
+  mseed3_stats_enter (MSEED3_STAGE_OUTPUT);
+  fflush (stdout);
+  mseed3_stats_print (stderr, "mseed3-text", stats_json);
+
   return EXIT_SUCCESS;
 }
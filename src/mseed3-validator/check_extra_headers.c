@@ -2,126 +2,325 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wjelement.h>
-#include <mseed3-common/files.h>
+#include <yyjson.h>
 
 #include <libmseed.h>
 
+#include <mseed3-common/hash.h>
+
+#include "report.h"
+#include "schema_program.h"
+#include "schema_registry.h"
+#include "schema_walker.h"
 #include "validator.h"
 #include "warnings.h"
 
-#define SCHEMA_BUFFER_SIZE 1024u
-
+static bool check_extra_headers_wjelement (struct validator_context_s *context, const char *extra_headers,
+                                           uint16_t extra_header_len);
+static bool check_extra_headers_yyjson (struct validator_context_s *context, const char *extra_headers,
+                                        uint16_t extra_header_len);
+static bool check_extra_headers_wjelement_used (struct validator_context_s *context);
+static bool memo_lookup (struct validator_context_s *context, uint64_t hash, uint16_t length, bool wjelement);
+static void memo_insert (struct validator_context_s *context, uint64_t hash, uint16_t length, bool wjelement);
 static void schema_error_func (void *client, const char *format, ...);
-static WJElement load_schema_func (const char *name, void *client, const char *file, const int line);
-static void schema_free (WJElement schema, void *client);
-
+static WJElement schema_load_func (const char *name, void *client, const char *file, const int line);
+static size_t extra_header_read_func (char *data, size_t length, size_t seen, void *client);
 
+/* Memory range handed to WJElement when parsing extra headers in place */
+struct extra_header_reader_s
+{
+  const char *data;
+  size_t length;
+};
 
-/*! @brief Check extra header using WJElement against a user provided schema
+/*! @brief Check extra header against a user provided schema
+ *
+ *  Extra headers are parsed by yyjson and validated by the schema walker,
+ *  or by WJElement with -W json=wjelement or when the schema uses keywords
+ *  the walker does not implement.  Valid extra headers are remembered by
+ *  the hash of their bytes, a byte-identical extra header of a later record
+ *  validated against the same schema is not parsed again.
  *
- *  @param[in] options -W cmd line warn options (currently not implemented)
- *  @param[in] schema path to provided json schema file
- *  @param[in] file_len overall binary length
+ *  @param[in] context validation context, with the preloaded json schema or NULL
+ *  @param[in] extra_headers pointer to the extra header bytes of the record
  *  @param[in] extra_header_len Extra header length in bytes
  *  @param[in] recordNum number of current record being processed
- *  @param[in] verbose verbosity level
  *
  */
 /*TODO future improvement pass back stuff from extra_headers to validate payloads*/
 bool
-check_extra_headers (struct extra_options_s *options, char *schema, FILE *input,
-                     uint16_t extra_header_len, uint32_t recordNum, uint8_t verbose)
+check_extra_headers (struct validator_context_s *context, const char *extra_headers, uint16_t extra_header_len,
+                     uint32_t recordNum)
 {
-  WJElement document_element;
-  char *extraHeaderStr;
-  bool valid_extra_header = true;
-  is_valid_gbl            = valid_extra_header;
-
-  char schema_buffer[SCHEMA_BUFFER_SIZE];
-  char *buffer = (char *)calloc (extra_header_len + 1, sizeof (char));
+  struct schema_registry_s *schema = context->schema;
+  uint8_t verbose                  = context->verbose;
+  uint64_t hash                    = 0;
+  bool wjelement;
+  bool valid;
 
-  if (buffer == NULL)
+  if (extra_headers == NULL)
   {
-    printf ("Fatal Error! Record: %d --- could not calloc buffer\n", recordNum);
-    free (buffer);
+    report_event (context->report, REPORT_EXTRA_HEADER, REPORT_FATAL,
+                  "EOF reached reading extra headers into buffer, please double check input record");
+
     return false;
   }
 
-  if (extra_header_len > fread (buffer, sizeof (char), extra_header_len, input))
+  if (extra_header_len == 0)
   {
-    printf ("Fatal Error! Record: %d --- EOF reached reading extra headers into buffer, please double check input record\n",
-            recordNum);
-    free (buffer);
-    valid_extra_header = false;
+    if (verbose > 1)
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO, "This record does not contain an extra header");
 
-    return valid_extra_header;
+    return true;
+  }
+
+  wjelement = check_extra_headers_wjelement_used (context);
+
+  /* Extra headers are printed above verbosity 3, so every record is parsed */
+  if (verbose <= 3)
+  {
+    hash = mseed3_hash64 (extra_headers, extra_header_len, 0);
+
+    if (memo_lookup (context, hash, extra_header_len, wjelement))
+    {
+      context->memo_counts.hits++;
 
+      if (schema != NULL && verbose > 2)
+        report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO, "JSON Schema validation success!");
+      else if (schema == NULL && verbose > 1)
+        report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO,
+                      "No json schema file provided, skipping Extra Header check");
+
+      return true;
+    }
+
+    context->memo_counts.misses++;
   }
 
-  if (extra_header_len == 0)
+  valid = check_extra_headers_schema (context, extra_headers, extra_header_len);
+
+  /* Only valid verdicts are remembered, invalid headers are checked again to report their errors */
+  if (valid && verbose <= 3)
   {
-    if (verbose > 1)
-      printf ("Record: %d --- This record does not contain an extra header\n", recordNum);
+    memo_insert (context, hash, extra_header_len, wjelement);
+  }
 
-    free (buffer);
-    return true;
+  return valid;
+}
+
+/*! @brief Parse an extra header and validate it against the schema, every time
+ *
+ *  The part of check_extra_headers() run when no valid verdict is
+ *  remembered, also timed on its own by mseed3-bench.
+ *
+ *  @param[in] context validation context, with the preloaded json schema or NULL
+ *  @param[in] extra_headers pointer to the extra header bytes of the record
+ *  @param[in] extra_header_len Extra header length in bytes, not 0
+ *
+ *  @return true if the extra header parses and is valid against the schema
+ */
+bool
+check_extra_headers_schema (struct validator_context_s *context, const char *extra_headers, uint16_t extra_header_len)
+{
+  if (check_extra_headers_wjelement_used (context))
+  {
+    return check_extra_headers_wjelement (context, extra_headers, extra_header_len);
   }
-  else
+
+  return check_extra_headers_yyjson (context, extra_headers, extra_header_len);
+}
+
+/* True if extra headers are validated with WJElement, asked for or needed by the schema */
+static bool
+check_extra_headers_wjelement_used (struct validator_context_s *context)
+{
+  return context->options->wjelement || (context->schema != NULL && !context->schema->walkable);
+}
+
+/* Find a remembered valid verdict, making it the most recently used of its set */
+static bool
+memo_lookup (struct validator_context_s *context, uint64_t hash, uint16_t length, bool wjelement)
+{
+  struct extra_header_memo_s *set = context->memo[hash % EXTRA_HEADER_MEMO_SETS];
+
+  for (uint32_t i = 0; i < EXTRA_HEADER_MEMO_WAYS; i++)
+  {
+    if (set[i].used != 0 && set[i].hash == hash && set[i].length == length && set[i].schema == context->schema &&
+        set[i].wjelement == wjelement)
+    {
+      set[i].used = ++context->memo_clock;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Remember a valid verdict in place of the least recently used entry of its set */
+static void
+memo_insert (struct validator_context_s *context, uint64_t hash, uint16_t length, bool wjelement)
+{
+  struct extra_header_memo_s *set    = context->memo[hash % EXTRA_HEADER_MEMO_SETS];
+  struct extra_header_memo_s *oldest = &set[0];
+
+  for (uint32_t i = 1; i < EXTRA_HEADER_MEMO_WAYS; i++)
+  {
+    if (set[i].used < oldest->used)
+    {
+      oldest = &set[i];
+    }
+  }
+
+  oldest->hash      = hash;
+  oldest->length    = length;
+  oldest->schema    = context->schema;
+  oldest->wjelement = wjelement;
+  oldest->used      = ++context->memo_clock;
+}
+
+/* Parse extra headers with yyjson, into memory of the context kept for the
+ * next record, and validate the document with the compiled schema or walker */
+static bool
+check_extra_headers_yyjson (struct validator_context_s *context, const char *extra_headers,
+                            uint16_t extra_header_len)
+{
+  struct schema_registry_s *schema = context->schema;
+  uint8_t verbose                  = context->verbose;
+  size_t pool_size                 = yyjson_read_max_memory_usage (extra_header_len, YYJSON_READ_NOFLAG);
+  yyjson_alc allocator;
+  yyjson_alc *pool = NULL;
+  yyjson_read_err error;
+  yyjson_doc *document;
+  char *extraHeaderStr;
+  bool valid_extra_header = true;
+
+  if (pool_size > context->document_pool_size)
   {
-    /* Parse extra headers to validate integrity */
-    document_element = WJEParse (buffer);
+    void *grown = realloc (context->document_pool, pool_size);
 
-    if (document_element != NULL)
+    if (grown != NULL)
     {
-      if (verbose > 3)
-      {
-        //TODO make optional
-        extraHeaderStr = WJEToString (document_element, true);
-        printf ("Record: %d --- Extra header output:\n%s\n\n", recordNum, extraHeaderStr);
-        free (extraHeaderStr);
-      }
+      context->document_pool      = grown;
+      context->document_pool_size = pool_size;
     }
-    else
+  }
+
+  if (pool_size <= context->document_pool_size &&
+      yyjson_alc_pool_init (&allocator, context->document_pool, context->document_pool_size))
+  {
+    pool = &allocator;
+  }
+
+  /* Without YYJSON_READ_INSITU the record is only read, it may be mapped read only */
+  document = yyjson_read_opts ((char *)extra_headers, extra_header_len, YYJSON_READ_NOFLAG, pool, &error);
+
+  if (document == NULL)
+  {
+    report_event (context->report, REPORT_EXTRA_HEADER, REPORT_ERROR, " Failed to parse Extra Header from Record!");
+    if (verbose > 1)
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO, "Extra header byte %zu: %s", error.pos,
+                    error.msg);
+
+    return false;
+  }
+
+  if (verbose > 3)
+  {
+    if ((extraHeaderStr = yyjson_val_write (yyjson_doc_get_root (document), YYJSON_WRITE_PRETTY, NULL)))
+    {
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO, "Extra header output:\n%s\n", extraHeaderStr);
+      free (extraHeaderStr);
+    }
+  }
+
+  if (schema)
+  {
+    yyjson_val *root = yyjson_doc_get_root (document);
+
+    if (!((schema->program != NULL) ? schema_program_run (schema->program, context->report, root)
+                                    : schema_walker_validate (schema, context->report, root)))
     {
-      printf ("Error! Record: %d ---  Failed to parse Extra Header from Record!\n", recordNum);
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_ERROR, " Schema validation failed!");
       valid_extra_header = false;
-      free (buffer);
-      return valid_extra_header;
+    }
+    else if (verbose > 2)
+    {
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO, "JSON Schema validation success!");
     }
   }
+  else
+  {
+    if (verbose > 1)
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO,
+                    "No json schema file provided, skipping Extra Header check");
+  }
+
+  yyjson_doc_free (document);
+
+  return valid_extra_header;
+}
 
-  /* If schema file is provided, attempt to validate */
-  if (schema && mseed3_file_exists (schema))
+/* Parse extra headers with WJElement and validate them with WJESchemaValidate() */
+static bool
+check_extra_headers_wjelement (struct validator_context_s *context, const char *extra_headers,
+                               uint16_t extra_header_len)
+{
+  struct schema_registry_s *schema = context->schema;
+  uint8_t verbose                  = context->verbose;
+  WJElement document_element;
+  WJReader document_reader;
+  struct extra_header_reader_s reader_range;
+  char *extraHeaderStr;
+  bool valid_extra_header = true;
+  context->schema_valid   = valid_extra_header;
+
+  /* Parse extra headers to validate integrity, reading directly from the record */
+  reader_range.data   = extra_headers;
+  reader_range.length = extra_header_len;
+  document_element    = NULL;
+
+  if ((document_reader = WJROpenDocument (extra_header_read_func, &reader_range, NULL, 0)))
   {
-    /* Get user provided schema and parge into WJElement */
-    FILE *schema_file        = fopen (schema, "r");
-    WJReader schema_reader   = WJROpenFILEDocument (schema_file, schema_buffer, SCHEMA_BUFFER_SIZE);
-    WJElement schema_element = WJEOpenDocument (schema_reader, NULL, NULL, NULL);
+    document_element = WJEOpenDocument (document_reader, NULL, NULL, NULL);
+    WJRCloseDocument (document_reader);
+  }
 
-    char *path    = mseed3_get_dirname (schema);
-    char *pattern = mseed3_cat_strings (path, "/%s");
+  if (document_element != NULL)
+  {
+    if (verbose > 3)
+    {
+      //TODO make optional
+      extraHeaderStr = WJEToString (document_element, true);
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO, "Extra header output:\n%s\n", extraHeaderStr);
+      free (extraHeaderStr);
+    }
+  }
+  else
+  {
+    report_event (context->report, REPORT_EXTRA_HEADER, REPORT_ERROR, " Failed to parse Extra Header from Record!");
+    valid_extra_header = false;
+    return valid_extra_header;
+  }
 
-    WJEErrCB errFunc            = &schema_error_func;
-    WJESchemaLoadCB load_schema = &load_schema_func;
-    WJESchemaFreeCB free_schema = &schema_free;
+  /* If schema is provided, attempt to validate */
+  if (schema)
+  {
+    WJEErrCB errFunc = &schema_error_func;
 
-    /* Validate extra headers against schema */
-    XplBool isValid = WJESchemaValidate (schema_element, document_element, errFunc, load_schema, free_schema, pattern);
+    /* Validate extra headers against the preloaded schema, schema_error_func() clears schema_valid */
+    XplBool isValid = WJESchemaValidate (schema->root, document_element, errFunc,
+                                         schema_load_func, schema_registry_free, context);
 
-    if ((!isValid) || (!is_valid_gbl))
+    if ((!isValid) || (!context->schema_valid))
     {
-      printf ("Error! Record: %d ---  Schema validation failed!\n", recordNum);
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_ERROR, " Schema validation failed!");
       valid_extra_header = false;
 
-      if (options->treat_as_errors)
+      if (context->options->treat_as_errors)
       {
-        free (buffer);
-        WJECloseDocument (schema_element);
-        WJRCloseDocument (schema_reader);
-        fclose (schema_file);
-        free (pattern);
-        free (path);
+        WJECloseDocument (document_element);
         return valid_extra_header;
       }
     }
@@ -129,92 +328,63 @@ check_extra_headers (struct extra_options_s *options, char *schema, FILE *input,
     {
 
       if (verbose > 2)
-        printf ("Record: %d --- JSON Schema validation success!\n", recordNum);
+        report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO, "JSON Schema validation success!");
     }
 
-    WJECloseDocument (schema_element);
-    WJRCloseDocument (schema_reader);
-    fclose (schema_file);
-    free (pattern);
-    free (path);
-
   } // if no schema file provided
   else
   {
     if (verbose > 1 && extra_header_len > 0)
-      printf ("Record: %d --- No json schema file provided, skipping Extra Header check\n", recordNum);
+      report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO,
+                    "No json schema file provided, skipping Extra Header check");
   }
   /*TODO other checks */
 
-  if (buffer)
+  WJECloseDocument (document_element);
+
+  return valid_extra_header;
+}
+
+/* Reader callback feeding WJElement from an in-memory extra header range */
+static size_t
+extra_header_read_func (char *data, size_t length, size_t seen, void *client)
+{
+  struct extra_header_reader_s *range = (struct extra_header_reader_s *)client;
+
+  if (seen >= range->length)
+  {
+    return 0;
+  }
+
+  if (length > range->length - seen)
   {
-    free (buffer);
+    length = range->length - seen;
   }
 
-  if (extra_header_len != 0)
-    WJECloseDocument (document_element);
+  memcpy (data, range->data + seen, length);
 
-  return valid_extra_header;
+  return length;
 }
 
-/* Helper function used with WJElement for error reporting */
+/* Helper function used with WJElement for error reporting, client is the validation context */
 static void
 schema_error_func (void *client, const char *format, ...)
 {
-  //TODO format to other log messages
+  struct validator_context_s *context = (struct validator_context_s *)client;
+  char message[1024];
   va_list ap;
   va_start (ap, format);
-  fprintf (stderr, "Error in Schema Validation- ");
-  vfprintf (stderr, format, ap);
+  vsnprintf (message, sizeof (message), format, ap);
   va_end (ap);
-  fprintf (stderr, "\n");
-  is_valid_gbl = false;
+  report_line (context->report, REPORT_SCHEMA, REPORT_ERROR, "Error in Schema Validation- %s", message);
+  context->schema_valid = false;
 }
 
-/* Callback for loading additional schemas */
+/* Loads schemas referenced while validating from the registry of the validation context in client */
 static WJElement
-load_schema_func (const char *name, void *client,
-                  const char *file, const int line)
+schema_load_func (const char *name, void *client, const char *file, const int line)
 {
-  char *format;
-  char *path;
-  FILE *schemafile;
-  WJReader readschema;
-  WJElement schema;
-  schema = NULL;
-  if (client && name)
-  {
-
-    format = (char *)client;
-    path   = malloc (strlen (format) + strlen (name));
-    sprintf (path, format, name);
-
-    if ((schemafile = fopen (path, "r")))
-    {
-      if ((readschema = WJROpenFILEDocument (schemafile, NULL, 0)))
-      {
-        schema = WJEOpenDocument (readschema, NULL, NULL, NULL);
-      }
-      else
-      {
-        fprintf (stderr, "json document failed to open: '%s'\n", path);
-      }
-      fclose (schemafile);
-    }
-    else
-    {
-      fprintf (stderr, "json file not found: '%s'\n", path);
-    }
-    free (path);
-  }
-  //WJEDump(schema);
-  return schema;
-}
+  struct validator_context_s *context = (struct validator_context_s *)client;
 
-/* Callback to free additional schemas */
-static void
-schema_free (WJElement schema, void *client)
-{
-  WJECloseDocument (schema);
-  return;
+  return schema_registry_load (name, context->schema, file, line);
 }
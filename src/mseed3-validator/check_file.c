@@ -1,222 +1,1266 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
+#include <mseed3-common/array.h>
+#include <mseed3-common/constants.h>
+#include <mseed3-common/crc32c.h>
 #include <mseed3-common/files.h>
+#include <mseed3-common/resync.h>
+#include <mseed3-common/stats.h>
+#include <mseed3-common/steim.h>
 
 #include <libmseed.h>
 
+#include "job_pool.h"
+#include "report.h"
 #include "validator.h"
 #include "warnings.h"
 
+/* Number of record ranges handed to each worker in split-records mode */
+#define RECORD_RANGES_PER_JOB 8
+
+/* Payload bytes checked per step for records larger than MAXRECLEN, a whole number of Steim frames */
+#define PAYLOAD_CHUNK_LEN (1024 * 1024)
+
+/* Outcome of checking a single record */
+enum record_status_e
+{
+  RECORD_CONTINUE = 0, /* record checked, continue with the next one */
+  RECORD_HALT,         /* validation failure with -W error, stop the file */
+  RECORD_END,          /* record runs past the end of the file, nothing more to read */
+  RECORD_DAMAGED       /* header or CRC failed with -W resync, the record length cannot be trusted */
+};
+
+/* State shared by the workers of a split-records run */
+struct record_ranges_s
+{
+  struct validator_context_s *context;
+  const struct mseed3_file_map_s *map;
+  const struct record_entry_s *entries;
+  uint32_t entry_cnt;
+  uint32_t range_len;
+
+  uint32_t fail_count_rcd;
+  uint32_t records;
+  struct extra_header_memo_counts_s memo;
+  bool halted;
+
+  /* Leading records found valid, counted while every range so far was valid */
+  uint32_t valid_records;
+  bool valid_prefix;
+};
+
+/* Results of the single streaming pass over a record larger than MAXRECLEN */
+struct record_stream_s
+{
+  uint32_t crc;
+  struct mseed3_steim_state_s steim;
+};
+
+static bool check_stream (struct validator_context_s *context, FILE *input, char *file_name, uint32_t *records);
+static bool check_records (struct validator_context_s *context, const struct mseed3_file_map_s *map,
+                           uint64_t *file_pos, uint32_t *recordNum, uint32_t *fail_count_rcd,
+                           check_tally_f tally, void *client);
+static enum record_status_e check_record (struct validator_context_s *context, const struct mseed3_file_map_s *map,
+                                          uint64_t offset, struct mseed3_stream_s *input, uint32_t recordNum,
+                                          MS3Record **msr, uint64_t *record_len, uint32_t *fail_count_rcd);
+static bool stream_record (const struct mseed3_file_map_s *map, struct mseed3_stream_s *input, const char *record,
+                           uint64_t record_len, uint32_t payload_len, uint8_t payload_fmt,
+                           struct record_stream_s *stream);
+static bool check_streamed_payload (struct validator_context_s *context, const char *record, uint32_t payload_len,
+                                    uint8_t payload_fmt, struct record_stream_s *stream, uint32_t recordNum);
+static bool check_steim_status (struct validator_context_s *context, int status,
+                                const struct mseed3_steim_state_s *steim, int version, uint32_t recordNum);
+static uint32_t record_number_samples (const char *record);
+static uint64_t header_record_length (const char *record);
+static int scan_records (const struct mseed3_file_map_s *map, bool resync, struct record_entry_s **entries,
+                         uint32_t *entry_cnt);
+static uint64_t resync_record (struct validator_context_s *context, const struct mseed3_file_map_s *map,
+                               uint64_t file_pos);
+static void report_memo (struct validator_context_s *context, const struct extra_header_memo_counts_s *start);
+static void tally_valid_prefix (void *client, uint32_t recordNum, uint64_t offset, uint64_t length, bool valid);
+static void digest_file (const struct mseed3_file_map_s *map, const struct check_resume_s *resume, uint64_t first_pos,
+                         struct check_digest_s *digest);
+static void check_record_range (void *context, size_t index, struct job_result_s *result);
+static bool tally_record_range (void *context, size_t index, const struct job_result_s *result);
+
 /*! @brief Top level function to perform all verification tests on input miniSEED file
  *
- *  @param[in] options -W cmd line warn options (currently not implemented)
+ *  The file is mapped into memory once and each check is handed a pointer
+ *  into the mapped region, so no record bytes are copied or read twice.
+ *
+ *  With -W split-records the file is validated in two phases: a sequential
+ *  pre-scan of the fixed headers builds the record offset table, then ranges
+ *  of records are checked concurrently and reported in record order.
+ *
+ *  Input that cannot be mapped or seeked, such as a pipe, is validated
+ *  front to back by check_stream() instead.
+ *
+ *  A file that has grown since it was last found valid is checked from the
+ *  end of the validated records only, record numbers continue from there.
+ *  Appended records are checked in order, -W split-records does not apply.
+ *
+ *  The mapped bytes are hashed for the cache once validated, while they
+ *  are still in memory, continuing from the hash of the skipped records.
+ *  The end of the complete records found valid from the start of the file
+ *  is hashed on its own, so a later run resumes after them even if the
+ *  file was cut off in the middle of its last record.
+ *
+ *  @param[in] context validation context, with the json schema given on the cmd line or NULL
  *  @param[in] input file pointer to miniSEED file
- *  @param[in] schema_file_name json file path parsed from cmd line
  *  @param[in] file_name miniSEED file path parsed from cmd line
+ *  @param[out] records number of records in the file, including the ones skipped by resume
+ *  @param[in] resume validated records to skip, or NULL to check the whole file
+ *  @param[out] digest hash of the file for the cache, or NULL
  *
  */
 bool
-check_file (struct extra_options_s *options, FILE *input, char *schema_file_name,
-            char *file_name, uint32_t *records, uint8_t verbose)
+check_file (struct validator_context_s *context, FILE *input, char *file_name, uint32_t *records,
+            const struct check_resume_s *resume, struct check_digest_s *digest)
 {
-  bool valid_header       = false;
-  bool valid_ident        = false;
-  bool valid_extra_header = false;
-  bool valid_payload      = false;
-
-  uint32_t fail_count_rcd  = 0;
-  uint32_t recordNum       = 0;
-  int64_t file_pos         = 0;
-  int file_len             = mseed3_file_length (input);
+  struct extra_options_s *options              = context->options;
+  uint8_t verbose                              = context->verbose;
+  uint32_t fail_count_rcd                      = 0;
+  uint32_t recordNum                           = 0;
+  uint64_t file_pos                            = 0;
+  uint32_t first_record                        = 0;
+  uint64_t first_pos                           = 0;
+  struct extra_header_memo_counts_s memo_start = context->memo_counts;
+  int stage;
+  int rv;
+  struct mseed3_file_map_s map;
 
-  uint32_t flags = 0;
-  MS3Record *msr = NULL;
-  char recordbuffer[MAXRECLEN];
+  if (digest != NULL)
+  {
+    digest->hashed        = false;
+    digest->valid_length  = 0;
+    digest->valid_records = 0;
+  }
 
   if (verbose > 0)
   {
-    printf("Reading file %s\n", file_name);
+    report_line (context->report, REPORT_FILE, REPORT_INFO, "Reading file %s", file_name);
+  }
+
+  stage = mseed3_stats_enter (MSEED3_STAGE_READ);
+  rv    = mseed3_map_file (input, &map);
+  mseed3_stats_leave (stage);
+
+  /* Pipes and other input that cannot be seeked are read front to back */
+  if (rv == MSEED3_SEEK_ERROR)
+  {
+    return check_stream (context, input, file_name, records);
   }
 
-  if (file_len < 0)
+  if (rv < 0)
   {
-    printf ("Error! file %s could not read!\n", file_name);
+    report_line (context->report, REPORT_FILE, REPORT_ERROR, "Error! file %s could not read!", file_name);
     return false;
   }
 
   if (verbose > 1)
   {
-    printf ("File length of %d found, starting verification...\n", file_len);
+    report_line (context->report, REPORT_FILE, REPORT_INFO,
+                 "File length of %" PRIu64 " found, starting verification...", map.length);
   }
 
-  /* Set flags to check CRC and unpack data */
-  flags |= MSF_VALIDATECRC;
+  if (resume != NULL && resume->offset > 0 && resume->offset <= map.length)
+  {
+    file_pos     = resume->offset;
+    recordNum    = resume->records;
+    first_pos    = file_pos;
+    first_record = recordNum;
 
-  /* Loop through all records in the provided file and validate content */
-  for (file_pos = lmp_ftell64 (input); file_len > file_pos; file_pos = lmp_ftell64 (input))
+    if (digest != NULL)
+    {
+      digest->valid_length  = first_pos;
+      digest->valid_records = first_record;
+    }
+
+    if (verbose > 1)
+    {
+      report_line (context->report, REPORT_FILE, REPORT_INFO,
+                   "Skipping %" PRIu32 " record(s) validated before, checking %" PRIu64 " appended byte(s)...",
+                   recordNum, map.length - file_pos);
+    }
+  }
+
+  if (options->split_records && file_pos == 0)
   {
-    uint8_t identifier_len    = 0;
-    uint16_t extra_header_len = 0;
-    uint32_t payload_len      = 0;
-    uint8_t payload_fmt       = 0;
-    uint64_t record_len       = 0;
-    bool can_check_payload    = false;
+    struct record_ranges_s ranges;
+    struct record_entry_s *entries = NULL;
+    uint32_t range_cnt;
+
+    /* Phase 1: walk the fixed headers to find every record */
+    if (scan_records (&map, options->resync, &entries, &ranges.entry_cnt) < 0)
+    {
+      report_line (context->report, REPORT_FILE, REPORT_ERROR, "Error! file %s, cannot allocate the record table",
+                   file_name);
+      mseed3_unmap_file (&map);
+      return false;
+    }
+
+    ranges.context        = context;
+    ranges.map            = &map;
+    ranges.entries        = entries;
+    ranges.fail_count_rcd = 0;
+    ranges.records        = 0;
+    ranges.memo.hits      = 0;
+    ranges.memo.misses    = 0;
+    ranges.halted         = false;
+    ranges.valid_records  = 0;
+    ranges.valid_prefix   = true;
+    ranges.range_len      = ranges.entry_cnt / ((uint32_t)options->jobs * RECORD_RANGES_PER_JOB) + 1;
 
-    /* ----Check fixed header----- */
     if (verbose > 2)
     {
-      printf ("--- Starting Fixed Header verification for record: %d ---\n", recordNum);
+      report_line (context->report, REPORT_FILE, REPORT_INFO, "Found %d record(s), validating with %d worker(s)",
+                   ranges.entry_cnt, options->jobs);
     }
 
-    valid_header = check_header (options, input, file_len, &file_pos, &identifier_len, &extra_header_len,
-                                 &payload_len, &payload_fmt, recordNum, verbose);
+    /* Phase 2: check ranges of records concurrently, reported in record order */
+    range_cnt = (ranges.entry_cnt + ranges.range_len - 1) / ranges.range_len;
 
-    if (valid_header && verbose > 1)
+    if (job_pool_run (options->jobs, range_cnt, check_record_range, tally_record_range, &ranges) < (int)range_cnt &&
+        !ranges.halted)
     {
-      printf ("Record: %d --- Fixed Header is valid!\n", recordNum);
+      report_line (context->report, REPORT_FILE, REPORT_ERROR, "Error! file %s, not every record could be checked",
+                   file_name);
+      ranges.fail_count_rcd++;
     }
-    else if (!valid_header)
+
+    if (digest != NULL && ranges.valid_records > 0)
     {
-      printf ("Error! Record: %d --- Fixed Header is not valid!\n", recordNum);
-      if (options->treat_as_errors)
-      {
-        return false;
-      }
-      fail_count_rcd += 1;
+      digest->valid_length  = entries[ranges.valid_records - 1].offset + entries[ranges.valid_records - 1].length;
+      digest->valid_records = ranges.valid_records;
     }
 
-    /* ----Check identifier----- */
-    valid_ident = check_identifier (options, input, identifier_len, recordNum, verbose);
-    if (!valid_ident)
+    free (entries);
+    mseed3_stats_count (1, ranges.records, map.length);
+    digest_file (&map, resume, first_pos, digest);
+    mseed3_unmap_file (&map);
+
+    if (ranges.halted)
     {
-      printf ("Error! Record: %d --- Error parsing identifier\n", recordNum);
-      if (options->treat_as_errors)
+      return false;
+    }
+
+    fail_count_rcd = ranges.fail_count_rcd;
+    recordNum      = ranges.records;
+
+    /* Workers count verdicts in contexts of their own */
+    context->memo_counts.hits += ranges.memo.hits;
+    context->memo_counts.misses += ranges.memo.misses;
+  }
+  else
+  {
+    /* Loop through all records in the provided file and validate content */
+    bool halted = !check_records (context, &map, &file_pos, &recordNum, &fail_count_rcd,
+                                  (digest != NULL) ? tally_valid_prefix : NULL, digest);
+
+    mseed3_stats_count (1, recordNum - first_record, (halted ? file_pos : map.length) - first_pos);
+    digest_file (&map, resume, first_pos, digest);
+    mseed3_unmap_file (&map);
+
+    if (halted)
+    {
+      return false;
+    }
+  }
+
+  if (verbose > 1)
+  {
+    report_memo (context, &memo_start);
+    report_line (context->report, REPORT_FILE, REPORT_INFO, "Completed processing %d record(s)", recordNum);
+  }
+
+  *records = recordNum;
+
+  if (fail_count_rcd == 0)
+    return true;
+  else
+    return false;
+}
+
+/*! @brief Validate the miniSEED records held in memory
+ *
+ *  Records are checked in order as they are found in the buffer, as for a
+ *  mapped file without -W split-records.  Events are reported to the sink
+ *  of the context, tally is called once each record is done.
+ *
+ *  @param[in] context validation context
+ *  @param[in] data first byte of the first record
+ *  @param[in] length number of bytes in the buffer
+ *  @param[out] records number of records checked
+ *  @param[in] tally function called with the verdict of each record, or NULL
+ *  @param[in] client passed to tally
+ *
+ *  @return true if every record is valid
+ */
+bool
+check_buffer (struct validator_context_s *context, const char *data, uint64_t length, uint32_t *records,
+              check_tally_f tally, void *client)
+{
+  uint32_t fail_count_rcd = 0;
+  uint32_t recordNum      = 0;
+  uint64_t file_pos       = 0;
+  bool halted;
+  struct mseed3_file_map_s map;
+
+  map.data   = data;
+  map.length = length;
+  map.mapped = false;
+
+  halted = !check_records (context, &map, &file_pos, &recordNum, &fail_count_rcd, tally, client);
+
+  mseed3_stats_count (1, recordNum, halted ? file_pos : length);
+  *records = recordNum;
+
+  return !halted && fail_count_rcd == 0;
+}
+
+/*! @brief Check the records of a mapped file one after the other
+ *
+ *  @param[in] context validation context
+ *  @param[in] map mapped file, or a buffer held in memory
+ *  @param[in,out] file_pos offset of the first record, of the record that halted validation on return
+ *  @param[in,out] recordNum number of the first record, number of records checked on return
+ *  @param[in,out] fail_count_rcd number of failed checks
+ *  @param[in] tally function called with the verdict of each record, or NULL
+ *  @param[in] client passed to tally
+ *
+ *  @return false if a record halted validation with -W error
+ */
+static bool
+check_records (struct validator_context_s *context, const struct mseed3_file_map_s *map, uint64_t *file_pos,
+               uint32_t *recordNum, uint32_t *fail_count_rcd, check_tally_f tally, void *client)
+{
+  MS3Record *msr = NULL;
+  bool halted    = false;
+
+  while (map->length > *file_pos)
+  {
+    uint64_t record_len = 0;
+    uint64_t next;
+    uint32_t failures = *fail_count_rcd;
+    enum record_status_e status;
+
+    status = check_record (context, map, *file_pos, NULL, *recordNum, &msr, &record_len, fail_count_rcd);
+    halted = (status == RECORD_HALT);
+
+    if (status == RECORD_DAMAGED)
+    {
+      /* Skip the damaged bytes instead of trusting the lengths they give */
+      next = resync_record (context, map, *file_pos);
+    }
+    else if (status == RECORD_END || halted)
+    {
+      next = map->length;
+    }
+    else
+    {
+      next = *file_pos + record_len;
+    }
+
+    if (tally != NULL)
+    {
+      tally (client, *recordNum, *file_pos, next - *file_pos, *fail_count_rcd == failures);
+    }
+
+    *recordNum = *recordNum + 1;
+
+    if (halted || status == RECORD_END)
+    {
+      break;
+    }
+
+    *file_pos = next;
+  }
+
+  if (msr)
+  {
+    msr3_free (&msr);
+  }
+
+  return !halted;
+}
+
+/*! @brief Validate input that can only be read front to back, such as stdin
+ *
+ *  Each record is buffered on its own and checked like a record of a
+ *  mapped file, the input is never seeked.  Records larger than MAXRECLEN
+ *  only have their headers buffered, the payload is read in chunks while
+ *  it is checked, so memory use stays bounded whatever the input length.
+ *  Records are checked in order, -W split-records does not apply.
+ *
+ *  @param[in] context validation context
+ *  @param[in] input file pointer to the stream
+ *  @param[in] file_name name of the stream from the cmd line
+ *  @param[out] records number of records processed
+ *
+ */
+static bool
+check_stream (struct validator_context_s *context, FILE *input, char *file_name, uint32_t *records)
+{
+  uint8_t verbose                              = context->verbose;
+  uint32_t fail_count_rcd                      = 0;
+  uint32_t recordNum                           = 0;
+  bool read_failed                             = false;
+  struct extra_header_memo_counts_s memo_start = context->memo_counts;
+  int rv;
+  struct mseed3_stream_s stream;
+  struct mseed3_file_map_s view;
+
+  MS3Record *msr = NULL;
+
+  if (verbose > 1)
+  {
+    report_line (context->report, REPORT_FILE, REPORT_INFO, "File %s cannot be seeked, reading it as a stream...",
+                 file_name);
+  }
+
+  mseed3_stream_open (input, &stream);
+
+  while (true)
+  {
+    uint64_t record_len = 0;
+    size_t wanted       = MSEED3_FIXED_HEADER_LEN;
+    int stage           = mseed3_stats_enter (MSEED3_STAGE_READ);
+    enum record_status_e status;
+
+    if (mseed3_stream_fill (&stream, MSEED3_FIXED_HEADER_LEN) == 0)
+    {
+      mseed3_stats_leave (stage);
+      break;
+    }
+
+    /* Buffer the whole record, or only its headers if it is too large for libmseed */
+    if (stream.fill >= MSEED3_FIXED_HEADER_LEN)
+    {
+      const uint8_t *header = (const uint8_t *)stream.data;
+      uint64_t length       = header_record_length (stream.data);
+
+      wanted = (length <= MAXRECLEN)
+                   ? (size_t)length
+                   : MSEED3_FIXED_HEADER_LEN + header[33] + (header[34] | (header[35] << 8));
+    }
+
+    view.length = mseed3_stream_fill (&stream, wanted);
+    view.data   = stream.data;
+    view.mapped = false;
+    mseed3_stats_leave (stage);
+
+    status = check_record (context, &view, 0, &stream, recordNum, &msr, &record_len, &fail_count_rcd);
+
+    if (status == RECORD_HALT)
+    {
+      if (msr)
       {
-        return false;
+        msr3_free (&msr);
       }
-      fail_count_rcd += 1;
+      mseed3_stats_count (1, recordNum + 1, stream.offset + stream.fill + stream.read);
+      mseed3_stream_close (&stream);
+      return false;
     }
 
-    /* ----Check extra headers----- */
-    if (verbose > 2)
+    recordNum = recordNum + 1;
+
+    if (status == RECORD_END)
     {
-      printf ("--- Completed Header verification for record: %d ---\n", recordNum);
-      printf ("--- Starting Extra Header verification for record: %d ---\n", recordNum);
+      break;
     }
 
-    valid_extra_header = check_extra_headers (options, schema_file_name, input, extra_header_len, recordNum,
-                                              verbose);
-    if (valid_extra_header && schema_file_name != NULL && extra_header_len > 0 && verbose > 1)
+    stage = mseed3_stats_enter (MSEED3_STAGE_READ);
+    rv    = mseed3_stream_next (&stream, record_len);
+    mseed3_stats_leave (stage);
+
+    if (rv < 0)
     {
-      printf ("Record: %d --- Extra Header is valid!\n", recordNum);
+      read_failed = stream.failed;
+      break;
     }
-    if (!valid_extra_header)
+  }
+
+  read_failed = read_failed || stream.failed;
+
+  if (msr)
+  {
+    msr3_free (&msr);
+  }
+
+  mseed3_stats_count (1, recordNum, stream.offset + stream.fill + stream.read);
+  mseed3_stream_close (&stream);
+
+  if (read_failed)
+  {
+    report_line (context->report, REPORT_FILE, REPORT_ERROR, "Error! file %s could not read!", file_name);
+    fail_count_rcd += 1;
+  }
+
+  if (verbose > 1)
+  {
+    report_memo (context, &memo_start);
+    report_line (context->report, REPORT_FILE, REPORT_INFO, "Completed processing %d record(s)", recordNum);
+  }
+
+  *records = recordNum;
+
+  return (fail_count_rcd == 0);
+}
+
+/*! @brief Perform all verification tests on a single record
+ *
+ *  @param[in] context validation context
+ *  @param[in] map mapped file
+ *  @param[in] offset offset of the record in the file
+ *  @param[in,out] input stream the record is read from, or NULL if the whole file is mapped
+ *  @param[in] recordNum number of the record in the file
+ *  @param[in,out] msr libmseed record reused between calls
+ *  @param[out] record_len length of the record
+ *  @param[in,out] fail_count_rcd number of failed checks
+ *
+ */
+static enum record_status_e
+check_record (struct validator_context_s *context, const struct mseed3_file_map_s *map, uint64_t offset,
+              struct mseed3_stream_s *input, uint32_t recordNum, MS3Record **msr, uint64_t *record_len,
+              uint32_t *fail_count_rcd)
+{
+  struct extra_options_s *options  = context->options;
+  struct schema_registry_s *schema = context->schema;
+  uint8_t verbose                  = context->verbose;
+  const char *record               = map->data + offset;
+  uint64_t available               = map->length - offset;
+  bool valid_header                = false;
+  bool valid_ident                 = false;
+  bool valid_extra_header          = false;
+  bool valid_payload               = false;
+  uint8_t identifier_len           = 0;
+  uint16_t extra_header_len        = 0;
+  uint32_t payload_len             = 0;
+  uint8_t payload_fmt              = 0;
+  bool can_check_payload           = false;
+  uint32_t flags                   = 0;
+  bool resync                      = options->resync && input == NULL;
+  int stage;
+  int rv;
+  struct record_stream_s stream;
+
+  report_record (context->report, recordNum, (input != NULL) ? input->offset : offset);
+
+  /* ----Check fixed header----- */
+  if (verbose > 2)
+  {
+    report_line (context->report, REPORT_HEADER, REPORT_INFO,
+                 "--- Starting Fixed Header verification for record: %d ---", recordNum);
+  }
+
+  stage        = mseed3_stats_enter (MSEED3_STAGE_HEADER);
+  valid_header = check_header (context, record, available, &identifier_len, &extra_header_len,
+                               &payload_len, &payload_fmt, recordNum);
+  mseed3_stats_leave (stage);
+
+  if (valid_header && verbose > 1)
+  {
+    report_event (context->report, REPORT_HEADER, REPORT_INFO, "Fixed Header is valid!");
+  }
+  else if (!valid_header)
+  {
+    report_event (context->report, REPORT_HEADER, REPORT_ERROR, "Fixed Header is not valid!");
+    if (options->treat_as_errors)
+    {
+      return RECORD_HALT;
+    }
+    *fail_count_rcd += 1;
+
+    /* Nothing more can be read from a truncated fixed header */
+    if (MSEED3_FIXED_HEADER_LEN > available)
+    {
+      return RECORD_END;
+    }
+
+    /* The lengths of a damaged header are garbage, checking further only repeats the error */
+    if (resync)
+    {
+      return RECORD_DAMAGED;
+    }
+  }
+
+  /* ----Check identifier----- */
+  stage       = mseed3_stats_enter (MSEED3_STAGE_IDENTIFIER);
+  valid_ident = check_identifier (context,
+                                  (MSEED3_FIXED_HEADER_LEN + identifier_len <= available)
+                                      ? record + MSEED3_FIXED_HEADER_LEN
+                                      : NULL,
+                                  identifier_len, recordNum);
+  mseed3_stats_leave (stage);
+  if (!valid_ident)
+  {
+    report_event (context->report, REPORT_IDENTIFIER, REPORT_ERROR, "Error parsing identifier");
+    if (options->treat_as_errors)
+    {
+      return RECORD_HALT;
+    }
+    *fail_count_rcd += 1;
+  }
+
+  /* ----Check extra headers----- */
+  if (verbose > 2)
+  {
+    report_line (context->report, REPORT_HEADER, REPORT_INFO, "--- Completed Header verification for record: %d ---",
+                 recordNum);
+    report_line (context->report, REPORT_EXTRA_HEADER, REPORT_INFO,
+                 "--- Starting Extra Header verification for record: %d ---", recordNum);
+  }
+
+  stage              = mseed3_stats_enter (MSEED3_STAGE_EXTRA_HEADER);
+  valid_extra_header = check_extra_headers (context,
+                                            (MSEED3_FIXED_HEADER_LEN + identifier_len + extra_header_len <= available)
+                                                ? record + MSEED3_FIXED_HEADER_LEN + identifier_len
+                                                : NULL,
+                                            extra_header_len, recordNum);
+  mseed3_stats_leave (stage);
+  if (valid_extra_header && schema != NULL && extra_header_len > 0 && verbose > 1)
+  {
+    report_event (context->report, REPORT_EXTRA_HEADER, REPORT_INFO, "Extra Header is valid!");
+  }
+  if (!valid_extra_header)
+  {
+    report_event (context->report, REPORT_EXTRA_HEADER, REPORT_ERROR, "Extra Header not valid under provided schema!");
+    if (options->treat_as_errors)
+    {
+      return RECORD_HALT;
+    }
+    *fail_count_rcd += 1;
+  }
+
+  if (verbose > 2)
+  {
+    report_line (context->report, REPORT_EXTRA_HEADER, REPORT_INFO,
+                 "--- Completed Extra Header verification for record: %d ---", recordNum);
+  }
+
+  /* Calculate record length and make sure the whole record is in the file */
+  *record_len = MSEED3_FIXED_HEADER_LEN + identifier_len + extra_header_len + payload_len;
+
+  /* Check that record length is within libmseed limits, larger payloads are streamed in chunks */
+  can_check_payload = (*record_len <= MAXRECLEN);
+
+  /* Only the headers of a large record read from a stream are buffered, the rest is checked as it is read */
+  if (*record_len > available && (input == NULL || can_check_payload || *record_len - payload_len > available))
+  {
+    report_event (context->report, REPORT_FILE, REPORT_FATAL, "File size mismatch, check input record");
+    *fail_count_rcd += 1;
+    return resync ? RECORD_DAMAGED : RECORD_END;
+  }
+
+  if (!options->skip_payload && !can_check_payload && payload_len > 0)
+  {
+    if (verbose > 1)
+    {
+      report_event (context->report, REPORT_PAYLOAD, REPORT_INFO, "Streaming payload of record length %" PRId64,
+                    *record_len);
+    }
+
+    bool streamed;
+
+    stage    = mseed3_stats_enter (MSEED3_STAGE_PAYLOAD);
+    streamed = stream_record (map, input, record, *record_len, payload_len, payload_fmt, &stream);
+    mseed3_stats_leave (stage);
+
+    if (!streamed)
+    {
+      report_event (context->report, REPORT_FILE, REPORT_FATAL, "File size mismatch, check input record");
+      *fail_count_rcd += 1;
+      return RECORD_END;
+    }
+  }
+
+  /* ----Check record CRC, over the whole record regardless of libmseed limits----- */
+  if (!options->skip_payload)
+  {
+    uint32_t stored_crc = mseed3_record_stored_crc (record);
+    uint32_t calculated_crc;
+
+    stage          = mseed3_stats_enter (MSEED3_STAGE_CRC);
+    calculated_crc = (!can_check_payload && payload_len > 0) ? stream.crc : mseed3_record_crc (record, *record_len);
+    mseed3_stats_leave (stage);
+
+    if (stored_crc != calculated_crc)
     {
-      printf ("Error! Record: %d --- Extra Header not valid under provided schema!\n", recordNum);
+      report_event (context->report, REPORT_CRC, REPORT_ERROR, "CRC mismatch, record 0x%08X, calculated 0x%08X",
+                    stored_crc, calculated_crc);
       if (options->treat_as_errors)
       {
-        return false;
+        return RECORD_HALT;
       }
-      fail_count_rcd += 1;
-    }
+      *fail_count_rcd += 1;
 
-    if (verbose > 2)
+      if (resync)
+      {
+        return RECORD_DAMAGED;
+      }
+    }
+    else if (verbose > 1)
     {
-      printf ("--- Completed Extra Header verification for record: %d ---\n", recordNum);
+      report_event (context->report, REPORT_CRC, REPORT_INFO, "CRC is valid!");
     }
+  }
 
-    /* ----Check data payload headers----- */
-    if (payload_len > 0)
+  /* ----Check data payload headers----- */
+  if (payload_len > 0)
+  {
+    if (!options->skip_payload && can_check_payload)
     {
-      /* Calculate record length and check that it is within libmseed limits */
-      record_len        = MSEED3_FIXED_HEADER_LEN + identifier_len + extra_header_len + payload_len;
-      can_check_payload = (record_len <= MAXRECLEN);
-
-      if (!options->skip_payload && can_check_payload)
+      if (verbose > 2)
       {
-        if (verbose > 2)
-        {
-          printf ("--- Starting Data Payload verification for record: %d ---\n", recordNum);
-        }
+        report_line (context->report, REPORT_PAYLOAD, REPORT_INFO,
+                     "--- Starting Data Payload verification for record: %d ---", recordNum);
+      }
 
-        /* Reposition file position to beginning of record and read into buffer */
-        lmp_fseek64 (input, file_pos, SEEK_SET);
+      /* Parse record with libmseed directly from the mapped file, CRC already checked above */
+      stage = mseed3_stats_enter (MSEED3_STAGE_PAYLOAD);
+      rv    = msr3_parse (record, *record_len, msr, flags, context->libmseed_verbose);
+      mseed3_stats_leave (stage);
 
-        if (record_len != fread (recordbuffer, sizeof (char), record_len, input))
-        {
-          printf ("Fatal Error! Record: %d --- File size mismatch, check input record\n", recordNum);
-          fail_count_rcd += 1;
-        }
+      if (rv)
+      {
+        report_event (context->report, REPORT_PAYLOAD, REPORT_FATAL, "[libmseed] Could not parse record");
+        *fail_count_rcd += 1;
+      }
 
-        /* Parse record with libmseed, including CRC check */
-        else if (msr3_parse (recordbuffer, MAXRECLEN, &msr, flags, verbose))
+      else
+      {
+        /* Walk Steim frames in place, nothing is decoded into a sample buffer */
+        if (payload_fmt == MSEED3_STEIM1 || payload_fmt == MSEED3_STEIM2)
         {
-          printf ("Fatal Error! Record: %d --- [libmseed] Could not parse record\n", recordNum);
-          fail_count_rcd += 1;
+          struct mseed3_steim_state_s steim;
+          int steim_version = (payload_fmt == MSEED3_STEIM1) ? 1 : 2;
+          int status;
+
+          stage  = mseed3_stats_enter (MSEED3_STAGE_PAYLOAD);
+          status = mseed3_steim_verify (record + *record_len - payload_len, payload_len, steim_version,
+                                        record_number_samples (record), &steim);
+          mseed3_stats_leave (stage);
+
+          valid_payload = check_steim_status (context, status, &steim, steim_version, recordNum);
         }
 
         /* Unpack data samples, aka payload */
         else
         {
-          int samples = msr3_unpack_data (msr, verbose);
+          int samples;
+
+          stage   = mseed3_stats_enter (MSEED3_STAGE_PAYLOAD);
+          samples = msr3_unpack_data (*msr, context->libmseed_verbose);
+          mseed3_stats_leave (stage);
 
           valid_payload = (samples <= 0) ? false : true;
+        }
 
-          if (valid_payload)
-          {
-            if (verbose > 1)
-              printf ("Record: %d --- Data Payload is valid!\n", recordNum);
-          }
-          else
+        if (valid_payload)
+        {
+          if (verbose > 1)
+            report_event (context->report, REPORT_PAYLOAD, REPORT_INFO, "Data Payload is valid!");
+        }
+        else
+        {
+          report_event (context->report, REPORT_PAYLOAD, REPORT_ERROR, "Data Payload is not valid!");
+          if (options->treat_as_errors)
           {
-            printf ("Error! Record: %d --- Data Payload is not valid!\n", recordNum);
-            if (options->treat_as_errors)
-            {
-              return false;
-            }
-            fail_count_rcd += 1;
+            return RECORD_HALT;
           }
+          *fail_count_rcd += 1;
         }
       }
+    }
+    else if (!options->skip_payload)
+    {
+      /* Too large for libmseed, the payload was checked chunk by chunk above */
+      valid_payload = check_streamed_payload (context, record, payload_len, payload_fmt, &stream, recordNum);
+
+      if (valid_payload)
+      {
+        if (verbose > 1)
+          report_event (context->report, REPORT_PAYLOAD, REPORT_INFO, "Data Payload is valid!");
+      }
       else
       {
-        /* Skip payload if not checking it */
-        lmp_fseek64 (input, payload_len, SEEK_CUR);
-
-        if (verbose > 0)
+        report_event (context->report, REPORT_PAYLOAD, REPORT_ERROR, "Data Payload is not valid!");
+        if (options->treat_as_errors)
         {
-          if (!can_check_payload)
-            printf ("Cannot check payload of record length %" PRId64 "\n", record_len);
-          else
-            printf ("Payload validation skipped by user\n");
+          return RECORD_HALT;
         }
+        *fail_count_rcd += 1;
       }
+    }
+    else
+    {
+      if (verbose > 0)
+      {
+        report_line (context->report, REPORT_PAYLOAD, REPORT_INFO, "Payload validation skipped by user");
+      }
+    }
 
-      if (verbose > 2)
+    if (verbose > 2)
+    {
+      report_line (context->report, REPORT_PAYLOAD, REPORT_INFO,
+                   "--- Completed Data Payload verification for record: %d ---", recordNum);
+    }
+  } /* End of payload check */
+
+  return RECORD_CONTINUE;
+}
+
+/*! @brief Checksum and check the payload of a record too large for libmseed
+ *
+ *  The payload is walked once in fixed-size chunks straight from the mapped
+ *  file, updating the CRC and the Steim frame state as it goes, and each
+ *  chunk is released once done so memory use stays bounded whatever the
+ *  record length.  When reading a stream only the headers are buffered and
+ *  the payload chunks are read as they are checked.
+ *
+ *  @param[in] map mapped file, or the buffered headers of a stream
+ *  @param[in,out] input stream the payload is read from, or NULL
+ *  @param[in] record pointer to the start of the record
+ *  @param[in] record_len length of the record
+ *  @param[in] payload_len length of the payload
+ *  @param[in] payload_fmt payload encoding
+ *  @param[out] stream CRC and Steim state after the last chunk
+ *
+ *  @return false if the input ended before the end of the payload
+ */
+static bool
+stream_record (const struct mseed3_file_map_s *map, struct mseed3_stream_s *input, const char *record,
+               uint64_t record_len, uint32_t payload_len, uint8_t payload_fmt, struct record_stream_s *stream)
+{
+  const char *payload = record + record_len - payload_len;
+  bool steim          = (payload_fmt == MSEED3_STEIM1 || payload_fmt == MSEED3_STEIM2);
+  char *chunk         = NULL;
+
+  /* Fixed header, identifier and extra headers, with the CRC field taken as zero */
+  stream->crc = mseed3_record_crc (record, record_len - payload_len);
+
+  if (steim)
+  {
+    mseed3_steim_init (&stream->steim, (payload_fmt == MSEED3_STEIM1) ? 1 : 2, record_number_samples (record));
+  }
+
+  if (input != NULL && (chunk = (char *)malloc (PAYLOAD_CHUNK_LEN)) == NULL)
+  {
+    return false;
+  }
+
+  for (uint64_t pos = 0; pos < payload_len; pos += PAYLOAD_CHUNK_LEN)
+  {
+    uint64_t chunk_len = (payload_len - pos < PAYLOAD_CHUNK_LEN) ? payload_len - pos : PAYLOAD_CHUNK_LEN;
+    const char *data   = payload + pos;
+
+    if (input != NULL)
+    {
+      if (mseed3_stream_read (input, chunk, (size_t)chunk_len) != chunk_len)
       {
-        printf ("--- Completed Data Payload verification for record: %d ---\n", recordNum);
+        free (chunk);
+        return false;
       }
-    } /* End of payload check */
+      data = chunk;
+    }
 
-    recordNum = recordNum + 1;
-  } /* End of buffer input for-loop */
+    stream->crc = mseed3_crc32c (data, (size_t)chunk_len, stream->crc);
+
+    if (steim)
+    {
+      mseed3_steim_feed (&stream->steim, data, chunk_len);
+    }
+
+    mseed3_release_file_range (map, data, chunk_len);
+  }
+
+  free (chunk);
+
+  return true;
+}
+
+/*! @brief Check the encoding of a payload walked by stream_record()
+ *
+ *  Steim payloads are checked frame by frame, fixed size sample encodings
+ *  must hold exactly the header number of samples, text and opaque
+ *  payloads have no structure to check.
+ *
+ *  @param[in] record pointer to the start of the record
+ *  @param[in] payload_len length of the payload
+ *  @param[in] payload_fmt payload encoding
+ *  @param[in,out] stream state from stream_record()
+ *  @param[in] recordNum number of the record in the file
+ *
+ */
+static bool
+check_streamed_payload (struct validator_context_s *context, const char *record, uint32_t payload_len,
+                        uint8_t payload_fmt, struct record_stream_s *stream, uint32_t recordNum)
+{
+  uint64_t sample_size = 0;
+
+  switch (payload_fmt)
+  {
+  case MSEED3_TEXT:
+  case MSEED3_OPAQUE:
+    return true;
+  case MSEED3_STEIM1:
+  case MSEED3_STEIM2:
+    return check_steim_status (context, mseed3_steim_finish (&stream->steim), &stream->steim,
+                               (payload_fmt == MSEED3_STEIM1) ? 1 : 2, recordNum);
+  case MSEED3_UINT16:
+    sample_size = 2;
+    break;
+  case MSEED3_UINT32:
+  case MSEED3_FLOAT:
+    sample_size = 4;
+    break;
+  case MSEED3_DOUBLE:
+    sample_size = 8;
+    break;
+  default:
+    report_event (context->report, REPORT_PAYLOAD, REPORT_ERROR, "Cannot check payload encoding %d", payload_fmt);
+    return false;
+  }
+
+  if (sample_size * record_number_samples (record) != payload_len)
+  {
+    report_event (context->report, REPORT_PAYLOAD, REPORT_ERROR,
+                  "Payload length %u does not hold %u samples of %d bytes",
+                  payload_len, record_number_samples (record), (int)sample_size);
+    return false;
+  }
+
+  return true;
+}
+
+/* Report a Steim verification failure, returns true if the payload is valid */
+static bool
+check_steim_status (struct validator_context_s *context, int status, const struct mseed3_steim_state_s *steim,
+                    int version, uint32_t recordNum)
+{
+  if (status == MSEED3_STEIM_BAD_NIBBLE)
+  {
+    report_event (context->report, REPORT_PAYLOAD, REPORT_ERROR, "Steim-%d frame %u word %u: %s", version,
+                  steim->error_frame, steim->error_word, mseed3_steim_strerror (status));
+  }
+  else if (status == MSEED3_STEIM_BAD_XN)
+  {
+    report_event (context->report, REPORT_PAYLOAD, REPORT_ERROR, "Steim-%d %s (Xn %d, last sample %d)", version,
+                  mseed3_steim_strerror (status), steim->xn, (int32_t)steim->last);
+  }
+  else if (status != MSEED3_STEIM_OK)
+  {
+    report_event (context->report, REPORT_PAYLOAD, REPORT_ERROR, "Steim-%d %s (%u of %u samples)", version,
+                  mseed3_steim_strerror (status), steim->samples, steim->number_samples);
+  }
+
+  return (status == MSEED3_STEIM_OK);
+}
+
+/* Number of samples field of the fixed header */
+static uint32_t
+record_number_samples (const char *record)
+{
+  const uint8_t *header = (const uint8_t *)record;
+
+  return header[24] | (header[25] << 8) | (header[26] << 16) | ((uint32_t)header[27] << 24);
+}
+
+/* Record length given by the fixed header */
+static uint64_t
+header_record_length (const char *record)
+{
+  const uint8_t *header = (const uint8_t *)record;
+
+  return MSEED3_FIXED_HEADER_LEN + header[33] + (header[34] | (header[35] << 8)) +
+         (header[36] | (header[37] << 8) | (header[38] << 16) | ((uint64_t)header[39] << 24));
+}
+
+/* Report the damaged bytes skipped up to the next intact record */
+static void
+report_resync (struct validator_context_s *context, uint64_t file_pos, uint64_t next, uint64_t length)
+{
+  if (next >= length)
+  {
+    report_event (context->report, REPORT_FILE, REPORT_WARNING,
+                  "No intact record found in the last %" PRIu64 " byte(s) of the file", length - file_pos);
+  }
+  else
+  {
+    report_event (context->report, REPORT_FILE, REPORT_WARNING, "Resynchronized at offset %" PRIu64 ", skipped %" PRIu64
+                  " damaged byte(s)", next, next - file_pos);
+  }
+}
+
+/*! @brief Find where validation resumes after a damaged record
+ *
+ *  @param[in] context validation context the skipped bytes are reported to
+ *  @param[in] map mapped file
+ *  @param[in] file_pos offset of the damaged record
+ *
+ *  @return offset of the next intact record, or the file length if there is none
+ */
+static uint64_t
+resync_record (struct validator_context_s *context, const struct mseed3_file_map_s *map, uint64_t file_pos)
+{
+  uint64_t next = mseed3_find_record (map->data, map->length, file_pos + 1);
+
+  if (next == MSEED3_NO_RECORD)
+  {
+    next = map->length;
+  }
+
+  report_resync (context, file_pos, next, map->length);
+
+  return next;
+}
+
+/*! @brief Build the record offset table from the fixed headers only
+ *
+ *  Lengths are taken from the headers as found, exactly as the sequential
+ *  walk in check_file() does, so both modes visit the same records.  A
+ *  final record that runs past the end of the file is included so that
+ *  it is reported when checked.  With -W resync a record that is not
+ *  intact extends to the next one that is.
+ *
+ *  @param[in] map mapped file
+ *  @param[in] resync skip damaged records by searching for the next intact one
+ *  @param[out] entries table of record offsets, free() when done
+ *  @param[out] entry_cnt number of records found
+ *
+ *  @return 0 on success, MSEED3_MALLOC_ERROR if the table cannot grow
+ */
+static int
+scan_records (const struct mseed3_file_map_s *map, bool resync, struct record_entry_s **entries,
+              uint32_t *entry_cnt)
+{
+  int entry_alloc   = 0;
+  uint64_t file_pos = 0;
+
+  *entries   = NULL;
+  *entry_cnt = 0;
+
+  while (map->length > file_pos)
+  {
+    uint64_t record_len = MSEED3_FIXED_HEADER_LEN;
+
+    if (map->length - file_pos >= MSEED3_FIXED_HEADER_LEN)
+    {
+      record_len = header_record_length (map->data + file_pos);
+    }
+
+    if (resync && !mseed3_record_plausible (map->data + file_pos, map->length - file_pos))
+    {
+      uint64_t next = mseed3_find_record (map->data, map->length, file_pos + 1);
+
+      record_len = ((next == MSEED3_NO_RECORD) ? map->length : next) - file_pos;
+    }
+
+    if ((uint32_t)entry_alloc <= *entry_cnt)
+    {
+      struct record_entry_s *grown = *entries;
+      int len                      = expand_array ((void **)&grown, entry_alloc, sizeof (struct record_entry_s));
+
+      if (len < 0)
+      {
+        free (*entries);
+        *entries   = NULL;
+        *entry_cnt = 0;
+        return MSEED3_MALLOC_ERROR;
+      }
+      *entries    = grown;
+      entry_alloc = len;
+    }
+
+    (*entries)[*entry_cnt].offset = file_pos;
+    (*entries)[*entry_cnt].length = record_len;
+    (*entry_cnt)++;
+
+    file_pos += record_len;
+  }
+
+  return 0;
+}
+
+/* Worker entry point, checks one contiguous range of records in a context of its own,
+ * whose counts are handed back in result and merged by tally_record_range() */
+static void
+check_record_range (void *context, size_t index, struct job_result_s *result)
+{
+  struct record_ranges_s *ranges = (struct record_ranges_s *)context;
+  uint32_t first                 = (uint32_t)index * ranges->range_len;
+  uint32_t last                  = first + ranges->range_len;
+  MS3Record *msr                 = NULL;
+  struct validator_context_s *worker;
+
+  if (last > ranges->entry_cnt)
+  {
+    last = ranges->entry_cnt;
+  }
+
+  worker = validator_context_open (ranges->context->options, ranges->context->schema, ranges->context->report,
+                                   ranges->context->verbose);
+
+  if (worker == NULL)
+  {
+    report_line (ranges->context->report, REPORT_FILE, REPORT_ERROR,
+                 "Error! Records: %" PRIu32 "-%" PRIu32 " --- cannot allocate validation context", first, last - 1);
+    result->failures++;
+    return;
+  }
+  worker->libmseed_verbose = ranges->context->libmseed_verbose;
+
+  for (uint32_t recordNum = first; recordNum < last; recordNum++)
+  {
+    const struct record_entry_s *entry = &ranges->entries[recordNum];
+    uint64_t record_len                = 0;
+    uint32_t failures                  = result->failures;
+    enum record_status_e status;
+
+    status = check_record (worker, ranges->map, entry->offset, NULL, recordNum, &msr, &record_len,
+                           &result->failures);
+
+    if (status == RECORD_HALT)
+    {
+      result->status = RECORD_HALT;
+      break;
+    }
+
+    if (result->failures == failures && result->valid_records == recordNum - first)
+    {
+      result->valid_records++;
+    }
+
+    result->records++;
+
+    if (status == RECORD_END)
+    {
+      break;
+    }
+
+    if (status == RECORD_DAMAGED)
+    {
+      report_resync (worker, entry->offset, entry->offset + entry->length, ranges->map->length);
+    }
+  }
 
   if (msr)
   {
     msr3_free (&msr);
   }
 
-  if (verbose > 1)
+  result->memo_hits   = worker->memo_counts.hits;
+  result->memo_misses = worker->memo_counts.misses;
+
+  validator_context_close (worker);
+}
+
+/* Collect the result of one record range, called in record order */
+static bool
+tally_record_range (void *context, size_t index, const struct job_result_s *result)
+{
+  struct record_ranges_s *ranges = (struct record_ranges_s *)context;
+
+  ranges->fail_count_rcd += result->failures;
+  ranges->records += result->records;
+
+  /* Valid records only extend the prefix while every range before was valid throughout */
+  if (ranges->valid_prefix && result->status != JOB_ABORTED)
+  {
+    uint32_t first = (uint32_t)index * ranges->range_len;
+    uint32_t last  = (first + ranges->range_len < ranges->entry_cnt) ? first + ranges->range_len : ranges->entry_cnt;
+
+    ranges->valid_records += result->valid_records;
+    ranges->valid_prefix = (result->valid_records == last - first);
+  }
+  else
   {
-    printf("Completed processing %d record(s)\n", recordNum);
+    ranges->valid_prefix = false;
   }
 
-  *records = recordNum;
+  ranges->memo.hits += result->memo_hits;
+  ranges->memo.misses += result->memo_misses;
 
-  if (fail_count_rcd == 0)
-    return true;
-  else
+  if (result->status == JOB_ABORTED)
+  {
+    report_line (ranges->context->report, REPORT_FILE, REPORT_FATAL,
+                 "Fatal Error! Records: %d-%d --- validation terminated abnormally",
+                 (int)(index * ranges->range_len), (int)((index + 1) * ranges->range_len - 1));
+    ranges->fail_count_rcd += 1;
+  }
+
+  if (result->status == RECORD_HALT)
+  {
+    ranges->halted = true;
     return false;
+  }
+
+  return true;
+}
+
+/* Extend the valid prefix of a file for the cache while its records are valid, client is the check_digest_s */
+static void
+tally_valid_prefix (void *client, uint32_t recordNum, uint64_t offset, uint64_t length, bool valid)
+{
+  struct check_digest_s *digest = (struct check_digest_s *)client;
+
+  if (valid && offset == digest->valid_length)
+  {
+    digest->valid_length  = offset + length;
+    digest->valid_records = recordNum + 1;
+  }
+}
+
+/* Hash the mapped file for the cache, continuing from the state of the first_pos bytes skipped by resume.
+ * The valid prefix is hashed first, its hash taken on the way to that of the whole file */
+static void
+digest_file (const struct mseed3_file_map_s *map, const struct check_resume_s *resume, uint64_t first_pos,
+             struct check_digest_s *digest)
+{
+  struct mseed3_hash64_s state;
+  int stage;
+
+  if (digest == NULL)
+  {
+    return;
+  }
+
+  stage = mseed3_stats_enter (MSEED3_STAGE_READ);
+
+  if (first_pos > 0)
+  {
+    state = resume->hash;
+  }
+  else
+  {
+    mseed3_hash64_reset (&state, 0);
+  }
+
+  mseed3_hash64_update (&state, map->data + first_pos, (size_t)(digest->valid_length - first_pos));
+  digest->valid_hash = mseed3_hash64_digest (&state);
+
+  mseed3_hash64_update (&state, map->data + digest->valid_length, (size_t)(map->length - digest->valid_length));
+
+  digest->length       = map->length;
+  digest->content_hash = mseed3_hash64_digest (&state);
+  digest->hashed       = true;
+
+  mseed3_stats_leave (stage);
+}
+
+/* Report how many extra headers of a file reused a remembered verdict, counted from start */
+static void
+report_memo (struct validator_context_s *context, const struct extra_header_memo_counts_s *start)
+{
+  uint32_t hits   = context->memo_counts.hits - start->hits;
+  uint32_t misses = context->memo_counts.misses - start->misses;
+
+  if (hits + misses > 0)
+  {
+    report_line (context->report, REPORT_FILE, REPORT_INFO,
+                 "Extra header verdicts: %" PRIu32 " validated, %" PRIu32 " reused", misses, hits);
+  }
 }
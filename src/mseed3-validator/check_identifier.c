@@ -1,39 +1,235 @@
+#include "report.h"
 #include "validator.h"
 #include "warnings.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
-/*! @brief Read identifier length into buffer
+/* Character classes of identifier bytes */
+#define SID_ALNUM 0x01 /* uppercase ASCII letter or digit */
+#define SID_DASH 0x02
+
+/* Number of codes in NET_STA_LOC_BAND_SOURCE_SUBSOURCE */
+#define SID_CODE_CNT 6
+
+/* Code of an FDSN source identifier, see sid_codes */
+struct sid_code_s
+{
+  const char *name;
+  uint8_t min_len;
+  uint8_t max_len; /* 0 for no limit but the identifier length */
+  uint8_t allowed; /* SID_ character classes */
+};
+
+/* Reasons a source identifier is rejected */
+enum sid_error_e
+{
+  SID_OK = 0,
+  SID_BAD_CHARACTER,
+  SID_TOO_SHORT,
+  SID_TOO_LONG,
+  SID_TOO_FEW_CODES,
+  SID_TOO_MANY_CODES
+};
+
+/* FDSN Source Identifiers 1.0, codes in order of appearance */
+static const struct sid_code_s sid_codes[SID_CODE_CNT] = {{"network", 1, 8, SID_ALNUM},
+                                                          {"station", 1, 8, SID_ALNUM | SID_DASH},
+                                                          {"location", 0, 8, SID_ALNUM | SID_DASH},
+                                                          {"band", 0, 0, SID_ALNUM},
+                                                          {"source", 1, 0, SID_ALNUM},
+                                                          {"subsource", 0, 0, SID_ALNUM}};
+
+/* Class of every byte value, computed once so the check is one lookup per byte */
+static const uint8_t sid_classes[256] = {
+    ['-'] = SID_DASH,
+    ['0'] = SID_ALNUM, ['1'] = SID_ALNUM, ['2'] = SID_ALNUM, ['3'] = SID_ALNUM, ['4'] = SID_ALNUM,
+    ['5'] = SID_ALNUM, ['6'] = SID_ALNUM, ['7'] = SID_ALNUM, ['8'] = SID_ALNUM, ['9'] = SID_ALNUM,
+    ['A'] = SID_ALNUM, ['B'] = SID_ALNUM, ['C'] = SID_ALNUM, ['D'] = SID_ALNUM, ['E'] = SID_ALNUM,
+    ['F'] = SID_ALNUM, ['G'] = SID_ALNUM, ['H'] = SID_ALNUM, ['I'] = SID_ALNUM, ['J'] = SID_ALNUM,
+    ['K'] = SID_ALNUM, ['L'] = SID_ALNUM, ['M'] = SID_ALNUM, ['N'] = SID_ALNUM, ['O'] = SID_ALNUM,
+    ['P'] = SID_ALNUM, ['Q'] = SID_ALNUM, ['R'] = SID_ALNUM, ['S'] = SID_ALNUM, ['T'] = SID_ALNUM,
+    ['U'] = SID_ALNUM, ['V'] = SID_ALNUM, ['W'] = SID_ALNUM, ['X'] = SID_ALNUM, ['Y'] = SID_ALNUM,
+    ['Z'] = SID_ALNUM};
+
+/* Namespaces whose identifiers follow the FDSN syntax, XFDSN is used by the reference datasets */
+static const char fdsn_prefix[]  = "FDSN:";
+static const char xfdsn_prefix[] = "XFDSN:";
+
+/*! @brief Check the codes of an FDSN source identifier in a single pass
+ *
+ *  @param[in] codes identifier bytes following the namespace prefix
+ *  @param[in] length number of bytes
+ *  @param[out] code index in sid_codes of the offending code
+ *  @param[out] position offset of the offending byte in codes
+ *
+ *  @return SID_OK or the reason the identifier is rejected
+ */
+static enum sid_error_e
+parse_sid_codes (const uint8_t *codes, size_t length, int *code, size_t *position)
+{
+  size_t start = 0;
+  int current  = 0;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    if (codes[i] == '_')
+    {
+      size_t code_len = i - start;
+
+      *code     = current;
+      *position = start;
+
+      if (code_len < sid_codes[current].min_len)
+      {
+        return SID_TOO_SHORT;
+      }
+      if (sid_codes[current].max_len > 0 && code_len > sid_codes[current].max_len)
+      {
+        return SID_TOO_LONG;
+      }
+      if (++current == SID_CODE_CNT)
+      {
+        *position = i;
+        return SID_TOO_MANY_CODES;
+      }
+
+      start = i + 1;
+    }
+    else if (!(sid_classes[codes[i]] & sid_codes[current].allowed))
+    {
+      *code     = current;
+      *position = i;
+      return SID_BAD_CHARACTER;
+    }
+  }
+
+  *code     = current;
+  *position = start;
+
+  if (current != SID_CODE_CNT - 1)
+  {
+    return SID_TOO_FEW_CODES;
+  }
+  if (length - start < sid_codes[current].min_len)
+  {
+    return SID_TOO_SHORT;
+  }
+  if (sid_codes[current].max_len > 0 && length - start > sid_codes[current].max_len)
+  {
+    return SID_TOO_LONG;
+  }
+
+  return SID_OK;
+}
+
+/*! @brief Check the source identifier of a record
+ *
+ *  Identifiers in the FDSN namespace must follow
+ *  FDSN:NET_STA_LOC_BAND_SOURCE_SUBSOURCE from the FDSN Source Identifiers
+ *  specification, the first malformed code is reported.  Identifiers in
+ *  other namespaces are not checked further.
  *
- *  @param[in] options -W cmd line warn options (currently not implemented)
- *  @param[in] input file pointer to miniSEED file
+ *  @param[in] context validation context
+ *  @param[in] identifier pointer to the identifier bytes of the record
  *  @param[in] identifier_len
  *
  */
 bool
-check_identifier (struct extra_options_s *options, FILE *input, uint8_t identifier_len,
-                  uint32_t recordNum, uint8_t verbose)
+check_identifier (struct validator_context_s *context, const char *identifier, uint8_t identifier_len,
+                  uint32_t recordNum)
 {
-  bool output  = true;
-  char *buffer = (char *)calloc (identifier_len + 1, sizeof (char));
+  bool output = true;
+  size_t prefix_len;
+  size_t position = 0;
+  int code        = 0;
+  enum sid_error_e status;
 
-  if (identifier_len > fread (buffer, sizeof (char), identifier_len, input))
+  if (identifier == NULL)
   {
-    printf ("Fatal Error: EOF reached reading identifier_len into buffer, please double check input record\n");
-    free (buffer);
+    report_line (context->report, REPORT_IDENTIFIER, REPORT_FATAL,
+                 "Fatal Error: EOF reached reading identifier_len into buffer, please double check input record");
     output = false;
     return output;
   }
 
-  if (verbose > 2)
-    printf ("Record: %d --- Checking source identifier URN: %s\n", recordNum, buffer);
+  if (context->verbose > 2)
+    report_event (context->report, REPORT_IDENTIFIER, REPORT_INFO, "Checking source identifier URN: %.*s",
+                  (int)identifier_len, identifier);
 
-  //TODO test value
+  if (identifier_len >= sizeof (fdsn_prefix) - 1 && 0 == memcmp (identifier, fdsn_prefix, sizeof (fdsn_prefix) - 1))
+  {
+    prefix_len = sizeof (fdsn_prefix) - 1;
+  }
+  else if (identifier_len >= sizeof (xfdsn_prefix) - 1 &&
+           0 == memcmp (identifier, xfdsn_prefix, sizeof (xfdsn_prefix) - 1))
+  {
+    prefix_len = sizeof (xfdsn_prefix) - 1;
+  }
+  else
+  {
+    if (memchr (identifier, ':', identifier_len) == NULL)
+    {
+      report_event (context->report, REPORT_IDENTIFIER, REPORT_WARNING,
+                    "Source identifier %.*s has no namespace prefix such as FDSN:", (int)identifier_len, identifier);
+    }
+    else if (context->verbose > 2)
+    {
+      report_event (context->report, REPORT_IDENTIFIER, REPORT_INFO,
+                    "Source identifier is not in the FDSN namespace, not checked");
+    }
+
+    return output;
+  }
+
+  status = parse_sid_codes ((const uint8_t *)identifier + prefix_len, identifier_len - prefix_len, &code, &position);
+  position += prefix_len;
 
-  if (buffer)
+  switch (status)
   {
-    free (buffer);
+  case SID_OK:
+    break;
+  case SID_BAD_CHARACTER:
+    if (identifier[position] >= 0x20 && identifier[position] < 0x7F)
+    {
+      report_event (context->report, REPORT_IDENTIFIER, REPORT_ERROR,
+                    "Source identifier %.*s, %s code has invalid character '%c' at offset %d", (int)identifier_len,
+                    identifier, sid_codes[code].name, identifier[position], (int)position);
+    }
+    else
+    {
+      report_event (context->report, REPORT_IDENTIFIER, REPORT_ERROR,
+                    "Source identifier %.*s, %s code has invalid byte 0x%02X at offset %d", (int)identifier_len,
+                    identifier, sid_codes[code].name, (uint8_t)identifier[position], (int)position);
+    }
+    output = false;
+    break;
+  case SID_TOO_SHORT:
+    report_event (context->report, REPORT_IDENTIFIER, REPORT_ERROR,
+                  "Source identifier %.*s, %s code at offset %d is empty", (int)identifier_len, identifier,
+                  sid_codes[code].name, (int)position);
+    output = false;
+    break;
+  case SID_TOO_LONG:
+    report_event (context->report, REPORT_IDENTIFIER, REPORT_ERROR,
+                  "Source identifier %.*s, %s code at offset %d is longer than %d characters", (int)identifier_len,
+                  identifier, sid_codes[code].name, (int)position, sid_codes[code].max_len);
+    output = false;
+    break;
+  case SID_TOO_FEW_CODES:
+    report_event (context->report, REPORT_IDENTIFIER, REPORT_ERROR,
+                  "Source identifier %.*s has %d code(s), expected NET_STA_LOC_BAND_SOURCE_SUBSOURCE",
+                  (int)identifier_len, identifier, code + 1);
+    output = false;
+    break;
+  case SID_TOO_MANY_CODES:
+    report_event (context->report, REPORT_IDENTIFIER, REPORT_ERROR,
+                  "Source identifier %.*s has more than %d codes, unexpected '_' at offset %d", (int)identifier_len,
+                  identifier, SID_CODE_CNT, (int)position);
+    output = false;
+    break;
   }
+
   return output;
 }
@@ -0,0 +1,605 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mseed3-common/array.h>
+#include <mseed3-common/constants.h>
+#include <mseed3-common/files.h>
+
+#include "file_queue.h"
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define FILE_QUEUE_HAVE_OPENAT 1
+#endif
+
+/* Longest error message kept about an unreadable directory or list */
+#define FILE_QUEUE_ERROR_LEN 1024
+
+#ifdef FILE_QUEUE_HAVE_OPENAT
+/* Directory being searched, its entries sorted by name */
+struct file_queue_dir_s
+{
+  DIR *dir;
+  char *path;
+  char **entries;
+  int entry_cnt;
+  int entry_alloc;
+  int next;
+};
+#endif
+
+/* Where the enumeration stands, advanced by file_queue_wait() */
+struct file_queue_walk_s
+{
+  int operand_next;
+  int tree_next;
+  int list_next;
+
+#ifdef FILE_QUEUE_HAVE_OPENAT
+  /* Directories being searched, innermost last */
+  struct file_queue_dir_s *dirs;
+  int dir_cnt;
+  int dir_alloc;
+#endif
+
+  /* List being read and the name read so far */
+  FILE *list;
+  const char *list_path;
+  char *name;
+  size_t name_len;
+  size_t name_alloc;
+};
+
+/* Append a copy of a string to a growable array */
+static bool
+push_string (char ***array, int *cnt, int *alloc, const char *string)
+{
+  char *copy = strdup (string);
+
+  if (copy == NULL)
+  {
+    return false;
+  }
+
+  if (*cnt >= *alloc)
+  {
+    char **grown = *array;
+    int len      = expand_array ((void **)&grown, *alloc, sizeof (char *));
+
+    if (len < 0)
+    {
+      free (copy);
+      return false;
+    }
+    *array = grown;
+    *alloc = len;
+  }
+
+  (*array)[(*cnt)++] = copy;
+
+  return true;
+}
+
+/* Add a file found, stopping the enumeration when out of memory */
+static void
+add_name (struct file_queue_s *queue, const char *name)
+{
+  char *copy;
+
+  if (queue->name_cnt >= (size_t)queue->name_alloc)
+  {
+    char **names = queue->names;
+    int len      = expand_array ((void **)&names, queue->name_alloc, sizeof (char *));
+
+    if (len < 0)
+    {
+      queue->stop = true;
+      return;
+    }
+    queue->names      = names;
+    queue->name_alloc = len;
+  }
+
+  if ((copy = strdup (name)) == NULL)
+  {
+    queue->stop = true;
+    return;
+  }
+
+  queue->names[queue->name_cnt++] = copy;
+}
+
+/* Note a directory or list that could not be read */
+static void
+add_error (struct file_queue_s *queue, const char *what, const char *path, int error)
+{
+  char message[FILE_QUEUE_ERROR_LEN];
+  struct file_queue_error_s entry;
+
+  snprintf (message, sizeof (message), "Error! Cannot read %s: %s, %s", what, path, strerror (error));
+
+  entry.path    = strdup (path);
+  entry.message = strdup (message);
+
+  if (queue->error_cnt >= queue->error_alloc && entry.path != NULL && entry.message != NULL)
+  {
+    struct file_queue_error_s *errors = queue->errors;
+    int len = expand_array ((void **)&errors, queue->error_alloc, sizeof (struct file_queue_error_s));
+
+    if (len >= 0)
+    {
+      queue->errors      = errors;
+      queue->error_alloc = len;
+    }
+  }
+
+  if (queue->error_cnt < queue->error_alloc && entry.path != NULL && entry.message != NULL)
+  {
+    queue->errors[queue->error_cnt++] = entry;
+    return;
+  }
+
+  free (entry.path);
+  free (entry.message);
+}
+
+#ifdef FILE_QUEUE_HAVE_OPENAT
+static int
+compare_names (const void *a, const void *b)
+{
+  return strcmp (*(char *const *)a, *(char *const *)b);
+}
+
+/* Start searching an open directory, reading and sorting its entries */
+static void
+open_dir (struct file_queue_s *queue, int dirfd, const char *path)
+{
+  struct file_queue_walk_s *walk = queue->walk;
+  struct file_queue_dir_s *top;
+  struct dirent *entry;
+  DIR *dir;
+
+  if ((dir = fdopendir (dirfd)) == NULL)
+  {
+    add_error (queue, "directory", path, errno);
+    close (dirfd);
+    return;
+  }
+
+  if (walk->dir_cnt >= walk->dir_alloc)
+  {
+    struct file_queue_dir_s *dirs = walk->dirs;
+    int len                       = expand_array ((void **)&dirs, walk->dir_alloc, sizeof (struct file_queue_dir_s));
+
+    if (len < 0)
+    {
+      add_error (queue, "directory", path, ENOMEM);
+      closedir (dir);
+      return;
+    }
+    walk->dirs      = dirs;
+    walk->dir_alloc = len;
+  }
+
+  top = &walk->dirs[walk->dir_cnt];
+  memset (top, 0, sizeof (struct file_queue_dir_s));
+  top->dir = dir;
+
+  if ((top->path = strdup (path)) == NULL)
+  {
+    add_error (queue, "directory", path, ENOMEM);
+    closedir (dir);
+    return;
+  }
+  walk->dir_cnt++;
+
+  /* Sort the entries so the order of the report does not depend on the file system */
+  while ((entry = readdir (dir)) != NULL)
+  {
+    if (0 == strcmp (entry->d_name, ".") || 0 == strcmp (entry->d_name, ".."))
+    {
+      continue;
+    }
+
+    if (!push_string (&top->entries, &top->entry_cnt, &top->entry_alloc, entry->d_name))
+    {
+      add_error (queue, "directory", path, ENOMEM);
+      break;
+    }
+  }
+
+  if (top->entry_cnt > 1)
+  {
+    qsort (top->entries, (size_t)top->entry_cnt, sizeof (char *), compare_names);
+  }
+}
+
+/* Stop searching the innermost directory */
+static void
+close_dir (struct file_queue_s *queue)
+{
+  struct file_queue_dir_s *top = &queue->walk->dirs[--queue->walk->dir_cnt];
+
+  for (int i = 0; i < top->entry_cnt; i++)
+  {
+    free (top->entries[i]);
+  }
+
+  free (top->entries);
+  free (top->path);
+  closedir (top->dir);
+}
+
+/* Take the next entry of the innermost directory, descending into subdirectories, depth first */
+static void
+step_dir (struct file_queue_s *queue)
+{
+  struct file_queue_dir_s *top = &queue->walk->dirs[queue->walk->dir_cnt - 1];
+  int fd                       = dirfd (top->dir);
+  size_t path_len              = strlen (top->path);
+  const char *name;
+  struct stat info;
+  size_t len;
+  char *child;
+
+  if (top->next >= top->entry_cnt)
+  {
+    close_dir (queue);
+    return;
+  }
+
+  name  = top->entries[top->next++];
+  len   = path_len + strlen (name) + 2;
+  child = (char *)malloc (len);
+
+  if (child == NULL)
+  {
+    queue->stop = true;
+    return;
+  }
+
+  /* A single separator, also below "/" or a path given with a trailing slash */
+  if (path_len > 0 && top->path[path_len - 1] == '/')
+  {
+    snprintf (child, len, "%s%s", top->path, name);
+  }
+  else
+  {
+    snprintf (child, len, "%s/%s", top->path, name);
+  }
+
+  /* Symbolic links to files are followed, links to directories are not, like find(1) */
+  if (fstatat (fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0)
+  {
+    add_error (queue, "file", child, errno);
+  }
+  else if (S_ISDIR (info.st_mode))
+  {
+    int subdir = openat (fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (subdir < 0)
+    {
+      add_error (queue, "directory", child, errno);
+    }
+    else
+    {
+      open_dir (queue, subdir, child);
+    }
+  }
+  else if (S_ISREG (info.st_mode) ||
+           (S_ISLNK (info.st_mode) && fstatat (fd, name, &info, 0) == 0 && S_ISREG (info.st_mode)))
+  {
+    add_name (queue, child);
+  }
+
+  free (child);
+}
+#endif
+
+/* Start searching a directory given with -r */
+static void
+open_tree (struct file_queue_s *queue, const char *path)
+{
+#ifdef FILE_QUEUE_HAVE_OPENAT
+  int dirfd = openat (AT_FDCWD, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  if (dirfd < 0)
+  {
+    add_error (queue, "directory", path, errno);
+    return;
+  }
+
+  open_dir (queue, dirfd, path);
+#else
+  add_error (queue, "directory", path, ENOSYS);
+#endif
+}
+
+/* Start reading a list of files given with -L */
+static void
+open_list (struct file_queue_s *queue, const char *path)
+{
+  struct file_queue_walk_s *walk = queue->walk;
+
+  if (0 == strcmp (path, "-"))
+  {
+    walk->list = stdin;
+  }
+  else if ((walk->list = fopen (path, "rb")) == NULL)
+  {
+    add_error (queue, "file list", path, errno);
+    return;
+  }
+
+  walk->list_path = path;
+  walk->name_len  = 0;
+}
+
+/* Stop reading the current list */
+static void
+close_list (struct file_queue_s *queue)
+{
+  struct file_queue_walk_s *walk = queue->walk;
+
+  if (walk->list != stdin)
+  {
+    fclose (walk->list);
+  }
+  walk->list = NULL;
+}
+
+/* Read the next name of a NUL separated list, such as written by find -print0 */
+static void
+step_list (struct file_queue_s *queue)
+{
+  struct file_queue_walk_s *walk = queue->walk;
+  int c;
+
+  while ((c = getc (walk->list)) != EOF)
+  {
+    if (walk->name_len + 1 >= walk->name_alloc)
+    {
+      size_t alloc = walk->name_alloc ? walk->name_alloc * 2 : 256;
+      char *grown  = (char *)realloc (walk->name, alloc);
+
+      if (grown == NULL)
+      {
+        add_error (queue, "file list", walk->list_path, ENOMEM);
+        close_list (queue);
+        return;
+      }
+      walk->name       = grown;
+      walk->name_alloc = alloc;
+    }
+
+    if (c != '\0')
+    {
+      walk->name[walk->name_len++] = (char)c;
+      continue;
+    }
+
+    walk->name[walk->name_len] = '\0';
+    if (walk->name_len > 0)
+    {
+      walk->name_len = 0;
+      add_name (queue, walk->name);
+      return;
+    }
+  }
+
+  /* The last name need not be terminated */
+  if (walk->name_len > 0)
+  {
+    walk->name[walk->name_len] = '\0';
+    walk->name_len             = 0;
+    add_name (queue, walk->name);
+  }
+
+  if (ferror (walk->list))
+  {
+    add_error (queue, "file list", walk->list_path, EIO);
+  }
+
+  close_list (queue);
+}
+
+/* Enumerate inputs one step further: command line files, then -r directories, then file lists */
+static void
+step (struct file_queue_s *queue)
+{
+  struct file_queue_walk_s *walk = queue->walk;
+
+  if (queue->stop)
+  {
+    queue->finished = true;
+  }
+#ifdef FILE_QUEUE_HAVE_OPENAT
+  else if (walk->dir_cnt > 0)
+  {
+    step_dir (queue);
+  }
+#endif
+  else if (walk->list != NULL)
+  {
+    step_list (queue);
+  }
+  else if (walk->operand_next < queue->operand_cnt)
+  {
+    add_name (queue, queue->operands[walk->operand_next++]);
+  }
+  else if (walk->tree_next < queue->tree_cnt)
+  {
+    open_tree (queue, queue->trees[walk->tree_next++]);
+  }
+  else if (walk->list_next < queue->list_cnt)
+  {
+    open_list (queue, queue->lists[walk->list_next++]);
+  }
+  else
+  {
+    queue->finished = true;
+  }
+}
+
+/*! @brief Add a directory whose files are all validated, searched recursively
+ *
+ *  @param[in,out] queue queue, before file_queue_open()
+ *  @param[in] path directory name
+ *
+ *  @return 0 on success, MSEED3_MALLOC_ERROR on failure
+ */
+int
+file_queue_add_tree (struct file_queue_s *queue, const char *path)
+{
+  return push_string (&queue->trees, &queue->tree_cnt, &queue->tree_alloc, path) ? 0 : MSEED3_MALLOC_ERROR;
+}
+
+/*! @brief Add a file listing names separated by NUL bytes, "-" for stdin
+ *
+ *  @param[in,out] queue queue, before file_queue_open()
+ *  @param[in] path list file name
+ *
+ *  @return 0 on success, MSEED3_MALLOC_ERROR on failure
+ */
+int
+file_queue_add_list (struct file_queue_s *queue, const char *path)
+{
+  return push_string (&queue->lists, &queue->list_cnt, &queue->list_alloc, path) ? 0 : MSEED3_MALLOC_ERROR;
+}
+
+/*! @brief Start enumerating the files to validate
+ *
+ *  Files named on the command line come first, in order, followed by the
+ *  files below each -r directory and the files of each list.  Directories
+ *  and lists are read as file_queue_wait() asks for further files, by the
+ *  thread validating them, so no other thread runs while workers are forked
+ *  and the files found so far are validated while the rest is searched.
+ *
+ *  @param[in,out] queue queue with trees and lists added, zeroed before use
+ *  @param[in] operands file names from the command line, kept by reference
+ *  @param[in] operand_cnt number of file names
+ *
+ *  @return 0 on success, MSEED3_MALLOC_ERROR on failure
+ */
+int
+file_queue_open (struct file_queue_s *queue, char **operands, int operand_cnt)
+{
+  queue->operands    = operands;
+  queue->operand_cnt = operand_cnt;
+
+  if ((queue->walk = (struct file_queue_walk_s *)calloc (1, sizeof (struct file_queue_walk_s))) == NULL)
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  return 0;
+}
+
+/*! @brief Enumerate files until file index is known
+ *
+ *  @param[in] queue open queue
+ *  @param[in] index index of the file, in enumeration order
+ *
+ *  @return true if the file exists, false once all files have been enumerated
+ */
+bool
+file_queue_wait (struct file_queue_s *queue, size_t index)
+{
+  while (index >= queue->name_cnt && !queue->finished)
+  {
+    step (queue);
+  }
+
+  return index < queue->name_cnt;
+}
+
+/*! @brief Name of file index, after file_queue_wait() has returned true for it
+ *
+ */
+char *
+file_queue_name (struct file_queue_s *queue, size_t index)
+{
+  return index < queue->name_cnt ? queue->names[index] : NULL;
+}
+
+/*! @brief Stop enumerating files and release the queue
+ *
+ *  Unreadable directories and lists are kept in errors until
+ *  file_queue_free_errors().
+ *
+ */
+void
+file_queue_close (struct file_queue_s *queue)
+{
+  if (queue->walk != NULL)
+  {
+#ifdef FILE_QUEUE_HAVE_OPENAT
+    while (queue->walk->dir_cnt > 0)
+    {
+      close_dir (queue);
+    }
+    free (queue->walk->dirs);
+#endif
+
+    if (queue->walk->list != NULL)
+    {
+      close_list (queue);
+    }
+
+    free (queue->walk->name);
+    free (queue->walk);
+    queue->walk = NULL;
+  }
+
+  for (size_t i = 0; i < queue->name_cnt; i++)
+  {
+    free (queue->names[i]);
+  }
+
+  for (int i = 0; i < queue->tree_cnt; i++)
+  {
+    free (queue->trees[i]);
+  }
+
+  for (int i = 0; i < queue->list_cnt; i++)
+  {
+    free (queue->lists[i]);
+  }
+
+  free (queue->names);
+  free (queue->trees);
+  free (queue->lists);
+  queue->names    = NULL;
+  queue->trees    = NULL;
+  queue->lists    = NULL;
+  queue->name_cnt = 0;
+  queue->tree_cnt = 0;
+  queue->list_cnt = 0;
+}
+
+/*! @brief Release the unreadable directories and lists of a closed queue
+ *
+ */
+void
+file_queue_free_errors (struct file_queue_s *queue)
+{
+  for (int i = 0; i < queue->error_cnt; i++)
+  {
+    free (queue->errors[i].path);
+    free (queue->errors[i].message);
+  }
+
+  free (queue->errors);
+  queue->errors      = NULL;
+  queue->error_cnt   = 0;
+  queue->error_alloc = 0;
+}
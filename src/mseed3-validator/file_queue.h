@@ -0,0 +1,59 @@
+#ifndef __MSEED3VALIDATOR_FILE_QUEUE_H__
+#define __MSEED3VALIDATOR_FILE_QUEUE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct file_queue_walk_s;
+
+/* Directory or list that could not be read */
+struct file_queue_error_s
+{
+    char *path;
+    char *message;
+};
+
+/* Names of the files to validate, found as they are asked for, see file_queue_open() */
+struct file_queue_s
+{
+    /* Inputs, enumerated in this order */
+    char **operands;
+    int operand_cnt;
+    char **trees;
+    int tree_cnt;
+    int tree_alloc;
+    char **lists;
+    int list_cnt;
+    int list_alloc;
+
+    /* Files found so far */
+    char **names;
+    size_t name_cnt;
+    int name_alloc;
+
+    /* Directories and lists that could not be read */
+    struct file_queue_error_s *errors;
+    int error_cnt;
+    int error_alloc;
+
+    bool finished;
+    bool stop;
+    struct file_queue_walk_s *walk;
+};
+
+int file_queue_add_tree(struct file_queue_s *queue, const char *path);
+
+int file_queue_add_list(struct file_queue_s *queue, const char *path);
+
+int file_queue_open(struct file_queue_s *queue, char **operands, int operand_cnt);
+
+bool file_queue_wait(struct file_queue_s *queue, size_t index);
+
+char *file_queue_name(struct file_queue_s *queue, size_t index);
+
+void file_queue_close(struct file_queue_s *queue);
+
+void file_queue_free_errors(struct file_queue_s *queue);
+
+#endif /* __MSEED3VALIDATOR_FILE_QUEUE_H__ */
@@ -0,0 +1,380 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "job_pool.h"
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define JOB_POOL_HAVE_FORK 1
+#endif
+
+#define JOB_POOL_COPY_SIZE 65536
+
+/* Number of jobs that may be finished but waiting for earlier output, per worker */
+#define JOB_POOL_WINDOW_FACTOR 4
+
+/* Flushes output buffered outside of stdio, see job_pool_set_flush() */
+static void (*flush_hook) (void) = NULL;
+
+/* Write out everything buffered for stdout and stderr */
+static void
+flush_output (void)
+{
+  if (flush_hook)
+  {
+    flush_hook ();
+  }
+  fflush (stdout);
+  fflush (stderr);
+}
+
+#ifdef JOB_POOL_HAVE_FORK
+/* One in-flight job, output is captured in anonymous temporary files */
+struct job_slot_s
+{
+  pid_t pid;
+  size_t index;
+  bool done;
+  FILE *out;
+  FILE *err;
+};
+
+/* Copy captured output of a finished job to one of our own streams */
+static void
+copy_output (FILE *from, FILE *to)
+{
+  char buffer[JOB_POOL_COPY_SIZE];
+  size_t len;
+
+  fflush (from);
+  rewind (from);
+
+  while ((len = fread (buffer, 1, sizeof (buffer), from)) > 0)
+  {
+    fwrite (buffer, 1, len, to);
+  }
+}
+
+/* Fork a worker for job index with stdout/stderr redirected to the slot files */
+static bool
+start_job (struct job_slot_s *slot, struct job_result_s *result, size_t index,
+           job_run_f run, void *context)
+{
+  memset (result, 0, sizeof (struct job_result_s));
+  slot->index = index;
+  slot->done  = false;
+  slot->out   = tmpfile ();
+  slot->err   = tmpfile ();
+
+  if (slot->out == NULL || slot->err == NULL)
+  {
+    return false;
+  }
+
+  /* Nothing buffered may be inherited, or it would be written twice */
+  flush_output ();
+
+  slot->pid = fork ();
+
+  if (slot->pid < 0)
+  {
+    return false;
+  }
+
+  if (slot->pid == 0)
+  {
+    dup2 (fileno (slot->out), STDOUT_FILENO);
+    dup2 (fileno (slot->err), STDERR_FILENO);
+
+    /* Only the work of this job is handed back to the parent */
+    mseed3_stats_take (NULL);
+    run (context, index, result);
+    mseed3_stats_take (&result->stats);
+
+    flush_output ();
+    _exit (EXIT_SUCCESS);
+  }
+
+  return true;
+}
+#endif
+
+/*! @brief Set a function that writes out output buffered outside of stdio
+ *
+ *  Called before forking a worker, before a worker exits and before the
+ *  captured output of a worker is copied, keeping output in job order.
+ *
+ *  @param[in] flush flush function, or NULL
+ */
+void
+job_pool_set_flush (void (*flush) (void))
+{
+  flush_hook = flush;
+}
+
+/*! @brief Number of workers to use when the user asks for one per processor
+ *
+ */
+int
+job_pool_default_jobs (void)
+{
+#ifdef JOB_POOL_HAVE_FORK
+  long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+
+  if (cpus > 0)
+  {
+    return (int)cpus;
+  }
+#endif
+  return 1;
+}
+
+#ifdef JOB_POOL_HAVE_FORK
+/* Mark the workers that have finished, waiting for one first if block is set.
+ * Returns the number of workers found, -1 if waiting failed */
+static int
+reap_jobs (struct job_slot_s *slots, struct job_result_s *results, size_t window, bool block)
+{
+  int found = 0;
+
+  while (true)
+  {
+    int status;
+    bool blocking = block && found == 0;
+    int stage     = blocking ? mseed3_stats_enter (MSEED3_STAGE_WAIT) : 0;
+    pid_t pid     = waitpid (-1, &status, blocking ? 0 : WNOHANG);
+
+    if (blocking)
+    {
+      mseed3_stats_leave (stage);
+    }
+
+    if (pid < 0 && errno == EINTR)
+    {
+      continue;
+    }
+
+    if (pid <= 0)
+    {
+      return (pid < 0 && blocking) ? -1 : found;
+    }
+
+    for (size_t i = 0; i < window; i++)
+    {
+      if (slots[i].pid == pid && !slots[i].done)
+      {
+        slots[i].done = true;
+
+        if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS)
+        {
+          results[i].status = JOB_ABORTED;
+        }
+        found++;
+        break;
+      }
+    }
+  }
+}
+#endif
+
+/* Run jobs until count is reached or next reports the end, see job_pool_run() */
+static int
+run_pool (int jobs, size_t count, job_next_f next, job_run_f run, job_done_f done, void *context)
+{
+  struct job_result_s result;
+  size_t emitted = 0;
+  size_t first   = 0;
+  bool pending   = false;
+  bool stop      = false;
+
+#ifdef JOB_POOL_HAVE_FORK
+  size_t window                = (size_t)jobs * JOB_POOL_WINDOW_FACTOR;
+  struct job_slot_s *slots     = NULL;
+  struct job_result_s *results = MAP_FAILED;
+
+  if (jobs > 1 && count > 1)
+  {
+    slots   = (struct job_slot_s *)calloc (window, sizeof (struct job_slot_s));
+    results = (struct job_result_s *)mmap (NULL, window * sizeof (struct job_result_s),
+                                           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  }
+
+  if (slots != NULL && results != MAP_FAILED)
+  {
+    size_t next_start = 0;
+    size_t completed  = 0;
+    int running       = 0;
+    int found;
+
+    while (true)
+    {
+      /* Collect finished workers first, so their output is not held up by fetching the next job */
+      if ((found = reap_jobs (slots, results, window, false)) > 0)
+      {
+        running -= found;
+      }
+
+      /* Emit finished jobs in order, output of jobs after a stop is dropped */
+      while (completed < next_start && slots[completed % window].done)
+      {
+        struct job_slot_s *head = &slots[completed % window];
+
+        if (!stop)
+        {
+          int stage = mseed3_stats_enter (MSEED3_STAGE_OUTPUT);
+
+          flush_output ();
+          copy_output (head->out, stdout);
+          fflush (stdout);
+          copy_output (head->err, stderr);
+          emitted++;
+
+          mseed3_stats_leave (stage);
+          mseed3_stats_add (&results[completed % window].stats);
+
+          if (!done (context, head->index, &results[completed % window]))
+          {
+            stop = true;
+          }
+        }
+
+        fclose (head->out);
+        fclose (head->err);
+        completed++;
+      }
+
+      /* Keep every worker busy while the output window allows */
+      if (!stop && !pending && running < jobs && next_start < count && next_start - completed < window)
+      {
+        size_t slot = next_start % window;
+
+        if (next != NULL && !next (context, next_start))
+        {
+          count = next_start;
+          continue;
+        }
+
+        /* Jobs that cannot get a worker run in-process once the running ones are emitted */
+        if (!start_job (&slots[slot], &results[slot], next_start, run, context))
+        {
+          fprintf (stderr, "Error! Cannot start worker, continuing in-process: %s\n", strerror (errno));
+          if (slots[slot].out)
+            fclose (slots[slot].out);
+          if (slots[slot].err)
+            fclose (slots[slot].err);
+          pending = true;
+          continue;
+        }
+
+        running++;
+        next_start++;
+        continue;
+      }
+
+      if (completed == next_start)
+      {
+        break;
+      }
+
+      /* Wait for any worker to finish */
+      if ((found = reap_jobs (slots, results, window, true)) < 0)
+      {
+        fprintf (stderr, "Error! Cannot wait for workers: %s\n", strerror (errno));
+        stop = true;
+        break;
+      }
+      running -= found;
+    }
+
+    first = next_start;
+
+    free (slots);
+    munmap (results, window * sizeof (struct job_result_s));
+
+    if (!pending)
+    {
+      return (int)emitted;
+    }
+  }
+  else
+  {
+    if (slots != NULL)
+    {
+      free (slots);
+    }
+
+    if (results != MAP_FAILED)
+    {
+      munmap (results, window * sizeof (struct job_result_s));
+    }
+  }
+#endif
+
+  /* The job fetched for a worker that could not be started is not fetched again */
+  for (size_t index = first; index < count && !stop; index++)
+  {
+    if (!(pending && index == first) && next != NULL && !next (context, index))
+    {
+      break;
+    }
+
+    memset (&result, 0, sizeof (struct job_result_s));
+    run (context, index, &result);
+    emitted++;
+
+    stop = !done (context, index, &result);
+  }
+
+  return (int)emitted;
+}
+
+/*! @brief Run count jobs on up to jobs concurrent worker processes
+ *
+ *  Each job runs in its own forked worker with stdout and stderr captured.
+ *  Captured output is written and the done callback invoked strictly in job
+ *  order, so the combined output is identical to running the jobs one after
+ *  another.  Falls back to running jobs in-process where fork is unavailable
+ *  or when a single worker is requested.  When a worker cannot be started,
+ *  the jobs still running are emitted and the remaining jobs run in-process.
+ *
+ *  @param[in] jobs maximum number of concurrent workers
+ *  @param[in] count number of jobs
+ *  @param[in] run worker entry point
+ *  @param[in] done completion callback, called in job order
+ *  @param[in] context passed through to the callbacks
+ *
+ *  @return number of jobs completed, fewer than count if done stopped the pool or waiting for a worker failed
+ */
+int
+job_pool_run (int jobs, size_t count, job_run_f run, job_done_f done, void *context)
+{
+  return run_pool (jobs, count, NULL, run, done, context);
+}
+
+/*! @brief Run jobs as they become known, such as files found by another thread
+ *
+ *  Like job_pool_run(), except that the number of jobs is not known up front.
+ *  Before starting job index the pool calls next, which may block until the
+ *  job is known and returns false when the queue has ended.
+ *
+ *  @param[in] jobs maximum number of concurrent workers
+ *  @param[in] next called in job order before each job is started
+ *  @param[in] run worker entry point
+ *  @param[in] done completion callback, called in job order
+ *  @param[in] context passed through to the callbacks
+ *
+ *  @return number of jobs completed
+ */
+int
+job_pool_run_queue (int jobs, job_next_f next, job_run_f run, job_done_f done, void *context)
+{
+  return run_pool (jobs, SIZE_MAX, next, run, done, context);
+}
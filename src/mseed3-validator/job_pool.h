@@ -0,0 +1,51 @@
+#ifndef __MSEED3VALIDATOR_JOB_POOL_H__
+#define __MSEED3VALIDATOR_JOB_POOL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mseed3-common/stats.h>
+
+/* Status reported for a job whose worker terminated abnormally */
+#define JOB_ABORTED -1
+
+/* Result of one job, filled in by the worker and handed back to the parent */
+struct job_result_s
+{
+    int status;
+    uint32_t records;
+    uint32_t failures;
+    bool cached;
+
+    /* Leading records of a split-records range found valid */
+    uint32_t valid_records;
+
+    /* Extra header verdicts the worker reused and validated */
+    uint32_t memo_hits;
+    uint32_t memo_misses;
+
+    /* Stage timing of the worker with --stats */
+    struct mseed3_stats_s stats;
+};
+
+/* Runs one job in a worker, anything written to stdout/stderr is captured */
+typedef void (*job_run_f)(void *context, size_t index, struct job_result_s *result);
+
+/* Called in job order once the captured output of a job has been written,
+ * returning false stops the pool from starting further jobs */
+typedef bool (*job_done_f)(void *context, size_t index, const struct job_result_s *result);
+
+/* Called in the parent before job index is started, blocking until it is known,
+ * returning false once there are no further jobs */
+typedef bool (*job_next_f)(void *context, size_t index);
+
+int job_pool_run(int jobs, size_t count, job_run_f run, job_done_f done, void *context);
+
+int job_pool_run_queue(int jobs, job_next_f next, job_run_f run, job_done_f done, void *context);
+
+int job_pool_default_jobs(void);
+
+void job_pool_set_flush(void (*flush)(void));
+
+#endif /* __MSEED3VALIDATOR_JOB_POOL_H__ */
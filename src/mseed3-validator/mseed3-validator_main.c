@@ -5,11 +5,19 @@
 
 #include <libmseed.h>
 
+#include <mseed3-common/array.h>
 #include <mseed3-common/cmd_opt.h>
+#include <mseed3-common/constants.h>
 #include <mseed3-common/files.h>
 #include <mseed3-common/mseed3_string.h>
+#include <mseed3-common/stats.h>
 
 #include "mseed3-validator_config.h"
+#include "file_queue.h"
+#include "job_pool.h"
+#include "report.h"
+#include "schema_registry.h"
+#include "validation_cache.h"
 #include "warnings.h"
 #include "validator.h"
 
@@ -35,20 +43,80 @@ static const struct mseed3_option_s args[] = {
                       "                         "
                       "error - Halt processing on validation failure\n"
                       "                          "
-                      "skip-payload - Skip payload validation", NULL, MANDATORY_OPTARG},
+                      "skip-payload - Skip payload validation\n"
+                      "                          "
+                      "split-records - Validate the records of each file concurrently on -J workers\n"
+                      "                          "
+                      "resync - Resume at the next intact record after a damaged header or CRC\n"
+                      "                          "
+                      "cap=N - Report at most N warnings and errors of each check per file\n"
+                      "                          "
+                      "json=ENGINE - Extra header JSON engine, yyjson (default) or wjelement",
+     NULL, MANDATORY_OPTARG},
+    {'F', "format", " Report format, text (default) or ndjson", NULL, MANDATORY_OPTARG},
+    {'r', "recursive", "Validate every file below a directory, may be repeated", NULL, MANDATORY_OPTARG},
+    {'L', "files-from", "File listing files to validate separated by NUL bytes, as written by find -print0,\n"
+                        "                       "
+                        "- for stdin, may be repeated",
+     NULL, MANDATORY_OPTARG},
+    {'c', "cache", "  File remembering verdicts, unchanged files are not validated again", NULL, MANDATORY_OPTARG},
+    {'J', "jobs", "   Number of files to validate concurrently, 0 for one per processor", NULL, MANDATORY_OPTARG},
+    {'S', "stats", "  Print time spent per stage to stderr at exit, text (default) or json", NULL, OPTIONAL_OPTARG},
     {'V', "version", "Print program version", NULL, OPTIONAL_OPTARG},
     {0, 0, 0, 0, 0}};
 
+/* Sink every event of the run is written to, shared by the workers */
+static struct report_s output;
+
+/* Outcome of validating a single input file */
+enum file_status_e
+{
+  FILE_SKIPPED = 0,
+  FILE_VALID,
+  FILE_INVALID
+};
+
+/* State shared by all files of one validation run */
+struct validator_run_s
+{
+  struct extra_options_s *extra_options;
+  struct schema_registry_s *schema;
+  struct file_queue_s *queue;
+  struct validation_cache_s *cache;
+  struct validator_context_s *context;
+  char *file_name;
+  uint8_t verbose;
+
+  uint32_t file_cnt;
+  uint32_t cached_cnt;
+  uint64_t record_total;
+  int32_t fail_cnt;
+  int32_t files_cnt;
+  int files_alloc;
+  char **files;
+
+  /* Input files may have been left out */
+  bool incomplete;
+};
+
+static bool next_file (void *context, size_t index);
+static void flush_output (void);
+
+static void record_failure (struct validator_run_s *run, const char *file_name);
+static void report_result (struct validator_run_s *run, char *file_name, bool valid, bool cached);
+static void validate_file (void *context, size_t index, struct job_result_s *result);
+static bool tally_file (void *context, size_t index, const struct job_result_s *result);
+
 /*! @brief Program to Validate miniSEED format files
  *
  */
 int
 main (int argc, char **argv)
 {
-  uint8_t verbose        = 0;
-  char *file_name        = NULL;
-  char *schema_file_name = NULL;
-  int32_t fail_cnt       = 0;
+  uint8_t verbose                  = 0;
+  char *schema_file_name           = NULL;
+  char *cache_file_name            = NULL;
+  struct schema_registry_s *schema = NULL;
 
   /* vars to store command line options/args */
   char *short_opt_string        = NULL;
@@ -58,16 +126,18 @@ main (int argc, char **argv)
   unsigned char display_usage    = 0;
   unsigned char display_revision = 0;
 
-  bool valid;
-  FILE *file        = NULL;
-  uint32_t file_cnt = 0;
-  uint32_t record_cnt;
-  uint64_t record_total = 0;
-
-  char **files = malloc (argc * sizeof (char *));
+  int jobs = 1;
+  struct validator_run_s run[1];
+  enum report_format_e format = REPORT_FORMAT_TEXT;
+  struct file_queue_s queue[1];
+  struct validation_cache_s cache[1];
+  bool stats      = false;
+  bool stats_json = false;
+  int validated;
 
   /* For warning options */
   memset (extra_options, 0, sizeof (struct extra_options_s));
+  memset (queue, 0, sizeof (struct file_queue_s));
 
   /* parse command line args */
   mseed3_get_short_getopt_string (&short_opt_string, args);
@@ -98,6 +168,50 @@ main (int argc, char **argv)
     case 'V':
       display_revision = 1;
       break;
+    case 'J':
+      jobs = atoi (optarg);
+
+      if (jobs <= 0)
+      {
+        jobs = job_pool_default_jobs ();
+      }
+
+      break;
+    case 'F':
+      if (!report_parse_format (optarg, &format))
+      {
+        printf ("Error! Unknown report format: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+
+      break;
+    case 'r':
+      if (file_queue_add_tree (queue, optarg) < 0)
+      {
+        printf ("Error! Cannot allocate file queue\n");
+        return EXIT_FAILURE;
+      }
+
+      break;
+    case 'L':
+      if (file_queue_add_list (queue, optarg) < 0)
+      {
+        printf ("Error! Cannot allocate file queue\n");
+        return EXIT_FAILURE;
+      }
+
+      break;
+    case 'c':
+      cache_file_name = optarg;
+      break;
+    case 'S':
+      if (!mseed3_stats_parse_format (optarg, &stats_json))
+      {
+        printf ("Error! Unknown stats format: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      stats = true;
+      break;
     case 'j':
       schema_file_name = strndup (optarg, MAX_FILE_SIZE);
 
@@ -120,7 +234,7 @@ main (int argc, char **argv)
 
   if (display_usage > 0 || (argc == 1))
   {
-    display_help (argv[0], " [options] infile(s)", "Program to validate miniSEED 3 format files", args);
+    display_help (argv[0], " [options] infile(s) | -r DIR | -L LIST", "Program to validate miniSEED 3 format files", args);
     return display_usage < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
   }
 
@@ -136,80 +250,485 @@ main (int argc, char **argv)
   free (long_opt_array);
   free (short_opt_string);
 
-  while (argc > optind)
+  if (stats)
+  {
+    mseed3_stats_enable ();
+  }
+
+  /* All output from here on goes through the report sink */
+  if (report_open (&output, format, extra_options->cap) < 0)
+  {
+    printf ("Error! Cannot allocate report output buffer\n");
+    return EXIT_FAILURE;
+  }
+  job_pool_set_flush (flush_output);
+
+  /* libmseed logs through the sink too, in order with the events */
+  report_libmseed (&output);
+
+  /* Load the schema and everything it references once for all files */
+  if (schema_file_name)
   {
-    record_cnt = 0;
-    file_name  = argv[optind++];
+    schema = schema_registry_open (schema_file_name, &output, verbose);
 
-    if (!mseed3_file_exists (file_name))
+    if (schema == NULL)
     {
-      printf ("Error! Cannot read file: %s, File Not Found! \n", file_name);
-      continue;
+      report_line (&output, REPORT_SCHEMA, REPORT_FATAL, "Error! Cannot parse JSON schema file: %s", schema_file_name);
+      report_close (&output);
+      return EXIT_FAILURE;
     }
+  }
+
+  memset (run, 0, sizeof (struct validator_run_s));
+  run->extra_options = extra_options;
+  run->schema        = schema;
+  run->queue         = queue;
+  run->verbose       = verbose;
+  run->context       = validator_context_open (extra_options, schema, &output, verbose);
 
-    if (!mseed3_regular_file (file_name))
+  if (run->context == NULL)
+  {
+    report_line (&output, REPORT_RUN, REPORT_FATAL, "Error! Cannot allocate validation context");
+    schema_registry_close (schema);
+    report_close (&output);
+    return EXIT_FAILURE;
+  }
+
+  /* Verdicts of earlier runs, and of an interrupted run from its journal */
+  if (cache_file_name)
+  {
+    if (validation_cache_open (cache, cache_file_name, validation_cache_config_hash (schema, extra_options)) < 0)
     {
-      printf ("Error! %s, is not a regular file...skipping \n", file_name);
-      continue;
+      report_line (&output, REPORT_RUN, REPORT_FATAL, "Error! Cannot open validation cache: %s", cache_file_name);
+      validation_cache_close (cache);
+      report_close (&output);
+      return EXIT_FAILURE;
     }
 
-    /* Open ms file as binary */
-    file = fopen (file_name, "rb");
-
-    if (file == NULL)
+    if (cache->resumed > 0 && verbose > 0)
     {
-      printf ("Error reading file: %s, fopen failure \n", file_name);
-      continue;
+      report_line (&output, REPORT_RUN, REPORT_INFO,
+                   "Resuming an interrupted run, %" PRIu32 " file(s) already validated", cache->resumed);
     }
+    run->cache = cache;
+  }
 
-    /* run verification tests */
-    valid = check_file (extra_options, file, schema_file_name, file_name, &record_cnt, verbose);
-    fclose (file);
-    record_total = record_total + (uint64_t)record_cnt;
-    file_cnt++;
+  /* Directories and file lists are searched as the pool asks for further files */
+  if (file_queue_open (queue, argv + optind, argc - optind) < 0)
+  {
+    report_line (&output, REPORT_RUN, REPORT_FATAL, "Error! Cannot start enumerating input files");
+    report_close (&output);
+    return EXIT_FAILURE;
+  }
+
+  /* Validate files on the worker pool, results are reported in enumeration order.
+   * When splitting records the workers are used within each file instead. */
+  extra_options->jobs = jobs;
+  validated = job_pool_run_queue (extra_options->split_records ? 1 : jobs, next_file, validate_file, tally_file, run);
+
+  /* Files found but never validated, and the rest of an enumeration cut short, fail the run */
+  for (size_t i = (validated < 0) ? 0 : (size_t)validated; i < queue->name_cnt; i++)
+  {
+    char *file_name = file_queue_name (queue, i);
+
+    report_file_begin (&output, file_name);
+    report_line (&output, REPORT_RUN, REPORT_ERROR,
+                 "mseed3-validator RESULT - file %s is **NOT** VALID miniSEED 3, not validated", file_name);
+    report_file_end (&output);
+    record_failure (run, file_name);
+  }
+
+  if (queue->stop || !queue->finished)
+  {
+    report_line (&output, REPORT_RUN, REPORT_ERROR, "Error! Not every input file could be enumerated");
+    run->incomplete = true;
+  }
+
+  file_queue_close (queue);
+
+  /* Unreadable directories and lists count as failed inputs in the summary */
+  for (int i = 0; i < queue->error_cnt; i++)
+  {
+    report_file_begin (&output, queue->errors[i].path);
+    report_line (&output, REPORT_FILE, REPORT_ERROR, "%s", queue->errors[i].message);
+    report_file_end (&output);
+    record_failure (run, queue->errors[i].path);
+  }
+  file_queue_free_errors (queue);
+
+  if (run->cache != NULL && validation_cache_close (cache) < 0)
+  {
+    report_line (&output, REPORT_RUN, REPORT_ERROR, "Error! Cannot write validation cache: %s", cache_file_name);
+  }
+
+  validator_context_close (run->context);
+
+  if (schema_file_name)
+  {
+    schema_registry_close (schema);
+    free (schema_file_name);
+  }
+
+  /* Final program output */
+  if (verbose > 0 && format == REPORT_FORMAT_TEXT)
+  {
+    report_line (&output, REPORT_RUN, REPORT_INFO, "\n----------------------------------------------------------");
+  }
 
-    if (valid)
+  report_line (&output, REPORT_RUN, REPORT_INFO,
+               "mseed3-validator COMPLETE - %" PRId64 " record(s) processed in %d file(s)", run->record_total,
+               run->file_cnt);
+
+  if (cache_file_name && verbose > 0)
+  {
+    report_line (&output, REPORT_RUN, REPORT_INFO,
+                 "mseed3-validator CACHE - %" PRIu32 " unchanged file(s) not validated again", run->cached_cnt);
+  }
+
+  if (run->fail_cnt != 0)
+  {
+    report_line (&output, REPORT_RUN, REPORT_ERROR,
+                 "mseed3-validator FAILED to validate %d file(s) out of the %d file(s) processed", run->fail_cnt,
+                 run->file_cnt);
+
+    if (format == REPORT_FORMAT_TEXT)
     {
-      if (verbose > 0)
+      report_line (&output, REPORT_RUN, REPORT_INFO, "Offending file(s):");
+    }
+
+    for (int i = 0; i < run->files_cnt; i++)
+    {
+      if (format == REPORT_FORMAT_TEXT)
+      {
+        report_line (&output, REPORT_RUN, REPORT_INFO, "%s", run->files[i]);
+      }
+      else
       {
-        printf ("mseed3-validator RESULT - file %s is VALID miniSEED 3\n", file_name);
+        report_file_begin (&output, run->files[i]);
+        report_line (&output, REPORT_RUN, REPORT_INFO, "Offending file: %s", run->files[i]);
+        report_file_end (&output);
       }
+      free (run->files[i]);
     }
-    else
+
+    if (format == REPORT_FORMAT_TEXT)
     {
-      printf ("mseed3-validator RESULT - file %s is **NOT** VALID miniSEED 3\n", file_name);
-      files[fail_cnt] = strndup (file_name, MAX_FILE_SIZE);
-      fail_cnt++;
+      report_line (&output, REPORT_RUN, REPORT_INFO, "");
     }
   }
 
-  if (schema_file_name)
+  free (run->files);
+  report_close (&output);
+  mseed3_stats_print (stderr, "mseed3-validator", stats_json);
+
+  return (run->fail_cnt || run->incomplete) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*! @brief Validate one input file, runs on a worker
+ *
+ *  @param[in] context validation run state
+ *  @param[in] index index of the file in the run
+ *  @param[out] result file status and number of records processed
+ *
+ */
+static void
+validate_file (void *context, size_t index, struct job_result_s *result)
+{
+  struct validator_run_s *run = (struct validator_run_s *)context;
+  char *file_name             = run->file_name;
+  uint32_t record_cnt         = 0;
+  FILE *file                  = NULL;
+  struct mseed3_input_s input;
+  struct cache_entry_s identity;
+  struct check_resume_s resume;
+  struct check_digest_s digest;
+  enum cache_lookup_e lookup = CACHE_MISS;
+  bool cacheable             = false;
+  bool valid;
+  int rv = 0;
+
+  result->status = FILE_SKIPPED;
+  report_file_begin (&output, file_name);
+
+  /* "-" reads records from stdin, validated as they arrive */
+  if (0 == strcmp (file_name, "-"))
   {
-    free (schema_file_name);
+    file = stdin;
+  }
+  else
+  {
+    /* Open ms file as binary, checked through the open descriptor */
+    rv = mseed3_open_file (AT_FDCWD, file_name, &file);
   }
 
-  /* Final program output */
-  if (verbose > 0)
+  if (rv == MSEED3_NOT_FOUND)
+  {
+    report_line (&output, REPORT_FILE, REPORT_ERROR, "Error! Cannot read file: %s, File Not Found! ", file_name);
+    report_file_end (&output);
+    return;
+  }
+  else if (rv == MSEED3_NOT_REGULAR)
   {
-    printf ("\n----------------------------------------------------------\n");
+    report_line (&output, REPORT_FILE, REPORT_ERROR, "Error! %s, is not a regular file...skipping ", file_name);
+    report_file_end (&output);
+    return;
   }
+  else if (file == NULL)
+  {
+    report_line (&output, REPORT_FILE, REPORT_ERROR, "Error reading file: %s, fopen failure ", file_name);
+    report_file_end (&output);
+    return;
+  }
+
+  /* Unchanged files keep the verdict of their last validation */
+  if (run->cache != NULL && file != stdin)
+  {
+    cacheable = (validation_cache_identify (file, file_name, &identity) == 0);
+
+    if (cacheable)
+    {
+      lookup = validation_cache_lookup (run->cache, file, &identity);
+    }
 
-  printf ("mseed3-validator COMPLETE - %" PRId64 " record(s) processed in %d file(s)\n", record_total, file_cnt);
+    if (lookup == CACHE_UNCHANGED)
+    {
+      fclose (file);
+      validation_cache_record (run->cache, &identity);
+      report_result (run, file_name, identity.valid, true);
+
+      result->status  = identity.valid ? FILE_VALID : FILE_INVALID;
+      result->records = identity.records;
+      result->cached  = true;
+      return;
+    }
+  }
 
-  if (fail_cnt != 0)
+  /* Compressed files are decompressed on a worker thread while the records are validated */
+  if (mseed3_input_open (file, &input) < 0)
   {
-    printf ("mseed3-validator FAILED to validate %d file(s) out of the %d file(s) processed\n", fail_cnt, file_cnt);
+    report_line (&output, REPORT_FILE, REPORT_ERROR, "Error reading file: %s, cannot read %s compressed input ",
+                 file_name, mseed3_compression_name (input.compression));
+    mseed3_input_close (&input);
+    if (file != stdin)
+    {
+      fclose (file);
+    }
+    report_file_end (&output);
+    return;
+  }
 
-    printf ("Offending file(s):\n");
+  if (input.compression != MSEED3_COMPRESSION_NONE && run->verbose > 1)
+  {
+    report_line (&output, REPORT_FILE, REPORT_INFO, "File %s is %s compressed, decompressing while validating",
+                 file_name, mseed3_compression_name (input.compression));
+  }
+
+  /* Only the records after the valid ones of the last validation are checked, compressed files always whole */
+  memset (&resume, 0, sizeof (struct check_resume_s));
 
-    for (int i = 0; i < fail_cnt; i++)
+  if (lookup == CACHE_APPENDED && input.compression == MSEED3_COMPRESSION_NONE)
+  {
+    resume.offset  = identity.valid_length;
+    resume.records = identity.valid_records;
+    resume.hash    = identity.valid_state;
+
+    if (run->verbose > 0)
     {
-      printf ("%s\n", files[i]);
-      free (files[i]);
+      report_line (&output, REPORT_FILE, REPORT_INFO,
+                   "File %s changed after its last valid record, checking the records that follow", file_name);
     }
-    printf ("\n");
+  }
+
+  /* run verification tests */
+  valid = check_file (run->context, input.file, file_name, &record_cnt, &resume, cacheable ? &digest : NULL);
 
+  if (mseed3_input_close (&input) < 0)
+  {
+    report_line (&output, REPORT_FILE, REPORT_ERROR, "Error! file %s, corrupt %s compressed data", file_name,
+                 mseed3_compression_name (input.compression));
+    valid = false;
   }
 
-  return fail_cnt ? EXIT_FAILURE : EXIT_SUCCESS;
+  /* Compressed files are hashed as stored, once decompressed and validated */
+  if (cacheable && !digest.hashed)
+  {
+    struct mseed3_hash64_s state;
+
+    mseed3_hash64_reset (&state, 0);
+    rewind (file);
+
+    cacheable            = (mseed3_hash64_file (file, identity.size, &state) == 0);
+    digest.length        = identity.size;
+    digest.content_hash  = mseed3_hash64_digest (&state);
+    digest.valid_length  = 0;
+    digest.valid_records = 0;
+    digest.valid_hash    = 0;
+  }
+
+  if (file != stdin)
+  {
+    fclose (file);
+  }
+
+  if (cacheable)
+  {
+    identity.size          = digest.length;
+    identity.content_hash  = digest.content_hash;
+    identity.valid_length  = digest.valid_length;
+    identity.valid_records = digest.valid_records;
+    identity.valid_hash    = digest.valid_hash;
+    identity.valid         = valid;
+    identity.records       = record_cnt;
+    validation_cache_record (run->cache, &identity);
+  }
+
+  /* Note suppressed messages before the result, which is never capped */
+  report_file_end (&output);
+  report_file_begin (&output, file_name);
+  report_result (run, file_name, valid, false);
+
+  result->status  = valid ? FILE_VALID : FILE_INVALID;
+  result->records = record_cnt;
+}
+
+/*! @brief Report the verdict on a file and stop reporting on it
+ *
+ *  @param[in] run validation run state
+ *  @param[in] file_name file name
+ *  @param[in] valid verdict
+ *  @param[in] cached true if the verdict is that of an earlier run
+ *
+ */
+static void
+report_result (struct validator_run_s *run, char *file_name, bool valid, bool cached)
+{
+  const char *origin = cached ? ", unchanged since its last validation" : "";
+
+  if (valid)
+  {
+    if (run->verbose > 0)
+    {
+      report_line (&output, REPORT_RUN, REPORT_INFO, "mseed3-validator RESULT - file %s is VALID miniSEED 3%s",
+                   file_name, origin);
+    }
+  }
+  else
+  {
+    report_line (&output, REPORT_RUN, REPORT_ERROR, "mseed3-validator RESULT - file %s is **NOT** VALID miniSEED 3%s",
+                 file_name, origin);
+  }
+
+  report_file_end (&output);
+}
+
+/*! @brief Add the result of one file to the run summary, called in file order
+ *
+ *  @param[in] context validation run state
+ *  @param[in] index index of the file in the run
+ *  @param[in] result result reported by validate_file()
+ *
+ */
+static bool
+tally_file (void *context, size_t index, const struct job_result_s *result)
+{
+  struct validator_run_s *run = (struct validator_run_s *)context;
+  char *file_name             = file_queue_name (run->queue, index);
+
+  if (result->status == FILE_SKIPPED)
+  {
+    return true;
+  }
+
+  if (result->status == JOB_ABORTED)
+  {
+    report_file_begin (&output, file_name);
+    report_line (&output, REPORT_RUN, REPORT_ERROR,
+                 "mseed3-validator RESULT - file %s is **NOT** VALID miniSEED 3, validation terminated abnormally",
+                 file_name);
+    report_file_end (&output);
+  }
+  else
+  {
+    run->record_total = run->record_total + (uint64_t)result->records;
+  }
+
+  if (result->cached)
+  {
+    run->cached_cnt++;
+  }
+
+  if (result->status != FILE_VALID)
+  {
+    record_failure (run, file_name);
+  }
+  else
+  {
+    run->file_cnt++;
+  }
+
+  return true;
+}
+
+/*! @brief Count a file that failed validation, listed in the summary
+ *
+ *  The failure is always counted so the run exits with an error, only the
+ *  listing of its name is dropped when out of memory.
+ */
+static void
+record_failure (struct validator_run_s *run, const char *file_name)
+{
+  char *name;
+
+  run->file_cnt++;
+  run->fail_cnt++;
+
+  if (run->files_cnt >= run->files_alloc)
+  {
+    /* Grow a copy, expand_array() loses the pointer on failure and the names listed so far are kept */
+    char **files = run->files;
+    int len      = expand_array ((void **)&files, run->files_alloc, sizeof (char *));
+
+    if (len < 0)
+    {
+      return;
+    }
+    run->files       = files;
+    run->files_alloc = len;
+  }
+
+  name = strndup (file_name, MAX_FILE_SIZE);
+
+  if (name != NULL)
+  {
+    run->files[run->files_cnt++] = name;
+  }
+}
+
+/*! @brief Fetch the name of the next file to validate, called before it is started
+ *
+ *  @param[in] context validation run state
+ *  @param[in] index index of the file in the run
+ *
+ *  @return false once every file has been validated
+ */
+static bool
+next_file (void *context, size_t index)
+{
+  struct validator_run_s *run = (struct validator_run_s *)context;
+
+  if (!file_queue_wait (run->queue, index))
+  {
+    return false;
+  }
+
+  run->file_name = file_queue_name (run->queue, index);
+
+  return true;
+}
+
+/* Write out buffered events before the job pool forks */
+static void
+flush_output (void)
+{
+  report_flush (&output);
 }
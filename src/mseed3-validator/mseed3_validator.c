@@ -0,0 +1,258 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mseed3-common/array.h>
+
+#include "mseed3_validator.h"
+#include "report.h"
+#include "schema_registry.h"
+#include "validator.h"
+#include "warnings.h"
+
+/* The public check and severity values are those of the report sink */
+typedef char check_values_match[(MSEED3_CHECK_CNT == (int)REPORT_CHECK_CNT) ? 1 : -1];
+typedef char severity_values_match[(MSEED3_SEVERITY_FATAL == (int)REPORT_FATAL) ? 1 : -1];
+
+/* Options, schema and validation context of one embedding caller */
+struct mseed3_validator_s
+{
+  struct extra_options_s options;
+  struct schema_registry_s *schema;
+  struct report_s sink;
+  struct validator_context_s *context;
+
+  /* Report filled by the running mseed3_validate_buffer(), NULL between calls */
+  struct mseed3_validation_report_s *report;
+  uint32_t record_events;
+  bool out_of_memory;
+};
+
+static void collect_event (void *client, enum report_check_e check, enum report_severity_e severity,
+                           const char *message);
+static void tally_record (void *client, uint32_t recordNum, uint64_t offset, uint64_t length, bool valid);
+static void reset_report (struct mseed3_validation_report_s *report);
+
+/*! @brief Create a validator, loading the extra header schema if one is given
+ *
+ *  @param[out] validator validator, to be released with mseed3_validator_close()
+ *  @param[in] options validation options, copied
+ *
+ *  @return MSEED3_VALIDATOR_OK, MSEED3_VALIDATOR_MALLOC_ERROR or MSEED3_VALIDATOR_SCHEMA_ERROR
+ */
+int
+mseed3_validator_open (struct mseed3_validator_s **validator, const struct mseed3_validator_options_s *options)
+{
+  struct mseed3_validator_s *opened;
+
+  *validator = NULL;
+  opened     = (struct mseed3_validator_s *)calloc (1, sizeof (struct mseed3_validator_s));
+
+  if (opened == NULL)
+  {
+    return MSEED3_VALIDATOR_MALLOC_ERROR;
+  }
+
+  /* Records of a buffer are checked in order, there is no worker pool to split them over */
+  opened->options.treat_as_errors = options->treat_as_errors;
+  opened->options.skip_payload    = options->skip_payload;
+  opened->options.resync          = options->resync;
+  opened->options.cap             = options->cap;
+  opened->options.wjelement       = options->wjelement;
+  opened->options.split_records   = false;
+  opened->options.jobs            = 1;
+
+  /* Events outside of mseed3_validate_buffer(), such as schema loading, are dropped */
+  report_collect (&opened->sink, options->cap, collect_event, opened);
+
+  if (options->schema_file_name != NULL)
+  {
+    opened->schema = schema_registry_open (options->schema_file_name, &opened->sink, options->verbose);
+
+    if (opened->schema == NULL)
+    {
+      free (opened);
+      return MSEED3_VALIDATOR_SCHEMA_ERROR;
+    }
+  }
+
+  opened->context = validator_context_open (&opened->options, opened->schema, &opened->sink, options->verbose);
+
+  if (opened->context == NULL)
+  {
+    schema_registry_close (opened->schema);
+    free (opened);
+    return MSEED3_VALIDATOR_MALLOC_ERROR;
+  }
+
+  /* libmseed logs to stdout and stderr, its findings are reported by the checks already */
+  opened->context->libmseed_verbose = 0;
+  report_libmseed (NULL);
+
+  *validator = opened;
+
+  return MSEED3_VALIDATOR_OK;
+}
+
+/*! @brief Release a validator returned by mseed3_validator_open()
+ *
+ *  @param[in] validator validator, or NULL
+ *
+ */
+void
+mseed3_validator_close (struct mseed3_validator_s *validator)
+{
+  if (validator == NULL)
+  {
+    return;
+  }
+
+  validator_context_close (validator->context);
+  schema_registry_close (validator->schema);
+  free (validator);
+}
+
+/*! @brief Validate the miniSEED 3 records held in a buffer
+ *
+ *  The buffer is checked like a file given to mseed3-validator, from its
+ *  first byte to its end.  The results of an earlier call with the same
+ *  report are replaced, reusing their memory.
+ *
+ *  @param[in] validator validator returned by mseed3_validator_open()
+ *  @param[in] data first byte of the first record
+ *  @param[in] length number of bytes in the buffer
+ *  @param[in,out] report results, zeroed before the first call
+ *
+ *  @return MSEED3_VALIDATOR_OK, or MSEED3_VALIDATOR_MALLOC_ERROR if the results are incomplete
+ */
+int
+mseed3_validate_buffer (struct mseed3_validator_s *validator, const void *data, uint64_t length,
+                        struct mseed3_validation_report_s *report)
+{
+  uint32_t records;
+  bool valid;
+
+  reset_report (report);
+  validator->report        = report;
+  validator->record_events = 0;
+  validator->out_of_memory = false;
+
+  report_file_begin (&validator->sink, NULL);
+  valid = check_buffer (validator->context, (const char *)data, length, &records, tally_record, validator);
+  report_file_end (&validator->sink);
+
+  validator->report = NULL;
+  report->valid     = valid;
+
+  return validator->out_of_memory ? MSEED3_VALIDATOR_MALLOC_ERROR : MSEED3_VALIDATOR_OK;
+}
+
+/*! @brief Release the memory of results filled by mseed3_validate_buffer()
+ *
+ *  @param[in] report results, zeroed and ready for reuse on return
+ *
+ */
+void
+mseed3_validation_report_free (struct mseed3_validation_report_s *report)
+{
+  reset_report (report);
+  free (report->records);
+  free (report->events);
+  memset (report, 0, sizeof (struct mseed3_validation_report_s));
+}
+
+/* Forget the results of an earlier call, keeping the arrays for reuse */
+static void
+reset_report (struct mseed3_validation_report_s *report)
+{
+  for (uint32_t i = 0; i < report->event_cnt; i++)
+  {
+    free ((char *)report->events[i].message);
+  }
+
+  report->valid      = false;
+  report->record_cnt = 0;
+  report->event_cnt  = 0;
+}
+
+/* Event function of the sink, the record being checked is the next one tallied */
+static void
+collect_event (void *client, enum report_check_e check, enum report_severity_e severity, const char *message)
+{
+  struct mseed3_validator_s *validator      = (struct mseed3_validator_s *)client;
+  struct mseed3_validation_report_s *report = validator->report;
+  struct mseed3_validation_event_s *event;
+
+  if (report == NULL)
+  {
+    return;
+  }
+
+  /* Grow a copy of the pointer, the events kept so far and their messages stay in the report when it cannot grow */
+  if (report->event_alloc <= (int)report->event_cnt)
+  {
+    struct mseed3_validation_event_s *events = report->events;
+    int len = expand_array ((void **)&events, report->event_alloc, sizeof (struct mseed3_validation_event_s));
+
+    if (len < 0)
+    {
+      validator->out_of_memory = true;
+      return;
+    }
+    report->events      = events;
+    report->event_alloc = len;
+  }
+
+  event           = &report->events[report->event_cnt];
+  event->record   = validator->sink.in_record ? report->record_cnt : MSEED3_NO_RECORD_INDEX;
+  event->check    = (enum mseed3_validation_check_e)check;
+  event->severity = (enum mseed3_validation_severity_e)severity;
+  event->message  = strdup (message);
+
+  if (event->message == NULL)
+  {
+    validator->out_of_memory = true;
+    return;
+  }
+
+  report->event_cnt++;
+}
+
+/* Tally function of check_buffer(), taking the events since the previous record */
+static void
+tally_record (void *client, uint32_t recordNum, uint64_t offset, uint64_t length, bool valid)
+{
+  struct mseed3_validator_s *validator      = (struct mseed3_validator_s *)client;
+  struct mseed3_validation_report_s *report = validator->report;
+  struct mseed3_record_result_s *result;
+
+  if (report->record_alloc <= (int)report->record_cnt)
+  {
+    struct mseed3_record_result_s *records = report->records;
+    int len = expand_array ((void **)&records, report->record_alloc, sizeof (struct mseed3_record_result_s));
+
+    /* Drop the events of the record that cannot be kept, they would be attributed to the next one */
+    if (len < 0)
+    {
+      while (report->event_cnt > validator->record_events)
+      {
+        free ((char *)report->events[--report->event_cnt].message);
+      }
+      validator->out_of_memory = true;
+      return;
+    }
+    report->records      = records;
+    report->record_alloc = len;
+  }
+
+  result              = &report->records[report->record_cnt];
+  result->offset      = offset;
+  result->length      = length;
+  result->valid       = valid;
+  result->first_event = validator->record_events;
+  result->event_cnt   = report->event_cnt - validator->record_events;
+
+  validator->record_events = report->event_cnt;
+  report->record_cnt++;
+}
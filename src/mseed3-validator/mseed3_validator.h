@@ -0,0 +1,131 @@
+#ifndef __MSEED3VALIDATOR_MSEED3_VALIDATOR_H__
+#define __MSEED3VALIDATOR_MSEED3_VALIDATOR_H__
+
+/* Validation of miniSEED 3 records held in memory, built as libmseed3-validate.
+ * Nothing is printed, findings are returned as structured results.
+ *
+ *   struct mseed3_validator_s *validator;
+ *   struct mseed3_validation_report_s report = {0};
+ *
+ *   mseed3_validator_open (&validator, &options);
+ *   mseed3_validate_buffer (validator, data, length, &report);
+ *   ... report.valid, report.records[i], report.events[i] ...
+ *   mseed3_validation_report_free (&report);
+ *   mseed3_validator_close (validator);
+ *
+ * A validator may be used by one thread at a time, threads validating
+ * concurrently each open their own.  Opening a validator silences the
+ * logging of the libmseed it is linked with, which is private to the
+ * shared library. */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The library is built with hidden symbols, only the functions below are exported */
+#if defined(__GNUC__) && !defined(_WIN32)
+#define MSEED3_VALIDATOR_EXPORT __attribute__ ((visibility ("default")))
+#else
+#define MSEED3_VALIDATOR_EXPORT
+#endif
+
+/* Error codes, the values match those of the mseed3-utils tools */
+enum mseed3_validator_status_e
+{
+    MSEED3_VALIDATOR_OK = 0,
+    MSEED3_VALIDATOR_MALLOC_ERROR = -3,
+    MSEED3_VALIDATOR_SCHEMA_ERROR = -9
+};
+
+/* Check that produced an event */
+enum mseed3_validation_check_e
+{
+    MSEED3_CHECK_RUN = 0,
+    MSEED3_CHECK_FILE,
+    MSEED3_CHECK_HEADER,
+    MSEED3_CHECK_IDENTIFIER,
+    MSEED3_CHECK_EXTRA_HEADER,
+    MSEED3_CHECK_SCHEMA,
+    MSEED3_CHECK_CRC,
+    MSEED3_CHECK_PAYLOAD,
+    MSEED3_CHECK_CNT
+};
+
+enum mseed3_validation_severity_e
+{
+    MSEED3_SEVERITY_INFO = 0,
+    MSEED3_SEVERITY_WARNING,
+    MSEED3_SEVERITY_ERROR,
+    MSEED3_SEVERITY_FATAL
+};
+
+/* Options of a validator, the -j and -W options of mseed3-validator.
+ * Zeroed options validate everything without a schema and report errors only */
+struct mseed3_validator_options_s
+{
+    const char *schema_file_name; /* JSON schema for extra headers, or NULL */
+    bool treat_as_errors;         /* stop at the first invalid record */
+    bool skip_payload;            /* do not decode payloads */
+    bool resync;                  /* continue at the next intact record after a damaged one */
+    uint32_t cap;                 /* warnings and errors kept per check and buffer, 0 for no limit */
+    bool wjelement;               /* validate extra headers with WJElement instead of yyjson */
+    uint8_t verbose;              /* informational events kept, as -v of mseed3-validator */
+};
+
+/* Something found about the buffer or one of its records */
+struct mseed3_validation_event_s
+{
+    uint32_t record; /* index in records, MSEED3_NO_RECORD_INDEX for the buffer as a whole */
+    enum mseed3_validation_check_e check;
+    enum mseed3_validation_severity_e severity;
+    const char *message;
+};
+
+#define MSEED3_NO_RECORD_INDEX UINT32_MAX
+
+/* Verdict of one record, its events are events[first_event] to
+ * events[first_event + event_cnt - 1] */
+struct mseed3_record_result_s
+{
+    uint64_t offset;
+    uint64_t length; /* bytes covered, including damaged bytes skipped with resync */
+    bool valid;
+    uint32_t first_event;
+    uint32_t event_cnt;
+};
+
+/* Results of mseed3_validate_buffer(), the memory is reused by the next call
+ * with the same report and released by mseed3_validation_report_free() */
+struct mseed3_validation_report_s
+{
+    bool valid;
+    uint32_t record_cnt;
+    struct mseed3_record_result_s *records;
+    uint32_t event_cnt;
+    struct mseed3_validation_event_s *events;
+
+    /* Private to the library */
+    int record_alloc;
+    int event_alloc;
+};
+
+struct mseed3_validator_s;
+
+MSEED3_VALIDATOR_EXPORT int mseed3_validator_open(struct mseed3_validator_s **validator,
+                                                  const struct mseed3_validator_options_s *options);
+
+MSEED3_VALIDATOR_EXPORT void mseed3_validator_close(struct mseed3_validator_s *validator);
+
+MSEED3_VALIDATOR_EXPORT int mseed3_validate_buffer(struct mseed3_validator_s *validator, const void *data,
+                                                   uint64_t length, struct mseed3_validation_report_s *report);
+
+MSEED3_VALIDATOR_EXPORT void mseed3_validation_report_free(struct mseed3_validation_report_s *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MSEED3VALIDATOR_MSEED3_VALIDATOR_H__ */
@@ -41,6 +41,41 @@ parse_extra_options (struct extra_options_s *extra_options, char *string_parse)
     {
       extra_options->skip_payload = true;
     }
+    else if (0 == strncmp ("split-records", flag, strlen ("split-records")))
+    {
+      extra_options->split_records = true;
+    }
+    else if (0 == strncmp ("resync", flag, strlen ("resync")))
+    {
+      extra_options->resync = true;
+    }
+    else if (0 == strncmp ("cap", flag, strlen ("cap")))
+    {
+      char *value = strtok (NULL, "=");
+      char *end   = NULL;
+
+      if (value == NULL || (extra_options->cap = (uint32_t)strtoul (value, &end, 10), *end != '\0'))
+      {
+        bad_option = true;
+      }
+    }
+    else if (0 == strncmp ("json", flag, strlen ("json")))
+    {
+      char *value = strtok (NULL, "=");
+
+      if (value != NULL && 0 == strcmp (value, "yyjson"))
+      {
+        extra_options->wjelement = false;
+      }
+      else if (value != NULL && 0 == strcmp (value, "wjelement"))
+      {
+        extra_options->wjelement = true;
+      }
+      else
+      {
+        bad_option = true;
+      }
+    }
     else
     {
       bad_option = true;
@@ -0,0 +1,509 @@
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#include <mseed3-common/stats.h>
+
+#include "report.h"
+
+#if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
+#define REPORT_STDOUT_FD 1
+#else
+#include <unistd.h>
+#define REPORT_STDOUT_FD STDOUT_FILENO
+#endif
+
+/* Messages up to this length are formatted on the stack before JSON escaping */
+#define REPORT_MESSAGE_LEN 1024
+
+static const char *check_names[REPORT_CHECK_CNT] = {
+    "run", "file", "header", "identifier", "extra-header", "schema", "crc", "payload"};
+
+static const char *severity_names[] = {"info", "warning", "error", "fatal"};
+
+/* Text prefixes of record events, matching the historical printf output */
+static const char *severity_prefixes[] = {"", "Warning! ", "Error! ", "Fatal Error! "};
+
+/* Sink libmseed logs to, see report_libmseed(), libmseed logging is global to the process */
+static struct report_s *libmseed_sink = NULL;
+static bool libmseed_silent           = false;
+
+/*! @brief Start writing events to stdout
+ *
+ *  A sink that was only zeroed and never opened prints with stdio instead.
+ *
+ *  @param[out] report sink to open
+ *  @param[in] format text or NDJSON
+ *  @param[in] cap maximum number of warnings and errors of each check per file, 0 for no limit
+ *
+ *  @return 0 on success, negative error code if the output buffer cannot be allocated
+ */
+int
+report_open (struct report_s *report, enum report_format_e format, uint32_t cap)
+{
+  int rv;
+
+  memset (report, 0, sizeof (struct report_s));
+  report->format = format;
+  report->cap    = cap;
+
+  fflush (stdout);
+  rv = mseed3_writer_open (&report->writer, REPORT_STDOUT_FD);
+  report->open = (rv == 0);
+
+  return rv;
+}
+
+/*! @brief Hand events to a function instead of writing them out
+ *
+ *  Nothing is written to stdout by a collecting sink, it needs no
+ *  report_close().
+ *
+ *  @param[out] report sink to open
+ *  @param[in] cap maximum number of warnings and errors of each check per file, 0 for no limit
+ *  @param[in] event_func function called with every event admitted by the cap
+ *  @param[in] client passed to event_func
+ *
+ */
+void
+report_collect (struct report_s *report, uint32_t cap, report_event_f event_func, void *client)
+{
+  memset (report, 0, sizeof (struct report_s));
+  report->cap          = cap;
+  report->event_func   = event_func;
+  report->event_client = client;
+}
+
+/*! @brief Flush and stop the report sink
+ *
+ *  @param[in] report sink opened by report_open()
+ *
+ */
+void
+report_close (struct report_s *report)
+{
+  if (report->open)
+  {
+    mseed3_writer_close (&report->writer);
+    report->open = false;
+  }
+}
+
+/*! @brief Write out buffered events, required before forking or using stdio on stdout
+ *
+ *  @param[in] report sink opened by report_open()
+ *
+ */
+void
+report_flush (struct report_s *report)
+{
+  if (report->open)
+  {
+    int stage = mseed3_stats_enter (MSEED3_STAGE_OUTPUT);
+
+    mseed3_writer_flush (&report->writer);
+    mseed3_stats_leave (stage);
+  }
+}
+
+/*! @brief Map a -F argument to a report format
+ *
+ */
+bool
+report_parse_format (const char *name, enum report_format_e *format)
+{
+  if (0 == strcmp (name, "text"))
+  {
+    *format = REPORT_FORMAT_TEXT;
+    return true;
+  }
+  if (0 == strcmp (name, "ndjson") || 0 == strcmp (name, "json"))
+  {
+    *format = REPORT_FORMAT_NDJSON;
+    return true;
+  }
+
+  return false;
+}
+
+/* Append a string as a JSON string literal */
+static void
+write_json_string (struct report_s *report, const char *text)
+{
+  static const char hex[] = "0123456789abcdef";
+  const char *run         = text;
+
+  mseed3_writer_write (&report->writer, "\"", 1);
+
+  for (; *text; text++)
+  {
+    unsigned char c = (unsigned char)*text;
+    char escape[6];
+
+    if (c >= 0x20 && c != '"' && c != '\\')
+    {
+      continue;
+    }
+
+    mseed3_writer_write (&report->writer, run, (size_t)(text - run));
+    run = text + 1;
+
+    switch (c)
+    {
+    case '"':
+      mseed3_writer_write (&report->writer, "\\\"", 2);
+      break;
+    case '\\':
+      mseed3_writer_write (&report->writer, "\\\\", 2);
+      break;
+    case '\n':
+      mseed3_writer_write (&report->writer, "\\n", 2);
+      break;
+    case '\t':
+      mseed3_writer_write (&report->writer, "\\t", 2);
+      break;
+    default:
+      memcpy (escape, "\\u00", 4);
+      escape[4] = hex[c >> 4];
+      escape[5] = hex[c & 0xF];
+      mseed3_writer_write (&report->writer, escape, 6);
+      break;
+    }
+  }
+
+  mseed3_writer_write (&report->writer, run, (size_t)(text - run));
+  mseed3_writer_write (&report->writer, "\"", 1);
+}
+
+/* Count an event against its check, false once the cap for this file is exceeded.
+ * Verdicts and the summary of the run are never capped */
+static bool
+admit (struct report_s *report, enum report_check_e check, enum report_severity_e severity)
+{
+  if (severity == REPORT_INFO || check == REPORT_RUN)
+  {
+    return true;
+  }
+
+  report->counts[check]++;
+
+  if (report->cap > 0 && report->counts[check] > report->cap)
+  {
+    report->suppressed[check]++;
+    return false;
+  }
+
+  return true;
+}
+
+/* Format an event message into stack_message, or into allocated memory if
+ * it does not fit, without trailing line breaks */
+static char *
+format_message (char *stack_message, const char *format, va_list ap)
+{
+  char *message = stack_message;
+  va_list retry;
+  int len;
+
+  va_copy (retry, ap);
+  len = vsnprintf (stack_message, REPORT_MESSAGE_LEN, format, ap);
+
+  if (len >= REPORT_MESSAGE_LEN && (message = (char *)malloc ((size_t)len + 1)) != NULL)
+  {
+    vsnprintf (message, (size_t)len + 1, format, retry);
+  }
+  va_end (retry);
+
+  if (message == NULL)
+  {
+    message = stack_message;
+  }
+
+  /* Messages keep their own line breaks in text, events do not */
+  len = (int)strlen (message);
+  while (len > 0 && message[len - 1] == '\n')
+  {
+    message[--len] = '\0';
+  }
+
+  return message;
+}
+
+/* Hand one event to the function of a collecting sink */
+static void
+collect_event (struct report_s *report, enum report_check_e check, enum report_severity_e severity,
+               const char *format, va_list ap)
+{
+  char stack_message[REPORT_MESSAGE_LEN];
+  char *message = format_message (stack_message, format, ap);
+
+  report->event_func (report->event_client, check, severity, message);
+
+  if (message != stack_message)
+  {
+    free (message);
+  }
+}
+
+/* Write one event as an NDJSON object */
+static void
+write_ndjson (struct report_s *report, enum report_check_e check, enum report_severity_e severity, const char *format,
+              va_list ap)
+{
+  char stack_message[REPORT_MESSAGE_LEN];
+  char *message = format_message (stack_message, format, ap);
+
+  mseed3_writer_write (&report->writer, "{", 1);
+
+  if (report->file_name)
+  {
+    mseed3_writer_write (&report->writer, "\"file\":", 7);
+    write_json_string (report, report->file_name);
+    mseed3_writer_write (&report->writer, ",", 1);
+  }
+
+  if (report->in_record)
+  {
+    mseed3_writer_printf (&report->writer, "\"record\":%" PRIu32 ",\"offset\":%" PRIu64 ",",
+                          report->record, report->offset);
+  }
+
+  mseed3_writer_printf (&report->writer, "\"check\":\"%s\",\"severity\":\"%s\",\"message\":",
+                        check_names[check], severity_names[severity]);
+  write_json_string (report, message);
+  mseed3_writer_write (&report->writer, "}\n", 2);
+
+  if (message != stack_message)
+  {
+    free (message);
+  }
+}
+
+/*! @brief Report an event about the current record
+ *
+ *  In text format the line reads "Error! Record: N --- message", with the
+ *  prefix chosen by severity.
+ *
+ *  @param[in] report sink the event is written to
+ *  @param[in] check check that produced the event
+ *  @param[in] severity event severity
+ *  @param[in] format printf style message, without the record prefix or newline
+ *
+ */
+void
+report_event (struct report_s *report, enum report_check_e check, enum report_severity_e severity, const char *format,
+              ...)
+{
+  va_list ap;
+  int stage;
+
+  if (!admit (report, check, severity))
+  {
+    return;
+  }
+
+  stage = mseed3_stats_enter (MSEED3_STAGE_OUTPUT);
+  va_start (ap, format);
+
+  if (report->event_func != NULL)
+  {
+    collect_event (report, check, severity, format, ap);
+  }
+  else if (!report->open)
+  {
+    printf ("%sRecord: %" PRIu32 " --- ", severity_prefixes[severity], report->record);
+    vprintf (format, ap);
+    printf ("\n");
+  }
+  else if (report->format == REPORT_FORMAT_NDJSON)
+  {
+    write_ndjson (report, check, severity, format, ap);
+  }
+  else
+  {
+    if (report->in_record)
+    {
+      mseed3_writer_printf (&report->writer, "%sRecord: %" PRIu32 " --- ", severity_prefixes[severity],
+                            report->record);
+    }
+    else
+    {
+      mseed3_writer_printf (&report->writer, "%s", severity_prefixes[severity]);
+    }
+    mseed3_writer_vprintf (&report->writer, format, ap);
+    mseed3_writer_write (&report->writer, "\n", 1);
+  }
+
+  va_end (ap);
+  mseed3_stats_leave (stage);
+}
+
+/*! @brief Report an event written verbatim in text format
+ *
+ *  Used for progress and summary lines that have no record prefix, NDJSON
+ *  events still carry the current file and record.
+ *
+ *  @param[in] report sink the event is written to
+ *  @param[in] check check that produced the event
+ *  @param[in] severity event severity
+ *  @param[in] format printf style message, without the newline
+ *
+ */
+void
+report_line (struct report_s *report, enum report_check_e check, enum report_severity_e severity, const char *format,
+             ...)
+{
+  va_list ap;
+  int stage;
+
+  if (!admit (report, check, severity))
+  {
+    return;
+  }
+
+  stage = mseed3_stats_enter (MSEED3_STAGE_OUTPUT);
+  va_start (ap, format);
+
+  if (report->event_func != NULL)
+  {
+    collect_event (report, check, severity, format, ap);
+  }
+  else if (!report->open)
+  {
+    vprintf (format, ap);
+    printf ("\n");
+  }
+  else if (report->format == REPORT_FORMAT_NDJSON)
+  {
+    write_ndjson (report, check, severity, format, ap);
+  }
+  else
+  {
+    mseed3_writer_vprintf (&report->writer, format, ap);
+    mseed3_writer_write (&report->writer, "\n", 1);
+  }
+
+  va_end (ap);
+  mseed3_stats_leave (stage);
+}
+
+/*! @brief Start reporting on a file, resets the per-file counters
+ *
+ *  @param[in] report sink
+ *  @param[in] file_name file name, must stay valid until report_file_end()
+ *
+ */
+void
+report_file_begin (struct report_s *report, const char *file_name)
+{
+  report->file_name = file_name;
+  report->in_record = false;
+  memset (report->counts, 0, sizeof (report->counts));
+  memset (report->suppressed, 0, sizeof (report->suppressed));
+}
+
+/*! @brief Finish reporting on a file, noting events dropped by the cap
+ *
+ *  @param[in] report sink
+ *
+ */
+void
+report_file_end (struct report_s *report)
+{
+  report->in_record = false;
+
+  for (int check = 0; check < REPORT_CHECK_CNT; check++)
+  {
+    if (report->suppressed[check] > 0)
+    {
+      report_line (report, (enum report_check_e)check, REPORT_INFO,
+                   "%" PRIu32 " further %s message(s) suppressed after the first %" PRIu32,
+                   report->suppressed[check], check_names[check], report->cap);
+    }
+  }
+
+  report->file_name = NULL;
+}
+
+/*! @brief Set the record that following events refer to
+ *
+ *  @param[in] report sink
+ *  @param[in] record number of the record in the file
+ *  @param[in] offset byte offset of the record in the file
+ *
+ */
+void
+report_record (struct report_s *report, uint32_t record, uint64_t offset)
+{
+  report->in_record = true;
+  report->record    = record;
+  report->offset    = offset;
+}
+
+/* Log function of libmseed, messages it would print to stdout become lines of the sink */
+static void
+libmseed_print (const char *message)
+{
+  size_t len;
+
+  if (libmseed_silent)
+  {
+    return;
+  }
+
+  if (libmseed_sink == NULL || !libmseed_sink->open)
+  {
+    fputs (message, stdout);
+    return;
+  }
+
+  /* The sink ends the line itself */
+  len = strlen (message);
+  if (len > 0 && message[len - 1] == '\n')
+  {
+    len--;
+  }
+
+  report_line (libmseed_sink, REPORT_FILE, REPORT_INFO, "%.*s", (int)len, message);
+}
+
+/* Diagnostic function of libmseed, written to stderr once the lines before it are out */
+static void
+libmseed_diag (const char *message)
+{
+  if (libmseed_silent)
+  {
+    return;
+  }
+
+  if (libmseed_sink != NULL)
+  {
+    report_flush (libmseed_sink);
+  }
+
+  fputs (message, stderr);
+}
+
+/*! @brief Route the messages libmseed logs through a sink
+ *
+ *  Messages libmseed prints to stdout are written as lines of the sink, so
+ *  they keep their place among the events, and its diagnostics are written
+ *  to stderr after flushing the sink.  libmseed logging is global, so the
+ *  process has one such sink at a time.
+ *
+ *  @param[in] report sink opened by report_open(), or NULL to drop every message
+ *
+ */
+void
+report_libmseed (struct report_s *report)
+{
+  libmseed_sink   = report;
+  libmseed_silent = (report == NULL);
+  ms_loginit (libmseed_print, NULL, libmseed_diag, NULL);
+}
@@ -0,0 +1,87 @@
+#ifndef __MSEED3VALIDATOR_REPORT_H__
+#define __MSEED3VALIDATOR_REPORT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <mseed3-common/writer.h>
+
+/* Output formats of the report sink, selected with -F */
+enum report_format_e
+{
+    REPORT_FORMAT_TEXT = 0,
+    REPORT_FORMAT_NDJSON
+};
+
+enum report_severity_e
+{
+    REPORT_INFO = 0,
+    REPORT_WARNING,
+    REPORT_ERROR,
+    REPORT_FATAL
+};
+
+/* Check that produced an event, each has its own counters and cap */
+enum report_check_e
+{
+    REPORT_RUN = 0,
+    REPORT_FILE,
+    REPORT_HEADER,
+    REPORT_IDENTIFIER,
+    REPORT_EXTRA_HEADER,
+    REPORT_SCHEMA,
+    REPORT_CRC,
+    REPORT_PAYLOAD,
+    REPORT_CHECK_CNT
+};
+
+/* Receives the events of a sink opened with report_collect(), message is
+ * formatted and only valid during the call */
+typedef void (*report_event_f)(void *client, enum report_check_e check, enum report_severity_e severity,
+                                  const char *message);
+
+/* Sink events are written to, each validation context writes to its own or
+ * shares one with contexts of the same thread */
+struct report_s
+{
+    bool open;
+    enum report_format_e format;
+    uint32_t cap;
+    struct mseed3_writer_s writer;
+    report_event_f event_func;
+    void *event_client;
+
+    const char *file_name;
+    bool in_record;
+    uint32_t record;
+    uint64_t offset;
+
+    uint32_t counts[REPORT_CHECK_CNT];
+    uint32_t suppressed[REPORT_CHECK_CNT];
+};
+
+int report_open(struct report_s *report, enum report_format_e format, uint32_t cap);
+
+void report_collect(struct report_s *report, uint32_t cap, report_event_f event_func, void *client);
+
+void report_close(struct report_s *report);
+
+void report_flush(struct report_s *report);
+
+bool report_parse_format(const char *name, enum report_format_e *format);
+
+void report_file_begin(struct report_s *report, const char *file_name);
+
+void report_file_end(struct report_s *report);
+
+void report_record(struct report_s *report, uint32_t record, uint64_t offset);
+
+void report_event(struct report_s *report, enum report_check_e check, enum report_severity_e severity,
+                  const char *format, ...);
+
+void report_line(struct report_s *report, enum report_check_e check, enum report_severity_e severity,
+                 const char *format, ...);
+
+void report_libmseed(struct report_s *report);
+
+#endif /* __MSEED3VALIDATOR_REPORT_H__ */
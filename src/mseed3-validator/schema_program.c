@@ -0,0 +1,1125 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <yyjson.h>
+
+#include <mseed3-common/array.h>
+
+#include "report.h"
+#include "schema_program.h"
+#include "schema_registry.h"
+#include "schema_walker.h"
+
+#define PROGRAM_PATH_SIZE 512u
+
+/* Operations of a compiled schema, each checks one keyword */
+enum opcode_e
+{
+  OP_TYPE = 0,
+  OP_MEMBERS, /* properties and additionalProperties in one pass over the members */
+  OP_REQUIRED,
+  OP_ITEMS,
+  OP_TUPLE,
+  OP_ENUM,
+  OP_CONST,
+  OP_MINIMUM,
+  OP_MAXIMUM,
+  OP_EXCLUSIVE_MINIMUM,
+  OP_EXCLUSIVE_MAXIMUM,
+  OP_MULTIPLE_OF,
+  OP_MIN_LENGTH,
+  OP_MAX_LENGTH,
+  OP_MIN_ITEMS,
+  OP_MAX_ITEMS,
+  OP_MIN_PROPERTIES,
+  OP_MAX_PROPERTIES,
+  OP_UNIQUE_ITEMS,
+  OP_ALL_OF,
+  OP_ANY_OF,
+  OP_ONE_OF,
+  OP_NOT,
+  OP_DATE_TIME,
+  OP_REJECT,
+  OP_CALL
+};
+
+/* Instance types as bits of OP_TYPE, integers are numbers without a fraction */
+#define TYPE_NULL 0x01u
+#define TYPE_BOOLEAN 0x02u
+#define TYPE_INTEGER 0x04u
+#define TYPE_NUMBER 0x08u
+#define TYPE_STRING 0x10u
+#define TYPE_ARRAY 0x20u
+#define TYPE_OBJECT 0x40u
+#define TYPE_ANY 0x7Fu
+
+/* Members not named in properties, unless additionalProperties is a subschema */
+#define ADDITIONAL_ALLOWED -1
+#define ADDITIONAL_REJECTED -2
+
+/* One keyword of a subschema, operands live in the tables of the program */
+struct instruction_s
+{
+  uint8_t opcode;
+  uint8_t types;     /* OP_TYPE allowed types, OP_MINIMUM and OP_MAXIMUM 1 if exclusive */
+  uint32_t first;    /* first operand in members, values or branches */
+  uint32_t count;    /* number of operands */
+  int32_t block;     /* subschema of OP_ITEMS, OP_NOT and OP_CALL, additional members of OP_MEMBERS */
+  double bound;      /* limit of numeric and size checks */
+  yyjson_val *value; /* value of OP_CONST, keyword of OP_TYPE for messages */
+};
+
+/* Property of OP_MEMBERS, sorted by length and name, or name of OP_REQUIRED */
+struct member_s
+{
+  const char *name;
+  size_t name_len;
+  int32_t block;
+};
+
+/* Instructions of a subschema, run in order */
+struct block_s
+{
+  uint32_t start;
+  uint32_t count;
+};
+
+struct schema_program_s
+{
+  struct block_s *blocks;
+  int block_cnt;
+  struct instruction_s *code;
+  uint32_t code_cnt;
+  struct member_s *members;
+  int member_cnt;
+  int member_alloc;
+  yyjson_val **values;
+  int value_cnt;
+  int value_alloc;
+  int32_t *branches;
+  int branch_cnt;
+  int branch_alloc;
+};
+
+/* Block being compiled, instructions are moved into one array once all blocks are done */
+struct pending_block_s
+{
+  yyjson_val *schema;
+  struct instruction_s *code;
+  int code_cnt;
+  int code_alloc;
+};
+
+struct compiler_s
+{
+  struct schema_registry_s *registry;
+  struct schema_program_s *program;
+  struct pending_block_s *blocks;
+  int block_cnt;
+  int block_alloc;
+  bool failed;
+};
+
+/* Value of the instance path, an object member or an array index */
+struct step_s
+{
+  const char *key;
+  size_t key_len;
+  size_t index;
+};
+
+/* State of one run, errors are reported with the JSON pointer built from path */
+struct runner_s
+{
+  const struct schema_program_s *program;
+  struct report_s *report;
+  struct step_s path[SCHEMA_MAX_DEPTH + 1];
+  uint32_t path_len;
+  uint32_t depth;
+  uint32_t quiet; /* inside anyOf, oneOf or not, where failing branches are not errors */
+};
+
+static int32_t compile_block (struct compiler_s *compiler, yyjson_val *schema, yyjson_val *root);
+static bool run_block (struct runner_s *runner, int32_t block, yyjson_val *instance);
+
+/* Type bit of a type keyword, 0 for names that match no instance */
+static uint8_t
+type_bits (yyjson_val *type)
+{
+  static const struct
+  {
+    const char *name;
+    uint8_t bits;
+  } types[] = {{"null", TYPE_NULL},     {"boolean", TYPE_BOOLEAN}, {"integer", TYPE_INTEGER},
+               {"number", TYPE_INTEGER | TYPE_NUMBER}, {"string", TYPE_STRING}, {"array", TYPE_ARRAY},
+               {"object", TYPE_OBJECT}, {"any", TYPE_ANY}};
+
+  for (size_t i = 0; i < sizeof (types) / sizeof (types[0]); i++)
+  {
+    if (yyjson_equals_str (type, types[i].name))
+    {
+      return types[i].bits;
+    }
+  }
+
+  return 0;
+}
+
+/* Type bit of an instance */
+static uint8_t
+instance_type (yyjson_val *instance)
+{
+  switch (yyjson_get_type (instance))
+  {
+  case YYJSON_TYPE_NULL:
+    return TYPE_NULL;
+  case YYJSON_TYPE_BOOL:
+    return TYPE_BOOLEAN;
+  case YYJSON_TYPE_NUM:
+    return (yyjson_is_int (instance) || floor (yyjson_get_num (instance)) == yyjson_get_num (instance))
+               ? TYPE_INTEGER
+               : TYPE_NUMBER;
+  case YYJSON_TYPE_STR:
+    return TYPE_STRING;
+  case YYJSON_TYPE_ARR:
+    return TYPE_ARRAY;
+  case YYJSON_TYPE_OBJ:
+    return TYPE_OBJECT;
+  default:
+    return 0;
+  }
+}
+
+/* Order of properties in OP_MEMBERS, by length first so most lookups end at the length */
+static int
+compare_members (const void *a, const void *b)
+{
+  const struct member_s *left  = (const struct member_s *)a;
+  const struct member_s *right = (const struct member_s *)b;
+
+  if (left->name_len != right->name_len)
+  {
+    return (left->name_len < right->name_len) ? -1 : 1;
+  }
+
+  return memcmp (left->name, right->name, left->name_len);
+}
+
+/* Append an instruction to a block being compiled */
+static void
+emit (struct compiler_s *compiler, int32_t block, const struct instruction_s *instruction)
+{
+  struct pending_block_s *pending = &compiler->blocks[block];
+
+  while (pending->code_alloc <= pending->code_cnt)
+  {
+    pending->code_alloc = expand_array ((void **)&pending->code, pending->code_alloc, sizeof (struct instruction_s));
+  }
+
+  pending->code[pending->code_cnt++] = *instruction;
+}
+
+/* Compile a list of subschemas into consecutive branch operands, returns the first */
+static uint32_t
+compile_branches (struct compiler_s *compiler, yyjson_val *list, yyjson_val *root)
+{
+  struct schema_program_s *program = compiler->program;
+  size_t count                     = yyjson_arr_size (list);
+  int32_t *blocks                  = (int32_t *)malloc ((count + 1) * sizeof (int32_t));
+  uint32_t first;
+
+  if (blocks == NULL)
+  {
+    compiler->failed = true;
+    return 0;
+  }
+
+  /* Nested lists are appended while compiling, so the list is collected first */
+  for (size_t i = 0; i < count; i++)
+  {
+    blocks[i] = compile_block (compiler, yyjson_arr_get (list, i), root);
+  }
+
+  while (program->branch_alloc <= program->branch_cnt + (int)count)
+  {
+    program->branch_alloc = expand_array ((void **)&program->branches, program->branch_alloc, sizeof (int32_t));
+  }
+
+  first = (uint32_t)program->branch_cnt;
+  memcpy (program->branches + first, blocks, count * sizeof (int32_t));
+  program->branch_cnt += (int)count;
+  free (blocks);
+
+  return first;
+}
+
+/* Compile properties and additionalProperties of a schema into one OP_MEMBERS */
+static void
+compile_members (struct compiler_s *compiler, int32_t block, yyjson_val *schema, yyjson_val *root)
+{
+  struct schema_program_s *program = compiler->program;
+  yyjson_val *properties           = yyjson_obj_get (schema, "properties");
+  yyjson_val *additional           = yyjson_obj_get (schema, "additionalProperties");
+  struct instruction_s instruction = {OP_MEMBERS, 0, 0, 0, ADDITIONAL_ALLOWED, 0, NULL};
+  size_t count                     = yyjson_is_obj (properties) ? yyjson_obj_size (properties) : 0;
+  struct member_s *members         = (struct member_s *)malloc ((count + 1) * sizeof (struct member_s));
+  yyjson_obj_iter iter;
+  yyjson_val *key;
+  size_t index = 0;
+
+  if (members == NULL)
+  {
+    compiler->failed = true;
+    return;
+  }
+
+  yyjson_obj_iter_init (properties, &iter);
+  while (index < count && (key = yyjson_obj_iter_next (&iter)) != NULL)
+  {
+    members[index].name     = yyjson_get_str (key);
+    members[index].name_len = yyjson_get_len (key);
+    members[index].block    = compile_block (compiler, yyjson_obj_iter_get_val (key), root);
+    index++;
+  }
+
+  qsort (members, count, sizeof (struct member_s), compare_members);
+
+  if (yyjson_is_false (additional))
+  {
+    instruction.block = ADDITIONAL_REJECTED;
+  }
+  else if (yyjson_is_obj (additional))
+  {
+    instruction.block = compile_block (compiler, additional, root);
+  }
+
+  while (program->member_alloc <= program->member_cnt + (int)count)
+  {
+    program->member_alloc = expand_array ((void **)&program->members, program->member_alloc, sizeof (struct member_s));
+  }
+
+  instruction.first = (uint32_t)program->member_cnt;
+  instruction.count = (uint32_t)count;
+  memcpy (program->members + program->member_cnt, members, count * sizeof (struct member_s));
+  program->member_cnt += (int)count;
+  free (members);
+
+  emit (compiler, block, &instruction);
+}
+
+/* Compile the names of required into member operands */
+static void
+compile_required (struct compiler_s *compiler, int32_t block, yyjson_val *names)
+{
+  struct schema_program_s *program = compiler->program;
+  struct instruction_s instruction = {OP_REQUIRED, 0, (uint32_t)program->member_cnt, 0, 0, 0, NULL};
+  yyjson_arr_iter iter;
+  yyjson_val *name;
+
+  yyjson_arr_iter_init (names, &iter);
+  while ((name = yyjson_arr_iter_next (&iter)) != NULL)
+  {
+    if (!yyjson_is_str (name))
+    {
+      continue;
+    }
+
+    while (program->member_alloc <= program->member_cnt)
+    {
+      program->member_alloc =
+          expand_array ((void **)&program->members, program->member_alloc, sizeof (struct member_s));
+    }
+
+    program->members[program->member_cnt].name     = yyjson_get_str (name);
+    program->members[program->member_cnt].name_len = yyjson_get_len (name);
+    program->members[program->member_cnt].block    = -1;
+    program->member_cnt++;
+    instruction.count++;
+  }
+
+  emit (compiler, block, &instruction);
+}
+
+/* Compile the values of enum into value operands */
+static void
+compile_enum (struct compiler_s *compiler, int32_t block, yyjson_val *values)
+{
+  struct schema_program_s *program = compiler->program;
+  struct instruction_s instruction = {OP_ENUM, 0, (uint32_t)program->value_cnt, 0, 0, 0, NULL};
+  yyjson_arr_iter iter;
+  yyjson_val *value;
+
+  yyjson_arr_iter_init (values, &iter);
+  while ((value = yyjson_arr_iter_next (&iter)) != NULL)
+  {
+    while (program->value_alloc <= program->value_cnt)
+    {
+      program->value_alloc = expand_array ((void **)&program->values, program->value_alloc, sizeof (yyjson_val *));
+    }
+
+    program->values[program->value_cnt++] = value;
+    instruction.count++;
+  }
+
+  emit (compiler, block, &instruction);
+}
+
+/* Compile a $ref into a call of the block of its target */
+static void
+compile_ref (struct compiler_s *compiler, int32_t block, yyjson_val *ref, yyjson_val *root)
+{
+  struct instruction_s instruction = {OP_CALL, 0, 0, 0, 0, 0, NULL};
+  const char *name                 = yyjson_get_str (ref);
+  const char *fragment             = memchr (name, '#', yyjson_get_len (ref));
+  yyjson_val *target;
+
+  if (fragment != name)
+  {
+    root = schema_registry_document (compiler->registry, name,
+                                     (fragment != NULL) ? (size_t)(fragment - name) : yyjson_get_len (ref));
+  }
+
+  target = root;
+
+  if (root != NULL && fragment != NULL && fragment[1] != '\0')
+  {
+    target = yyjson_ptr_getn (root, fragment + 1, yyjson_get_len (ref) - (size_t)(fragment + 1 - name));
+  }
+
+  /* Left to the walker, which reports the reference on every record */
+  if (target == NULL)
+  {
+    compiler->failed = true;
+    return;
+  }
+
+  instruction.block = compile_block (compiler, target, root);
+  emit (compiler, block, &instruction);
+}
+
+/* Compile a keyword of a schema into instructions of its block */
+static void
+compile_keyword (struct compiler_s *compiler, int32_t block, enum schema_keyword_e keyword, yyjson_val *schema,
+                 yyjson_val *value, yyjson_val *root, bool *members_done)
+{
+  struct instruction_s instruction = {OP_TYPE, 0, 0, 0, -1, 0, NULL};
+
+  switch (keyword)
+  {
+  case SCHEMA_KW_TYPE:
+    instruction.value = value;
+    if (yyjson_is_str (value))
+    {
+      instruction.types = type_bits (value);
+    }
+    else if (yyjson_is_arr (value))
+    {
+      yyjson_arr_iter iter;
+      yyjson_val *type;
+
+      yyjson_arr_iter_init (value, &iter);
+      while ((type = yyjson_arr_iter_next (&iter)) != NULL)
+      {
+        instruction.types |= type_bits (type);
+      }
+    }
+    else
+    {
+      return;
+    }
+    break;
+  case SCHEMA_KW_PROPERTIES:
+  case SCHEMA_KW_ADDITIONAL_PROPERTIES:
+    if (!*members_done)
+    {
+      *members_done = true;
+      compile_members (compiler, block, schema, root);
+    }
+    return;
+  case SCHEMA_KW_REQUIRED:
+    if (yyjson_is_arr (value))
+    {
+      compile_required (compiler, block, value);
+    }
+    return;
+  case SCHEMA_KW_ITEMS:
+    if (yyjson_is_arr (value))
+    {
+      instruction.opcode = OP_TUPLE;
+      instruction.count  = (uint32_t)yyjson_arr_size (value);
+      instruction.first  = compile_branches (compiler, value, root);
+    }
+    else
+    {
+      instruction.opcode = OP_ITEMS;
+      instruction.block  = compile_block (compiler, value, root);
+    }
+    break;
+  case SCHEMA_KW_ENUM:
+    if (yyjson_is_arr (value))
+    {
+      compile_enum (compiler, block, value);
+    }
+    return;
+  case SCHEMA_KW_CONST:
+    instruction.opcode = OP_CONST;
+    instruction.value  = value;
+    break;
+  case SCHEMA_KW_MINIMUM:
+  case SCHEMA_KW_MAXIMUM:
+    if (!yyjson_is_num (value))
+    {
+      return;
+    }
+    /* draft-04 exclusiveMinimum and exclusiveMaximum are booleans modifying these */
+    instruction.opcode = (keyword == SCHEMA_KW_MINIMUM) ? OP_MINIMUM : OP_MAXIMUM;
+    instruction.types  = yyjson_is_true (
+        yyjson_obj_get (schema, (keyword == SCHEMA_KW_MINIMUM) ? "exclusiveMinimum" : "exclusiveMaximum"));
+    instruction.bound = yyjson_get_num (value);
+    break;
+  case SCHEMA_KW_EXCLUSIVE_MINIMUM:
+  case SCHEMA_KW_EXCLUSIVE_MAXIMUM:
+    if (!yyjson_is_num (value))
+    {
+      return;
+    }
+    instruction.opcode = (keyword == SCHEMA_KW_EXCLUSIVE_MINIMUM) ? OP_EXCLUSIVE_MINIMUM : OP_EXCLUSIVE_MAXIMUM;
+    instruction.bound  = yyjson_get_num (value);
+    break;
+  case SCHEMA_KW_MULTIPLE_OF:
+    if (!yyjson_is_num (value) || yyjson_get_num (value) <= 0)
+    {
+      return;
+    }
+    instruction.opcode = OP_MULTIPLE_OF;
+    instruction.bound  = yyjson_get_num (value);
+    break;
+  case SCHEMA_KW_MIN_LENGTH:
+  case SCHEMA_KW_MAX_LENGTH:
+  case SCHEMA_KW_MIN_ITEMS:
+  case SCHEMA_KW_MAX_ITEMS:
+  case SCHEMA_KW_MIN_PROPERTIES:
+  case SCHEMA_KW_MAX_PROPERTIES:
+    if (!yyjson_is_num (value))
+    {
+      return;
+    }
+    instruction.opcode = (keyword == SCHEMA_KW_MIN_LENGTH)   ? OP_MIN_LENGTH
+                         : (keyword == SCHEMA_KW_MAX_LENGTH) ? OP_MAX_LENGTH
+                         : (keyword == SCHEMA_KW_MIN_ITEMS)  ? OP_MIN_ITEMS
+                         : (keyword == SCHEMA_KW_MAX_ITEMS)  ? OP_MAX_ITEMS
+                         : (keyword == SCHEMA_KW_MIN_PROPERTIES) ? OP_MIN_PROPERTIES
+                                                                 : OP_MAX_PROPERTIES;
+    instruction.bound  = yyjson_get_num (value);
+    break;
+  case SCHEMA_KW_UNIQUE_ITEMS:
+    if (!yyjson_is_true (value))
+    {
+      return;
+    }
+    instruction.opcode = OP_UNIQUE_ITEMS;
+    break;
+  case SCHEMA_KW_ALL_OF:
+  case SCHEMA_KW_ANY_OF:
+  case SCHEMA_KW_ONE_OF:
+    if (!yyjson_is_arr (value))
+    {
+      return;
+    }
+    instruction.opcode = (keyword == SCHEMA_KW_ALL_OF) ? OP_ALL_OF : (keyword == SCHEMA_KW_ANY_OF) ? OP_ANY_OF : OP_ONE_OF;
+    instruction.count  = (uint32_t)yyjson_arr_size (value);
+    instruction.first  = compile_branches (compiler, value, root);
+    break;
+  case SCHEMA_KW_NOT:
+    instruction.opcode = OP_NOT;
+    instruction.block  = compile_block (compiler, value, root);
+    break;
+  case SCHEMA_KW_FORMAT:
+    /* Other formats are annotations, as draft-07 allows */
+    if (!yyjson_equals_str (value, "date-time"))
+    {
+      return;
+    }
+    instruction.opcode = OP_DATE_TIME;
+    break;
+  default:
+    return;
+  }
+
+  emit (compiler, block, &instruction);
+}
+
+/* Compile a schema into a block, once per schema however often it is referenced */
+static int32_t
+compile_block (struct compiler_s *compiler, yyjson_val *schema, yyjson_val *root)
+{
+  struct instruction_s reject = {OP_REJECT, 0, 0, 0, -1, 0, NULL};
+  yyjson_obj_iter iter;
+  yyjson_val *key;
+  yyjson_val *ref;
+  bool members_done = false;
+  int32_t block;
+
+  for (int i = 0; i < compiler->block_cnt; i++)
+  {
+    if (compiler->blocks[i].schema == schema)
+    {
+      return i;
+    }
+  }
+
+  while (compiler->block_alloc <= compiler->block_cnt)
+  {
+    compiler->block_alloc =
+        expand_array ((void **)&compiler->blocks, compiler->block_alloc, sizeof (struct pending_block_s));
+  }
+
+  block = compiler->block_cnt++;
+  memset (&compiler->blocks[block], 0, sizeof (struct pending_block_s));
+  compiler->blocks[block].schema = schema;
+
+  if (yyjson_is_false (schema))
+  {
+    emit (compiler, block, &reject);
+    return block;
+  }
+
+  if (!yyjson_is_obj (schema))
+  {
+    return block;
+  }
+
+  /* Members next to a $ref are ignored, as in draft-04 to draft-07 */
+  if ((ref = yyjson_obj_get (schema, "$ref")) != NULL && yyjson_is_str (ref))
+  {
+    compile_ref (compiler, block, ref, root);
+    return block;
+  }
+
+  yyjson_obj_iter_init (schema, &iter);
+
+  while ((key = yyjson_obj_iter_next (&iter)) != NULL)
+  {
+    const struct schema_keyword_s *keyword = schema_keyword_lookup (yyjson_get_str (key), yyjson_get_len (key));
+
+    if (keyword != NULL)
+    {
+      compile_keyword (compiler, block, keyword->keyword, schema, yyjson_obj_iter_get_val (key), root,
+                       &members_done);
+    }
+  }
+
+  return block;
+}
+
+/*! @brief Compile the schemas of a registry into a program
+ *
+ *  Every subschema becomes a block of instructions checking its keywords
+ *  directly, properties are looked up in sorted tables and $refs are
+ *  resolved to blocks, so no schema document is read while validating.
+ *
+ *  @param[in] registry registry whose documents are walkable
+ *  @param[in] verbose verbosity level
+ *
+ *  @return program, NULL if a $ref cannot be resolved, the walker is used then
+ */
+struct schema_program_s *
+schema_program_compile (struct schema_registry_s *registry, uint8_t verbose)
+{
+  struct compiler_s compiler;
+  struct schema_program_s *program;
+  yyjson_val *root = yyjson_doc_get_root (registry->document);
+
+  if (root == NULL || (program = (struct schema_program_s *)calloc (1, sizeof (struct schema_program_s))) == NULL)
+  {
+    return NULL;
+  }
+
+  memset (&compiler, 0, sizeof (struct compiler_s));
+  compiler.registry = registry;
+  compiler.program  = program;
+
+  compile_block (&compiler, root, root);
+
+  /* A schema loaded for a $ref may use keywords the walker does not know either */
+  compiler.failed = compiler.failed || !registry->walkable;
+
+  if (!compiler.failed)
+  {
+    program->blocks = (struct block_s *)malloc (compiler.block_cnt * sizeof (struct block_s));
+
+    for (int i = 0; i < compiler.block_cnt; i++)
+    {
+      program->code_cnt += (uint32_t)compiler.blocks[i].code_cnt;
+    }
+
+    program->code = (struct instruction_s *)malloc ((program->code_cnt + 1) * sizeof (struct instruction_s));
+    compiler.failed = (program->blocks == NULL || program->code == NULL);
+  }
+
+  /* Instructions of each block are laid out next to each other */
+  program->code_cnt = 0;
+  for (int i = 0; i < compiler.block_cnt; i++)
+  {
+    if (!compiler.failed)
+    {
+      program->blocks[i].start = program->code_cnt;
+      program->blocks[i].count = (uint32_t)compiler.blocks[i].code_cnt;
+      memcpy (program->code + program->code_cnt, compiler.blocks[i].code,
+              compiler.blocks[i].code_cnt * sizeof (struct instruction_s));
+      program->code_cnt += (uint32_t)compiler.blocks[i].code_cnt;
+    }
+    free (compiler.blocks[i].code);
+  }
+  program->block_cnt = compiler.block_cnt;
+  free (compiler.blocks);
+
+  if (compiler.failed)
+  {
+    schema_program_free (program);
+    return NULL;
+  }
+
+  if (verbose > 1)
+  {
+    report_line (registry->report, REPORT_SCHEMA, REPORT_INFO,
+                 "Compiled JSON schema into %u instruction(s) in %d block(s)", program->code_cnt, program->block_cnt);
+  }
+
+  return program;
+}
+
+/*! @brief Release a program returned by schema_program_compile()
+ *
+ *  @param[in] program program, or NULL
+ */
+void
+schema_program_free (struct schema_program_s *program)
+{
+  if (program == NULL)
+  {
+    return;
+  }
+
+  free (program->blocks);
+  free (program->code);
+  free (program->members);
+  free (program->values);
+  free (program->branches);
+  free (program);
+}
+
+/* Report a validation error at the current path, unless inside a branch that may fail */
+static void
+runner_error (struct runner_s *runner, const char *format, ...)
+{
+  char path[PROGRAM_PATH_SIZE];
+  char message[512];
+  size_t length = 0;
+  va_list ap;
+
+  if (runner->quiet > 0)
+  {
+    return;
+  }
+
+  /* The path is only formatted here, running keeps pointers to the member names */
+  for (uint32_t i = 0; i < runner->path_len && length + 2 < PROGRAM_PATH_SIZE; i++)
+  {
+    const struct step_s *step = &runner->path[i];
+
+    if (step->key == NULL)
+    {
+      int written = snprintf (path + length, PROGRAM_PATH_SIZE - length, "/%zu", step->index);
+
+      length += (written > 0 && (size_t)written < PROGRAM_PATH_SIZE - length) ? (size_t)written : 0;
+      continue;
+    }
+
+    path[length++] = '/';
+    for (size_t j = 0; j < step->key_len && length + 2 < PROGRAM_PATH_SIZE; j++)
+    {
+      if (step->key[j] == '~' || step->key[j] == '/')
+      {
+        path[length++] = '~';
+        path[length++] = (step->key[j] == '~') ? '0' : '1';
+      }
+      else
+      {
+        path[length++] = step->key[j];
+      }
+    }
+  }
+  path[length] = '\0';
+
+  va_start (ap, format);
+  vsnprintf (message, sizeof (message), format, ap);
+  va_end (ap);
+
+  report_line (runner->report, REPORT_SCHEMA, REPORT_ERROR, "Error in Schema Validation- %s: %s",
+               (length > 0) ? path : "/", message);
+}
+
+/* Run a block on a member or element of the instance, with the path extended by it */
+static bool
+run_step (struct runner_s *runner, int32_t block, const char *key, size_t key_len, size_t index, yyjson_val *value)
+{
+  bool valid;
+
+  runner->path[runner->path_len].key     = key;
+  runner->path[runner->path_len].key_len = key_len;
+  runner->path[runner->path_len].index   = index;
+  runner->path_len++;
+
+  valid = run_block (runner, block, value);
+
+  runner->path_len--;
+
+  return valid;
+}
+
+/* Find a property of OP_MEMBERS by binary search */
+static int32_t
+find_member (const struct schema_program_s *program, const struct instruction_s *instruction, const char *name,
+             size_t name_len)
+{
+  const struct member_s *members = program->members + instruction->first;
+  struct member_s wanted         = {name, name_len, 0};
+  size_t low                     = 0;
+  size_t high                    = instruction->count;
+
+  while (low < high)
+  {
+    size_t middle = (low + high) / 2;
+    int order     = compare_members (&wanted, &members[middle]);
+
+    if (order == 0)
+    {
+      return members[middle].block;
+    }
+    if (order < 0)
+    {
+      high = middle;
+    }
+    else
+    {
+      low = middle + 1;
+    }
+  }
+
+  return ADDITIONAL_ALLOWED;
+}
+
+/* Run the instructions of a block, stopping at the first failure inside a branch that may fail */
+static bool
+run_block (struct runner_s *runner, int32_t block, yyjson_val *instance)
+{
+  const struct schema_program_s *program = runner->program;
+  const struct instruction_s *code       = program->code + program->blocks[block].start;
+  uint32_t count                         = program->blocks[block].count;
+  uint8_t type                           = instance_type (instance);
+  bool valid                             = true;
+
+  if (runner->depth >= SCHEMA_MAX_DEPTH)
+  {
+    runner_error (runner, "schema nested deeper than %u levels, possible $ref cycle", SCHEMA_MAX_DEPTH);
+    return false;
+  }
+
+  runner->depth++;
+
+  for (uint32_t i = 0; i < count && (valid || runner->quiet == 0); i++)
+  {
+    const struct instruction_s *instruction = &code[i];
+    double number                           = (type & (TYPE_INTEGER | TYPE_NUMBER)) ? yyjson_get_num (instance) : 0;
+    size_t matches                          = 0;
+
+    switch (instruction->opcode)
+    {
+    case OP_TYPE:
+      if (!(type & instruction->types))
+      {
+        if (yyjson_is_str (instruction->value))
+        {
+          runner_error (runner, "%s found, expected %s", schema_type_name (instance),
+                        yyjson_get_str (instruction->value));
+        }
+        else
+        {
+          runner_error (runner, "%s found, not one of the allowed types", schema_type_name (instance));
+        }
+        valid = false;
+      }
+      break;
+    case OP_MEMBERS:
+      if (type == TYPE_OBJECT)
+      {
+        yyjson_obj_iter iter;
+        yyjson_val *key;
+
+        yyjson_obj_iter_init (instance, &iter);
+        while ((key = yyjson_obj_iter_next (&iter)) != NULL && (valid || runner->quiet == 0))
+        {
+          const char *name = yyjson_get_str (key);
+          size_t name_len  = yyjson_get_len (key);
+          int32_t member   = find_member (program, instruction, name, name_len);
+
+          if (member < 0)
+          {
+            member = instruction->block;
+          }
+
+          if (member >= 0)
+          {
+            valid = run_step (runner, member, name, name_len, 0, yyjson_obj_iter_get_val (key)) && valid;
+          }
+          else if (member == ADDITIONAL_REJECTED)
+          {
+            runner->path[runner->path_len].key     = name;
+            runner->path[runner->path_len].key_len = name_len;
+            runner->path_len++;
+            runner_error (runner, "property is not allowed by the schema");
+            runner->path_len--;
+            valid = false;
+          }
+        }
+      }
+      break;
+    case OP_REQUIRED:
+      if (type == TYPE_OBJECT)
+      {
+        for (uint32_t j = 0; j < instruction->count; j++)
+        {
+          const struct member_s *name = &program->members[instruction->first + j];
+
+          if (yyjson_obj_getn (instance, name->name, name->name_len) == NULL)
+          {
+            runner_error (runner, "required property %s is missing", name->name);
+            valid = false;
+          }
+        }
+      }
+      break;
+    case OP_ITEMS:
+    case OP_TUPLE:
+      if (type == TYPE_ARRAY)
+      {
+        yyjson_arr_iter iter;
+        yyjson_val *element;
+        size_t index = 0;
+
+        yyjson_arr_iter_init (instance, &iter);
+        while ((element = yyjson_arr_iter_next (&iter)) != NULL && (valid || runner->quiet == 0))
+        {
+          if (instruction->opcode == OP_ITEMS)
+          {
+            valid = run_step (runner, instruction->block, NULL, 0, index, element) && valid;
+          }
+          else if (index < instruction->count)
+          {
+            valid = run_step (runner, program->branches[instruction->first + index], NULL, 0, index, element) && valid;
+          }
+          index++;
+        }
+      }
+      break;
+    case OP_ENUM:
+      for (uint32_t j = 0; j < instruction->count && matches == 0; j++)
+      {
+        matches = yyjson_equals (instance, program->values[instruction->first + j]);
+      }
+      if (matches == 0)
+      {
+        runner_error (runner, "value is not one of the values of enum");
+        valid = false;
+      }
+      break;
+    case OP_CONST:
+      if (!yyjson_equals (instance, instruction->value))
+      {
+        runner_error (runner, "value is not the value of const");
+        valid = false;
+      }
+      break;
+    case OP_MINIMUM:
+      if ((type & (TYPE_INTEGER | TYPE_NUMBER)) &&
+          (number < instruction->bound || (instruction->types && number == instruction->bound)))
+      {
+        runner_error (runner, "%g is less than %sminimum %g", number,
+                      instruction->types ? "or equal to exclusive " : "", instruction->bound);
+        valid = false;
+      }
+      break;
+    case OP_MAXIMUM:
+      if ((type & (TYPE_INTEGER | TYPE_NUMBER)) &&
+          (number > instruction->bound || (instruction->types && number == instruction->bound)))
+      {
+        runner_error (runner, "%g is greater than %smaximum %g", number,
+                      instruction->types ? "or equal to exclusive " : "", instruction->bound);
+        valid = false;
+      }
+      break;
+    case OP_EXCLUSIVE_MINIMUM:
+      if ((type & (TYPE_INTEGER | TYPE_NUMBER)) && number <= instruction->bound)
+      {
+        runner_error (runner, "%g is less than or equal to exclusive minimum %g", number, instruction->bound);
+        valid = false;
+      }
+      break;
+    case OP_EXCLUSIVE_MAXIMUM:
+      if ((type & (TYPE_INTEGER | TYPE_NUMBER)) && number >= instruction->bound)
+      {
+        runner_error (runner, "%g is greater than or equal to exclusive maximum %g", number, instruction->bound);
+        valid = false;
+      }
+      break;
+    case OP_MULTIPLE_OF:
+      if (type & (TYPE_INTEGER | TYPE_NUMBER))
+      {
+        double quotient = number / instruction->bound;
+
+        if (fabs (quotient - nearbyint (quotient)) > 1e-9 * fmax (1.0, fabs (quotient)))
+        {
+          runner_error (runner, "%g is not a multiple of %g", number, instruction->bound);
+          valid = false;
+        }
+      }
+      break;
+    case OP_MIN_LENGTH:
+    case OP_MAX_LENGTH:
+      if (type == TYPE_STRING)
+      {
+        size_t length = schema_utf8_length (yyjson_get_str (instance), yyjson_get_len (instance));
+
+        if ((instruction->opcode == OP_MIN_LENGTH) ? (double)length < instruction->bound
+                                                   : (double)length > instruction->bound)
+        {
+          runner_error (runner, "string of %zu characters, %s %g", length,
+                        (instruction->opcode == OP_MIN_LENGTH) ? "minLength" : "maxLength", instruction->bound);
+          valid = false;
+        }
+      }
+      break;
+    case OP_MIN_ITEMS:
+    case OP_MAX_ITEMS:
+    case OP_MIN_PROPERTIES:
+    case OP_MAX_PROPERTIES:
+      if (type == ((instruction->opcode <= OP_MAX_ITEMS) ? TYPE_ARRAY : TYPE_OBJECT))
+      {
+        static const char *names[] = {"minItems", "maxItems", "minProperties", "maxProperties"};
+        size_t size                = yyjson_get_len (instance);
+        bool minimum = (instruction->opcode == OP_MIN_ITEMS || instruction->opcode == OP_MIN_PROPERTIES);
+
+        if (minimum ? (double)size < instruction->bound : (double)size > instruction->bound)
+        {
+          runner_error (runner, "%zu %s, %s %g", size, (type == TYPE_ARRAY) ? "items" : "properties",
+                        names[instruction->opcode - OP_MIN_ITEMS], instruction->bound);
+          valid = false;
+        }
+      }
+      break;
+    case OP_UNIQUE_ITEMS:
+      if (type == TYPE_ARRAY)
+      {
+        size_t size = yyjson_arr_size (instance);
+        bool unique = true;
+
+        for (size_t j = 0; j < size && unique; j++)
+        {
+          for (size_t k = j + 1; k < size && unique; k++)
+          {
+            if (yyjson_equals (yyjson_arr_get (instance, j), yyjson_arr_get (instance, k)))
+            {
+              runner_error (runner, "items %zu and %zu are equal, uniqueItems", j, k);
+              unique = false;
+            }
+          }
+        }
+        valid = unique && valid;
+      }
+      break;
+    case OP_ALL_OF:
+    case OP_ANY_OF:
+    case OP_ONE_OF:
+      runner->quiet += (instruction->opcode != OP_ALL_OF);
+      for (uint32_t j = 0; j < instruction->count; j++)
+      {
+        matches += run_block (runner, program->branches[instruction->first + j], instance);
+      }
+      runner->quiet -= (instruction->opcode != OP_ALL_OF);
+
+      if (instruction->opcode == OP_ALL_OF && matches != instruction->count)
+      {
+        valid = false;
+      }
+      else if (instruction->opcode == OP_ANY_OF && matches == 0)
+      {
+        runner_error (runner, "value matches none of the schemas of anyOf");
+        valid = false;
+      }
+      else if (instruction->opcode == OP_ONE_OF && matches != 1)
+      {
+        runner_error (runner, "value matches %zu of the schemas of oneOf, expected exactly one", matches);
+        valid = false;
+      }
+      break;
+    case OP_NOT:
+      runner->quiet++;
+      matches = run_block (runner, instruction->block, instance);
+      runner->quiet--;
+
+      if (matches)
+      {
+        runner_error (runner, "value matches the schema of not");
+        valid = false;
+      }
+      break;
+    case OP_DATE_TIME:
+      if (type == TYPE_STRING && !schema_date_time (yyjson_get_str (instance), yyjson_get_len (instance)))
+      {
+        runner_error (runner, "\"%.64s\" is not an RFC 3339 date-time", yyjson_get_str (instance));
+        valid = false;
+      }
+      break;
+    case OP_REJECT:
+      runner_error (runner, "no value is allowed by the schema");
+      valid = false;
+      break;
+    case OP_CALL:
+      valid = run_block (runner, instruction->block, instance) && valid;
+      break;
+    }
+  }
+
+  runner->depth--;
+
+  return valid;
+}
+
+/*! @brief Validate a parsed extra header with a compiled schema
+ *
+ *  Reports the same errors as schema_walker_validate().
+ *
+ *  @param[in] program program returned by schema_program_compile()
+ *  @param[in] report sink errors are reported to
+ *  @param[in] instance root of the extra header document
+ *
+ *  @return true if the extra header is valid
+ */
+bool
+schema_program_run (const struct schema_program_s *program, struct report_s *report, yyjson_val *instance)
+{
+  struct runner_s runner;
+
+  runner.program  = program;
+  runner.report   = report;
+  runner.path_len = 0;
+  runner.depth    = 0;
+  runner.quiet    = 0;
+
+  return run_block (&runner, 0, instance);
+}
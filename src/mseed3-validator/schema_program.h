@@ -0,0 +1,21 @@
+#ifndef __MSEED3VALIDATOR_SCHEMA_PROGRAM_H__
+#define __MSEED3VALIDATOR_SCHEMA_PROGRAM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <yyjson.h>
+
+#include "report.h"
+#include "schema_registry.h"
+
+/* JSON schema compiled into blocks of instructions, one block per subschema,
+ * see schema_program_compile() */
+struct schema_program_s;
+
+struct schema_program_s *schema_program_compile(struct schema_registry_s *registry, uint8_t verbose);
+
+void schema_program_free(struct schema_program_s *program);
+
+bool schema_program_run(const struct schema_program_s *program, struct report_s *report, yyjson_val *instance);
+
+#endif /* __MSEED3VALIDATOR_SCHEMA_PROGRAM_H__ */
@@ -0,0 +1,467 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wjelement.h>
+#include <yyjson.h>
+
+#include <mseed3-common/array.h>
+#include <mseed3-common/files.h>
+#include <mseed3-common/mseed3_string.h>
+
+#include "report.h"
+#include "schema_program.h"
+#include "schema_registry.h"
+#include "schema_walker.h"
+
+#define SCHEMA_BUFFER_SIZE 1024u
+
+/* Longest JSON pointer token followed into a WJElement schema */
+#define SCHEMA_TOKEN_LEN 256u
+
+static WJElement read_schema (struct schema_registry_s *registry, const char *path);
+static yyjson_doc *read_document (struct schema_registry_s *registry, const char *path);
+static struct schema_entry_s *find_entry (struct schema_registry_s *registry, const char *name, size_t name_len);
+static bool load_entry (struct schema_registry_s *registry, const char *name);
+static WJElement resolve_fragment (WJElement schema, const char *fragment);
+static void preload_reference (struct schema_registry_s *registry, const char *ref, uint8_t verbose);
+static void preload_element (struct schema_registry_s *registry, WJElement element, uint8_t verbose);
+static void preload_value (struct schema_registry_s *registry, yyjson_val *value, uint8_t verbose);
+
+/*! @brief Load a JSON schema and every schema it references
+ *
+ *  The root schema is parsed once and walked for external "$ref" entries,
+ *  which are loaded relative to the directory of the root schema, and so
+ *  on for the schemas they reference.  Every reference is resolved here,
+ *  the lookups made while validating only read the registry, so contexts
+ *  on any number of threads share it without locks.  Schemas are parsed by
+ *  yyjson as well, for schema_walker_validate().
+ *
+ *  @param[in] schema_file_name path to the root json schema
+ *  @param[in] report sink for loading errors
+ *  @param[in] verbose verbosity level
+ *
+ *  @return registry on success, NULL if the root schema could not be loaded
+ */
+struct schema_registry_s *
+schema_registry_open (const char *schema_file_name, struct report_s *report, uint8_t verbose)
+{
+  struct schema_registry_s *registry;
+
+  if (schema_file_name == NULL)
+  {
+    return NULL;
+  }
+
+  registry = (struct schema_registry_s *)calloc (1, sizeof (struct schema_registry_s));
+
+  if (registry == NULL)
+  {
+    return NULL;
+  }
+
+  registry->file_name = strdup (schema_file_name);
+  registry->directory = mseed3_get_dirname (registry->file_name);
+  registry->report    = report;
+  registry->root      = read_schema (registry, schema_file_name);
+
+  if (registry->root == NULL)
+  {
+    schema_registry_close (registry);
+    return NULL;
+  }
+
+  registry->walkable = true;
+  registry->document = read_document (registry, schema_file_name);
+
+  if (registry->document != NULL)
+  {
+    preload_value (registry, yyjson_doc_get_root (registry->document), verbose);
+  }
+  else
+  {
+    preload_element (registry, registry->root, verbose);
+  }
+
+  if (verbose > 1)
+  {
+    report_line (registry->report, REPORT_SCHEMA, REPORT_INFO, "Loaded JSON schema %s with %d referenced schema(s)",
+                 schema_file_name, registry->entry_cnt);
+
+    if (!registry->walkable)
+    {
+      report_line (registry->report, REPORT_SCHEMA, REPORT_INFO,
+                   "JSON schema uses %s, extra headers are validated with WJElement",
+                   (registry->unsupported != NULL) ? registry->unsupported : "syntax yyjson cannot parse");
+    }
+  }
+
+  if (registry->walkable)
+  {
+    registry->program = schema_program_compile (registry, verbose);
+  }
+
+  return registry;
+}
+
+/*! @brief Release a registry and all schemas it holds
+ *
+ *  @param[in] registry registry returned by schema_registry_open()
+ *
+ */
+void
+schema_registry_close (struct schema_registry_s *registry)
+{
+  if (registry == NULL)
+  {
+    return;
+  }
+
+  for (int i = 0; i < registry->entry_cnt; i++)
+  {
+    if (registry->entries[i].schema)
+    {
+      WJECloseDocument (registry->entries[i].schema);
+    }
+    yyjson_doc_free (registry->entries[i].document);
+    free (registry->entries[i].name);
+    free (registry->entries[i].path);
+  }
+
+  if (registry->root)
+  {
+    WJECloseDocument (registry->root);
+  }
+  yyjson_doc_free (registry->document);
+  schema_program_free (registry->program);
+
+  free (registry->entries);
+  free (registry->directory);
+  free (registry->file_name);
+  free (registry);
+}
+
+/*! @brief WJElement callback for loading additional schemas from the registry
+ *
+ *  Only reads the registry, a schema not loaded by schema_registry_open()
+ *  is not found.
+ *
+ *  @param[in] name value of the "$ref" being resolved, with an optional JSON pointer fragment
+ *  @param[in] client registry passed to WJESchemaValidate()
+ *
+ *  @return referenced schema, NULL if it was not loaded
+ */
+WJElement
+schema_registry_load (const char *name, void *client, const char *file, const int line)
+{
+  struct schema_registry_s *registry = (struct schema_registry_s *)client;
+  const struct schema_entry_s *entry;
+  size_t name_len;
+
+  if (registry == NULL || name == NULL)
+  {
+    return NULL;
+  }
+
+  name_len = strcspn (name, "#");
+
+  if ((entry = find_entry (registry, name, name_len)) == NULL || entry->schema == NULL)
+  {
+    return NULL;
+  }
+
+  return resolve_fragment (entry->schema, name + name_len);
+}
+
+/* Callback to free additional schemas, the registry owns them until closed */
+void
+schema_registry_free (WJElement schema, void *client)
+{
+  return;
+}
+
+/*! @brief Find the yyjson document of a referenced schema
+ *
+ *  Only reads the registry, a schema not loaded by schema_registry_open()
+ *  is not found.
+ *
+ *  @param[in] registry registry returned by schema_registry_open()
+ *  @param[in] name "$ref" value without its fragment, not NUL terminated
+ *  @param[in] name_len length of name
+ *
+ *  @return root of the schema document, NULL if it was not loaded
+ */
+yyjson_val *
+schema_registry_document (struct schema_registry_s *registry, const char *name, size_t name_len)
+{
+  const struct schema_entry_s *entry = find_entry (registry, name, name_len);
+
+  return (entry != NULL) ? yyjson_doc_get_root (entry->document) : NULL;
+}
+
+/* Parse a schema file into a WJElement document */
+static WJElement
+read_schema (struct schema_registry_s *registry, const char *path)
+{
+  char schema_buffer[SCHEMA_BUFFER_SIZE];
+  FILE *schema_file;
+  WJReader schema_reader;
+  WJElement schema = NULL;
+
+  if ((schema_file = fopen (path, "r")))
+  {
+    if ((schema_reader = WJROpenFILEDocument (schema_file, schema_buffer, SCHEMA_BUFFER_SIZE)))
+    {
+      schema = WJEOpenDocument (schema_reader, NULL, NULL, NULL);
+      WJRCloseDocument (schema_reader);
+    }
+    else
+    {
+      report_line (registry->report, REPORT_SCHEMA, REPORT_ERROR, "json document failed to open: '%s'", path);
+    }
+    fclose (schema_file);
+  }
+  else
+  {
+    report_line (registry->report, REPORT_SCHEMA, REPORT_ERROR, "json file not found: '%s'", path);
+  }
+
+  return schema;
+}
+
+/* Parse a schema file with yyjson, a schema yyjson cannot parse or the walker
+ * cannot validate with leaves validation to WJElement */
+static yyjson_doc *
+read_document (struct schema_registry_s *registry, const char *path)
+{
+  yyjson_read_err error;
+  yyjson_doc *document = yyjson_read_file (path, YYJSON_READ_NOFLAG, NULL, &error);
+  const char *keyword  = NULL;
+
+  if (document == NULL)
+  {
+    registry->walkable = false;
+  }
+  else if (!schema_walker_supported (yyjson_doc_get_root (document), &keyword))
+  {
+    registry->walkable    = false;
+    registry->unsupported = keyword;
+  }
+
+  return document;
+}
+
+/* Entry of the schema named by the first name_len bytes of name, NULL if not loaded */
+static struct schema_entry_s *
+find_entry (struct schema_registry_s *registry, const char *name, size_t name_len)
+{
+  for (int i = 0; i < registry->entry_cnt; i++)
+  {
+    if (0 == strncmp (registry->entries[i].name, name, name_len) && registry->entries[i].name[name_len] == '\0')
+    {
+      return &registry->entries[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Load a referenced schema relative to the root schema directory and cache it,
+ * references given as URLs are looked up by their final path component */
+static bool
+load_entry (struct schema_registry_s *registry, const char *name)
+{
+  const char *base = strrchr (name, '/');
+  struct schema_entry_s *entry;
+  char *path;
+
+  if (registry->entry_alloc <= registry->entry_cnt)
+  {
+    struct schema_entry_s *entries = registry->entries;
+    int len = expand_array ((void **)&entries, registry->entry_alloc, sizeof (struct schema_entry_s));
+
+    if (len < 0)
+    {
+      return false;
+    }
+    registry->entries     = entries;
+    registry->entry_alloc = len;
+  }
+
+  path = (char *)malloc (strlen (registry->directory) + strlen (name) + 2);
+
+  if (path == NULL)
+  {
+    return false;
+  }
+
+  sprintf (path, "%s/%s", registry->directory, name);
+
+  if (base != NULL && !mseed3_file_exists (path))
+  {
+    sprintf (path, "%s/%s", registry->directory, base + 1);
+  }
+
+  /* Failed loads are cached as well so a missing file is reported once */
+  entry           = &registry->entries[registry->entry_cnt++];
+  entry->name     = strdup (name);
+  entry->path     = path;
+  entry->schema   = read_schema (registry, path);
+  entry->document = read_document (registry, path);
+
+  return true;
+}
+
+/* Follow the JSON pointer of a "$ref" fragment, such as "#/definitions/name", into a WJElement schema */
+static WJElement
+resolve_fragment (WJElement schema, const char *fragment)
+{
+  char token[SCHEMA_TOKEN_LEN];
+
+  if (fragment[0] == '#')
+  {
+    fragment++;
+  }
+
+  while (schema != NULL && fragment[0] == '/')
+  {
+    size_t len = 0;
+    WJElement child;
+    long index;
+
+    /* Unescape ~1 to / and ~0 to ~ */
+    for (fragment++; fragment[0] != '\0' && fragment[0] != '/'; fragment++)
+    {
+      char c = fragment[0];
+
+      if (c == '~' && (fragment[1] == '0' || fragment[1] == '1'))
+      {
+        c = (fragment[1] == '1') ? '/' : '~';
+        fragment++;
+      }
+
+      if (len + 1 >= sizeof (token))
+      {
+        return NULL;
+      }
+      token[len++] = c;
+    }
+    token[len] = '\0';
+
+    index = (schema->type == WJR_TYPE_ARRAY) ? strtol (token, NULL, 10) : -1;
+    child = schema->child;
+
+    for (long i = 0; child != NULL; child = child->next, i++)
+    {
+      if ((index >= 0) ? (i == index) : (child->name != NULL && 0 == strcmp (child->name, token)))
+      {
+        break;
+      }
+    }
+
+    schema = child;
+  }
+
+  return schema;
+}
+
+/* Load the schema a "$ref" names unless already loaded, then the schemas it references in turn */
+static void
+preload_reference (struct schema_registry_s *registry, const char *ref, uint8_t verbose)
+{
+  size_t name_len = strcspn (ref, "#");
+  int index       = registry->entry_cnt;
+  char *name;
+  bool loaded;
+
+  /* Local references are resolved within the same document */
+  if (name_len == 0 || find_entry (registry, ref, name_len) != NULL || (name = strndup (ref, name_len)) == NULL)
+  {
+    return;
+  }
+
+  loaded = load_entry (registry, name);
+  free (name);
+
+  if (!loaded)
+  {
+    return;
+  }
+
+  if (verbose > 2)
+  {
+    report_line (registry->report, REPORT_SCHEMA, REPORT_INFO, "Loaded referenced JSON schema %s",
+                 registry->entries[index].name);
+  }
+
+  /* The entries may move while the references of this one are loaded */
+  if (registry->entries[index].document != NULL)
+  {
+    preload_value (registry, yyjson_doc_get_root (registry->entries[index].document), verbose);
+  }
+  else if (registry->entries[index].schema != NULL)
+  {
+    preload_element (registry, registry->entries[index].schema, verbose);
+  }
+}
+
+/* Walk a WJElement schema, for schemas yyjson cannot parse, and load every external "$ref" it contains */
+static void
+preload_element (struct schema_registry_s *registry, WJElement element, uint8_t verbose)
+{
+  for (WJElement child = element->child; child != NULL; child = child->next)
+  {
+    if (child->type == WJR_TYPE_STRING && child->name && 0 == strcmp (child->name, "$ref"))
+    {
+      char *ref = WJEString (child, NULL, WJE_GET, NULL);
+
+      if (ref != NULL)
+      {
+        preload_reference (registry, ref, verbose);
+      }
+    }
+    else if (child->child != NULL)
+    {
+      preload_element (registry, child, verbose);
+    }
+  }
+}
+
+/* Walk a yyjson schema document and load every external "$ref" it contains */
+static void
+preload_value (struct schema_registry_s *registry, yyjson_val *value, uint8_t verbose)
+{
+  yyjson_obj_iter members;
+  yyjson_arr_iter items;
+  yyjson_val *key;
+  yyjson_val *item;
+
+  if (yyjson_is_obj (value))
+  {
+    yyjson_obj_iter_init (value, &members);
+
+    while ((key = yyjson_obj_iter_next (&members)) != NULL)
+    {
+      item = yyjson_obj_iter_get_val (key);
+
+      if (yyjson_equals_str (key, "$ref") && yyjson_is_str (item))
+      {
+        preload_reference (registry, yyjson_get_str (item), verbose);
+      }
+      else
+      {
+        preload_value (registry, item, verbose);
+      }
+    }
+  }
+  else if (yyjson_is_arr (value))
+  {
+    yyjson_arr_iter_init (value, &items);
+
+    while ((item = yyjson_arr_iter_next (&items)) != NULL)
+    {
+      preload_value (registry, item, verbose);
+    }
+  }
+}
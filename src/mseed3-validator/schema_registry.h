@@ -0,0 +1,53 @@
+#ifndef __MSEED3VALIDATOR_SCHEMA_REGISTRY_H__
+#define __MSEED3VALIDATOR_SCHEMA_REGISTRY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wjelement.h>
+#include <yyjson.h>
+
+#include "report.h"
+
+struct schema_program_s;
+
+/* A referenced schema loaded from disk, keyed on its $ref name without the fragment,
+ * path is the file it was read from */
+struct schema_entry_s
+{
+    char *name;
+    char *path;
+    WJElement schema;
+    yyjson_doc *document;
+};
+
+/* JSON schema loaded once per run together with every schema it references,
+ * shared by all records and files validated against it.  Each schema is held
+ * both as a WJElement and as a yyjson document, walkable is false when a
+ * schema uses keywords only WJElement implements, named by unsupported.
+ * program is the compiled form of walkable schemas */
+struct schema_registry_s
+{
+    char *file_name;
+    char *directory;
+    struct report_s *report;
+    WJElement root;
+    yyjson_doc *document;
+    bool walkable;
+    const char *unsupported;
+    struct schema_program_s *program;
+    struct schema_entry_s *entries;
+    int entry_cnt;
+    int entry_alloc;
+};
+
+struct schema_registry_s *schema_registry_open(const char *schema_file_name, struct report_s *report, uint8_t verbose);
+
+void schema_registry_close(struct schema_registry_s *registry);
+
+WJElement schema_registry_load(const char *name, void *client, const char *file, const int line);
+
+void schema_registry_free(WJElement schema, void *client);
+
+yyjson_val *schema_registry_document(struct schema_registry_s *registry, const char *name, size_t name_len);
+
+#endif /* __MSEED3VALIDATOR_SCHEMA_REGISTRY_H__ */
@@ -0,0 +1,892 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <yyjson.h>
+
+#include "report.h"
+#include "schema_registry.h"
+#include "schema_walker.h"
+
+#define WALKER_PATH_SIZE 512u
+
+/* Keywords of draft-04 to draft-07 with a meaning for validation, any other
+ * member of a schema is an annotation such as description and is skipped.
+ * Schemas using an unsupported keyword are validated by WJElement instead */
+static const struct schema_keyword_s keywords[] = {{"definitions", SCHEMA_KW_DEFINITIONS},
+                                                   {"$defs", SCHEMA_KW_DEFINITIONS},
+                                                   {"type", SCHEMA_KW_TYPE},
+                                                   {"properties", SCHEMA_KW_PROPERTIES},
+                                                   {"additionalProperties", SCHEMA_KW_ADDITIONAL_PROPERTIES},
+                                                   {"required", SCHEMA_KW_REQUIRED},
+                                                   {"items", SCHEMA_KW_ITEMS},
+                                                   {"enum", SCHEMA_KW_ENUM},
+                                                   {"const", SCHEMA_KW_CONST},
+                                                   {"minimum", SCHEMA_KW_MINIMUM},
+                                                   {"maximum", SCHEMA_KW_MAXIMUM},
+                                                   {"exclusiveMinimum", SCHEMA_KW_EXCLUSIVE_MINIMUM},
+                                                   {"exclusiveMaximum", SCHEMA_KW_EXCLUSIVE_MAXIMUM},
+                                                   {"multipleOf", SCHEMA_KW_MULTIPLE_OF},
+                                                   {"minLength", SCHEMA_KW_MIN_LENGTH},
+                                                   {"maxLength", SCHEMA_KW_MAX_LENGTH},
+                                                   {"minItems", SCHEMA_KW_MIN_ITEMS},
+                                                   {"maxItems", SCHEMA_KW_MAX_ITEMS},
+                                                   {"uniqueItems", SCHEMA_KW_UNIQUE_ITEMS},
+                                                   {"minProperties", SCHEMA_KW_MIN_PROPERTIES},
+                                                   {"maxProperties", SCHEMA_KW_MAX_PROPERTIES},
+                                                   {"allOf", SCHEMA_KW_ALL_OF},
+                                                   {"anyOf", SCHEMA_KW_ANY_OF},
+                                                   {"oneOf", SCHEMA_KW_ONE_OF},
+                                                   {"not", SCHEMA_KW_NOT},
+                                                   {"format", SCHEMA_KW_FORMAT},
+                                                   {"pattern", SCHEMA_KW_UNSUPPORTED},
+                                                   {"patternProperties", SCHEMA_KW_UNSUPPORTED},
+                                                   {"additionalItems", SCHEMA_KW_UNSUPPORTED},
+                                                   {"dependencies", SCHEMA_KW_UNSUPPORTED},
+                                                   {"contains", SCHEMA_KW_UNSUPPORTED},
+                                                   {"propertyNames", SCHEMA_KW_UNSUPPORTED},
+                                                   {"if", SCHEMA_KW_UNSUPPORTED},
+                                                   {"then", SCHEMA_KW_UNSUPPORTED},
+                                                   {"else", SCHEMA_KW_UNSUPPORTED},
+                                                   {"divisibleBy", SCHEMA_KW_UNSUPPORTED},
+                                                   {"disallow", SCHEMA_KW_UNSUPPORTED},
+                                                   {"extends", SCHEMA_KW_UNSUPPORTED}};
+
+#define KEYWORD_CNT (sizeof (keywords) / sizeof (keywords[0]))
+
+/* State of one validation, errors are reported with the JSON pointer of the value in path */
+struct walker_s
+{
+  struct schema_registry_s *registry;
+  struct report_s *report;
+  char path[WALKER_PATH_SIZE];
+  size_t path_len;
+  uint32_t depth;
+  uint32_t quiet; /* inside anyOf, oneOf or not, where failing branches are not errors */
+};
+
+static bool validate_schema (struct walker_s *walker, yyjson_val *schema, yyjson_val *root, yyjson_val *instance);
+
+/*! @brief Look up the keyword of a schema member
+ *
+ *  @param[in] name member name, not NUL terminated
+ *  @param[in] name_len length of name
+ *
+ *  @return keyword, NULL for annotations such as description
+ */
+const struct schema_keyword_s *
+schema_keyword_lookup (const char *name, size_t name_len)
+{
+  for (size_t i = 0; i < KEYWORD_CNT; i++)
+  {
+    if (keywords[i].name[0] == name[0] && 0 == strncmp (keywords[i].name, name, name_len) &&
+        keywords[i].name[name_len] == '\0')
+    {
+      return &keywords[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Report a validation error at the current path, unless inside a branch that may fail */
+static void
+walker_error (struct walker_s *walker, const char *format, ...)
+{
+  char message[512];
+  va_list ap;
+
+  if (walker->quiet > 0)
+  {
+    return;
+  }
+
+  va_start (ap, format);
+  vsnprintf (message, sizeof (message), format, ap);
+  va_end (ap);
+
+  report_line (walker->report, REPORT_SCHEMA, REPORT_ERROR, "Error in Schema Validation- %s: %s",
+               (walker->path_len > 0) ? walker->path : "/", message);
+}
+
+/* Append an object member to the path, escaped as in RFC 6901, returns the length to restore */
+static size_t
+push_key (struct walker_s *walker, const char *key, size_t key_len)
+{
+  size_t restore = walker->path_len;
+  size_t length  = walker->path_len;
+
+  if (length + 1 < WALKER_PATH_SIZE)
+  {
+    walker->path[length++] = '/';
+  }
+
+  for (size_t i = 0; i < key_len && length + 2 < WALKER_PATH_SIZE; i++)
+  {
+    if (key[i] == '~' || key[i] == '/')
+    {
+      walker->path[length++] = '~';
+      walker->path[length++] = (key[i] == '~') ? '0' : '1';
+    }
+    else
+    {
+      walker->path[length++] = key[i];
+    }
+  }
+
+  walker->path[length] = '\0';
+  walker->path_len     = length;
+
+  return restore;
+}
+
+/* Append an array index to the path, returns the length to restore */
+static size_t
+push_index (struct walker_s *walker, size_t index)
+{
+  size_t restore = walker->path_len;
+  int written    = snprintf (walker->path + walker->path_len, WALKER_PATH_SIZE - walker->path_len, "/%zu", index);
+
+  if (written > 0)
+  {
+    walker->path_len += ((size_t)written < WALKER_PATH_SIZE - walker->path_len) ? (size_t)written
+                                                                               : WALKER_PATH_SIZE - walker->path_len - 1;
+  }
+
+  return restore;
+}
+
+/* Truncate the path to a length returned by push_key() or push_index() */
+static void
+pop_path (struct walker_s *walker, size_t restore)
+{
+  walker->path_len      = restore;
+  walker->path[restore] = '\0';
+}
+
+/*! @brief Name of the JSON type of a value as used by the type keyword
+ *
+ *  Integers are numbers without a fraction, whichever way they are written.
+ *
+ *  @param[in] value JSON value
+ */
+const char *
+schema_type_name (yyjson_val *value)
+{
+  switch (yyjson_get_type (value))
+  {
+  case YYJSON_TYPE_NULL:
+    return "null";
+  case YYJSON_TYPE_BOOL:
+    return "boolean";
+  case YYJSON_TYPE_NUM:
+    return (yyjson_is_int (value) || floor (yyjson_get_num (value)) == yyjson_get_num (value)) ? "integer" : "number";
+  case YYJSON_TYPE_STR:
+    return "string";
+  case YYJSON_TYPE_ARR:
+    return "array";
+  case YYJSON_TYPE_OBJ:
+    return "object";
+  default:
+    return "unknown";
+  }
+}
+
+/* Check an instance against a single type name */
+static bool
+type_matches (yyjson_val *instance, yyjson_val *type)
+{
+  if (yyjson_equals_str (type, "number"))
+  {
+    return yyjson_is_num (instance);
+  }
+  if (yyjson_equals_str (type, "integer"))
+  {
+    return yyjson_is_num (instance) && 0 == strcmp (schema_type_name (instance), "integer");
+  }
+  if (yyjson_equals_str (type, "any"))
+  {
+    return true;
+  }
+
+  return yyjson_equals_str (type, schema_type_name (instance));
+}
+
+/*! @brief Number of code points of a UTF-8 string, the unit of minLength and maxLength
+ *
+ *  @param[in] text string bytes
+ *  @param[in] length number of bytes
+ */
+size_t
+schema_utf8_length (const char *text, size_t length)
+{
+  size_t count = 0;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    count += (((uint8_t)text[i] & 0xC0) != 0x80);
+  }
+
+  return count;
+}
+
+/* Parse a fixed number of decimal digits */
+static bool
+parse_digits (const char *text, size_t count, int *value)
+{
+  *value = 0;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (text[i] < '0' || text[i] > '9')
+    {
+      return false;
+    }
+    *value = *value * 10 + (text[i] - '0');
+  }
+
+  return true;
+}
+
+/*! @brief Check a date-time as defined by RFC 3339 section 5.6
+ *
+ *  @param[in] text string bytes
+ *  @param[in] length number of bytes
+ *
+ *  @return true if text is a valid date-time
+ */
+bool
+schema_date_time (const char *text, size_t length)
+{
+  static const int month_days[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  int year, month, day, hour, minute, second;
+  size_t i = 19;
+
+  if (length < 20 || text[4] != '-' || text[7] != '-' || (text[10] != 'T' && text[10] != 't') || text[13] != ':' ||
+      text[16] != ':')
+  {
+    return false;
+  }
+
+  if (!parse_digits (text, 4, &year) || !parse_digits (text + 5, 2, &month) || !parse_digits (text + 8, 2, &day) ||
+      !parse_digits (text + 11, 2, &hour) || !parse_digits (text + 14, 2, &minute) ||
+      !parse_digits (text + 17, 2, &second))
+  {
+    return false;
+  }
+
+  if (month < 1 || month > 12 || day < 1 || day > month_days[month - 1] || hour > 23 || minute > 59 || second > 60)
+  {
+    return false;
+  }
+
+  if (month == 2 && day == 29 && !((year % 4 == 0 && year % 100 != 0) || year % 400 == 0))
+  {
+    return false;
+  }
+
+  if (text[i] == '.')
+  {
+    size_t digits = ++i;
+
+    while (i < length && text[i] >= '0' && text[i] <= '9')
+    {
+      i++;
+    }
+    if (i == digits)
+    {
+      return false;
+    }
+  }
+
+  if (i + 1 == length && (text[i] == 'Z' || text[i] == 'z'))
+  {
+    return true;
+  }
+
+  if (i + 6 == length && (text[i] == '+' || text[i] == '-') && text[i + 3] == ':' &&
+      parse_digits (text + i + 1, 2, &hour) && parse_digits (text + i + 4, 2, &minute))
+  {
+    return hour <= 23 && minute <= 59;
+  }
+
+  return false;
+}
+
+/* Validate every element of an array, or the elements matching the positions of a list of schemas */
+static bool
+validate_items (struct walker_s *walker, yyjson_val *items, yyjson_val *root, yyjson_val *instance)
+{
+  yyjson_arr_iter iter;
+  yyjson_val *element;
+  bool valid   = true;
+  size_t index = 0;
+
+  yyjson_arr_iter_init (instance, &iter);
+
+  while ((element = yyjson_arr_iter_next (&iter)) != NULL && (valid || walker->quiet == 0))
+  {
+    yyjson_val *schema = yyjson_is_arr (items) ? yyjson_arr_get (items, index) : items;
+
+    if (schema != NULL)
+    {
+      size_t restore = push_index (walker, index);
+
+      valid = validate_schema (walker, schema, root, element) && valid;
+      pop_path (walker, restore);
+    }
+    index++;
+  }
+
+  return valid;
+}
+
+/* Validate the members of an object named in properties, and the others against additionalProperties */
+static bool
+validate_members (struct walker_s *walker, yyjson_val *schema, yyjson_val *subschemas, bool additional,
+                  yyjson_val *root, yyjson_val *instance)
+{
+  yyjson_val *properties = additional ? yyjson_obj_get (schema, "properties") : subschemas;
+  yyjson_obj_iter iter;
+  yyjson_val *key;
+  bool valid = true;
+
+  yyjson_obj_iter_init (instance, &iter);
+
+  while ((key = yyjson_obj_iter_next (&iter)) != NULL && (valid || walker->quiet == 0))
+  {
+    yyjson_val *property = NULL;
+    size_t restore;
+
+    if (yyjson_is_obj (properties))
+    {
+      property = yyjson_obj_getn (properties, yyjson_get_str (key), yyjson_get_len (key));
+    }
+
+    if (additional == (property != NULL))
+    {
+      continue;
+    }
+
+    restore = push_key (walker, yyjson_get_str (key), yyjson_get_len (key));
+
+    if (!additional)
+    {
+      valid = validate_schema (walker, property, root, yyjson_obj_iter_get_val (key)) && valid;
+    }
+    else if (yyjson_is_false (subschemas))
+    {
+      walker_error (walker, "property is not allowed by the schema");
+      valid = false;
+    }
+    else
+    {
+      valid = validate_schema (walker, subschemas, root, yyjson_obj_iter_get_val (key)) && valid;
+    }
+
+    pop_path (walker, restore);
+  }
+
+  return valid;
+}
+
+/* Validate against the schemas of allOf, anyOf or oneOf, returns the number of matching schemas */
+static size_t
+validate_branches (struct walker_s *walker, yyjson_val *branches, bool quiet, yyjson_val *root, yyjson_val *instance)
+{
+  yyjson_arr_iter iter;
+  yyjson_val *branch;
+  size_t matches = 0;
+
+  walker->quiet += quiet;
+  yyjson_arr_iter_init (branches, &iter);
+
+  while ((branch = yyjson_arr_iter_next (&iter)) != NULL)
+  {
+    matches += validate_schema (walker, branch, root, instance);
+  }
+
+  walker->quiet -= quiet;
+
+  return matches;
+}
+
+/* Follow a $ref, either within the current document or to a schema loaded by the registry */
+static bool
+validate_ref (struct walker_s *walker, yyjson_val *ref, yyjson_val *root, yyjson_val *instance)
+{
+  const char *name     = yyjson_get_str (ref);
+  const char *fragment = memchr (name, '#', yyjson_get_len (ref));
+  yyjson_val *target;
+
+  if (fragment != name)
+  {
+    root = schema_registry_document (walker->registry, name,
+                                     (fragment != NULL) ? (size_t)(fragment - name) : yyjson_get_len (ref));
+  }
+
+  target = root;
+
+  if (root != NULL && fragment != NULL && fragment[1] != '\0')
+  {
+    target = yyjson_ptr_getn (root, fragment + 1, yyjson_get_len (ref) - (size_t)(fragment + 1 - name));
+  }
+
+  if (target == NULL)
+  {
+    walker_error (walker, "cannot resolve $ref %s", name);
+    return false;
+  }
+
+  return validate_schema (walker, target, root, instance);
+}
+
+/* Validate a value against one schema, root is the document the schema belongs to */
+static bool
+validate_schema (struct walker_s *walker, yyjson_val *schema, yyjson_val *root, yyjson_val *instance)
+{
+  yyjson_obj_iter iter;
+  yyjson_val *key;
+  yyjson_val *ref;
+  bool valid = true;
+
+  if (yyjson_is_bool (schema))
+  {
+    if (!yyjson_get_bool (schema))
+    {
+      walker_error (walker, "no value is allowed by the schema");
+    }
+    return yyjson_get_bool (schema);
+  }
+
+  if (!yyjson_is_obj (schema))
+  {
+    return true;
+  }
+
+  if (walker->depth >= SCHEMA_MAX_DEPTH)
+  {
+    walker_error (walker, "schema nested deeper than %u levels, possible $ref cycle", SCHEMA_MAX_DEPTH);
+    return false;
+  }
+
+  walker->depth++;
+
+  /* Members next to a $ref are ignored, as in draft-04 to draft-07 */
+  if ((ref = yyjson_obj_get (schema, "$ref")) != NULL && yyjson_is_str (ref))
+  {
+    valid = validate_ref (walker, ref, root, instance);
+    walker->depth--;
+    return valid;
+  }
+
+  yyjson_obj_iter_init (schema, &iter);
+
+  while ((key = yyjson_obj_iter_next (&iter)) != NULL && (valid || walker->quiet == 0))
+  {
+    const struct schema_keyword_s *keyword = schema_keyword_lookup (yyjson_get_str (key), yyjson_get_len (key));
+    yyjson_val *value                      = yyjson_obj_iter_get_val (key);
+    yyjson_val *sibling;
+    size_t matches;
+
+    if (keyword == NULL)
+    {
+      continue;
+    }
+
+    switch (keyword->keyword)
+    {
+    case SCHEMA_KW_TYPE:
+      if (yyjson_is_str (value) && !type_matches (instance, value))
+      {
+        walker_error (walker, "%s found, expected %s", schema_type_name (instance), yyjson_get_str (value));
+        valid = false;
+      }
+      else if (yyjson_is_arr (value))
+      {
+        yyjson_arr_iter types;
+        yyjson_val *type;
+        bool matched = false;
+
+        yyjson_arr_iter_init (value, &types);
+        while (!matched && (type = yyjson_arr_iter_next (&types)) != NULL)
+        {
+          matched = type_matches (instance, type);
+        }
+
+        if (!matched)
+        {
+          walker_error (walker, "%s found, not one of the allowed types", schema_type_name (instance));
+          valid = false;
+        }
+      }
+      break;
+    case SCHEMA_KW_PROPERTIES:
+    case SCHEMA_KW_ADDITIONAL_PROPERTIES:
+      if (yyjson_is_obj (instance))
+      {
+        valid = validate_members (walker, schema, value, keyword->keyword == SCHEMA_KW_ADDITIONAL_PROPERTIES, root,
+                                  instance) &&
+                valid;
+      }
+      break;
+    case SCHEMA_KW_REQUIRED:
+      if (yyjson_is_obj (instance) && yyjson_is_arr (value))
+      {
+        yyjson_arr_iter names;
+        yyjson_val *name;
+
+        yyjson_arr_iter_init (value, &names);
+        while ((name = yyjson_arr_iter_next (&names)) != NULL)
+        {
+          if (yyjson_is_str (name) && yyjson_obj_getn (instance, yyjson_get_str (name), yyjson_get_len (name)) == NULL)
+          {
+            walker_error (walker, "required property %s is missing", yyjson_get_str (name));
+            valid = false;
+          }
+        }
+      }
+      break;
+    case SCHEMA_KW_ITEMS:
+      if (yyjson_is_arr (instance))
+      {
+        valid = validate_items (walker, value, root, instance) && valid;
+      }
+      break;
+    case SCHEMA_KW_ENUM:
+      if (yyjson_is_arr (value))
+      {
+        yyjson_arr_iter members;
+        yyjson_val *member;
+        bool matched = false;
+
+        yyjson_arr_iter_init (value, &members);
+        while (!matched && (member = yyjson_arr_iter_next (&members)) != NULL)
+        {
+          matched = yyjson_equals (instance, member);
+        }
+
+        if (!matched)
+        {
+          walker_error (walker, "value is not one of the values of enum");
+          valid = false;
+        }
+      }
+      break;
+    case SCHEMA_KW_CONST:
+      if (!yyjson_equals (instance, value))
+      {
+        walker_error (walker, "value is not the value of const");
+        valid = false;
+      }
+      break;
+    case SCHEMA_KW_MINIMUM:
+      if (yyjson_is_num (instance) && yyjson_is_num (value))
+      {
+        /* draft-04 exclusiveMinimum is a boolean modifying minimum */
+        sibling        = yyjson_obj_get (schema, "exclusiveMinimum");
+        bool exclusive = yyjson_is_true (sibling);
+
+        if (yyjson_get_num (instance) < yyjson_get_num (value) ||
+            (exclusive && yyjson_get_num (instance) == yyjson_get_num (value)))
+        {
+          walker_error (walker, "%g is less than %sminimum %g", yyjson_get_num (instance),
+                        exclusive ? "or equal to exclusive " : "", yyjson_get_num (value));
+          valid = false;
+        }
+      }
+      break;
+    case SCHEMA_KW_MAXIMUM:
+      if (yyjson_is_num (instance) && yyjson_is_num (value))
+      {
+        sibling        = yyjson_obj_get (schema, "exclusiveMaximum");
+        bool exclusive = yyjson_is_true (sibling);
+
+        if (yyjson_get_num (instance) > yyjson_get_num (value) ||
+            (exclusive && yyjson_get_num (instance) == yyjson_get_num (value)))
+        {
+          walker_error (walker, "%g is greater than %smaximum %g", yyjson_get_num (instance),
+                        exclusive ? "or equal to exclusive " : "", yyjson_get_num (value));
+          valid = false;
+        }
+      }
+      break;
+    case SCHEMA_KW_EXCLUSIVE_MINIMUM:
+      /* draft-06 and later, a number of its own */
+      if (yyjson_is_num (instance) && yyjson_is_num (value) && yyjson_get_num (instance) <= yyjson_get_num (value))
+      {
+        walker_error (walker, "%g is less than or equal to exclusive minimum %g", yyjson_get_num (instance),
+                      yyjson_get_num (value));
+        valid = false;
+      }
+      break;
+    case SCHEMA_KW_EXCLUSIVE_MAXIMUM:
+      if (yyjson_is_num (instance) && yyjson_is_num (value) && yyjson_get_num (instance) >= yyjson_get_num (value))
+      {
+        walker_error (walker, "%g is greater than or equal to exclusive maximum %g", yyjson_get_num (instance),
+                      yyjson_get_num (value));
+        valid = false;
+      }
+      break;
+    case SCHEMA_KW_MULTIPLE_OF:
+      if (yyjson_is_num (instance) && yyjson_is_num (value) && yyjson_get_num (value) > 0)
+      {
+        double quotient = yyjson_get_num (instance) / yyjson_get_num (value);
+
+        if (fabs (quotient - nearbyint (quotient)) > 1e-9 * fmax (1.0, fabs (quotient)))
+        {
+          walker_error (walker, "%g is not a multiple of %g", yyjson_get_num (instance), yyjson_get_num (value));
+          valid = false;
+        }
+      }
+      break;
+    case SCHEMA_KW_MIN_LENGTH:
+    case SCHEMA_KW_MAX_LENGTH:
+      if (yyjson_is_str (instance) && yyjson_is_num (value))
+      {
+        size_t length = schema_utf8_length (yyjson_get_str (instance), yyjson_get_len (instance));
+
+        if ((keyword->keyword == SCHEMA_KW_MIN_LENGTH) ? (double)length < yyjson_get_num (value)
+                                                : (double)length > yyjson_get_num (value))
+        {
+          walker_error (walker, "string of %zu characters, %s %g", length, keyword->name, yyjson_get_num (value));
+          valid = false;
+        }
+      }
+      break;
+    case SCHEMA_KW_MIN_ITEMS:
+    case SCHEMA_KW_MAX_ITEMS:
+    case SCHEMA_KW_MIN_PROPERTIES:
+    case SCHEMA_KW_MAX_PROPERTIES:
+      if (((keyword->keyword == SCHEMA_KW_MIN_ITEMS || keyword->keyword == SCHEMA_KW_MAX_ITEMS) ? yyjson_is_arr (instance)
+                                                                                   : yyjson_is_obj (instance)) &&
+          yyjson_is_num (value))
+      {
+        size_t size = yyjson_get_len (instance);
+        bool minimum = (keyword->keyword == SCHEMA_KW_MIN_ITEMS || keyword->keyword == SCHEMA_KW_MIN_PROPERTIES);
+
+        if (minimum ? (double)size < yyjson_get_num (value) : (double)size > yyjson_get_num (value))
+        {
+          walker_error (walker, "%zu %s, %s %g", size, yyjson_is_arr (instance) ? "items" : "properties",
+                        keyword->name, yyjson_get_num (value));
+          valid = false;
+        }
+      }
+      break;
+    case SCHEMA_KW_UNIQUE_ITEMS:
+      if (yyjson_is_arr (instance) && yyjson_is_true (value))
+      {
+        size_t size = yyjson_arr_size (instance);
+        bool unique = true;
+
+        for (size_t i = 0; i < size && unique; i++)
+        {
+          for (size_t j = i + 1; j < size && unique; j++)
+          {
+            if (yyjson_equals (yyjson_arr_get (instance, i), yyjson_arr_get (instance, j)))
+            {
+              walker_error (walker, "items %zu and %zu are equal, uniqueItems", i, j);
+              unique = false;
+            }
+          }
+        }
+        valid = unique && valid;
+      }
+      break;
+    case SCHEMA_KW_ALL_OF:
+      if (yyjson_is_arr (value) && validate_branches (walker, value, false, root, instance) != yyjson_arr_size (value))
+      {
+        valid = false;
+      }
+      break;
+    case SCHEMA_KW_ANY_OF:
+      if (yyjson_is_arr (value) && validate_branches (walker, value, true, root, instance) == 0)
+      {
+        walker_error (walker, "value matches none of the schemas of anyOf");
+        valid = false;
+      }
+      break;
+    case SCHEMA_KW_ONE_OF:
+      if (yyjson_is_arr (value) && (matches = validate_branches (walker, value, true, root, instance)) != 1)
+      {
+        walker_error (walker, "value matches %zu of the schemas of oneOf, expected exactly one", matches);
+        valid = false;
+      }
+      break;
+    case SCHEMA_KW_NOT:
+      walker->quiet++;
+      matches = validate_schema (walker, value, root, instance);
+      walker->quiet--;
+
+      if (matches)
+      {
+        walker_error (walker, "value matches the schema of not");
+        valid = false;
+      }
+      break;
+    case SCHEMA_KW_FORMAT:
+      /* Other formats are annotations, as draft-07 allows */
+      if (yyjson_is_str (instance) && yyjson_equals_str (value, "date-time") &&
+          !schema_date_time (yyjson_get_str (instance), yyjson_get_len (instance)))
+      {
+        walker_error (walker, "\"%.64s\" is not an RFC 3339 date-time", yyjson_get_str (instance));
+        valid = false;
+      }
+      break;
+    case SCHEMA_KW_DEFINITIONS:
+    case SCHEMA_KW_UNSUPPORTED:
+      break;
+    }
+  }
+
+  walker->depth--;
+
+  return valid;
+}
+
+/*! @brief Check that the walker implements every keyword a schema uses
+ *
+ *  Subschemas are checked recursively, schemas reached through an external
+ *  "$ref" are checked when the registry loads them.
+ *
+ *  @param[in] schema schema document or subschema
+ *  @param[out] keyword first keyword that is not supported
+ *
+ *  @return true if extra headers can be validated by schema_walker_validate()
+ */
+bool
+schema_walker_supported (yyjson_val *schema, const char **keyword)
+{
+  yyjson_obj_iter iter;
+  yyjson_val *key;
+
+  if (!yyjson_is_obj (schema))
+  {
+    return true;
+  }
+
+  yyjson_obj_iter_init (schema, &iter);
+
+  while ((key = yyjson_obj_iter_next (&iter)) != NULL)
+  {
+    const struct schema_keyword_s *known = schema_keyword_lookup (yyjson_get_str (key), yyjson_get_len (key));
+    yyjson_val *value                    = yyjson_obj_iter_get_val (key);
+    yyjson_val *member;
+    bool supported = true;
+
+    if (known == NULL)
+    {
+      continue;
+    }
+
+    switch (known->keyword)
+    {
+    case SCHEMA_KW_UNSUPPORTED:
+      supported = false;
+      break;
+    case SCHEMA_KW_TYPE:
+    case SCHEMA_KW_REQUIRED:
+      /* draft-03 schemas in type lists, and required as a boolean of each property */
+      if (yyjson_is_arr (value))
+      {
+        yyjson_arr_iter members;
+
+        yyjson_arr_iter_init (value, &members);
+        while (supported && (member = yyjson_arr_iter_next (&members)) != NULL)
+        {
+          supported = yyjson_is_str (member);
+        }
+      }
+      else
+      {
+        supported = yyjson_is_str (value) && known->keyword == SCHEMA_KW_TYPE;
+      }
+      break;
+    case SCHEMA_KW_DEFINITIONS:
+    case SCHEMA_KW_PROPERTIES:
+      if (yyjson_is_obj (value))
+      {
+        yyjson_obj_iter members;
+        yyjson_val *name;
+
+        yyjson_obj_iter_init (value, &members);
+        while (supported && (name = yyjson_obj_iter_next (&members)) != NULL)
+        {
+          supported = schema_walker_supported (yyjson_obj_iter_get_val (name), keyword);
+        }
+        if (!supported)
+        {
+          return false;
+        }
+      }
+      break;
+    case SCHEMA_KW_ITEMS:
+    case SCHEMA_KW_ALL_OF:
+    case SCHEMA_KW_ANY_OF:
+    case SCHEMA_KW_ONE_OF:
+      if (yyjson_is_arr (value))
+      {
+        yyjson_arr_iter members;
+
+        yyjson_arr_iter_init (value, &members);
+        while (supported && (member = yyjson_arr_iter_next (&members)) != NULL)
+        {
+          supported = schema_walker_supported (member, keyword);
+        }
+        if (!supported)
+        {
+          return false;
+        }
+        break;
+      }
+      /* fall through, items may be a single schema */
+    case SCHEMA_KW_ADDITIONAL_PROPERTIES:
+    case SCHEMA_KW_NOT:
+      if (!schema_walker_supported (value, keyword))
+      {
+        return false;
+      }
+      break;
+    default:
+      break;
+    }
+
+    if (!supported)
+    {
+      *keyword = known->name;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*! @brief Validate a parsed extra header against the schemas of a registry
+ *
+ *  Every error is reported with the JSON pointer of the offending value,
+ *  except within anyOf, oneOf and not, where only the outcome is reported.
+ *
+ *  @param[in] registry schemas loaded by schema_registry_open(), whose documents are walkable
+ *  @param[in] report sink errors are reported to
+ *  @param[in] instance root of the extra header document
+ *
+ *  @return true if the extra header is valid
+ */
+bool
+schema_walker_validate (struct schema_registry_s *registry, struct report_s *report, yyjson_val *instance)
+{
+  struct walker_s walker;
+  yyjson_val *root = yyjson_doc_get_root (registry->document);
+
+  walker.registry = registry;
+  walker.report   = report;
+  walker.path[0]  = '\0';
+  walker.path_len = 0;
+  walker.depth    = 0;
+  walker.quiet    = 0;
+
+  return validate_schema (&walker, root, root, instance);
+}
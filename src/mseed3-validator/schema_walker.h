@@ -0,0 +1,62 @@
+#ifndef __MSEED3VALIDATOR_SCHEMA_WALKER_H__
+#define __MSEED3VALIDATOR_SCHEMA_WALKER_H__
+
+#include <stdbool.h>
+#include <yyjson.h>
+
+#include "report.h"
+#include "schema_registry.h"
+
+/* Deepest nesting of subschemas and $refs followed, guards against reference cycles */
+#define SCHEMA_MAX_DEPTH 64u
+
+/* JSON Schema keywords known to the walker */
+enum schema_keyword_e
+{
+    SCHEMA_KW_UNSUPPORTED = 0,
+    SCHEMA_KW_DEFINITIONS,
+    SCHEMA_KW_TYPE,
+    SCHEMA_KW_PROPERTIES,
+    SCHEMA_KW_ADDITIONAL_PROPERTIES,
+    SCHEMA_KW_REQUIRED,
+    SCHEMA_KW_ITEMS,
+    SCHEMA_KW_ENUM,
+    SCHEMA_KW_CONST,
+    SCHEMA_KW_MINIMUM,
+    SCHEMA_KW_MAXIMUM,
+    SCHEMA_KW_EXCLUSIVE_MINIMUM,
+    SCHEMA_KW_EXCLUSIVE_MAXIMUM,
+    SCHEMA_KW_MULTIPLE_OF,
+    SCHEMA_KW_MIN_LENGTH,
+    SCHEMA_KW_MAX_LENGTH,
+    SCHEMA_KW_MIN_ITEMS,
+    SCHEMA_KW_MAX_ITEMS,
+    SCHEMA_KW_UNIQUE_ITEMS,
+    SCHEMA_KW_MIN_PROPERTIES,
+    SCHEMA_KW_MAX_PROPERTIES,
+    SCHEMA_KW_ALL_OF,
+    SCHEMA_KW_ANY_OF,
+    SCHEMA_KW_ONE_OF,
+    SCHEMA_KW_NOT,
+    SCHEMA_KW_FORMAT
+};
+
+struct schema_keyword_s
+{
+    const char *name;
+    enum schema_keyword_e keyword;
+};
+
+const struct schema_keyword_s *schema_keyword_lookup(const char *name, size_t name_len);
+
+const char *schema_type_name(yyjson_val *value);
+
+size_t schema_utf8_length(const char *text, size_t length);
+
+bool schema_date_time(const char *text, size_t length);
+
+bool schema_walker_supported(yyjson_val *schema, const char **keyword);
+
+bool schema_walker_validate(struct schema_registry_s *registry, struct report_s *report, yyjson_val *instance);
+
+#endif /* __MSEED3VALIDATOR_SCHEMA_WALKER_H__ */
@@ -0,0 +1,72 @@
+# Checks the verdicts of mseed3-validator on compressed files and compressed records piped to it,
+# decompressed on a worker thread.  Formats the validator was built without, or that no compressor
+# is found for, are skipped
+#
+# cmake -DVALIDATOR=<mseed3-validator> -DSOURCE=<source tree> -DWORK=<scratch directory>
+#       -DHAVE_ZLIB=<ON|OFF> -DHAVE_LIBLZMA=<ON|OFF> -DHAVE_ZSTD=<ON|OFF> -P compressed_input.cmake
+
+INCLUDE(${CMAKE_CURRENT_LIST_DIR}/functions.cmake)
+
+SET(DATA ${SOURCE}/share/reference_datasets)
+
+FILE(REMOVE_RECURSE ${WORK})
+FILE(MAKE_DIRECTORY ${WORK})
+
+# Three records and the same cut off within the last one
+EXECUTE_PROCESS(COMMAND cat ${DATA}/reference-baseline-record-sinusoid-steim1.xseed
+        ${DATA}/reference-baseline-record-sinusoid-steim2.xseed
+        ${DATA}/reference-baseline-record-sinusoid_int32.xseed
+        OUTPUT_FILE ${WORK}/records.xseed)
+cut_off(${WORK}/records.xseed 2500 ${WORK}/truncated.xseed)
+
+SET(FORMATS)
+IF (HAVE_ZLIB)
+    LIST(APPEND FORMATS gzip:gz)
+ENDIF ()
+IF (HAVE_LIBLZMA)
+    LIST(APPEND FORMATS xz:xz)
+ENDIF ()
+IF (HAVE_ZSTD)
+    LIST(APPEND FORMATS zstd:zst)
+ENDIF ()
+
+FOREACH (entry IN LISTS FORMATS)
+    STRING(REPLACE ":" ";" entry ${entry})
+    LIST(GET entry 0 format)
+    LIST(GET entry 1 extension)
+
+    FIND_PROGRAM(${format}_PROGRAM ${format})
+    IF (NOT ${format}_PROGRAM)
+        MESSAGE(STATUS "No ${format} program found, ${format} input is not checked")
+        CONTINUE()
+    ENDIF ()
+
+    FOREACH (name records truncated)
+        EXECUTE_PROCESS(COMMAND ${${format}_PROGRAM} -c ${WORK}/${name}.xseed
+                OUTPUT_FILE ${WORK}/${name}.xseed.${extension})
+    ENDFOREACH ()
+
+    # Compressed data ending before the end of its stream, every compressed file is larger
+    cut_off(${WORK}/records.xseed.${extension} 1200 ${WORK}/cut.xseed.${extension})
+
+    run_validator(output status -v ${WORK}/records.xseed.${extension})
+    expect_verdict("${output}" "${status}" TRUE "${format}")
+    expect("${output}" "3 record(s) processed in 1 file(s)" "${format}")
+    pipe_validator(output status ${WORK}/records.xseed.${extension})
+    expect_verdict("${output}" "${status}" TRUE "${format} piped")
+    expect("${output}" "3 record(s) processed in 1 file(s)" "${format} piped")
+
+    run_validator(output status -v ${WORK}/truncated.xseed.${extension})
+    expect_verdict("${output}" "${status}" FALSE "${format} truncated")
+    expect("${output}" "Record: 2 --- File size mismatch" "${format} truncated")
+    pipe_validator(output status ${WORK}/truncated.xseed.${extension})
+    expect_verdict("${output}" "${status}" FALSE "${format} truncated piped")
+    expect("${output}" "Record: 2 --- File size mismatch" "${format} truncated piped")
+
+    run_validator(output status -v ${WORK}/cut.xseed.${extension})
+    expect_verdict("${output}" "${status}" FALSE "${format} cut")
+    expect("${output}" "corrupt ${format} compressed data" "${format} cut")
+    pipe_validator(output status ${WORK}/cut.xseed.${extension})
+    expect_verdict("${output}" "${status}" FALSE "${format} cut piped")
+    expect("${output}" "corrupt ${format} compressed data" "${format} cut piped")
+ENDFOREACH ()
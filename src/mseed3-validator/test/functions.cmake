@@ -0,0 +1,59 @@
+# Functions shared by the mseed3-validator test scripts, VALIDATOR is the program tested
+
+# Run the validator on the arguments, output and exit status in the variables named by out and status
+FUNCTION(run_validator out status)
+    EXECUTE_PROCESS(COMMAND ${VALIDATOR} ${ARGN}
+            OUTPUT_VARIABLE output ERROR_VARIABLE output RESULT_VARIABLE result)
+    SET(${out} "${output}" PARENT_SCOPE)
+    SET(${status} "${result}" PARENT_SCOPE)
+ENDFUNCTION()
+
+# Same for a file piped to the validator as -
+FUNCTION(pipe_validator out status file)
+    EXECUTE_PROCESS(COMMAND sh -c "cat '${file}' | '${VALIDATOR}' -v -"
+            OUTPUT_VARIABLE output ERROR_VARIABLE output RESULT_VARIABLE result)
+    SET(${out} "${output}" PARENT_SCOPE)
+    SET(${status} "${result}" PARENT_SCOPE)
+ENDFUNCTION()
+
+FUNCTION(expect output text step)
+    STRING(FIND "${output}" "${text}" at)
+    IF (at EQUAL -1)
+        MESSAGE(FATAL_ERROR "${step}: expected \"${text}\" in\n${output}")
+    ENDIF ()
+ENDFUNCTION()
+
+FUNCTION(reject output text step)
+    STRING(FIND "${output}" "${text}" at)
+    IF (NOT at EQUAL -1)
+        MESSAGE(FATAL_ERROR "${step}: unexpected \"${text}\" in\n${output}")
+    ENDIF ()
+ENDFUNCTION()
+
+# Check the verdict of a run on one file, printed with -v, and the exit status that goes with it
+FUNCTION(expect_verdict output status valid step)
+    IF (valid)
+        expect("${output}" "is VALID miniSEED 3" "${step}")
+        reject("${output}" "is **NOT** VALID" "${step}")
+        IF (NOT status EQUAL 0)
+            MESSAGE(FATAL_ERROR "${step}: exit status ${status} for a valid file in\n${output}")
+        ENDIF ()
+    ELSE ()
+        expect("${output}" "is **NOT** VALID miniSEED 3" "${step}")
+        IF (status EQUAL 0)
+            MESSAGE(FATAL_ERROR "${step}: exit status 0 for an invalid file in\n${output}")
+        ENDIF ()
+    ENDIF ()
+ENDFUNCTION()
+
+# Copy source to target with the byte at offset replaced by an X
+FUNCTION(damage source offset target)
+    MATH(EXPR after "${offset} + 2")
+    EXECUTE_PROCESS(COMMAND sh -c "head -c ${offset} '${source}'; printf X; tail -c +${after} '${source}'"
+            OUTPUT_FILE ${target})
+ENDFUNCTION()
+
+# Copy the first length bytes of source to target
+FUNCTION(cut_off source length target)
+    EXECUTE_PROCESS(COMMAND head -c ${length} ${source} OUTPUT_FILE ${target})
+ENDFUNCTION()
@@ -0,0 +1,45 @@
+# Checks that what libmseed logs at -vvv stays within the report of the file it is about
+#
+# cmake -DVALIDATOR=<mseed3-validator> -DSOURCE=<source tree> -P output_order.cmake
+
+SET(DATA ${SOURCE}/share/reference_datasets)
+
+# Payloads libmseed unpacks itself, Steim payloads are verified in place
+SET(FILES ${DATA}/reference-baseline-record-sinusoid_int32.xseed ${DATA}/reference-baseline-record-sinusoid-flt32.xseed)
+
+EXECUTE_PROCESS(COMMAND ${VALIDATOR} -vvv ${FILES}
+        OUTPUT_VARIABLE output ERROR_VARIABLE output RESULT_VARIABLE result)
+
+IF (NOT result EQUAL 0)
+    MESSAGE(FATAL_ERROR "validation failed:\n${output}")
+ENDIF ()
+
+# Every line between two files, and after the last one, is part of the summary
+STRING(REPLACE ";" "\\;" lines "${output}")
+STRING(REPLACE "\n" ";" lines "${lines}")
+SET(in_file FALSE)
+SET(files_seen 0)
+
+FOREACH (line IN LISTS lines)
+    IF (line MATCHES "^Reading file ")
+        SET(in_file TRUE)
+        MATH(EXPR files_seen "${files_seen} + 1")
+    ELSEIF (line MATCHES "^mseed3-validator RESULT - file ")
+        SET(in_file FALSE)
+    ELSEIF (NOT in_file AND NOT line STREQUAL "" AND NOT line MATCHES "^-+$"
+            AND NOT line MATCHES "^mseed3-validator COMPLETE")
+        MESSAGE(FATAL_ERROR "\"${line}\" is outside the report of any file in\n${output}")
+    ENDIF ()
+ENDFOREACH ()
+
+IF (NOT files_seen EQUAL 2)
+    MESSAGE(FATAL_ERROR "expected the report of 2 files in\n${output}")
+ENDIF ()
+
+# The summary comes last
+STRING(FIND "${output}" "mseed3-validator COMPLETE" at)
+STRING(SUBSTRING "${output}" ${at} -1 tail)
+STRING(STRIP "${tail}" tail)
+IF (tail MATCHES "\n")
+    MESSAGE(FATAL_ERROR "output after the summary in\n${output}")
+ENDIF ()
@@ -0,0 +1,57 @@
+# Checks the verdicts of mseed3-validator -W resync and -W split-records on clean and damaged records
+#
+# cmake -DVALIDATOR=<mseed3-validator> -DSOURCE=<source tree> -DWORK=<scratch directory> -P record_modes.cmake
+
+INCLUDE(${CMAKE_CURRENT_LIST_DIR}/functions.cmake)
+
+SET(DATA ${SOURCE}/share/reference_datasets)
+
+FILE(REMOVE_RECURSE ${WORK})
+FILE(MAKE_DIRECTORY ${WORK})
+
+# Three records, the second one from byte 956 on
+EXECUTE_PROCESS(COMMAND cat ${DATA}/reference-baseline-record-sinusoid-steim1.xseed
+        ${DATA}/reference-baseline-record-sinusoid-steim2.xseed
+        ${DATA}/reference-baseline-record-sinusoid_int32.xseed
+        OUTPUT_FILE ${WORK}/records.xseed)
+
+# A payload byte of the second record, the data length in its fixed header, and the last record cut off
+damage(${WORK}/records.xseed 1856 ${WORK}/payload.xseed)
+damage(${WORK}/records.xseed 993 ${WORK}/length.xseed)
+cut_off(${WORK}/records.xseed 2500 ${WORK}/truncated.xseed)
+
+run_validator(output status -v -W resync ${WORK}/records.xseed)
+expect_verdict("${output}" "${status}" TRUE "resync clean")
+reject("${output}" "Resynchronized" "resync clean")
+
+run_validator(output status -v ${WORK}/length.xseed)
+expect_verdict("${output}" "${status}" FALSE "damaged length")
+expect("${output}" "2 record(s) processed" "damaged length")
+
+run_validator(output status -v -W resync ${WORK}/length.xseed)
+expect_verdict("${output}" "${status}" FALSE "resync damaged length")
+expect("${output}" "Record: 1 --- Resynchronized at offset 1912, skipped 956 damaged byte(s)" "resync damaged length")
+expect("${output}" "3 record(s) processed" "resync damaged length")
+
+run_validator(output status -v -W resync ${WORK}/truncated.xseed)
+expect_verdict("${output}" "${status}" FALSE "resync truncated")
+expect("${output}" "No intact record found in the last 588 byte(s) of the file" "resync truncated")
+
+run_validator(output status -vvv -W split-records -J 2 ${WORK}/records.xseed)
+expect_verdict("${output}" "${status}" TRUE "split clean")
+expect("${output}" "Found 3 record(s), validating with 2 worker(s)" "split clean")
+
+run_validator(output status -v -W split-records -J 2 ${WORK}/payload.xseed)
+expect_verdict("${output}" "${status}" FALSE "split damaged payload")
+expect("${output}" "Record: 1 --- CRC mismatch" "split damaged payload")
+reject("${output}" "Record: 2 ---" "split damaged payload")
+
+run_validator(output status -v -W split-records -J 2 ${WORK}/truncated.xseed)
+expect_verdict("${output}" "${status}" FALSE "split truncated")
+expect("${output}" "Record: 2 --- File size mismatch" "split truncated")
+
+run_validator(output status -v -W split-records,resync -J 2 ${WORK}/length.xseed)
+expect_verdict("${output}" "${status}" FALSE "split resync damaged length")
+expect("${output}" "Record: 1 --- Resynchronized at offset 1912, skipped 956 damaged byte(s)"
+        "split resync damaged length")
+expect("${output}" "3 record(s) processed" "split resync damaged length")
@@ -0,0 +1,69 @@
+# Checks the verdicts of mseed3-validator -F ndjson and -W cap on clean and damaged records
+#
+# cmake -DVALIDATOR=<mseed3-validator> -DSOURCE=<source tree> -DWORK=<scratch directory> -P report_formats.cmake
+
+INCLUDE(${CMAKE_CURRENT_LIST_DIR}/functions.cmake)
+
+SET(DATA ${SOURCE}/share/reference_datasets)
+
+# Every line of ndjson output is one JSON object
+FUNCTION(expect_ndjson output step)
+    STRING(REPLACE ";" "\\;" lines "${output}")
+    STRING(REPLACE "\n" ";" lines "${lines}")
+
+    FOREACH (line IN LISTS lines)
+        IF (NOT line STREQUAL "" AND NOT line MATCHES "^{\"(file|check)\":.*\"message\":\".*\"}$")
+            MESSAGE(FATAL_ERROR "${step}: \"${line}\" is not an event in\n${output}")
+        ENDIF ()
+    ENDFOREACH ()
+ENDFUNCTION()
+
+FILE(REMOVE_RECURSE ${WORK})
+FILE(MAKE_DIRECTORY ${WORK})
+
+# Three records, starting at bytes 0, 956 and 1912
+EXECUTE_PROCESS(COMMAND cat ${DATA}/reference-baseline-record-sinusoid-steim1.xseed
+        ${DATA}/reference-baseline-record-sinusoid-steim2.xseed
+        ${DATA}/reference-baseline-record-sinusoid_int32.xseed
+        OUTPUT_FILE ${WORK}/records.xseed)
+
+# A payload byte of the second record, of every record, and the last record cut off
+damage(${WORK}/records.xseed 1856 ${WORK}/payload.xseed)
+damage(${WORK}/records.xseed 900 ${WORK}/first.xseed)
+damage(${WORK}/first.xseed 1856 ${WORK}/second.xseed)
+damage(${WORK}/second.xseed 2812 ${WORK}/every.xseed)
+cut_off(${WORK}/records.xseed 2500 ${WORK}/truncated.xseed)
+
+run_validator(output status -v -F ndjson ${WORK}/records.xseed)
+expect_ndjson("${output}" "ndjson clean")
+expect_verdict("${output}" "${status}" TRUE "ndjson clean")
+
+run_validator(output status -v -F ndjson ${WORK}/payload.xseed)
+expect_ndjson("${output}" "ndjson damaged payload")
+expect_verdict("${output}" "${status}" FALSE "ndjson damaged payload")
+expect("${output}" "\"record\":1,\"offset\":956,\"check\":\"crc\",\"severity\":\"error\"" "ndjson damaged payload")
+
+run_validator(output status -v -F ndjson ${WORK}/truncated.xseed)
+expect_ndjson("${output}" "ndjson truncated")
+expect_verdict("${output}" "${status}" FALSE "ndjson truncated")
+expect("${output}" "\"record\":2,\"offset\":1912,\"check\":\"file\",\"severity\":\"fatal\"" "ndjson truncated")
+
+run_validator(output status -v -W cap=1 ${WORK}/records.xseed)
+expect_verdict("${output}" "${status}" TRUE "cap clean")
+reject("${output}" "suppressed" "cap clean")
+
+run_validator(output status -v ${WORK}/every.xseed)
+expect_verdict("${output}" "${status}" FALSE "uncapped")
+expect("${output}" "Record: 2 --- CRC mismatch" "uncapped")
+
+run_validator(output status -v -W cap=1 ${WORK}/every.xseed)
+expect_verdict("${output}" "${status}" FALSE "cap")
+expect("${output}" "Record: 0 --- CRC mismatch" "cap")
+reject("${output}" "Record: 2 --- CRC mismatch" "cap")
+expect("${output}" "2 further crc message(s) suppressed after the first 1" "cap")
+expect("${output}" "FAILED to validate 1 file(s)" "cap")
+
+run_validator(output status -v -W cap=1 -F ndjson ${WORK}/every.xseed)
+expect_ndjson("${output}" "ndjson cap")
+expect_verdict("${output}" "${status}" FALSE "ndjson cap")
+expect("${output}" "\"check\":\"crc\",\"severity\":\"info\",\"message\":\"2 further crc message(s) suppressed" "ndjson cap")
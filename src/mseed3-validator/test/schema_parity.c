@@ -0,0 +1,138 @@
+/* Checks that the compiled schema program, the schema walker and WJElement give the same verdict on the
+ * same extra headers
+ *
+ * schema_parity <test directory> */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <mseed3-validator/report.h>
+#include <mseed3-validator/schema_registry.h>
+#include <mseed3-validator/validator.h>
+#include <mseed3-validator/warnings.h>
+
+/* Extra headers validated against schema_parity.schema.json and schema_parity_walker.schema.json */
+struct sample_s
+{
+  const char *what;
+  const char *extra_headers;
+  bool valid;
+};
+
+static const struct sample_s samples[] = {
+    {"required keys only", "{\"FDSN\":{\"Time\":{\"Quality\":100}}}", true},
+    {"every key", "{\"FDSN\":{\"Time\":{\"Quality\":0,\"Exception\":\"2022-06-05T20:32:38.123456Z\"},"
+                  "\"Event\":{\"Type\":\"MURDOCK\"}}}", true},
+    {"wrong type", "{\"FDSN\":{\"Time\":{\"Quality\":\"100\"}}}", false},
+    {"missing required key", "{\"FDSN\":{\"Event\":{\"Type\":\"GENERIC\"}}}", false},
+    {"out-of-range value", "{\"FDSN\":{\"Time\":{\"Quality\":101}}}", false},
+    {"enum miss", "{\"FDSN\":{\"Time\":{\"Quality\":50},\"Event\":{\"Type\":\"LOCAL\"}}}", false},
+    {"bad date-time", "{\"FDSN\":{\"Time\":{\"Quality\":50,\"Exception\":\"June 5, 2022\"}}}", false},
+};
+
+#define SAMPLE_CNT (sizeof (samples) / sizeof (samples[0]))
+
+/* Schema engine, selected with -W json= and by what the schema needs.  The
+ * walker validates schemas with a $ref no program can be compiled for,
+ * compiled only applies to yyjson */
+struct engine_s
+{
+  const char *name;
+  const char *schema_file;
+  bool wjelement;
+  bool compiled;
+};
+
+static const struct engine_s engines[] = {
+    {"program", "schema_parity.schema.json", false, true},
+    {"walker", "schema_parity_walker.schema.json", false, false},
+    {"wjelement", "schema_parity.schema.json", true, false},
+};
+
+#define ENGINE_CNT (sizeof (engines) / sizeof (engines[0]))
+
+/* Counts the errors reported for an extra header */
+static void
+count_error (void *client, enum report_check_e check, enum report_severity_e severity, const char *message)
+{
+  if (severity >= REPORT_ERROR)
+  {
+    (*(uint32_t *)client)++;
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  struct schema_registry_s *schemas[ENGINE_CNT];
+  struct report_s report;
+  uint32_t errors = 0;
+  char path[4096];
+  int failures = 0;
+
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: %s <test directory>\n", argv[0]);
+    return 2;
+  }
+
+  report_collect (&report, 0, count_error, &errors);
+
+  for (size_t e = 0; e < ENGINE_CNT; e++)
+  {
+    snprintf (path, sizeof (path), "%s/%s", argv[1], engines[e].schema_file);
+
+    if ((schemas[e] = schema_registry_open (path, &report, 0)) == NULL)
+    {
+      fprintf (stderr, "Cannot open %s\n", path);
+      return 2;
+    }
+
+    /* The engine a yyjson schema runs on depends on the schema alone */
+    if (!engines[e].wjelement && (!schemas[e]->walkable || (schemas[e]->program != NULL) != engines[e].compiled))
+    {
+      fprintf (stderr, "%s: %s is %s\n", engines[e].name, path,
+               !schemas[e]->walkable ? "not walkable" : engines[e].compiled ? "not compiled" : "compiled");
+      failures++;
+    }
+  }
+
+  for (size_t s = 0; s < SAMPLE_CNT; s++)
+  {
+    for (size_t e = 0; e < ENGINE_CNT; e++)
+    {
+      struct extra_options_s options = {0};
+      struct validator_context_s *context;
+      bool valid;
+
+      options.wjelement = engines[e].wjelement;
+
+      if ((context = validator_context_open (&options, schemas[e], &report, 0)) == NULL)
+      {
+        fprintf (stderr, "Cannot open a validation context\n");
+        return 2;
+      }
+
+      errors = 0;
+      valid  = check_extra_headers_schema (context, samples[s].extra_headers,
+                                           (uint16_t)strlen (samples[s].extra_headers));
+      validator_context_close (context);
+
+      if (valid != samples[s].valid || (errors == 0) != valid)
+      {
+        fprintf (stderr, "%s: %s found %s with %u error(s), expected %s\n", samples[s].what, engines[e].name,
+                 valid ? "valid" : "invalid", errors, samples[s].valid ? "valid" : "invalid");
+        failures++;
+      }
+    }
+  }
+
+  for (size_t e = 0; e < ENGINE_CNT; e++)
+  {
+    schema_registry_close (schemas[e]);
+  }
+
+  return (failures == 0) ? 0 : 1;
+}
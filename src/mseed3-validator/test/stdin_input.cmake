@@ -0,0 +1,30 @@
+# Checks the verdicts of mseed3-validator - on records piped to it, read front to back without seeking
+#
+# cmake -DVALIDATOR=<mseed3-validator> -DSOURCE=<source tree> -DWORK=<scratch directory> -P stdin_input.cmake
+
+INCLUDE(${CMAKE_CURRENT_LIST_DIR}/functions.cmake)
+
+SET(DATA ${SOURCE}/share/reference_datasets)
+
+FILE(REMOVE_RECURSE ${WORK})
+FILE(MAKE_DIRECTORY ${WORK})
+
+# Three records, the second one from byte 956 on
+EXECUTE_PROCESS(COMMAND cat ${DATA}/reference-baseline-record-sinusoid-steim1.xseed
+        ${DATA}/reference-baseline-record-sinusoid-steim2.xseed
+        ${DATA}/reference-baseline-record-sinusoid_int32.xseed
+        OUTPUT_FILE ${WORK}/records.xseed)
+
+pipe_validator(output status ${WORK}/records.xseed)
+expect_verdict("${output}" "${status}" TRUE "clean")
+expect("${output}" "3 record(s) processed in 1 file(s)" "clean")
+
+damage(${WORK}/records.xseed 1856 ${WORK}/damaged.xseed)
+pipe_validator(output status ${WORK}/damaged.xseed)
+expect_verdict("${output}" "${status}" FALSE "damaged")
+expect("${output}" "Record: 1 --- CRC mismatch" "damaged")
+
+cut_off(${WORK}/records.xseed 2500 ${WORK}/truncated.xseed)
+pipe_validator(output status ${WORK}/truncated.xseed)
+expect_verdict("${output}" "${status}" FALSE "truncated")
+expect("${output}" "Record: 2 --- File size mismatch" "truncated")
@@ -0,0 +1,184 @@
+/* Checks the per-record results of mseed3_validate_buffer() through the shared libmseed3-validate
+ *
+ * validate_buffer <reference dataset directory> */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mseed3-validator/mseed3_validator.h>
+
+/* Records concatenated into the buffer, the one marked damaged gets its last payload byte changed */
+struct buffer_record_s
+{
+  const char *file_name;
+  bool damaged;
+  uint64_t offset;
+  uint64_t length;
+};
+
+static struct buffer_record_s records[] = {
+    {"reference-baseline-record-sinusoid-steim1.xseed", false, 0, 0},
+    {"reference-baseline-record-sinusoid-steim2.xseed", false, 0, 0},
+    {"reference-baseline-record-sinusoid_int32.xseed", true, 0, 0},
+    {"reference-baseline-record-sinusoid-flt32.xseed", false, 0, 0},
+};
+
+#define RECORD_CNT (sizeof (records) / sizeof (records[0]))
+
+static int failures = 0;
+
+static void
+expect (bool condition, const char *what, uint32_t record)
+{
+  if (!condition)
+  {
+    fprintf (stderr, "record %u: expected %s\n", record, what);
+    failures++;
+  }
+}
+
+/* Append a reference record to the buffer, returning the new buffer or NULL */
+static char *
+append_record (char *buffer, uint64_t *length, const char *directory, struct buffer_record_s *record)
+{
+  char path[4096];
+  FILE *file;
+  long size;
+
+  snprintf (path, sizeof (path), "%s/%s", directory, record->file_name);
+
+  if ((file = fopen (path, "rb")) == NULL || fseek (file, 0, SEEK_END) != 0 || (size = ftell (file)) <= 0)
+  {
+    fprintf (stderr, "Cannot read %s\n", path);
+    return NULL;
+  }
+
+  rewind (file);
+  buffer = (char *)realloc (buffer, *length + size);
+
+  if (buffer == NULL || fread (buffer + *length, 1, size, file) != (size_t)size)
+  {
+    fprintf (stderr, "Cannot read %s\n", path);
+    fclose (file);
+    return NULL;
+  }
+  fclose (file);
+
+  record->offset = *length;
+  record->length = size;
+  *length += size;
+
+  if (record->damaged)
+  {
+    buffer[*length - 1] ^= 0x01;
+  }
+
+  return buffer;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct mseed3_validator_options_s options = {0};
+  struct mseed3_validation_report_s report  = {0};
+  struct mseed3_validator_s *validator;
+  char *buffer    = NULL;
+  uint64_t length = 0;
+  struct stat output;
+  FILE *capture_out;
+  FILE *capture_err;
+  int saved_stdout;
+  int saved_stderr;
+
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: %s <reference dataset directory>\n", argv[0]);
+    return 2;
+  }
+
+  for (size_t i = 0; i < RECORD_CNT; i++)
+  {
+    if ((buffer = append_record (buffer, &length, argv[1], &records[i])) == NULL)
+    {
+      return 2;
+    }
+  }
+
+  /* Anything the library prints lands in the capture files instead of stdout and stderr */
+  fflush (stdout);
+  fflush (stderr);
+  saved_stdout = dup (STDOUT_FILENO);
+  saved_stderr = dup (STDERR_FILENO);
+  capture_out  = tmpfile ();
+  capture_err  = tmpfile ();
+
+  if (capture_out == NULL || capture_err == NULL || saved_stdout < 0 || saved_stderr < 0 ||
+      dup2 (fileno (capture_out), STDOUT_FILENO) < 0 || dup2 (fileno (capture_err), STDERR_FILENO) < 0)
+  {
+    fprintf (stderr, "Cannot capture stdout and stderr\n");
+    return 2;
+  }
+
+  if (mseed3_validator_open (&validator, &options) != MSEED3_VALIDATOR_OK)
+  {
+    dprintf (saved_stderr, "Cannot open a validator\n");
+    return 2;
+  }
+
+  /* The second call reuses the results of the first */
+  for (int run = 0; run < 2; run++)
+  {
+    if (mseed3_validate_buffer (validator, buffer, length, &report) != MSEED3_VALIDATOR_OK)
+    {
+      dprintf (saved_stderr, "Validation ran out of memory\n");
+      return 2;
+    }
+  }
+
+  fflush (stdout);
+  fflush (stderr);
+  dup2 (saved_stdout, STDOUT_FILENO);
+  dup2 (saved_stderr, STDERR_FILENO);
+  close (saved_stdout);
+  close (saved_stderr);
+
+  expect (!report.valid, "an invalid buffer", MSEED3_NO_RECORD_INDEX);
+  expect (report.record_cnt == RECORD_CNT, "one result per record", MSEED3_NO_RECORD_INDEX);
+
+  for (uint32_t i = 0; i < report.record_cnt && i < RECORD_CNT; i++)
+  {
+    const struct mseed3_record_result_s *result = &report.records[i];
+    bool crc_error                              = false;
+
+    expect (result->offset == records[i].offset, "the offset of the record", i);
+    expect (result->length == records[i].length, "the length of the record", i);
+    expect (result->valid == !records[i].damaged, records[i].damaged ? "invalid" : "valid", i);
+    expect (result->first_event + result->event_cnt <= report.event_cnt, "events within the report", i);
+
+    for (uint32_t e = result->first_event; e < result->first_event + result->event_cnt && e < report.event_cnt; e++)
+    {
+      expect (report.events[e].record == i, "events of the record only", i);
+      crc_error |= report.events[e].check == MSEED3_CHECK_CRC && report.events[e].severity >= MSEED3_SEVERITY_ERROR;
+    }
+
+    expect (crc_error == records[i].damaged, records[i].damaged ? "a CRC error" : "no CRC error", i);
+  }
+
+  expect (fstat (fileno (capture_out), &output) == 0 && output.st_size == 0, "nothing written to stdout",
+          MSEED3_NO_RECORD_INDEX);
+  expect (fstat (fileno (capture_err), &output) == 0 && output.st_size == 0, "nothing written to stderr",
+          MSEED3_NO_RECORD_INDEX);
+
+  fclose (capture_out);
+  fclose (capture_err);
+  mseed3_validation_report_free (&report);
+  mseed3_validator_close (validator);
+  free (buffer);
+
+  return (failures == 0) ? 0 : 1;
+}
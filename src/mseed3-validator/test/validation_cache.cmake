@@ -0,0 +1,101 @@
+# Checks the verdict cache of mseed3-validator -c across runs
+#
+# cmake -DVALIDATOR=<mseed3-validator> -DSOURCE=<source tree> -DWORK=<scratch directory> -P validation_cache.cmake
+
+SET(DATA ${SOURCE}/share/reference_datasets)
+SET(CACHE_FILE ${WORK}/cache)
+
+# Run the validator on the arguments with the cache, output in the variable named by out
+FUNCTION(run_validator out)
+    EXECUTE_PROCESS(COMMAND ${VALIDATOR} -vv -c ${CACHE_FILE} ${ARGN}
+            OUTPUT_VARIABLE output ERROR_VARIABLE output RESULT_VARIABLE result)
+    SET(${out} "${output}" PARENT_SCOPE)
+ENDFUNCTION()
+
+FUNCTION(expect output text step)
+    STRING(FIND "${output}" "${text}" at)
+    IF (at EQUAL -1)
+        MESSAGE(FATAL_ERROR "${step}: expected \"${text}\" in\n${output}")
+    ENDIF ()
+ENDFUNCTION()
+
+FUNCTION(reject output text step)
+    STRING(FIND "${output}" "${text}" at)
+    IF (NOT at EQUAL -1)
+        MESSAGE(FATAL_ERROR "${step}: unexpected \"${text}\" in\n${output}")
+    ENDIF ()
+ENDFUNCTION()
+
+FILE(REMOVE_RECURSE ${WORK})
+FILE(MAKE_DIRECTORY ${WORK})
+
+# Three records in one file
+EXECUTE_PROCESS(COMMAND cat ${DATA}/reference-baseline-record-sinusoid-steim1.xseed
+        ${DATA}/reference-baseline-record-sinusoid-steim2.xseed
+        ${DATA}/reference-baseline-record-sinusoid_int32.xseed
+        OUTPUT_FILE ${WORK}/records.xseed)
+
+run_validator(output ${WORK}/records.xseed)
+expect("${output}" "is VALID" "first run")
+reject("${output}" "unchanged since its last validation" "first run")
+
+run_validator(output ${WORK}/records.xseed)
+expect("${output}" "unchanged since its last validation" "unchanged file")
+
+# Same content under a new inode and modification time
+FILE(RENAME ${WORK}/records.xseed ${WORK}/records.old)
+EXECUTE_PROCESS(COMMAND cat ${WORK}/records.old OUTPUT_FILE ${WORK}/records.xseed)
+run_validator(output ${WORK}/records.xseed)
+expect("${output}" "unchanged since its last validation" "copied file")
+
+# Same size, different content
+EXECUTE_PROCESS(COMMAND cat ${DATA}/reference-baseline-record-sinusoid-steim2.xseed
+        ${DATA}/reference-baseline-record-sinusoid-steim1.xseed
+        ${DATA}/reference-baseline-record-sinusoid_int32.xseed
+        OUTPUT_FILE ${WORK}/records.xseed)
+run_validator(output ${WORK}/records.xseed)
+reject("${output}" "unchanged since its last validation" "changed file")
+
+# A run interrupted before writing the cache leaves its verdicts in the journal
+FILE(RENAME ${CACHE_FILE} ${CACHE_FILE}.journal)
+run_validator(output ${WORK}/records.xseed)
+expect("${output}" "Resuming an interrupted run, 1 file(s) already validated" "journal")
+expect("${output}" "unchanged since its last validation" "journal")
+IF (EXISTS ${CACHE_FILE}.journal OR NOT EXISTS ${CACHE_FILE})
+    MESSAGE(FATAL_ERROR "journal: not merged into the cache")
+ENDIF ()
+
+# Appended records are checked on their own, also after a cut-off last record
+SET(RECORD ${DATA}/reference-baseline-record-sinusoid-steim1.xseed)
+EXECUTE_PROCESS(COMMAND cat ${RECORD} ${DATA}/reference-baseline-record-sinusoid-steim2.xseed
+        OUTPUT_FILE ${WORK}/grow.xseed)
+run_validator(output ${WORK}/grow.xseed)
+expect("${output}" "is VALID" "grow")
+
+EXECUTE_PROCESS(COMMAND sh -c "cat '${DATA}/reference-baseline-record-sinusoid_int32.xseed' >> '${WORK}/grow.xseed'")
+EXECUTE_PROCESS(COMMAND sh -c "head -c 100 '${RECORD}' >> '${WORK}/grow.xseed'")
+run_validator(output ${WORK}/grow.xseed -v)
+expect("${output}" "Skipping 2 record(s) validated before, checking 2160 appended byte(s)" "appended")
+reject("${output}" "verification for record: 1 ---" "appended")
+expect("${output}" "verification for record: 2 ---" "appended")
+expect("${output}" "is **NOT** VALID" "appended")
+
+EXECUTE_PROCESS(COMMAND sh -c "tail -c +101 '${RECORD}' >> '${WORK}/grow.xseed'")
+run_validator(output ${WORK}/grow.xseed -v)
+expect("${output}" "Skipping 3 record(s) validated before, checking 956 appended byte(s)" "completed")
+reject("${output}" "verification for record: 2 ---" "completed")
+expect("${output}" "is VALID" "completed")
+
+# Editing a schema referenced by the root schema invalidates the verdicts
+FILE(COPY ${SOURCE}/share/json_schemas DESTINATION ${WORK})
+SET(SCHEMA ${WORK}/json_schemas/all-schemas.github.json)
+EXECUTE_PROCESS(COMMAND cat ${DATA}/reference-baseline-record-sinusoid-steim2_EH-FDSN-Full.xseed
+        OUTPUT_FILE ${WORK}/headers.xseed)
+
+run_validator(output ${WORK}/headers.xseed -j ${SCHEMA})
+run_validator(output ${WORK}/headers.xseed -j ${SCHEMA})
+expect("${output}" "unchanged since its last validation" "schema")
+
+FILE(APPEND ${WORK}/json_schemas/ExtraHeaders-OperatorXYZ.schema.json "\n")
+run_validator(output ${WORK}/headers.xseed -j ${SCHEMA})
+reject("${output}" "unchanged since its last validation" "referenced schema")
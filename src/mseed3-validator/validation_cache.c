@@ -0,0 +1,598 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mseed3-common/array.h>
+#include <mseed3-common/constants.h>
+#include <mseed3-common/hash.h>
+
+#include "schema_registry.h"
+#include "validation_cache.h"
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(WIN64) && !defined(_WIN64)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define CACHE_HAVE_FILE_ID 1
+#if defined(__APPLE__)
+#define CACHE_MTIME_NSEC(info) ((info).st_mtimespec.tv_nsec)
+#else
+#define CACHE_MTIME_NSEC(info) ((info).st_mtim.tv_nsec)
+#endif
+#endif
+
+/* First line of a cache file, changes whenever the meaning of a verdict does */
+#define CACHE_MAGIC "# mseed3-validator cache 2"
+
+/* Suffix of the journal a run appends its verdicts to, next to the cache */
+#define CACHE_JOURNAL_SUFFIX ".journal"
+
+/* Suffix of the new cache while it is written, renamed over the cache when complete */
+#define CACHE_TEMPORARY_SUFFIX ".tmp"
+
+/* Longest line kept, path included */
+#define CACHE_LINE_LEN 8192
+
+static uint64_t
+hash_path (const char *path)
+{
+  return mseed3_hash64 (path, strlen (path), 0);
+}
+
+/* Rebuild the path index for at least count entries, keeping it at most half full */
+static bool
+grow_slots (struct validation_cache_s *cache, size_t count)
+{
+  size_t slot_cnt = 64;
+  uint32_t *slots;
+
+  while (slot_cnt < count * 2)
+  {
+    slot_cnt *= 2;
+  }
+
+  if (slot_cnt <= cache->slot_cnt)
+  {
+    return true;
+  }
+
+  if ((slots = (uint32_t *)calloc (slot_cnt, sizeof (uint32_t))) == NULL)
+  {
+    return false;
+  }
+
+  for (int i = 0; i < cache->entry_cnt; i++)
+  {
+    size_t slot = (size_t)hash_path (cache->entries[i].path) & (slot_cnt - 1);
+
+    while (slots[slot] != 0)
+    {
+      slot = (slot + 1) & (slot_cnt - 1);
+    }
+    slots[slot] = (uint32_t)i + 1;
+  }
+
+  free (cache->slots);
+  cache->slots    = slots;
+  cache->slot_cnt = slot_cnt;
+
+  return true;
+}
+
+/* Slot holding path, or the empty slot where it belongs */
+static size_t
+find_slot (const struct validation_cache_s *cache, const char *path)
+{
+  size_t slot = (size_t)hash_path (path) & (cache->slot_cnt - 1);
+
+  while (cache->slots[slot] != 0 && 0 != strcmp (cache->entries[cache->slots[slot] - 1].path, path))
+  {
+    slot = (slot + 1) & (cache->slot_cnt - 1);
+  }
+
+  return slot;
+}
+
+/* Add an entry or replace the one with the same path, taking ownership of its path */
+static bool
+store_entry (struct validation_cache_s *cache, struct cache_entry_s *entry)
+{
+  size_t slot;
+
+  if (!grow_slots (cache, (size_t)cache->entry_cnt + 1))
+  {
+    return false;
+  }
+
+  slot = find_slot (cache, entry->path);
+
+  if (cache->slots[slot] != 0)
+  {
+    struct cache_entry_s *old = &cache->entries[cache->slots[slot] - 1];
+
+    free (old->path);
+    *old = *entry;
+    return true;
+  }
+
+  /* Grow a copy, expand_array() loses the pointer on failure and the entries and slots so far stay valid */
+  if (cache->entry_cnt >= cache->entry_alloc)
+  {
+    struct cache_entry_s *entries = cache->entries;
+    int len                       = expand_array ((void **)&entries, cache->entry_alloc, sizeof (struct cache_entry_s));
+
+    if (len < 0)
+    {
+      return false;
+    }
+    cache->entries     = entries;
+    cache->entry_alloc = len;
+  }
+
+  cache->entries[cache->entry_cnt++] = *entry;
+  cache->slots[slot]                 = (uint32_t)cache->entry_cnt;
+
+  return true;
+}
+
+/* Parse one line,
+ * "V|I records device inode size mtime_ns content_hash schema_hash valid_records valid_length valid_hash path" */
+static bool
+parse_entry (char *line, struct cache_entry_s *entry)
+{
+  char verdict;
+  int path_at = 0;
+  size_t len  = strlen (line);
+
+  if (len == 0 || line[len - 1] != '\n')
+  {
+    /* Incomplete last line of an interrupted write */
+    return false;
+  }
+  line[len - 1] = '\0';
+
+  if (11 != sscanf (line,
+                    "%c %" SCNu32 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNd64 " %" SCNx64 " %" SCNx64 " %" SCNu32
+                    " %" SCNu64 " %" SCNx64 " %n",
+                    &verdict, &entry->records, &entry->device, &entry->inode, &entry->size, &entry->mtime_ns,
+                    &entry->content_hash, &entry->schema_hash, &entry->valid_records, &entry->valid_length,
+                    &entry->valid_hash, &path_at) ||
+      path_at == 0 || line[path_at] == '\0' || (verdict != 'V' && verdict != 'I'))
+  {
+    return false;
+  }
+
+  entry->valid = (verdict == 'V');
+  entry->path  = strdup (line + path_at);
+
+  return entry->path != NULL;
+}
+
+/* Format one line, 0 if the path cannot be stored */
+static int
+format_entry (char *line, size_t size, const struct cache_entry_s *entry)
+{
+  int len;
+
+  if (strchr (entry->path, '\n') != NULL)
+  {
+    return 0;
+  }
+
+  len = snprintf (line, size, "%c %" PRIu32 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRId64 " %016" PRIx64
+                  " %016" PRIx64 " %" PRIu32 " %" PRIu64 " %016" PRIx64 " %s\n",
+                  entry->valid ? 'V' : 'I', entry->records, entry->device, entry->inode, entry->size,
+                  entry->mtime_ns, entry->content_hash, entry->schema_hash, entry->valid_records, entry->valid_length,
+                  entry->valid_hash, entry->path);
+
+  return (len > 0 && (size_t)len < size) ? len : 0;
+}
+
+/* Load the entries of a cache or journal file, later lines replace earlier ones */
+static uint32_t
+load_entries (struct validation_cache_s *cache, const char *path, bool journal)
+{
+  char line[CACHE_LINE_LEN];
+  uint32_t loaded = 0;
+  FILE *file;
+
+  if ((file = fopen (path, "r")) == NULL)
+  {
+    return 0;
+  }
+
+  if (!journal && (fgets (line, sizeof (line), file) == NULL || 0 != strncmp (line, CACHE_MAGIC, strlen (CACHE_MAGIC))))
+  {
+    /* Not a cache, or one written by a version with different checks */
+    fclose (file);
+    return 0;
+  }
+
+  while (fgets (line, sizeof (line), file) != NULL)
+  {
+    struct cache_entry_s entry;
+
+    if (line[0] == '#' || !parse_entry (line, &entry))
+    {
+      continue;
+    }
+
+    if (!store_entry (cache, &entry))
+    {
+      free (entry.path);
+      break;
+    }
+    loaded++;
+  }
+
+  fclose (file);
+
+  return loaded;
+}
+
+static char *
+join_path (const char *path, const char *suffix)
+{
+  size_t len   = strlen (path) + strlen (suffix) + 1;
+  char *joined = (char *)malloc (len);
+
+  if (joined != NULL)
+  {
+    snprintf (joined, len, "%s%s", path, suffix);
+  }
+
+  return joined;
+}
+
+/* Add the bytes of a schema file to a hash, a file that cannot be read adds nothing */
+static void
+hash_schema_file (struct mseed3_hash64_s *state, const char *path)
+{
+  char buffer[4096];
+  size_t len;
+  FILE *file;
+
+  if (path == NULL || (file = fopen (path, "rb")) == NULL)
+  {
+    return;
+  }
+
+  while ((len = fread (buffer, 1, sizeof (buffer), file)) > 0)
+  {
+    mseed3_hash64_update (state, buffer, len);
+  }
+  fclose (file);
+}
+
+/*! @brief Hash of everything besides the file itself that a verdict depends on
+ *
+ *  Covers every JSON schema document the registry loaded, the root one and
+ *  each one it references, and the options that change which checks run,
+ *  so a verdict is only reused under the configuration that produced it.
+ *
+ *  @param[in] schema registry loaded by schema_registry_open(), or NULL
+ *  @param[in] options extra options of the run
+ *
+ *  @return hash stored with each verdict
+ */
+uint64_t
+validation_cache_config_hash (const struct schema_registry_s *schema, const struct extra_options_s *options)
+{
+  struct mseed3_hash64_s state;
+  uint8_t flags = (options->skip_payload ? 1 : 0) | (options->wjelement ? 2 : 0);
+
+  mseed3_hash64_reset (&state, 0);
+  mseed3_hash64_update (&state, CACHE_MAGIC, strlen (CACHE_MAGIC));
+  mseed3_hash64_update (&state, &flags, sizeof (flags));
+
+  if (schema != NULL)
+  {
+    hash_schema_file (&state, schema->file_name);
+
+    /* Referenced documents by name as well, so a $ref pointing elsewhere changes the hash */
+    for (int i = 0; i < schema->entry_cnt; i++)
+    {
+      mseed3_hash64_update (&state, schema->entries[i].name, strlen (schema->entries[i].name) + 1);
+      hash_schema_file (&state, schema->entries[i].path);
+    }
+  }
+
+  return mseed3_hash64_digest (&state);
+}
+
+/*! @brief Load a cache and the journal of an interrupted run, and start a new journal
+ *
+ *  A missing cache is not an error, it is created when the run completes.
+ *
+ *  @param[out] cache cache to open
+ *  @param[in] path cache file name
+ *  @param[in] schema_hash configuration of this run, see validation_cache_config_hash()
+ *
+ *  @return 0 on success, negative error code if the journal cannot be written
+ */
+int
+validation_cache_open (struct validation_cache_s *cache, const char *path, uint64_t schema_hash)
+{
+  memset (cache, 0, sizeof (struct validation_cache_s));
+  cache->journal_fd  = -1;
+  cache->schema_hash = schema_hash;
+
+  if ((cache->path = strdup (path)) == NULL || (cache->journal_path = join_path (path, CACHE_JOURNAL_SUFFIX)) == NULL ||
+      !grow_slots (cache, 1))
+  {
+    return MSEED3_MALLOC_ERROR;
+  }
+
+  load_entries (cache, cache->path, false);
+  cache->resumed = load_entries (cache, cache->journal_path, true);
+
+#ifdef CACHE_HAVE_FILE_ID
+  /* Appended to by every worker, one write per verdict */
+  cache->journal_fd = open (cache->journal_path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+
+  if (cache->journal_fd < 0)
+  {
+    return MSEED3_WRITE_ERROR;
+  }
+#endif
+
+  return 0;
+}
+
+/*! @brief Fill in the identity of an open file
+ *
+ *  @param[in] file open file pointer
+ *  @param[in] file_name name the file was opened with, referenced by the entry
+ *  @param[out] entry entry to fill, content hash and verdict are left 0
+ *
+ *  @return 0 on success, MSEED3_BAD_INPUT if the file has no stable identity
+ */
+int
+validation_cache_identify (FILE *file, const char *file_name, struct cache_entry_s *entry)
+{
+  memset (entry, 0, sizeof (struct cache_entry_s));
+  entry->path = (char *)file_name;
+
+#ifdef CACHE_HAVE_FILE_ID
+  struct stat info;
+
+  if (fstat (fileno (file), &info) != 0 || !S_ISREG (info.st_mode))
+  {
+    return MSEED3_BAD_INPUT;
+  }
+
+  entry->device   = (uint64_t)info.st_dev;
+  entry->inode    = (uint64_t)info.st_ino;
+  entry->size     = (uint64_t)info.st_size;
+  entry->mtime_ns = (int64_t)info.st_mtime * 1000000000 + (int64_t)CACHE_MTIME_NSEC (info);
+
+  return 0;
+#else
+  (void)file;
+  return MSEED3_BAD_INPUT;
+#endif
+}
+
+/* Copy the verdict and the stored hashes of a cached entry */
+static void
+copy_verdict (struct cache_entry_s *entry, const struct cache_entry_s *cached)
+{
+  entry->content_hash  = cached->content_hash;
+  entry->records       = cached->records;
+  entry->valid         = cached->valid;
+  entry->valid_length  = cached->valid_length;
+  entry->valid_records = cached->valid_records;
+  entry->valid_hash    = cached->valid_hash;
+}
+
+/*! @brief Look up the verdict of an unchanged or appended file
+ *
+ *  A file whose device, inode, size and modification time all match is
+ *  unchanged.  Otherwise a file with an entry is hashed.  When its first
+ *  valid_length bytes still hash to the complete records found valid
+ *  before, only the bytes after them need checking, e.g. records appended
+ *  to a real-time file or a cut-off last record completed.  A file of the
+ *  same size and content is unchanged too, e.g. after a copy or a touch.
+ *  A file without an entry is not read here, its hashes are computed while
+ *  it is validated, see check_file().
+ *
+ *  @param[in] cache open cache
+ *  @param[in] file open file, identified with validation_cache_identify(), rewound on return
+ *  @param[in,out] entry identity of the file, verdict and records filled in when found
+ *
+ *  @return CACHE_UNCHANGED, CACHE_APPENDED or CACHE_MISS
+ */
+enum cache_lookup_e
+validation_cache_lookup (const struct validation_cache_s *cache, FILE *file, struct cache_entry_s *entry)
+{
+  const struct cache_entry_s *cached = NULL;
+  size_t slot                        = find_slot (cache, entry->path);
+  bool resumable;
+  struct mseed3_hash64_s state;
+
+  if (cache->slots[slot] == 0)
+  {
+    return CACHE_MISS;
+  }
+
+  cached = &cache->entries[cache->slots[slot] - 1];
+
+  if (cached->schema_hash != cache->schema_hash)
+  {
+    return CACHE_MISS;
+  }
+
+  if (cached->size == entry->size && cached->device == entry->device && cached->inode == entry->inode &&
+      cached->mtime_ns == entry->mtime_ns)
+  {
+    copy_verdict (entry, cached);
+    return CACHE_UNCHANGED;
+  }
+
+  /* Only a file of the same size, or one still holding the valid records, can reuse anything */
+  resumable = (cached->valid_length > 0 && cached->valid_length <= entry->size);
+
+  if (cached->size != entry->size && !resumable)
+  {
+    return CACHE_MISS;
+  }
+
+  mseed3_hash64_reset (&state, 0);
+  rewind (file);
+
+  if (resumable && (mseed3_hash64_file (file, cached->valid_length, &state) < 0 ||
+                    mseed3_hash64_digest (&state) != cached->valid_hash))
+  {
+    rewind (file);
+    return CACHE_MISS;
+  }
+
+  entry->valid_state = state;
+
+  /* Continue with the rest of a file of the same size, otherwise the state hashes the valid records only */
+  if (cached->size == entry->size)
+  {
+    uint64_t rest = entry->size - (resumable ? cached->valid_length : 0);
+
+    if (mseed3_hash64_file (file, rest, &state) == 0 && mseed3_hash64_digest (&state) == cached->content_hash)
+    {
+      rewind (file);
+      copy_verdict (entry, cached);
+      return CACHE_UNCHANGED;
+    }
+  }
+
+  rewind (file);
+
+  if (!resumable)
+  {
+    return CACHE_MISS;
+  }
+
+  entry->valid_length  = cached->valid_length;
+  entry->valid_records = cached->valid_records;
+
+  return CACHE_APPENDED;
+}
+
+/*! @brief Append the verdict on a file to the journal, safe to call from workers
+ *
+ *  @param[in] cache open cache
+ *  @param[in] entry identity, content hash and verdict of the file
+ *
+ */
+void
+validation_cache_record (struct validation_cache_s *cache, const struct cache_entry_s *entry)
+{
+  struct cache_entry_s stored = *entry;
+  char line[CACHE_LINE_LEN];
+  int len;
+
+  if (cache->journal_fd < 0)
+  {
+    return;
+  }
+
+  stored.schema_hash = cache->schema_hash;
+
+  /* A single O_APPEND write, lines of concurrent workers never interleave */
+  if ((len = format_entry (line, sizeof (line), &stored)) > 0)
+  {
+#ifdef CACHE_HAVE_FILE_ID
+    if (write (cache->journal_fd, line, (size_t)len) != len)
+    {
+      return;
+    }
+#endif
+  }
+}
+
+/*! @brief Merge the journal of this run into the cache and release it
+ *
+ *  The new cache is written to a temporary file and renamed over the old
+ *  one.  The journal is only removed once the cache is safely written, so an
+ *  interrupted or failed run is resumed from it.
+ *
+ *  @param[in,out] cache open cache
+ *
+ *  @return 0 on success, MSEED3_WRITE_ERROR if the cache cannot be written
+ */
+int
+validation_cache_close (struct validation_cache_s *cache)
+{
+  char line[CACHE_LINE_LEN];
+  char *temporary_path = NULL;
+  FILE *file           = NULL;
+  int rv               = 0;
+
+  if (cache->journal_fd >= 0)
+  {
+#ifdef CACHE_HAVE_FILE_ID
+    close (cache->journal_fd);
+#endif
+    cache->journal_fd = -1;
+
+    load_entries (cache, cache->journal_path, true);
+
+    if ((temporary_path = join_path (cache->path, CACHE_TEMPORARY_SUFFIX)) == NULL ||
+        (file = fopen (temporary_path, "w")) == NULL)
+    {
+      rv = MSEED3_WRITE_ERROR;
+    }
+    else
+    {
+      fprintf (file, "%s\n", CACHE_MAGIC);
+
+      for (int i = 0; i < cache->entry_cnt; i++)
+      {
+        int len = format_entry (line, sizeof (line), &cache->entries[i]);
+
+        if (len > 0)
+        {
+          fwrite (line, 1, (size_t)len, file);
+        }
+      }
+
+      if (fflush (file) != 0 || ferror (file))
+      {
+        rv = MSEED3_WRITE_ERROR;
+      }
+#ifdef CACHE_HAVE_FILE_ID
+      else if (fsync (fileno (file)) != 0)
+      {
+        rv = MSEED3_WRITE_ERROR;
+      }
+#endif
+
+      if (fclose (file) != 0 || rv < 0 || rename (temporary_path, cache->path) != 0)
+      {
+        remove (temporary_path);
+        rv = MSEED3_WRITE_ERROR;
+      }
+      else
+      {
+        remove (cache->journal_path);
+      }
+    }
+  }
+
+  for (int i = 0; i < cache->entry_cnt; i++)
+  {
+    free (cache->entries[i].path);
+  }
+
+  free (temporary_path);
+  free (cache->entries);
+  free (cache->slots);
+  free (cache->path);
+  free (cache->journal_path);
+  memset (cache, 0, sizeof (struct validation_cache_s));
+  cache->journal_fd = -1;
+
+  return rv;
+}
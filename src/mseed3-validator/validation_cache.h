@@ -0,0 +1,78 @@
+#ifndef __MSEED3VALIDATOR_VALIDATION_CACHE_H__
+#define __MSEED3VALIDATOR_VALIDATION_CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <mseed3-common/hash.h>
+
+#include "warnings.h"
+
+struct schema_registry_s;
+
+/* Identity and verdict of one validated file.  The first valid_length
+ * bytes hold valid_records complete records found valid, whatever follows */
+struct cache_entry_s
+{
+    char *path;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+    uint64_t content_hash;
+    uint64_t schema_hash;
+    uint32_t records;
+    bool valid;
+    uint64_t valid_length;
+    uint32_t valid_records;
+    uint64_t valid_hash;
+
+    /* Set by validation_cache_lookup() for an appended file, not stored.
+     * The state after hashing the first valid_length bytes */
+    struct mseed3_hash64_s valid_state;
+};
+
+/* Outcome of looking up a file in the cache */
+enum cache_lookup_e
+{
+    CACHE_MISS = 0,
+    CACHE_UNCHANGED, /* the cached verdict applies */
+    CACHE_APPENDED   /* the valid records are unchanged, only the bytes after valid_length need checking */
+};
+
+/* Verdicts of earlier runs, see validation_cache_open() */
+struct validation_cache_s
+{
+    char *path;
+    char *journal_path;
+    int journal_fd;
+    uint64_t schema_hash;
+
+    struct cache_entry_s *entries;
+    int entry_cnt;
+    int entry_alloc;
+
+    /* Open addressing index of entries by path, entry index + 1, 0 when empty */
+    uint32_t *slots;
+    size_t slot_cnt;
+
+    /* Files found in the journal of an interrupted run */
+    uint32_t resumed;
+};
+
+uint64_t validation_cache_config_hash(const struct schema_registry_s *schema, const struct extra_options_s *options);
+
+int validation_cache_open(struct validation_cache_s *cache, const char *path, uint64_t schema_hash);
+
+int validation_cache_identify(FILE *file, const char *file_name, struct cache_entry_s *entry);
+
+enum cache_lookup_e validation_cache_lookup(const struct validation_cache_s *cache, FILE *file,
+                                           struct cache_entry_s *entry);
+
+void validation_cache_record(struct validation_cache_s *cache, const struct cache_entry_s *entry);
+
+int validation_cache_close(struct validation_cache_s *cache);
+
+#endif /* __MSEED3VALIDATOR_VALIDATION_CACHE_H__ */
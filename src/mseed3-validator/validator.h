@@ -5,22 +5,119 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <mseed3-common/hash.h>
+
+#include "report.h"
+#include "schema_registry.h"
 #include "warnings.h"
 
 #define MSEED3_FIXED_HEADER_LEN 40
 
-bool check_file(struct extra_options_s *options, FILE *input, char *schema_file_name,
-                char *file_name, uint32_t *records, uint8_t verbose);
+/* Valid extra header verdicts remembered, in sets of EXTRA_HEADER_MEMO_WAYS entries picked by the hash */
+#define EXTRA_HEADER_MEMO_SETS 256u
+#define EXTRA_HEADER_MEMO_WAYS 4u
+
+/* Location of a record found by the fixed header pre-scan */
+struct record_entry_s
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+/* Leading records of a file already validated by an earlier run, see check_file().
+ * hash is the state after hashing the first offset bytes */
+struct check_resume_s
+{
+    uint64_t offset;
+    uint32_t records;
+    struct mseed3_hash64_s hash;
+};
+
+/* Hash of the bytes check_file() validated, kept by the cache.  The first
+ * valid_length bytes hold valid_records complete records found valid, with
+ * valid_hash their hash.  hashed is false for input that could not be
+ * mapped, which the caller hashes itself */
+struct check_digest_s
+{
+    uint64_t length;
+    uint64_t content_hash;
+    uint64_t valid_length;
+    uint32_t valid_records;
+    uint64_t valid_hash;
+    bool hashed;
+};
+
+/* Extra headers whose verdict was remembered, see check_extra_headers() */
+struct extra_header_memo_counts_s
+{
+    uint32_t hits;
+    uint32_t misses;
+};
+
+/* Extra header found valid, keyed on the hash of its bytes and the schema
+ * and engine that validated it.  used is 0 for empty entries */
+struct extra_header_memo_s
+{
+    uint64_t hash;
+    uint16_t length;
+    bool wjelement;
+    const struct schema_registry_s *schema;
+    uint32_t used;
+};
+
+/* Everything one validation reads and writes besides the records, see
+ * validator_context_open().  Contexts share nothing but the options and
+ * the schema, which are only read, so each thread may run its own with a
+ * report sink of its own.  Split-records workers each open one */
+struct validator_context_s
+{
+    struct extra_options_s *options;
+    struct schema_registry_s *schema;
+    struct report_s *report;
+    uint8_t verbose;
+
+    /* Verbosity handed to libmseed, which logs to stdout */
+    uint8_t libmseed_verbose;
+
+    /* Cleared by the WJElement error callback while an extra header is validated */
+    bool schema_valid;
 
-bool check_header(struct extra_options_s *options, FILE *input_file, long file_len, int64_t *file_pos,
+    /* Valid extra header verdicts, see check_extra_headers() */
+    struct extra_header_memo_s (*memo)[EXTRA_HEADER_MEMO_WAYS];
+    uint32_t memo_clock;
+    struct extra_header_memo_counts_s memo_counts;
+
+    /* Memory yyjson parses extra headers into, reused by every record */
+    void *document_pool;
+    size_t document_pool_size;
+};
+
+struct validator_context_s *validator_context_open(struct extra_options_s *options, struct schema_registry_s *schema,
+                                                   struct report_s *report, uint8_t verbose);
+
+void validator_context_close(struct validator_context_s *context);
+
+/* Called by check_buffer() with the bytes and verdict of each record */
+typedef void (*check_tally_f)(void *client, uint32_t recordNum, uint64_t offset, uint64_t length, bool valid);
+
+bool check_file(struct validator_context_s *context, FILE *input, char *file_name, uint32_t *records,
+                const struct check_resume_s *resume, struct check_digest_s *digest);
+
+bool check_buffer(struct validator_context_s *context, const char *data, uint64_t length, uint32_t *records,
+                  check_tally_f tally, void *client);
+
+bool check_header(struct validator_context_s *context, const char *record, uint64_t available,
                   uint8_t *identifier_len, uint16_t *extra_header_len, uint32_t *payload_len,
-                  uint8_t *payload_fmt, uint32_t recordNum, int8_t verbose);
+                  uint8_t *payload_fmt, uint32_t recordNum);
 
-bool check_identifier(struct extra_options_s *options, FILE *input, uint8_t identifier_len,
-                      uint32_t recordNum, uint8_t verbose);
+bool check_identifier(struct validator_context_s *context, const char *identifier, uint8_t identifier_len,
+                      uint32_t recordNum);
 
-bool check_extra_headers(struct extra_options_s *options, char *schema, FILE *input,
-                         uint16_t extra_header_len, uint32_t recordNum, uint8_t verbose);
+bool check_extra_headers(struct validator_context_s *context, const char *extra_headers, uint16_t extra_header_len,
+                         uint32_t recordNum);
+
+bool check_extra_headers_schema(struct validator_context_s *context, const char *extra_headers,
+                                uint16_t extra_header_len);
 
 bool
 check_payloads(struct extra_options_s *options, FILE *input, uint32_t payload_len,
@@ -29,6 +126,4 @@ check_payloads(struct extra_options_s *options, FILE *input, uint32_t payload_le
 
 bool check_payload_text(struct extra_options_s *options, uint32_t payload_len, char *buffer);
 
-bool is_valid_gbl;
-
 #endif /* __MSEED3VALIDATOR_VALIDATOR_H__ */
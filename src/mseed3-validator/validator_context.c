@@ -0,0 +1,79 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mseed3-common/crc32c.h>
+
+#include "report.h"
+#include "schema_registry.h"
+#include "validator.h"
+#include "warnings.h"
+
+/*! @brief Create the state of one validation
+ *
+ *  A context holds the error state, extra header memo and parse buffers of
+ *  the records it validates, and reports to its own sink.  Any number of
+ *  contexts may validate concurrently on separate threads, sharing the
+ *  options and the schema registry without locks: the registry resolves
+ *  every reference when opened and is only read afterwards.  The CRC-32C
+ *  kernel is picked here, before any context computes a CRC.
+ *
+ *  @param[in] options -W cmd line options
+ *  @param[in] schema json schema loaded by schema_registry_open(), or NULL
+ *  @param[in] report sink events are written to, used by this context only
+ *  @param[in] verbose verbosity level
+ *
+ *  @return context, NULL if out of memory
+ */
+struct validator_context_s *
+validator_context_open (struct extra_options_s *options, struct schema_registry_s *schema, struct report_s *report,
+                        uint8_t verbose)
+{
+  struct validator_context_s *context;
+
+  mseed3_crc32c_init ();
+
+  context = (struct validator_context_s *)calloc (1, sizeof (struct validator_context_s));
+
+  if (context == NULL)
+  {
+    return NULL;
+  }
+
+  context->memo = calloc (EXTRA_HEADER_MEMO_SETS, sizeof (*context->memo));
+
+  if (context->memo == NULL)
+  {
+    free (context);
+    return NULL;
+  }
+
+  context->options          = options;
+  context->schema           = schema;
+  context->report           = report;
+  context->verbose          = verbose;
+  context->libmseed_verbose = verbose;
+  context->schema_valid     = true;
+
+  return context;
+}
+
+/*! @brief Release a context returned by validator_context_open()
+ *
+ *  The options, schema and report sink are left to the caller.
+ *
+ *  @param[in] context context, or NULL
+ */
+void
+validator_context_close (struct validator_context_s *context)
+{
+  if (context == NULL)
+  {
+    return;
+  }
+
+  free (context->document_pool);
+  free (context->memo);
+  free (context);
+}
@@ -2,14 +2,25 @@
 #define __MSEED3VALIDATOR_WARNINGS_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /* Additional cmd line options:
  * treat_as_errors -> treats validation warnings as errors and halts program,
- * skip-payload -> skips payload validation */
+ * skip-payload -> skips payload validation,
+ * split-records -> validates the records of each file concurrently,
+ * resync -> resumes at the next intact record after a damaged one,
+ * cap -> maximum number of warnings and errors reported per check and file, 0 for no limit,
+ * wjelement -> parses and validates extra headers with WJElement instead of yyjson, from json=,
+ * jobs -> number of concurrent workers, from -J */
 struct extra_options_s
 {
     bool treat_as_errors;
     bool skip_payload;
+    bool split_records;
+    bool resync;
+    uint32_t cap;
+    bool wjelement;
+    int jobs;
 };
 
 bool parse_extra_options(struct extra_options_s *extra_options, char *string_parse);